@@ -0,0 +1,72 @@
+/* samaya-actions.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "samaya-actions.h"
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static void start_timer_action(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    SessionManagerPtr session_manager = user_data;
+
+    if (tm_get_state(session_manager->timer_instance) != StRunning) {
+        sm_trigger_event(session_manager, EvStart);
+    }
+}
+
+static void pause_timer_action(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    SessionManagerPtr session_manager = user_data;
+
+    if (tm_get_state(session_manager->timer_instance) == StRunning) {
+        sm_trigger_event(session_manager, EvStop);
+    }
+}
+
+static void skip_session_action(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    sm_skip_session();
+}
+
+static void extend_session_action(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+    sm_extend_completed_session(user_data, ACTIONS_EXTEND_SESSION_MINUTES);
+}
+
+static const GActionEntry timerActions[] = {
+    {"start-timer", start_timer_action},
+    {"pause-timer", pause_timer_action},
+    {"skip-session", skip_session_action},
+    {"extend-session", extend_session_action},
+};
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+void actions_add_timer_actions(GActionMap *map, SessionManagerPtr session_manager)
+{
+    g_action_map_add_action_entries(map, timerActions, G_N_ELEMENTS(timerActions),
+                                    session_manager);
+}
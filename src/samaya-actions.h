@@ -0,0 +1,36 @@
+/* samaya-actions.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "samaya-session.h"
+
+// Minutes the extend-session action adds to the session that ran out.
+#define ACTIONS_EXTEND_SESSION_MINUTES 5
+
+/*  Adds the timer actions the buttons of the completion notification activate to map:
+    start-timer, pause-timer, skip-session and extend-session.
+
+    They work on session_manager alone, so they never build or present a window, and they are safe
+    to activate over D-Bus while the application runs without one. extend-session resumes the
+    session that just ran out, see sm_extend_completed_session.
+*/
+void actions_add_timer_actions(GActionMap *map, SessionManagerPtr session_manager);
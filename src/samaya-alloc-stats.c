@@ -0,0 +1,148 @@
+/* samaya-alloc-stats.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include "samaya-alloc-stats.h"
+
+#if defined(__GLIBC__)
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *pointer);
+
+static guint64 total_allocations = 0;
+static gint64 live_allocations = 0;
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static void *count_allocation(void *pointer)
+{
+    __atomic_fetch_add(&total_allocations, 1, __ATOMIC_RELAXED);
+
+    if (pointer != NULL) {
+        __atomic_fetch_add(&live_allocations, 1, __ATOMIC_RELAXED);
+    }
+    return pointer;
+}
+
+
+/* ============================================================================
+ * Allocator Wrappers
+ * ============================================================================ */
+
+void *malloc(size_t size)
+{
+    return count_allocation(__libc_malloc(size));
+}
+
+void *calloc(size_t count, size_t size)
+{
+    return count_allocation(__libc_calloc(count, size));
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    if (pointer == NULL) {
+        return count_allocation(__libc_realloc(pointer, size));
+    }
+
+    // Resizing counts as an allocation, but the block stays the same one.
+    __atomic_fetch_add(&total_allocations, 1, __ATOMIC_RELAXED);
+    void *result = __libc_realloc(pointer, size);
+
+    // glibc frees the block and returns NULL when resizing to zero.
+    if (size == 0 && result == NULL) {
+        __atomic_fetch_sub(&live_allocations, 1, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return count_allocation(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+
+    void *result = count_allocation(__libc_memalign(alignment, size));
+    if (result == NULL) {
+        return ENOMEM;
+    }
+
+    *pointer = result;
+    return 0;
+}
+
+void free(void *pointer)
+{
+    if (pointer != NULL) {
+        __atomic_fetch_sub(&live_allocations, 1, __ATOMIC_RELAXED);
+    }
+    __libc_free(pointer);
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+gboolean alloc_stats_supported(void)
+{
+    return TRUE;
+}
+
+guint64 alloc_stats_get_total(void)
+{
+    return __atomic_load_n(&total_allocations, __ATOMIC_RELAXED);
+}
+
+gint64 alloc_stats_get_live(void)
+{
+    return __atomic_load_n(&live_allocations, __ATOMIC_RELAXED);
+}
+
+#else
+
+gboolean alloc_stats_supported(void)
+{
+    return FALSE;
+}
+
+guint64 alloc_stats_get_total(void)
+{
+    return 0;
+}
+
+gint64 alloc_stats_get_live(void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,39 @@
+/* samaya-alloc-stats.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+/*  Heap allocation counts of the whole process, GLib and GTK included, for samaya-bench and
+    samaya-soak.
+
+    Linking samaya-alloc-stats.c replaces malloc and its relatives with counting wrappers around
+    the allocator glibc also exports under __libc_ names, so it is only linked into those tools.
+    Without glibc nothing is counted and alloc_stats_supported returns FALSE.
+*/
+
+gboolean alloc_stats_supported(void);
+
+// Allocations made since the process started: every malloc, calloc, realloc and aligned one.
+guint64 alloc_stats_get_total(void);
+
+// Blocks allocated and not freed yet.
+gint64 alloc_stats_get_live(void);
@@ -19,9 +19,23 @@
  */
 
 #include <glib/gi18n.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "samaya-actions.h"
 #include "samaya-application.h"
+#include "samaya-heatmap-dialog.h"
+#include "samaya-history-dialog.h"
+#include "samaya-history.h"
+#include "samaya-hooks.h"
+#include "samaya-journal.h"
+#include "samaya-launcher.h"
+#include "samaya-metrics.h"
+#include "samaya-noise.h"
 #include "samaya-preferences-dialog.h"
+#include "samaya-schedule.h"
 #include "samaya-session.h"
+#include "samaya-status.h"
+#include "samaya-tray.h"
 #include "samaya-window.h"
 
 struct _SamayaApplication
@@ -29,8 +43,26 @@ struct _SamayaApplication
     AdwApplication parent_instance;
 
     SessionManagerPtr samayaSessionManager;
+    SchedulePtr schedule;
+    HooksPtr hooks;
+    StatusPagePtr status_page;
+    MetricsServerPtr metrics_server;
+    TrayPtr tray;
+    LauncherPtr launcher;
+    JournalPtr journal;
+
+    GSettings *settings;
+    guint settings_apply_id;
+
+    // Holds that keep the application running without a window, see on_session_state_changed.
+    gboolean session_hold;
+    guint notification_hold_id;
 };
 
+// How long the application stays around after a session ends without a window, so the buttons
+// of the completion notification still reach this instance and its session state.
+#define NOTIFICATION_HOLD_SECONDS (10 * 60)
+
 G_DEFINE_FINAL_TYPE(SamayaApplication, samaya_application, ADW_TYPE_APPLICATION)
 
 /* ============================================================================
@@ -48,6 +80,28 @@ static void samaya_application_preferences_action(GSimpleAction *action, GVarian
     adw_dialog_present(ADW_DIALOG(dialog), GTK_WIDGET(window));
 }
 
+static void samaya_application_focus_history_action(GSimpleAction *action, GVariant *parameter,
+                                                    gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+    GtkWindow *window = gtk_application_get_active_window(GTK_APPLICATION(self));
+
+    SamayaHeatmapDialog *dialog = samaya_heatmap_dialog_new();
+
+    adw_dialog_present(ADW_DIALOG(dialog), GTK_WIDGET(window));
+}
+
+static void samaya_application_session_history_action(GSimpleAction *action, GVariant *parameter,
+                                                      gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+    GtkWindow *window = gtk_application_get_active_window(GTK_APPLICATION(self));
+
+    SamayaHistoryDialog *dialog = samaya_history_dialog_new();
+
+    adw_dialog_present(ADW_DIALOG(dialog), GTK_WIDGET(window));
+}
+
 static void samaya_application_about_action(GSimpleAction *action, GVariant *parameter,
                                             gpointer user_data)
 {
@@ -90,10 +144,206 @@ static void samaya_application_quit_action(GSimpleAction *action, GVariant *para
     g_application_quit(G_APPLICATION(self));
 }
 
+static gboolean release_notification_hold(gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+
+    self->notification_hold_id = 0;
+    g_application_release(G_APPLICATION(self));
+
+    return G_SOURCE_REMOVE;
+}
+
+// A running session keeps the application, and with it the timer, alive after the window closed.
+static void on_session_state_changed(SessionManagerPtr session_manager, gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+    gboolean running = (tm_get_state(session_manager->timer_instance) == StRunning);
+
+    if (running == self->session_hold) {
+        return;
+    }
+
+    self->session_hold = running;
+
+    if (running) {
+        g_application_hold(G_APPLICATION(self));
+    } else {
+        g_application_release(G_APPLICATION(self));
+    }
+}
+
+static void on_session_completed(SessionManagerPtr session_manager, gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+
+    // Only a session that ran out sends a notification.
+    if (session_manager->last_session_skipped) {
+        return;
+    }
+
+    if (self->notification_hold_id == 0) {
+        g_application_hold(G_APPLICATION(self));
+    } else {
+        g_source_remove(self->notification_hold_id);
+    }
+
+    self->notification_hold_id =
+        g_timeout_add_seconds(NOTIFICATION_HOLD_SECONDS, release_notification_hold, self);
+}
+
+static void on_schedule_changed(GSettings *settings, const char *key, gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+
+    g_autoptr(GVariant) blocks = g_settings_get_value(settings, "schedule");
+    schedule_load(self->schedule, blocks);
+}
+
+// Settings mirrored into the session manager by apply_session_settings.
+static const char *const sessionSettingKeys[] = {
+    "work-duration",
+    "short-break-duration",
+    "long-break-duration",
+    "sessions-to-complete",
+    "auto-start-breaks",
+    "auto-start-work",
+    "ticking-sound",
+    "ambient-noise",
+    "ambient-noise-breaks",
+};
+
+/*  Brings the session manager in line with GSettings. Only setters whose value differs are
+    called, as changing the duration of the current routine resets the running session.
+*/
+static gboolean apply_session_settings(gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+    SessionManagerPtr session_manager = self->samayaSessionManager;
+    GSettings *settings = self->settings;
+
+    self->settings_apply_id = 0;
+
+    gfloat work_duration = (gfloat) g_settings_get_double(settings, "work-duration");
+    if (work_duration != (gfloat) sm_get_work_duration(session_manager)) {
+        sm_set_work_duration(session_manager, work_duration);
+    }
+
+    gfloat short_break_duration = (gfloat) g_settings_get_double(settings, "short-break-duration");
+    if (short_break_duration != (gfloat) sm_get_short_break_duration(session_manager)) {
+        sm_set_short_break_duration(session_manager, short_break_duration);
+    }
+
+    gfloat long_break_duration = (gfloat) g_settings_get_double(settings, "long-break-duration");
+    if (long_break_duration != (gfloat) sm_get_long_break_duration(session_manager)) {
+        sm_set_long_break_duration(session_manager, long_break_duration);
+    }
+
+    guint16 sessions;
+    g_settings_get(settings, "sessions-to-complete", "q", &sessions);
+    if (sessions != (guint16) sm_get_sessions_to_complete(session_manager)) {
+        sm_set_sessions_to_complete(session_manager, sessions);
+    }
+
+    gboolean auto_breaks = g_settings_get_boolean(settings, "auto-start-breaks");
+    if (auto_breaks != sm_get_auto_start_breaks(session_manager)) {
+        sm_set_auto_start_breaks(session_manager, auto_breaks);
+    }
+
+    gboolean auto_work = g_settings_get_boolean(settings, "auto-start-work");
+    if (auto_work != sm_get_auto_start_work(session_manager)) {
+        sm_set_auto_start_work(session_manager, auto_work);
+    }
+
+    gboolean ticking_sound = g_settings_get_boolean(settings, "ticking-sound");
+    if (ticking_sound != sm_get_ticking_sound(session_manager)) {
+        sm_set_ticking_sound(session_manager, ticking_sound);
+    }
+
+    g_autofree gchar *ambient_noise = g_settings_get_string(settings, "ambient-noise");
+    NoiseColor noise_color = noise_color_from_nick(ambient_noise);
+    if (noise_color != sm_get_ambient_noise(session_manager)) {
+        sm_set_ambient_noise(session_manager, noise_color);
+    }
+
+    gboolean noise_breaks = g_settings_get_boolean(settings, "ambient-noise-breaks");
+    if (noise_breaks != sm_get_ambient_noise_breaks(session_manager)) {
+        sm_set_ambient_noise_breaks(session_manager, noise_breaks);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+// A burst of changes, like a spin row being dragged or a dconf load, is applied once.
+static void on_session_setting_changed(GSettings *settings, const char *key, gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+
+    if (self->settings_apply_id == 0) {
+        self->settings_apply_id = g_idle_add(apply_session_settings, self);
+    }
+}
+
+// The tray icon is exported on the connection of the primary instance, so it can only be created
+// once the application is registered.
+static void on_tray_icon_changed(GSettings *settings, const char *key, gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+    GDBusConnection *connection = g_application_get_dbus_connection(G_APPLICATION(self));
+
+    if (!g_settings_get_boolean(settings, "tray-icon")) {
+        g_clear_pointer(&self->tray, tray_free);
+    } else if (self->tray == NULL && connection != NULL) {
+        self->tray = tray_new(self->samayaSessionManager, G_APPLICATION(self), connection);
+    }
+}
+
+static const char *const hookSettingKeys[N_HOOK_EVENTS] = {
+    [HookWorkStart] = "hook-work-start",
+    [HookBreakStart] = "hook-break-start",
+    [HookPause] = "hook-pause",
+    [HookComplete] = "hook-complete",
+};
+
+static void on_hooks_changed(GSettings *settings, const char *key, gpointer user_data)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(user_data);
+
+    for (guint i = 0; i < N_HOOK_EVENTS; i++) {
+        g_autofree gchar *command = g_settings_get_string(settings, hookSettingKeys[i]);
+        hooks_set_command(self->hooks, i, command);
+    }
+
+    GVariant *max_concurrent_variant = g_settings_get_value(settings, "hook-max-concurrent");
+    guint16 max_concurrent = g_variant_get_uint16(max_concurrent_variant);
+    g_variant_unref(max_concurrent_variant);
+
+    hooks_set_limits(self->hooks, max_concurrent, g_settings_get_uint(settings, "hook-timeout"));
+}
+
+static const GOptionEntry cmdOptions[] = {
+    {"export", 0, 0, G_OPTION_ARG_NONE, NULL,
+     N_("Write the session history to standard output and exit"), NULL},
+    {"format", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Export format, csv (default) or jsonl"),
+     N_("FORMAT")},
+    {"since", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Only export sessions started on or after DATE"),
+     N_("YYYY-MM-DD")},
+    {"until", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Only export sessions started on or before DATE"),
+     N_("YYYY-MM-DD")},
+    {"journal", 0, 0, G_OPTION_ARG_FILENAME, NULL,
+     N_("Record timer input and ticks to FILE, to reproduce a run with samaya-replay"), N_("FILE")},
+    {"metrics", 0, 0, G_OPTION_ARG_NONE, NULL,
+     N_("Print the runtime metrics of the running instance in the OpenMetrics format and exit"),
+     NULL},
+    G_OPTION_ENTRY_NULL,
+};
+
 static const GActionEntry appActions[] = {
     {"quit", samaya_application_quit_action},
     {"about", samaya_application_about_action},
     {"preferences", samaya_application_preferences_action},
+    {"focus-history", samaya_application_focus_history_action},
+    {"session-history", samaya_application_session_history_action},
 };
 
 SamayaApplication *samaya_application_new(const char *application_id, GApplicationFlags flags)
@@ -104,10 +354,186 @@ SamayaApplication *samaya_application_new(const char *application_id, GApplicati
                         "resource-base-path", "/io/github/redddfoxxyy/samaya", NULL);
 }
 
+/*  Replaces the monitor used to decide whether the timer should run in low power mode.
+
+    Passing NULL stops watching the power profile and restores full fidelity. Mainly useful to
+    drive the low power path with a fake GPowerProfileMonitor implementation.
+*/
+void samaya_application_set_power_profile_monitor(SamayaApplication *self,
+                                                  GPowerProfileMonitor *monitor)
+{
+    g_return_if_fail(SAMAYA_IS_APPLICATION(self));
+
+    sm_set_power_profile_monitor(self->samayaSessionManager, monitor);
+}
+
+// Parses a local YYYY-MM-DD date option into unix seconds, either the first or the last second of
+// that day. Leaves the output untouched if the option was not passed.
+static gboolean parse_date_option(GVariantDict *options, const char *key, gboolean end_of_day,
+                                  gint64 *unix_seconds)
+{
+    const char *value = NULL;
+    if (!g_variant_dict_lookup(options, key, "&s", &value)) {
+        return TRUE;
+    }
+
+    int year, month, day;
+    char trailing;
+    g_autoptr(GDateTime) date = NULL;
+
+    if (sscanf(value, "%d-%d-%d%c", &year, &month, &day, &trailing) == 3) {
+        date = g_date_time_new_local(year, month, day, 0, 0, 0);
+    }
+
+    if (date == NULL) {
+        g_printerr(_("Invalid date for --%s: %s, expected YYYY-MM-DD\n"), key, value);
+        return FALSE;
+    }
+
+    if (end_of_day) {
+        g_autoptr(GDateTime) next_day = g_date_time_add_days(date, 1);
+        *unix_seconds = g_date_time_to_unix(next_day) - 1;
+    } else {
+        *unix_seconds = g_date_time_to_unix(date);
+    }
+
+    return TRUE;
+}
+
+// Handles --export in the local instance, so no GTK display or primary instance is needed.
+static gint export_history(GVariantDict *options)
+{
+    HistoryFormat format = HistoryFormatCsv;
+    const char *format_name = NULL;
+    gint64 since = 0;
+    gint64 until = G_MAXINT64;
+
+    if (g_variant_dict_lookup(options, "format", "&s", &format_name)) {
+        if (g_strcmp0(format_name, "csv") == 0) {
+            format = HistoryFormatCsv;
+        } else if (g_strcmp0(format_name, "jsonl") == 0) {
+            format = HistoryFormatJsonLines;
+        } else {
+            g_printerr(_("Unknown export format: %s, expected csv or jsonl\n"), format_name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!parse_date_option(options, "since", FALSE, &since) ||
+        !parse_date_option(options, "until", TRUE, &until)) {
+        return EXIT_FAILURE;
+    }
+
+    g_autoptr(GError) error = NULL;
+    if (!history_export(stdout, format, since, until, &error)) {
+        g_printerr(_("Failed to export history: %s\n"), error->message);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Handles --metrics in the local instance by reading the socket the primary instance serves.
+static gint print_metrics(void)
+{
+    g_autoptr(GError) error = NULL;
+    g_autofree gchar *text = metrics_fetch(&error);
+
+    if (text == NULL) {
+        g_printerr(_("Failed to read metrics, is Samaya running? %s\n"), error->message);
+        return EXIT_FAILURE;
+    }
+
+    fputs(text, stdout);
+    return EXIT_SUCCESS;
+}
+
+static gint samaya_application_handle_local_options(GApplication *app, GVariantDict *options)
+{
+    SamayaApplication *self = SAMAYA_APPLICATION(app);
+    const char *journal_path = NULL;
+
+    if (g_variant_dict_contains(options, "export")) {
+        return export_history(options);
+    }
+
+    if (g_variant_dict_contains(options, "metrics")) {
+        return print_metrics();
+    }
+
+    if (g_variant_dict_lookup(options, "journal", "^&ay", &journal_path)) {
+        g_autoptr(GError) error = NULL;
+
+        // Opening truncates the file, which only the primary instance, running the timer, may do.
+        if (!g_application_register(app, NULL, &error)) {
+            g_printerr(_("Failed to register the application: %s\n"), error->message);
+            return EXIT_FAILURE;
+        }
+
+        if (g_application_get_is_remote(app)) {
+            g_printerr(_("Samaya is already running, --journal only applies when starting it\n"));
+            return EXIT_FAILURE;
+        }
+
+        self->journal = journal_open(journal_path, &error);
+        if (self->journal == NULL) {
+            g_printerr(_("Failed to open journal: %s\n"), error->message);
+            return EXIT_FAILURE;
+        }
+
+        sm_set_journal(self->samayaSessionManager, self->journal);
+    }
+
+    return -1;
+}
+
+// Called from startup, so --export and --metrics, which return from handle_local_options, and
+// remote instances never set up a session.
+static void init_session_manager(SamayaApplication *self)
+{
+    GSettings *settings = self->settings;
+
+    // Connected before the keys are read, a change in between would not be signalled otherwise.
+    for (guint i = 0; i < G_N_ELEMENTS(sessionSettingKeys); i++) {
+        g_autofree gchar *signal_name = g_strconcat("changed::", sessionSettingKeys[i], NULL);
+        g_signal_connect(settings, signal_name, G_CALLBACK(on_session_setting_changed), self);
+    }
+
+    g_signal_connect(settings, "changed::tray-icon", G_CALLBACK(on_tray_icon_changed), self);
+
+    GVariant *sessions_variant = g_settings_get_value(settings, "sessions-to-complete");
+    guint16 sessions = g_variant_get_uint16(sessions_variant);
+    g_variant_unref(sessions_variant);
+
+    gdouble work_duration = g_settings_get_double(settings, "work-duration");
+    gdouble short_break_duration = g_settings_get_double(settings, "short-break-duration");
+    gdouble long_break_duration = g_settings_get_double(settings, "long-break-duration");
+    gboolean auto_breaks = g_settings_get_boolean(settings, "auto-start-breaks");
+    gboolean auto_work = g_settings_get_boolean(settings, "auto-start-work");
+    gboolean ticking_sound = g_settings_get_boolean(settings, "ticking-sound");
+    g_autofree gchar *ambient_noise = g_settings_get_string(settings, "ambient-noise");
+    gboolean noise_breaks = g_settings_get_boolean(settings, "ambient-noise-breaks");
+
+    self->samayaSessionManager = sm_init(sessions, work_duration, short_break_duration,
+                                         long_break_duration, auto_breaks, auto_work, NULL, self);
+    sm_set_ticking_sound(self->samayaSessionManager, ticking_sound);
+    sm_set_ambient_noise_breaks(self->samayaSessionManager, noise_breaks);
+    sm_set_ambient_noise(self->samayaSessionManager, noise_color_from_nick(ambient_noise));
+    actions_add_timer_actions(G_ACTION_MAP(self), self->samayaSessionManager);
+
+    sm_connect_state_changed(self->samayaSessionManager, on_session_state_changed, self);
+    sm_connect_session_complete(self->samayaSessionManager, on_session_completed, self);
+
+    g_autoptr(GPowerProfileMonitor) power_monitor = g_power_profile_monitor_dup_default();
+    samaya_application_set_power_profile_monitor(self, power_monitor);
+}
+
 static void samaya_application_startup(GApplication *app)
 {
     G_APPLICATION_CLASS(samaya_application_parent_class)->startup(app);
 
+    init_session_manager(SAMAYA_APPLICATION(app));
+
     GtkCssProvider *provider = gtk_css_provider_new();
     gtk_css_provider_load_from_resource(provider, "/io/github/redddfoxxyy/samaya/samaya-style.css");
 
@@ -116,6 +542,38 @@ static void samaya_application_startup(GApplication *app)
                                                GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
 
     g_object_unref(provider);
+
+    SamayaApplication *self = SAMAYA_APPLICATION(app);
+    GSettings *settings = self->settings;
+    on_tray_icon_changed(settings, "tray-icon", self);
+
+    /*  Only the primary instance gets here, a remote one forwards its command line and exits. So
+        it alone runs the schedule and the hooks, and owns the status page a remote instance would
+        otherwise take over and mark as exited.
+    */
+    self->schedule = schedule_new();
+    g_signal_connect(settings, "changed::schedule", G_CALLBACK(on_schedule_changed), self);
+    on_schedule_changed(settings, "schedule", self);
+
+    self->hooks = hooks_new(self->samayaSessionManager);
+    for (guint i = 0; i < N_HOOK_EVENTS; i++) {
+        g_autofree gchar *signal_name = g_strconcat("changed::", hookSettingKeys[i], NULL);
+        g_signal_connect(settings, signal_name, G_CALLBACK(on_hooks_changed), self);
+    }
+    g_signal_connect(settings, "changed::hook-max-concurrent", G_CALLBACK(on_hooks_changed), self);
+    g_signal_connect(settings, "changed::hook-timeout", G_CALLBACK(on_hooks_changed), self);
+    on_hooks_changed(settings, NULL, self);
+
+    self->status_page = status_page_new(self->samayaSessionManager);
+
+    GDBusConnection *connection = g_application_get_dbus_connection(app);
+    if (connection != NULL) {
+        self->launcher = launcher_new(self->samayaSessionManager,
+                                      g_application_get_application_id(app), connection);
+    }
+
+    // Likewise the metrics socket.
+    self->metrics_server = metrics_server_new();
 }
 
 static void samaya_application_activate(GApplication *app)
@@ -137,11 +595,25 @@ static void samaya_application_dispose(GObject *object)
 {
     SamayaApplication *self = SAMAYA_APPLICATION(object);
 
+    g_clear_handle_id(&self->notification_hold_id, g_source_remove);
+    g_clear_handle_id(&self->settings_apply_id, g_source_remove);
+
+    g_clear_object(&self->settings);
+    g_clear_pointer(&self->schedule, schedule_free);
+    g_clear_pointer(&self->hooks, hooks_free);
+    g_clear_pointer(&self->status_page, status_page_free);
+    g_clear_pointer(&self->metrics_server, metrics_server_free);
+    g_clear_pointer(&self->tray, tray_free);
+    g_clear_pointer(&self->launcher, launcher_free);
+
     if (self->samayaSessionManager) {
         sm_deinit(self->samayaSessionManager);
         self->samayaSessionManager = NULL;
     }
 
+    // Only after the timer thread, which records ticks, has been stopped.
+    g_clear_pointer(&self->journal, journal_close);
+
     G_OBJECT_CLASS(samaya_application_parent_class)->dispose(object);
 }
 
@@ -150,6 +622,7 @@ static void samaya_application_class_init(SamayaApplicationClass *klass)
     GApplicationClass *app_class = G_APPLICATION_CLASS(klass);
     GObjectClass *object_class = G_OBJECT_CLASS(klass);
 
+    app_class->handle_local_options = samaya_application_handle_local_options;
     app_class->startup = samaya_application_startup;
     app_class->activate = samaya_application_activate;
     object_class->dispose = samaya_application_dispose;
@@ -157,27 +630,12 @@ static void samaya_application_class_init(SamayaApplicationClass *klass)
 
 static void samaya_application_init(SamayaApplication *self)
 {
+    g_application_add_main_option_entries(G_APPLICATION(self), cmdOptions);
     g_action_map_add_action_entries(G_ACTION_MAP(self), appActions, G_N_ELEMENTS(appActions), self);
     gtk_application_set_accels_for_action(GTK_APPLICATION(self), "app.quit",
                                           (const char *[]) {"<control>q", NULL});
     gtk_application_set_accels_for_action(GTK_APPLICATION(self), "app.preferences",
                                           (const char *[]) {"<control>comma", NULL});
 
-    // TODO: Convert the given block of code till line 163 into a function.
-    GSettings *settings = g_settings_new("io.github.redddfoxxyy.samaya");
-
-    GVariant *sessions_variant = g_settings_get_value(settings, "sessions-to-complete");
-    guint16 sessions = g_variant_get_uint16(sessions_variant);
-    g_variant_unref(sessions_variant);
-
-    gdouble work_duration = g_settings_get_double(settings, "work-duration");
-    gdouble short_break_duration = g_settings_get_double(settings, "short-break-duration");
-    gdouble long_break_duration = g_settings_get_double(settings, "long-break-duration");
-    gboolean auto_breaks = g_settings_get_boolean(settings, "auto-start-breaks");
-    gboolean auto_work = g_settings_get_boolean(settings, "auto-start-work");
-
-    self->samayaSessionManager = sm_init(sessions, work_duration, short_break_duration,
-                                         long_break_duration, auto_breaks, auto_work, NULL, self);
-
-    g_object_unref(settings);
+    self->settings = g_settings_new("io.github.redddfoxxyy.samaya");
 }
@@ -30,4 +30,7 @@ G_DECLARE_FINAL_TYPE(SamayaApplication, samaya_application, SAMAYA, APPLICATION,
 
 SamayaApplication *samaya_application_new(const char *application_id, GApplicationFlags flags);
 
+void samaya_application_set_power_profile_monitor(SamayaApplication *self,
+                                                  GPowerProfileMonitor *monitor);
+
 G_END_DECLS
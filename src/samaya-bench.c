@@ -0,0 +1,917 @@
+/* samaya-bench.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  Microbenchmarks for the timer, session manager, history browser and ambient noise hot paths.
+
+    Every benchmark is calibrated until a round takes at least --min-time milliseconds, then
+    measured over several rounds, and the median is reported. Timers run on a virtual clock and
+    the session manager headless, so results do not depend on wall time, sound or the desktop.
+    Results are printed as a single JSON object for tracking and comparing builds.
+
+    The running tick path must not allocate: timer/tick, timer/progress, timer/snapshot,
+    session/format-time and session/hour make the tool exit with a failure if a measured round
+    allocates. Allocations are only counted on glibc, elsewhere allocs_per_op is null.
+
+    The history benchmarks run over a million sessions and report frame_us, the longest an op kept
+    the UI thread busy: opening the model, a frame of scrolling or of dragging the scrollbar, and a
+    filter change up to the moment the list has its new rows. The tool fails if it exceeds a 60 Hz
+    frame. Rows are fetched from the model the way the list view does, no widgets are drawn.
+
+    timer/session-seconds and timer/session-minutes run whole sessions at either tick interval,
+    and also report the wakeups each session took and the worst distance between a deadline and
+    the moment its session completed. The tool fails if a session woke up more than once per
+    interval, or completed anywhere but on its deadline.
+
+    ring/sample-draw-time and ring/sample-presented feed the progress ring one 60 Hz frame per op
+    through a 25 minute session, the first reading the timer whenever the frame is drawn, a few
+    jittery milliseconds before it is shown, the second sampling the snapshot at the time the frame
+    is presented like the window does. They report the coefficient of variation of the steps the
+    arc takes between frames, 0 for perfectly even motion. The tool fails if the steps of
+    ring/sample-presented vary by more than a percent.
+
+    timer/tick-contended doubles as a stress test of tm_snapshot, it aborts if a reader thread
+    ever sees a torn snapshot. Configure with -Db_sanitize=thread to run it under ThreadSanitizer.
+
+    launcher/day also checks the launcher entry. A second connection on a private bus listens to
+    its updates like a dock would, and the benchmark aborts if an update changed nothing a dock
+    shows or carried an unquantized progress. It needs dbus-daemon to start the bus.
+
+    The noise benchmarks render one second of audio per op, so ns_per_op divided by 10^7 is the
+    share of one core the ambient noise takes, in percent.
+*/
+
+#include <glib/gstdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "samaya-alloc-stats.h"
+#include "samaya-history-model.h"
+#include "samaya-launcher.h"
+#include "samaya-metrics.h"
+#include "samaya-noise.h"
+#include "samaya-session.h"
+#include "samaya-timer.h"
+
+#define BENCH_ROUNDS 5
+#define BENCH_DAY_US (16 * G_GINT64_CONSTANT(3600) * G_USEC_PER_SEC)
+#define BENCH_SNAPSHOT_READERS 3
+#define BENCH_HISTORY_RECORDS 1000000
+// Rows a tall history dialog binds when it scrolls a full screen.
+#define BENCH_HISTORY_ROWS_PER_FRAME 40
+#define BENCH_APP_ID "io.github.redddfoxxyy.samaya"
+#define BENCH_NOISE_SAMPLE_RATE 48000
+// A 10 ms period, a common size for the buffers an audio callback is asked to fill.
+#define BENCH_NOISE_PERIOD_FRAMES 480
+#define BENCH_FRAME_US 16667
+// Frames are drawn between 4 and 12 ms before they are shown.
+#define BENCH_FRAME_LATENCY_US 4000
+#define BENCH_FRAME_JITTER_US 8000
+// The ring restarts its session after 10 minutes of frames, well before it runs out.
+#define BENCH_FRAMES_PER_SESSION 36000
+// Sampling at presentation measures around 0.003, reading the timer when drawing around 0.12.
+#define BENCH_MAX_FRAME_STEP_CV 0.01
+
+typedef struct
+{
+    TimerPtr timer;
+    SessionManagerPtr session_manager;
+    gint64 now_us;
+
+    GThread *snapshot_readers[BENCH_SNAPSHOT_READERS];
+    gint snapshot_readers_stop;
+    guint64 torn_snapshots;
+
+    guint64 wakeups;
+    gint64 completion_error_us;
+
+    gint64 presented_us;
+    guint64 frames;
+    gfloat last_frame_progress;
+    guint64 frame_steps;
+    gdouble frame_step_sum;
+    gdouble frame_step_square_sum;
+
+    gchar *history_dir;
+    SamayaHistoryModel *history_model;
+    guint history_position;
+    gint64 worst_frame_us;
+
+    GTestDBus *bus;
+    GDBusConnection *launcher_connection;
+    GDBusConnection *listener_connection;
+    LauncherPtr launcher;
+    guint launcher_subscription;
+    guint64 launcher_updates;
+    guint64 bad_launcher_updates;
+    gdouble last_progress;
+    gboolean last_progress_visible;
+    gint64 last_count;
+
+    NoiseGeneratorPtr noise;
+    gfloat noise_period[BENCH_NOISE_PERIOD_FRAMES];
+} BenchState;
+
+typedef struct
+{
+    const char *name;
+    void (*setup)(BenchState *state);
+    void (*run)(BenchState *state, guint64 iterations);
+    void (*teardown)(BenchState *state);
+
+    // The benchmark fails if a measured round allocates, where allocations can be counted.
+    gboolean allocation_free;
+
+    // The benchmark fails if what an op does on the UI thread takes longer than a 60 Hz frame.
+    gboolean frame_bound;
+
+    // For benchmarks running whole sessions, the benchmark fails if a session took more wakeups.
+    guint max_wakeups_per_op;
+
+    // For benchmarks drawing the ring, the benchmark fails if its steps vary more than this.
+    gdouble max_frame_step_cv;
+} Benchmark;
+
+
+/* ============================================================================
+ * Benchmarks
+ * ============================================================================ */
+
+static gint64 bench_clock(gpointer state_ptr)
+{
+    BenchState *state = state_ptr;
+    return state->now_us;
+}
+
+static void setup_nothing(BenchState *state)
+{
+}
+
+static void teardown_nothing(BenchState *state)
+{
+}
+
+static void setup_timer(BenchState *state)
+{
+    // Long enough to never run out while a benchmark ticks it.
+    state->timer = tm_new(60 * 24 * 365, NULL, NULL, NULL);
+    tm_set_clock(state->timer, bench_clock, state);
+}
+
+static void setup_session_timer(BenchState *state, guint64 tick_interval_ms)
+{
+    state->timer = tm_new(25, NULL, NULL, NULL);
+    tm_set_clock(state->timer, bench_clock, state);
+    tm_set_tick_interval(state->timer, tick_interval_ms);
+}
+
+static void setup_seconds_timer(BenchState *state)
+{
+    setup_session_timer(state, TM_TICK_INTERVAL_SECONDS);
+}
+
+static void setup_minutes_timer(BenchState *state)
+{
+    setup_session_timer(state, TM_TICK_INTERVAL_MINUTES);
+}
+
+static void setup_running_timer(BenchState *state)
+{
+    setup_timer(state);
+    tm_trigger_event(state->timer, EvStart);
+}
+
+static void teardown_timer(BenchState *state)
+{
+    tm_free(state->timer);
+}
+
+/*  Reads snapshots of the benchmark timer as fast as it can while the benchmark ticks it. Every
+    tick publishes the remaining time and the progress computed from it together, so a snapshot
+    where they disagree mixes two ticks.
+*/
+static gpointer read_snapshots(gpointer state_ptr)
+{
+    BenchState *state = state_ptr;
+    TmSnapshot snapshot;
+
+    while (!g_atomic_int_get(&state->snapshot_readers_stop)) {
+        tm_snapshot(state->timer, &snapshot);
+
+        if (snapshot.state != StRunning || snapshot.remaining_ms > snapshot.duration_ms ||
+            snapshot.progress != (gfloat) snapshot.remaining_ms / (gfloat) snapshot.duration_ms) {
+            __atomic_fetch_add(&state->torn_snapshots, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    return NULL;
+}
+
+static void setup_contended_timer(BenchState *state)
+{
+    setup_running_timer(state);
+
+    for (guint i = 0; i < BENCH_SNAPSHOT_READERS; i++) {
+        state->snapshot_readers[i] = g_thread_new("samaya-bench-reader", read_snapshots, state);
+    }
+}
+
+static void teardown_contended_timer(BenchState *state)
+{
+    g_atomic_int_set(&state->snapshot_readers_stop, TRUE);
+    for (guint i = 0; i < BENCH_SNAPSHOT_READERS; i++) {
+        g_thread_join(state->snapshot_readers[i]);
+    }
+
+    if (state->torn_snapshots > 0) {
+        g_error("%" G_GUINT64_FORMAT " torn timer snapshots", state->torn_snapshots);
+    }
+
+    teardown_timer(state);
+}
+
+static void setup_session(BenchState *state)
+{
+    state->session_manager = sm_init(4, 25, 5, 15, TRUE, TRUE, NULL, NULL);
+    state->timer = state->session_manager->timer_instance;
+
+    sm_set_headless(state->session_manager, TRUE);
+    tm_set_clock(state->timer, bench_clock, state);
+}
+
+static void setup_running_session(BenchState *state)
+{
+    setup_session(state);
+
+    // A work session that outlasts the benchmark, so it never reaches a completion.
+    sm_set_work_duration(state->session_manager, 60 * 24 * 365);
+    sm_trigger_event(state->session_manager, EvStart);
+}
+
+static void teardown_session(BenchState *state)
+{
+    sm_deinit(state->session_manager);
+}
+
+static GDBusConnection *connect_bench_bus(BenchState *state)
+{
+    g_autoptr(GError) error = NULL;
+    GDBusConnection *connection = g_dbus_connection_new_for_address_sync(
+        g_test_dbus_get_bus_address(state->bus),
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, &error);
+
+    if (connection == NULL) {
+        g_error("Failed to connect to the private bus: %s", error->message);
+    }
+
+    return connection;
+}
+
+// Counts an update as bad if a dock would show exactly what it showed before it.
+static void on_launcher_update(GDBusConnection *connection, const gchar *sender,
+                               const gchar *object_path, const gchar *interface_name,
+                               const gchar *signal_name, GVariant *parameters, gpointer state_ptr)
+{
+    BenchState *state = state_ptr;
+    g_autoptr(GVariant) properties = NULL;
+    gdouble progress = 0;
+    gboolean progress_visible = FALSE;
+    gint64 count = 0;
+
+    g_variant_get(parameters, "(&s@a{sv})", NULL, &properties);
+    g_variant_lookup(properties, "progress", "d", &progress);
+    g_variant_lookup(properties, "progress-visible", "b", &progress_visible);
+    g_variant_lookup(properties, "count", "x", &count);
+
+    gdouble steps = progress * LAUNCHER_PROGRESS_STEPS;
+    gboolean unchanged = (progress_visible == state->last_progress_visible &&
+                          count == state->last_count &&
+                          (progress == state->last_progress || !progress_visible));
+
+    if (state->launcher_updates > 0 && unchanged) {
+        state->bad_launcher_updates++;
+    } else if (steps != (gdouble) (guint) steps) {
+        state->bad_launcher_updates++;
+    }
+
+    state->launcher_updates++;
+    state->last_progress = progress;
+    state->last_progress_visible = progress_visible;
+    state->last_count = count;
+}
+
+static void setup_launcher(BenchState *state)
+{
+    setup_session(state);
+
+    state->bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(state->bus);
+    state->launcher_connection = connect_bench_bus(state);
+    state->listener_connection = connect_bench_bus(state);
+
+    state->launcher_subscription = g_dbus_connection_signal_subscribe(
+        state->listener_connection, NULL, "com.canonical.Unity.LauncherEntry", "Update", NULL,
+        NULL, G_DBUS_SIGNAL_FLAGS_NONE, on_launcher_update, state, NULL);
+
+    // The match rule is only in place once the bus answered a later call.
+    g_autoptr(GVariant) reply = g_dbus_connection_call_sync(
+        state->listener_connection, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+        "org.freedesktop.DBus", "GetId", NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+
+    state->launcher = launcher_new(state->session_manager, BENCH_APP_ID,
+                                   state->launcher_connection);
+}
+
+static void teardown_launcher(BenchState *state)
+{
+    launcher_free(state->launcher);
+
+    // The reply to a ping of the launcher connection arrives after every update it sent.
+    g_autoptr(GVariant) reply = g_dbus_connection_call_sync(
+        state->listener_connection, g_dbus_connection_get_unique_name(state->launcher_connection),
+        "/", "org.freedesktop.DBus.Peer", "Ping", NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+        NULL);
+    while (g_main_context_iteration(NULL, FALSE)) {
+    }
+
+    if (state->launcher_updates == 0 || state->bad_launcher_updates > 0) {
+        g_error("%" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " launcher updates were redundant "
+                "or unquantized",
+                state->bad_launcher_updates, state->launcher_updates);
+    }
+
+    g_dbus_connection_signal_unsubscribe(state->listener_connection,
+                                         state->launcher_subscription);
+    g_dbus_connection_close_sync(state->launcher_connection, NULL, NULL);
+    g_dbus_connection_close_sync(state->listener_connection, NULL, NULL);
+    g_clear_object(&state->launcher_connection);
+    g_clear_object(&state->listener_connection);
+    g_test_dbus_down(state->bus);
+    g_clear_object(&state->bus);
+
+    teardown_session(state);
+}
+
+/*  A million sessions, one every ten minutes for about nineteen years, written in one go to a
+    temporary directory, so every month but the last is a compact segment like on a real disk.
+*/
+static void setup_history(BenchState *state)
+{
+    static const guint8 routines[] = {Working, ShortBreak, Working, ShortBreak,
+                                      Working, ShortBreak, Working, LongBreak};
+    g_autoptr(GError) error = NULL;
+
+    state->history_dir = g_dir_make_tmp("samaya-bench-XXXXXX", &error);
+    if (state->history_dir == NULL) {
+        g_error("Failed to create a history directory: %s", error->message);
+    }
+
+    g_autofree HistoryRecord *records = g_new0(HistoryRecord, BENCH_HISTORY_RECORDS);
+    for (guint i = 0; i < BENCH_HISTORY_RECORDS; i++) {
+        records[i].started_at = G_GINT64_CONSTANT(1500000000) + (gint64) i * 600;
+        records[i].routine = routines[i % G_N_ELEMENTS(routines)];
+        records[i].planned_seconds = (records[i].routine == Working) ? 1500 : 300;
+        records[i].elapsed_seconds = records[i].planned_seconds - (i % 7 == 0 ? 120 : 0);
+        records[i].flags = (i % 7 == 0) ? HISTORY_FLAG_SKIPPED : 0;
+    }
+
+    if (!history_append_many(state->history_dir, records, BENCH_HISTORY_RECORDS, &error)) {
+        g_error("Failed to write the benchmark history: %s", error->message);
+    }
+
+    state->history_model = samaya_history_model_new(state->history_dir);
+}
+
+static void teardown_history(BenchState *state)
+{
+    GDir *dir = g_dir_open(state->history_dir, 0, NULL);
+    const gchar *name;
+
+    g_clear_object(&state->history_model);
+
+    while (dir != NULL && (name = g_dir_read_name(dir)) != NULL) {
+        g_autofree gchar *path = g_build_filename(state->history_dir, name, NULL);
+        g_remove(path);
+    }
+    g_clear_pointer(&dir, g_dir_close);
+
+    g_rmdir(state->history_dir);
+    g_clear_pointer(&state->history_dir, g_free);
+}
+
+// Settled at full volume, the fade in is over before the benchmark starts.
+static void setup_noise(BenchState *state, NoiseColor color)
+{
+    state->noise = noise_new(BENCH_NOISE_SAMPLE_RATE, 1);
+    noise_set_color(state->noise, color);
+    noise_set_playing(state->noise, TRUE);
+
+    for (guint i = 0; i < BENCH_NOISE_SAMPLE_RATE / BENCH_NOISE_PERIOD_FRAMES; i++) {
+        noise_render(state->noise, state->noise_period, BENCH_NOISE_PERIOD_FRAMES);
+    }
+}
+
+static void setup_white_noise(BenchState *state)
+{
+    setup_noise(state, NoiseWhite);
+}
+
+static void setup_pink_noise(BenchState *state)
+{
+    setup_noise(state, NoisePink);
+}
+
+static void setup_brown_noise(BenchState *state)
+{
+    setup_noise(state, NoiseBrown);
+}
+
+static void setup_rain_noise(BenchState *state)
+{
+    setup_noise(state, NoiseRain);
+}
+
+static void teardown_noise(BenchState *state)
+{
+    noise_free(state->noise);
+}
+
+static void run_transitions(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        state->now_us += 1000;
+        tm_trigger_event(state->timer, EvStart);
+        tm_trigger_event(state->timer, EvStop);
+    }
+}
+
+static void run_ticks(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        state->now_us = tm_get_next_wakeup_us(state->timer);
+        tm_tick(state->timer);
+    }
+}
+
+// A whole 25 minute session from start to completion, waking up only when the timer asks to.
+static void run_timer_session(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        tm_trigger_event(state->timer, EvReset);
+        tm_trigger_event(state->timer, EvStart);
+
+        gint64 deadline_us = tm_get_deadline_us(state->timer);
+        gint64 wakeup_us;
+
+        while ((wakeup_us = tm_get_next_wakeup_us(state->timer)) >= 0) {
+            state->now_us = wakeup_us;
+            tm_tick(state->timer);
+            state->wakeups++;
+        }
+
+        state->completion_error_us =
+            MAX(state->completion_error_us, ABS(state->now_us - deadline_us));
+    }
+}
+
+static void setup_frame_timer(BenchState *state)
+{
+    setup_session_timer(state, TM_TICK_INTERVAL_SECONDS);
+    state->presented_us = state->now_us;
+}
+
+/*  Moves on to the next frame and brings the clock to the moment it is drawn, ticking the timer on
+    the way like its thread would.
+*/
+static void advance_frame(BenchState *state)
+{
+    if (state->frames % BENCH_FRAMES_PER_SESSION == 0) {
+        tm_trigger_event(state->timer, EvReset);
+        tm_trigger_event(state->timer, EvStart);
+    }
+
+    state->presented_us += BENCH_FRAME_US;
+
+    // A cheap deterministic scramble of the frame number, so every build sees the same jitter.
+    guint32 jitter = (guint32) (state->frames * 2654435761u) >> 8;
+    gint64 drawn_us =
+        state->presented_us - BENCH_FRAME_LATENCY_US - (gint64) (jitter % BENCH_FRAME_JITTER_US);
+
+    gint64 wakeup_us;
+    while ((wakeup_us = tm_get_next_wakeup_us(state->timer)) >= 0 && wakeup_us <= drawn_us) {
+        state->now_us = wakeup_us;
+        tm_tick(state->timer);
+    }
+
+    state->now_us = drawn_us;
+}
+
+static void record_frame(BenchState *state, gfloat progress)
+{
+    if (state->frames % BENCH_FRAMES_PER_SESSION != 0) {
+        gdouble step = (gdouble) state->last_frame_progress - progress;
+
+        state->frame_steps++;
+        state->frame_step_sum += step;
+        state->frame_step_square_sum += step * step;
+    }
+
+    state->last_frame_progress = progress;
+    state->frames++;
+}
+
+static void run_draw_time_sampling(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        advance_frame(state);
+        record_frame(state, tm_get_progress(state->timer));
+    }
+}
+
+static void run_presented_sampling(BenchState *state, guint64 iterations)
+{
+    TmSnapshot snapshot;
+
+    for (guint64 i = 0; i < iterations; i++) {
+        advance_frame(state);
+        tm_snapshot(state->timer, &snapshot);
+        record_frame(state, tm_snapshot_progress_at(&snapshot, state->presented_us));
+    }
+}
+
+static void run_progress(BenchState *state, guint64 iterations)
+{
+    volatile gfloat sink = 0;
+
+    for (guint64 i = 0; i < iterations; i++) {
+        state->now_us += 16667;
+        sink = tm_get_progress(state->timer);
+    }
+
+    (void) sink;
+}
+
+static void run_snapshot(BenchState *state, guint64 iterations)
+{
+    TmSnapshot snapshot;
+
+    for (guint64 i = 0; i < iterations; i++) {
+        tm_snapshot(state->timer, &snapshot);
+    }
+}
+
+static void run_metrics_count(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        metrics_count(MetricLabelUpdates);
+    }
+}
+
+static void run_metrics_observe(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        metrics_observe_us(MetricTickLateness, (gint64) (i % 2000));
+    }
+}
+
+static void run_format_time(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        sm_format_time(state->session_manager, (gint64) (i % 3600) * 1000);
+    }
+}
+
+// One hour of ticks of a running session, the steady state which must not allocate.
+static void run_hour(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        for (guint second = 0; second < 3600; second++) {
+            state->now_us = tm_get_next_wakeup_us(state->timer);
+            tm_tick(state->timer);
+        }
+    }
+}
+
+static void run_session_complete(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        sm_skip_session();
+    }
+}
+
+// Sixteen hours of back to back sessions with both auto-starts on, one tick per second.
+static void run_day(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        gint64 day_end = state->now_us + BENCH_DAY_US;
+
+        sm_set_routine(Working, state->session_manager);
+        sm_trigger_event(state->session_manager, EvStart);
+
+        while (state->now_us < day_end) {
+            gint64 wakeup = tm_get_next_wakeup_us(state->timer);
+            if (wakeup < 0) {
+                break;
+            }
+
+            state->now_us = wakeup;
+            tm_tick(state->timer);
+        }
+
+        sm_trigger_event(state->session_manager, EvReset);
+    }
+}
+
+// Opening the model counts the rows, the dialog does this every time it is shown.
+static void run_history_open(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        g_object_unref(samaya_history_model_new(state->history_dir));
+    }
+}
+
+// A frame of scrolling down by one row, every visible row fetched again as the list rebinds them.
+static void run_history_scroll(BenchState *state, guint64 iterations)
+{
+    GListModel *model = G_LIST_MODEL(state->history_model);
+    guint n_items = g_list_model_get_n_items(model);
+
+    for (guint64 i = 0; i < iterations; i++) {
+        guint first = state->history_position++ % (n_items - BENCH_HISTORY_ROWS_PER_FRAME);
+
+        for (guint row = 0; row < BENCH_HISTORY_ROWS_PER_FRAME; row++) {
+            g_object_unref(g_list_model_get_item(model, first + row));
+        }
+    }
+}
+
+// A frame of dragging the scrollbar, a screen of rows far from the last one, missing the cache.
+static void run_history_jump(BenchState *state, guint64 iterations)
+{
+    GListModel *model = G_LIST_MODEL(state->history_model);
+    guint n_items = g_list_model_get_n_items(model);
+
+    for (guint64 i = 0; i < iterations; i++) {
+        state->history_position = state->history_position * 1664525u + 1013904223u;
+        guint first = state->history_position % (n_items - BENCH_HISTORY_ROWS_PER_FRAME);
+
+        for (guint row = 0; row < BENCH_HISTORY_ROWS_PER_FRAME; row++) {
+            g_object_unref(g_list_model_get_item(model, first + row));
+        }
+    }
+}
+
+/*  Switching the routine filter until the list shows the result. The rows are counted on a worker
+    thread, the frame time is the longest the UI thread spends at once in setting the filter or in
+    a main loop iteration while it waits, swapping in the result included.
+*/
+static void run_history_filter(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        gint64 started_us = g_get_monotonic_time();
+
+        samaya_history_model_set_filter(state->history_model, 0, G_MAXINT64,
+                                        1u << (state->history_position++ % 2 == 0
+                                                   ? ShortBreak
+                                                   : Working));
+        state->worst_frame_us =
+            MAX(state->worst_frame_us, g_get_monotonic_time() - started_us);
+
+        while (samaya_history_model_is_loading(state->history_model)) {
+            started_us = g_get_monotonic_time();
+            g_main_context_iteration(NULL, FALSE);
+            state->worst_frame_us =
+                MAX(state->worst_frame_us, g_get_monotonic_time() - started_us);
+        }
+    }
+}
+
+// One second of audio, rendered a period at a time like the audio thread does.
+static void run_noise_second(BenchState *state, guint64 iterations)
+{
+    for (guint64 i = 0; i < iterations; i++) {
+        for (guint period = 0; period < BENCH_NOISE_SAMPLE_RATE / BENCH_NOISE_PERIOD_FRAMES;
+             period++) {
+            noise_render(state->noise, state->noise_period, BENCH_NOISE_PERIOD_FRAMES);
+        }
+    }
+}
+
+static const Benchmark benchmarks[] = {
+    {"timer/start-stop", setup_timer, run_transitions, teardown_timer},
+    {"timer/tick", setup_running_timer, run_ticks, teardown_timer, TRUE},
+    {"timer/progress", setup_running_timer, run_progress, teardown_timer, TRUE},
+    {"timer/snapshot", setup_running_timer, run_snapshot, teardown_timer, TRUE},
+    // One wakeup per second or minute of the 25 minute session, the last one on the deadline.
+    {"timer/session-seconds", setup_seconds_timer, run_timer_session, teardown_timer, FALSE, FALSE,
+     25 * 60},
+    {"timer/session-minutes", setup_minutes_timer, run_timer_session, teardown_timer, FALSE, FALSE,
+     25},
+    {"timer/tick-contended", setup_contended_timer, run_ticks, teardown_contended_timer},
+    {"ring/sample-draw-time", setup_frame_timer, run_draw_time_sampling, teardown_timer},
+    {"ring/sample-presented", setup_frame_timer, run_presented_sampling, teardown_timer, FALSE,
+     FALSE, 0, BENCH_MAX_FRAME_STEP_CV},
+    {"metrics/count", setup_nothing, run_metrics_count, teardown_nothing},
+    {"metrics/observe", setup_nothing, run_metrics_observe, teardown_nothing},
+    {"session/format-time", setup_session, run_format_time, teardown_session, TRUE},
+    {"session/hour", setup_running_session, run_hour, teardown_session, TRUE},
+    {"session/complete", setup_session, run_session_complete, teardown_session},
+    {"session/day", setup_session, run_day, teardown_session},
+    {"launcher/day", setup_launcher, run_day, teardown_launcher},
+    {"history/open", setup_history, run_history_open, teardown_history, FALSE, TRUE},
+    {"history/scroll", setup_history, run_history_scroll, teardown_history, FALSE, TRUE},
+    {"history/jump", setup_history, run_history_jump, teardown_history, FALSE, TRUE},
+    {"history/filter", setup_history, run_history_filter, teardown_history, FALSE, TRUE},
+    {"noise/white", setup_white_noise, run_noise_second, teardown_noise},
+    {"noise/pink", setup_pink_noise, run_noise_second, teardown_noise},
+    {"noise/brown", setup_brown_noise, run_noise_second, teardown_noise},
+    {"noise/rain", setup_rain_noise, run_noise_second, teardown_noise},
+};
+
+
+/* ============================================================================
+ * Runner
+ * ============================================================================ */
+
+static gint compare_doubles(gconstpointer a, gconstpointer b)
+{
+    gdouble first = *(const gdouble *) a;
+    gdouble second = *(const gdouble *) b;
+
+    return (first > second) - (first < second);
+}
+
+// Returns FALSE if the benchmark allocated although it must not.
+static gboolean run_benchmark(const Benchmark *benchmark, gint64 min_time_us, gboolean first)
+{
+    BenchState state = {.now_us = 1};
+    guint64 iterations = 1;
+    gdouble ns_per_op[BENCH_ROUNDS];
+    guint64 allocations = 0;
+
+    benchmark->setup(&state);
+
+    // Grow the round until it is long enough to measure.
+    for (;;) {
+        gint64 started_us = g_get_monotonic_time();
+        benchmark->run(&state, iterations);
+
+        if (g_get_monotonic_time() - started_us >= min_time_us || iterations >= G_MAXUINT32) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    // Only what the measured rounds woke up for and drew is reported.
+    state.wakeups = 0;
+    state.frame_steps = 0;
+    state.frame_step_sum = 0;
+    state.frame_step_square_sum = 0;
+    state.worst_frame_us = 0;
+
+    for (guint round = 0; round < BENCH_ROUNDS; round++) {
+        guint64 allocations_before = alloc_stats_get_total();
+        gint64 started_us = g_get_monotonic_time();
+
+        benchmark->run(&state, iterations);
+
+        gint64 elapsed_us = g_get_monotonic_time() - started_us;
+        allocations += alloc_stats_get_total() - allocations_before;
+
+        ns_per_op[round] = elapsed_us * 1000.0 / iterations;
+    }
+
+    benchmark->teardown(&state);
+
+    qsort(ns_per_op, BENCH_ROUNDS, sizeof(gdouble), compare_doubles);
+
+    g_print("%s\n    {\"name\": \"%s\", \"iterations\": %" G_GUINT64_FORMAT
+            ", \"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, \"allocs_per_op\": ",
+            first ? "" : ",", benchmark->name, iterations, ns_per_op[BENCH_ROUNDS / 2],
+            ns_per_op[0]);
+
+    if (alloc_stats_supported()) {
+        g_print("%.3f", (gdouble) allocations / (iterations * BENCH_ROUNDS));
+    } else {
+        g_print("null");
+    }
+
+    if (state.wakeups > 0) {
+        g_print(", \"wakeups_per_op\": %.1f, \"completion_error_us\": %" G_GINT64_FORMAT,
+                (gdouble) state.wakeups / (iterations * BENCH_ROUNDS), state.completion_error_us);
+    }
+
+    gdouble frame_step_cv = 0;
+    if (state.frame_steps > 0) {
+        gdouble mean = state.frame_step_sum / state.frame_steps;
+        gdouble variance = state.frame_step_square_sum / state.frame_steps - mean * mean;
+
+        frame_step_cv = sqrt(MAX(variance, 0)) / mean;
+        g_print(", \"frame_step_cv\": %.4f", frame_step_cv);
+    }
+
+    // Ops that do not wait on other threads are all UI thread work, the slowest round counts.
+    gint64 frame_us = (state.worst_frame_us > 0) ? state.worst_frame_us
+                                                 : (gint64) (ns_per_op[BENCH_ROUNDS - 1] / 1000);
+    if (benchmark->frame_bound) {
+        g_print(", \"frame_us\": %" G_GINT64_FORMAT, frame_us);
+    }
+
+    g_print("}");
+
+    gdouble wakeups_per_op = (gdouble) state.wakeups / (iterations * BENCH_ROUNDS);
+    if (benchmark->max_wakeups_per_op > 0 && wakeups_per_op > benchmark->max_wakeups_per_op) {
+        g_printerr("%s woke up %.1f times per session, more than %u\n", benchmark->name,
+                   wakeups_per_op, benchmark->max_wakeups_per_op);
+        return FALSE;
+    }
+
+    // On the virtual clock the last wakeup has to land exactly on the deadline.
+    if (state.wakeups > 0 && state.completion_error_us != 0) {
+        g_printerr("%s completed %" G_GINT64_FORMAT " us away from its deadline\n",
+                   benchmark->name, state.completion_error_us);
+        return FALSE;
+    }
+
+    if (benchmark->max_frame_step_cv > 0 && frame_step_cv > benchmark->max_frame_step_cv) {
+        g_printerr("%s moved the ring unevenly, its steps vary by %.4f, more than %.4f\n",
+                   benchmark->name, frame_step_cv, benchmark->max_frame_step_cv);
+        return FALSE;
+    }
+
+    if (benchmark->frame_bound && frame_us > BENCH_FRAME_US) {
+        g_printerr("%s took %" G_GINT64_FORMAT " us of a frame on the UI thread, over the %d us"
+                   " of a 60 Hz frame\n",
+                   benchmark->name, frame_us, BENCH_FRAME_US);
+        return FALSE;
+    }
+
+    if (benchmark->allocation_free && allocations > 0) {
+        g_printerr("%s allocated %" G_GUINT64_FORMAT " times in %" G_GUINT64_FORMAT
+                   " ops, its path must not allocate\n",
+                   benchmark->name, allocations, iterations * BENCH_ROUNDS);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+    gint min_time_ms = 200;
+    gchar *filter = NULL;
+    g_autoptr(GError) error = NULL;
+
+    GOptionEntry options[] = {
+        {"min-time", 't', 0, G_OPTION_ARG_INT, &min_time_ms,
+         "Minimum duration of a measured round in milliseconds", "MS"},
+        {"filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+         "Only run benchmarks whose name contains TEXT", "TEXT"},
+        G_OPTION_ENTRY_NULL,
+    };
+
+    g_autoptr(GOptionContext) context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, options, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_print("{\n  \"version\": \"%s\",\n  \"benchmarks\": [", PACKAGE_VERSION);
+
+    gboolean first = TRUE;
+    gboolean passed = TRUE;
+    for (guint i = 0; i < G_N_ELEMENTS(benchmarks); i++) {
+        if (filter != NULL && strstr(benchmarks[i].name, filter) == NULL) {
+            continue;
+        }
+
+        passed &= run_benchmark(&benchmarks[i], (gint64) MAX(min_time_ms, 1) * 1000, first);
+        first = FALSE;
+    }
+
+    g_print("\n  ]\n}\n");
+
+    g_free(filter);
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,105 @@
+/* samaya-heatmap-dialog.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "samaya-heatmap-dialog.h"
+#include <glib/gi18n.h>
+#include "samaya-heatmap.h"
+
+struct _SamayaHeatmapDialog
+{
+    AdwDialog parent_instance;
+
+    SamayaHeatmap *heatmap;
+    GtkLabel *year_label;
+    GtkButton *next_year_button;
+};
+
+G_DEFINE_FINAL_TYPE(SamayaHeatmapDialog, samaya_heatmap_dialog, ADW_TYPE_DIALOG)
+
+
+/* ============================================================================
+ * Year Navigation Handlers
+ * ============================================================================ */
+
+static void sync_year(SamayaHeatmapDialog *self)
+{
+    GDateYear year = samaya_heatmap_get_year(self->heatmap);
+    g_autoptr(GDateTime) now = g_date_time_new_now_local();
+
+    char year_text[8];
+    g_snprintf(year_text, sizeof(year_text), "%u", year);
+    gtk_label_set_text(self->year_label, year_text);
+
+    gtk_widget_set_sensitive(GTK_WIDGET(self->next_year_button),
+                             year < (GDateYear) g_date_time_get_year(now));
+}
+
+static void on_previous_year_clicked(GtkButton *button, gpointer user_data)
+{
+    SamayaHeatmapDialog *self = SAMAYA_HEATMAP_DIALOG(user_data);
+    GDateYear year = samaya_heatmap_get_year(self->heatmap);
+
+    if (year > 1) {
+        samaya_heatmap_set_year(self->heatmap, year - 1);
+    }
+    sync_year(self);
+}
+
+static void on_next_year_clicked(GtkButton *button, gpointer user_data)
+{
+    SamayaHeatmapDialog *self = SAMAYA_HEATMAP_DIALOG(user_data);
+
+    samaya_heatmap_set_year(self->heatmap, samaya_heatmap_get_year(self->heatmap) + 1);
+    sync_year(self);
+}
+
+
+/* ============================================================================
+ * Samaya Heatmap Dialog Methods
+ * ============================================================================ */
+
+static void samaya_heatmap_dialog_class_init(SamayaHeatmapDialogClass *klass)
+{
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+
+    g_type_ensure(SAMAYA_TYPE_HEATMAP);
+
+    gtk_widget_class_set_template_from_resource(widget_class,
+                                                "/io/github/redddfoxxyy/samaya/heatmap-dialog.ui");
+
+    gtk_widget_class_bind_template_child(widget_class, SamayaHeatmapDialog, heatmap);
+    gtk_widget_class_bind_template_child(widget_class, SamayaHeatmapDialog, year_label);
+    gtk_widget_class_bind_template_child(widget_class, SamayaHeatmapDialog, next_year_button);
+
+    gtk_widget_class_bind_template_callback(widget_class, on_previous_year_clicked);
+    gtk_widget_class_bind_template_callback(widget_class, on_next_year_clicked);
+}
+
+static void samaya_heatmap_dialog_init(SamayaHeatmapDialog *self)
+{
+    gtk_widget_init_template(GTK_WIDGET(self));
+
+    sync_year(self);
+}
+
+SamayaHeatmapDialog *samaya_heatmap_dialog_new(void)
+{
+    return g_object_new(SAMAYA_TYPE_HEATMAP_DIALOG, NULL);
+}
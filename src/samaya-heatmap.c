@@ -0,0 +1,358 @@
+/* samaya-heatmap.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <glib/gi18n.h>
+#include "samaya-heatmap.h"
+#include "samaya-history.h"
+#include "samaya-session.h"
+
+#define CELL_SIZE 10
+#define CELL_SPACING 2
+#define CELL_STRIDE (CELL_SIZE + CELL_SPACING)
+#define CELL_RADIUS 2.0f
+#define DAYS_PER_WEEK 7
+// A leap year starting on a Sunday spans 54 Monday-first weeks.
+#define WEEK_COLUMNS 54
+
+/*  Every day of a year is rendered once into its own node, and the year is a container of those
+    nodes. Finishing a session only rebuilds the tiles whose totals changed plus the (cheap)
+    container, and switching between years reuses whatever was built before.
+*/
+typedef struct
+{
+    guint32 seconds_by_day[HISTORY_DAYS_PER_YEAR_MAX];
+    GskRenderNode *day_nodes[HISTORY_DAYS_PER_YEAR_MAX];
+    GskRenderNode *year_node;
+} HeatmapYear;
+
+struct _SamayaHeatmap
+{
+    GtkWidget parent_instance;
+
+    GDateYear year;
+    GHashTable *years;
+
+    // Color the cached nodes were rendered with.
+    GdkRGBA color;
+
+    gulong session_complete_id;
+};
+
+G_DEFINE_FINAL_TYPE(SamayaHeatmap, samaya_heatmap, GTK_TYPE_WIDGET)
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static void heatmap_year_clear_nodes(HeatmapYear *data)
+{
+    for (guint i = 0; i < HISTORY_DAYS_PER_YEAR_MAX; i++) {
+        g_clear_pointer(&data->day_nodes[i], gsk_render_node_unref);
+    }
+    g_clear_pointer(&data->year_node, gsk_render_node_unref);
+}
+
+static void heatmap_year_free(gpointer user_data)
+{
+    HeatmapYear *data = user_data;
+
+    heatmap_year_clear_nodes(data);
+    g_free(data);
+}
+
+static void load_daily_focus(GDateYear year, guint32 *seconds_by_day)
+{
+    g_autoptr(GError) error = NULL;
+
+    if (!history_get_daily_focus(NULL, year, seconds_by_day, &error)) {
+        g_warning("Failed to load focus time of %u: %s", year, error->message);
+    }
+}
+
+static HeatmapYear *ensure_year(SamayaHeatmap *self, GDateYear year)
+{
+    HeatmapYear *data = g_hash_table_lookup(self->years, GUINT_TO_POINTER(year));
+
+    if (data == NULL) {
+        data = g_new0(HeatmapYear, 1);
+        load_daily_focus(year, data->seconds_by_day);
+        g_hash_table_insert(self->years, GUINT_TO_POINTER(year), data);
+    }
+
+    return data;
+}
+
+static guint get_days_in_year(GDateYear year)
+{
+    return g_date_is_leap_year(year) ? 366 : 365;
+}
+
+// Number of cells before the 1st of January in the first (Monday-first) week column.
+static guint get_first_weekday_offset(GDateYear year)
+{
+    GDate date;
+    g_date_clear(&date, 1);
+    g_date_set_dmy(&date, 1, G_DATE_JANUARY, year);
+
+    return g_date_get_weekday(&date) - G_DATE_MONDAY;
+}
+
+static float get_level_alpha(guint32 seconds)
+{
+    guint32 minutes = seconds / 60;
+
+    if (minutes == 0) {
+        return 0.1f;
+    } else if (minutes < 25) {
+        return 0.3f;
+    } else if (minutes < 60) {
+        return 0.5f;
+    } else if (minutes < 120) {
+        return 0.75f;
+    }
+
+    return 1.0f;
+}
+
+static GskRenderNode *build_day_node(SamayaHeatmap *self, guint first_offset, guint day,
+                                     guint32 seconds)
+{
+    guint cell = first_offset + day;
+    graphene_rect_t bounds = GRAPHENE_RECT_INIT((cell / DAYS_PER_WEEK) * CELL_STRIDE,
+                                                (cell % DAYS_PER_WEEK) * CELL_STRIDE, CELL_SIZE,
+                                                CELL_SIZE);
+    GskRoundedRect outline;
+    gsk_rounded_rect_init_from_rect(&outline, &bounds, CELL_RADIUS);
+
+    GdkRGBA color = self->color;
+    color.alpha *= get_level_alpha(seconds);
+
+    GtkSnapshot *snapshot = gtk_snapshot_new();
+    gtk_snapshot_push_rounded_clip(snapshot, &outline);
+    gtk_snapshot_append_color(snapshot, &color, &bounds);
+    gtk_snapshot_pop(snapshot);
+
+    return gtk_snapshot_free_to_node(snapshot);
+}
+
+static GskRenderNode *ensure_year_node(SamayaHeatmap *self, GDateYear year, HeatmapYear *data)
+{
+    if (data->year_node != NULL) {
+        return data->year_node;
+    }
+
+    guint days = get_days_in_year(year);
+    guint first_offset = get_first_weekday_offset(year);
+
+    for (guint day = 0; day < days; day++) {
+        if (data->day_nodes[day] == NULL) {
+            data->day_nodes[day] =
+                build_day_node(self, first_offset, day, data->seconds_by_day[day]);
+        }
+    }
+
+    data->year_node = gsk_container_node_new(data->day_nodes, days);
+    return data->year_node;
+}
+
+static void invalidate_all_years(SamayaHeatmap *self)
+{
+    GHashTableIter iter;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, self->years);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        heatmap_year_clear_nodes(value);
+    }
+}
+
+// Refreshes the totals of the current year from the daily aggregates and drops only the tiles that
+// changed, which after a finished session is just today's.
+static void on_session_complete(SessionManagerPtr session_manager, gpointer user_data)
+{
+    SamayaHeatmap *self = SAMAYA_HEATMAP(user_data);
+
+    g_autoptr(GDateTime) now = g_date_time_new_now_local();
+    GDateYear year = g_date_time_get_year(now);
+
+    HeatmapYear *data = g_hash_table_lookup(self->years, GUINT_TO_POINTER(year));
+    if (data == NULL) {
+        return;
+    }
+
+    guint32 seconds_by_day[HISTORY_DAYS_PER_YEAR_MAX];
+    gboolean changed = FALSE;
+
+    load_daily_focus(year, seconds_by_day);
+
+    for (guint day = 0; day < HISTORY_DAYS_PER_YEAR_MAX; day++) {
+        if (seconds_by_day[day] != data->seconds_by_day[day]) {
+            data->seconds_by_day[day] = seconds_by_day[day];
+            g_clear_pointer(&data->day_nodes[day], gsk_render_node_unref);
+            changed = TRUE;
+        }
+    }
+
+    if (changed) {
+        g_clear_pointer(&data->year_node, gsk_render_node_unref);
+
+        if (year == self->year) {
+            gtk_widget_queue_draw(GTK_WIDGET(self));
+        }
+    }
+}
+
+
+/* ============================================================================
+ * Samaya Heatmap Methods
+ * ============================================================================ */
+
+static void samaya_heatmap_measure(GtkWidget *widget, GtkOrientation orientation, int for_size,
+                                   int *minimum, int *natural, int *minimum_baseline,
+                                   int *natural_baseline)
+{
+    if (orientation == GTK_ORIENTATION_HORIZONTAL) {
+        *minimum = *natural = WEEK_COLUMNS * CELL_STRIDE - CELL_SPACING;
+    } else {
+        *minimum = *natural = DAYS_PER_WEEK * CELL_STRIDE - CELL_SPACING;
+    }
+}
+
+static void samaya_heatmap_snapshot(GtkWidget *widget, GtkSnapshot *snapshot)
+{
+    SamayaHeatmap *self = SAMAYA_HEATMAP(widget);
+
+    GdkRGBA color;
+    gtk_widget_get_color(widget, &color);
+
+    if (!gdk_rgba_equal(&color, &self->color)) {
+        self->color = color;
+        invalidate_all_years(self);
+    }
+
+    HeatmapYear *data = ensure_year(self, self->year);
+    gtk_snapshot_append_node(snapshot, ensure_year_node(self, self->year, data));
+}
+
+static gboolean samaya_heatmap_query_tooltip(GtkWidget *widget, int x, int y,
+                                             gboolean keyboard_mode, GtkTooltip *tooltip)
+{
+    SamayaHeatmap *self = SAMAYA_HEATMAP(widget);
+
+    if (x < 0 || y < 0 || x % CELL_STRIDE >= CELL_SIZE || y % CELL_STRIDE >= CELL_SIZE) {
+        return FALSE;
+    }
+
+    guint cell = (x / CELL_STRIDE) * DAYS_PER_WEEK + (y / CELL_STRIDE);
+    guint first_offset = get_first_weekday_offset(self->year);
+    if (y / CELL_STRIDE >= DAYS_PER_WEEK || cell < first_offset ||
+        cell - first_offset >= get_days_in_year(self->year)) {
+        return FALSE;
+    }
+
+    guint day = cell - first_offset;
+    HeatmapYear *data = ensure_year(self, self->year);
+
+    GDate date;
+    g_date_clear(&date, 1);
+    g_date_set_dmy(&date, 1, G_DATE_JANUARY, self->year);
+    g_date_add_days(&date, day);
+
+    char date_text[64];
+    g_date_strftime(date_text, sizeof(date_text), "%x", &date);
+
+    guint32 minutes = data->seconds_by_day[day] / 60;
+    g_autofree char *text = g_strdup_printf(
+        ngettext("%u minute of focus on %s", "%u minutes of focus on %s", minutes), minutes,
+        date_text);
+    gtk_tooltip_set_text(tooltip, text);
+
+    return TRUE;
+}
+
+static void samaya_heatmap_dispose(GObject *object)
+{
+    SamayaHeatmap *self = SAMAYA_HEATMAP(object);
+    SessionManagerPtr session_manager = sm_get_default();
+
+    if (self->session_complete_id > 0 && session_manager != NULL) {
+        sm_disconnect_session_complete(session_manager, self->session_complete_id);
+    }
+    self->session_complete_id = 0;
+
+    g_clear_pointer(&self->years, g_hash_table_unref);
+
+    G_OBJECT_CLASS(samaya_heatmap_parent_class)->dispose(object);
+}
+
+static void samaya_heatmap_class_init(SamayaHeatmapClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+
+    object_class->dispose = samaya_heatmap_dispose;
+
+    widget_class->measure = samaya_heatmap_measure;
+    widget_class->snapshot = samaya_heatmap_snapshot;
+    widget_class->query_tooltip = samaya_heatmap_query_tooltip;
+
+    gtk_widget_class_set_css_name(widget_class, "heatmap");
+}
+
+static void samaya_heatmap_init(SamayaHeatmap *self)
+{
+    g_autoptr(GDateTime) now = g_date_time_new_now_local();
+
+    self->year = g_date_time_get_year(now);
+    self->years = g_hash_table_new_full(NULL, NULL, NULL, heatmap_year_free);
+
+    gtk_widget_set_has_tooltip(GTK_WIDGET(self), TRUE);
+
+    SessionManagerPtr session_manager = sm_get_default();
+    if (session_manager != NULL) {
+        self->session_complete_id =
+            sm_connect_session_complete(session_manager, on_session_complete, self);
+    }
+}
+
+GtkWidget *samaya_heatmap_new(void)
+{
+    return g_object_new(SAMAYA_TYPE_HEATMAP, NULL);
+}
+
+void samaya_heatmap_set_year(SamayaHeatmap *self, GDateYear year)
+{
+    g_return_if_fail(SAMAYA_IS_HEATMAP(self));
+
+    if (self->year == year) {
+        return;
+    }
+
+    self->year = year;
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+GDateYear samaya_heatmap_get_year(SamayaHeatmap *self)
+{
+    g_return_val_if_fail(SAMAYA_IS_HEATMAP(self), 0);
+
+    return self->year;
+}
@@ -0,0 +1,38 @@
+/* samaya-heatmap.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define SAMAYA_TYPE_HEATMAP (samaya_heatmap_get_type())
+
+G_DECLARE_FINAL_TYPE(SamayaHeatmap, samaya_heatmap, SAMAYA, HEATMAP, GtkWidget)
+
+GtkWidget *samaya_heatmap_new(void);
+
+// Shows the focus time of year. Years that were shown before are served from the cache.
+void samaya_heatmap_set_year(SamayaHeatmap *self, GDateYear year);
+
+GDateYear samaya_heatmap_get_year(SamayaHeatmap *self);
+
+G_END_DECLS
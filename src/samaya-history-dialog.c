@@ -0,0 +1,274 @@
+/* samaya-history-dialog.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "samaya-history-dialog.h"
+#include <glib/gi18n.h>
+#include "samaya-history-model.h"
+#include "samaya-session.h"
+
+// In the order of the period drop down.
+typedef enum
+{
+    PeriodAllTime,
+    PeriodToday,
+    PeriodWeek,
+    PeriodMonth,
+    PeriodYear,
+} HistoryPeriod;
+
+struct _SamayaHistoryDialog
+{
+    AdwDialog parent_instance;
+
+    GtkDropDown *routine_drop_down;
+    GtkDropDown *period_drop_down;
+    GtkStack *stack;
+    GtkListView *list_view;
+
+    SamayaHistoryModel *model;
+    gulong session_complete_id;
+};
+
+G_DEFINE_FINAL_TYPE(SamayaHistoryDialog, samaya_history_dialog, ADW_TYPE_DIALOG)
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static const char *get_routine_name(guint8 routine)
+{
+    switch (routine) {
+        case Working:
+            return _("Focus");
+        case ShortBreak:
+            return _("Short Break");
+        case LongBreak:
+            return _("Long Break");
+        default:
+            return _("Session");
+    }
+}
+
+static gint64 get_period_start(HistoryPeriod period)
+{
+    g_autoptr(GDateTime) now = g_date_time_new_now_local();
+    g_autoptr(GDateTime) start = NULL;
+
+    switch (period) {
+        case PeriodAllTime:
+            return 0;
+        case PeriodToday:
+            start = g_date_time_new_local(g_date_time_get_year(now), g_date_time_get_month(now),
+                                          g_date_time_get_day_of_month(now), 0, 0, 0);
+            break;
+        case PeriodWeek:
+            start = g_date_time_add_weeks(now, -1);
+            break;
+        case PeriodMonth:
+            start = g_date_time_add_months(now, -1);
+            break;
+        case PeriodYear:
+            start = g_date_time_add_years(now, -1);
+            break;
+        default:
+            g_assert_not_reached();
+    }
+
+    return (start != NULL) ? g_date_time_to_unix(start) : 0;
+}
+
+static void sync_stack(SamayaHistoryDialog *self)
+{
+    gboolean empty = g_list_model_get_n_items(G_LIST_MODEL(self->model)) == 0;
+
+    gtk_stack_set_visible_child_name(self->stack, empty ? "empty" : "sessions");
+}
+
+static void on_items_changed(GListModel *model, guint position, guint removed, guint added,
+                             gpointer user_data)
+{
+    sync_stack(SAMAYA_HISTORY_DIALOG(user_data));
+}
+
+static void on_session_complete(SessionManagerPtr session_manager, gpointer user_data)
+{
+    samaya_history_model_reload(SAMAYA_HISTORY_DIALOG(user_data)->model);
+}
+
+
+/* ============================================================================
+ * Row Factory
+ * ============================================================================ */
+
+/*  Rows are built once per visible slot and recycled by the list view while scrolling, binding
+    only sets label text. A row is a box of the routine and start time on the left and the time
+    spent on the right.
+*/
+static void on_setup_row(GtkSignalListItemFactory *factory, GtkListItem *list_item,
+                         gpointer user_data)
+{
+    GtkWidget *row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 12);
+    GtkWidget *text = gtk_box_new(GTK_ORIENTATION_VERTICAL, 3);
+    GtkWidget *title = gtk_label_new(NULL);
+    GtkWidget *subtitle = gtk_label_new(NULL);
+    GtkWidget *duration = gtk_label_new(NULL);
+
+    gtk_widget_set_hexpand(text, TRUE);
+    gtk_label_set_xalign(GTK_LABEL(title), 0.0f);
+    gtk_label_set_xalign(GTK_LABEL(subtitle), 0.0f);
+    gtk_widget_add_css_class(subtitle, "dim-label");
+    gtk_widget_add_css_class(subtitle, "caption");
+    gtk_widget_set_valign(duration, GTK_ALIGN_CENTER);
+    gtk_widget_add_css_class(duration, "numeric");
+
+    gtk_box_append(GTK_BOX(text), title);
+    gtk_box_append(GTK_BOX(text), subtitle);
+    gtk_box_append(GTK_BOX(row), text);
+    gtk_box_append(GTK_BOX(row), duration);
+
+    gtk_list_item_set_child(list_item, row);
+}
+
+static void on_bind_row(GtkSignalListItemFactory *factory, GtkListItem *list_item,
+                        gpointer user_data)
+{
+    SamayaHistoryItem *item = SAMAYA_HISTORY_ITEM(gtk_list_item_get_item(list_item));
+    const HistoryRecord *record = samaya_history_item_get_record(item);
+
+    GtkWidget *row = gtk_list_item_get_child(list_item);
+    GtkWidget *title = gtk_widget_get_first_child(gtk_widget_get_first_child(row));
+    GtkWidget *subtitle = gtk_widget_get_next_sibling(title);
+    GtkWidget *duration = gtk_widget_get_last_child(row);
+
+    if ((record->flags & HISTORY_FLAG_SKIPPED) != 0) {
+        g_autofree char *title_text =
+            g_strdup_printf(_("%s (Skipped)"), get_routine_name(record->routine));
+        gtk_label_set_text(GTK_LABEL(title), title_text);
+    } else {
+        gtk_label_set_text(GTK_LABEL(title), get_routine_name(record->routine));
+    }
+
+    g_autoptr(GDateTime) started_at = g_date_time_new_from_unix_local(record->started_at);
+    g_autofree char *date_text =
+        (started_at != NULL) ? g_date_time_format(started_at, "%x %X") : NULL;
+    gtk_label_set_text(GTK_LABEL(subtitle), (date_text != NULL) ? date_text : "");
+
+    char duration_text[SM_TIME_TEXT_SIZE];
+    g_snprintf(duration_text, sizeof(duration_text), "%02u:%02u", record->elapsed_seconds / 60,
+               record->elapsed_seconds % 60);
+    gtk_label_set_text(GTK_LABEL(duration), duration_text);
+}
+
+
+/* ============================================================================
+ * Filter Handlers
+ * ============================================================================ */
+
+static void on_filter_changed(GtkDropDown *drop_down, GParamSpec *pspec, gpointer user_data)
+{
+    SamayaHistoryDialog *self = SAMAYA_HISTORY_DIALOG(user_data);
+    guint routine = gtk_drop_down_get_selected(self->routine_drop_down);
+    guint period = gtk_drop_down_get_selected(self->period_drop_down);
+
+    // The first entry is every routine, the others follow RoutineType.
+    guint routine_mask = (routine == 0 || routine == GTK_INVALID_LIST_POSITION)
+                             ? HISTORY_ROUTINES_ALL
+                             : 1u << (routine - 1);
+    gint64 since = (period == GTK_INVALID_LIST_POSITION) ? 0 : get_period_start(period);
+
+    samaya_history_model_set_filter(self->model, since, G_MAXINT64, routine_mask);
+}
+
+
+/* ============================================================================
+ * Samaya History Dialog Methods
+ * ============================================================================ */
+
+static void samaya_history_dialog_dispose(GObject *object)
+{
+    SamayaHistoryDialog *self = SAMAYA_HISTORY_DIALOG(object);
+    SessionManagerPtr session_manager = sm_get_default();
+
+    if (self->session_complete_id > 0 && session_manager != NULL) {
+        sm_disconnect_session_complete(session_manager, self->session_complete_id);
+    }
+    self->session_complete_id = 0;
+
+    gtk_widget_dispose_template(GTK_WIDGET(self), SAMAYA_TYPE_HISTORY_DIALOG);
+
+    if (self->model != NULL) {
+        g_signal_handlers_disconnect_by_data(self->model, self);
+    }
+    g_clear_object(&self->model);
+
+    G_OBJECT_CLASS(samaya_history_dialog_parent_class)->dispose(object);
+}
+
+static void samaya_history_dialog_class_init(SamayaHistoryDialogClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+
+    object_class->dispose = samaya_history_dialog_dispose;
+
+    gtk_widget_class_set_template_from_resource(widget_class,
+                                                "/io/github/redddfoxxyy/samaya/history-dialog.ui");
+
+    gtk_widget_class_bind_template_child(widget_class, SamayaHistoryDialog, routine_drop_down);
+    gtk_widget_class_bind_template_child(widget_class, SamayaHistoryDialog, period_drop_down);
+    gtk_widget_class_bind_template_child(widget_class, SamayaHistoryDialog, stack);
+    gtk_widget_class_bind_template_child(widget_class, SamayaHistoryDialog, list_view);
+
+    gtk_widget_class_bind_template_callback(widget_class, on_filter_changed);
+}
+
+static void samaya_history_dialog_init(SamayaHistoryDialog *self)
+{
+    self->model = samaya_history_model_new(NULL);
+    g_signal_connect(self->model, "items-changed", G_CALLBACK(on_items_changed), self);
+
+    gtk_widget_init_template(GTK_WIDGET(self));
+
+    GtkListItemFactory *factory = gtk_signal_list_item_factory_new();
+    g_signal_connect(factory, "setup", G_CALLBACK(on_setup_row), NULL);
+    g_signal_connect(factory, "bind", G_CALLBACK(on_bind_row), NULL);
+
+    // The model is only ever browsed, rows are not selectable.
+    GtkSelectionModel *selection =
+        GTK_SELECTION_MODEL(gtk_no_selection_new(g_object_ref(G_LIST_MODEL(self->model))));
+    gtk_list_view_set_model(self->list_view, selection);
+    gtk_list_view_set_factory(self->list_view, factory);
+    g_object_unref(selection);
+    g_object_unref(factory);
+
+    sync_stack(self);
+
+    SessionManagerPtr session_manager = sm_get_default();
+    if (session_manager != NULL) {
+        self->session_complete_id =
+            sm_connect_session_complete(session_manager, on_session_complete, self);
+    }
+}
+
+SamayaHistoryDialog *samaya_history_dialog_new(void)
+{
+    return g_object_new(SAMAYA_TYPE_HISTORY_DIALOG, NULL);
+}
@@ -0,0 +1,325 @@
+/* samaya-history-model.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "samaya-history-model.h"
+
+struct _SamayaHistoryItem
+{
+    GObject parent_instance;
+
+    HistoryRecord record;
+};
+
+G_DEFINE_FINAL_TYPE(SamayaHistoryItem, samaya_history_item, G_TYPE_OBJECT)
+
+struct _SamayaHistoryModel
+{
+    GObject parent_instance;
+
+    gchar *path;
+    HistoryView *view;
+    guint n_items;
+
+    gint64 since;
+    gint64 until;
+    guint routine_mask;
+
+    // The view being opened for the current filter, see start_loading.
+    GCancellable *loading;
+    gboolean filter_changed;
+};
+
+typedef struct
+{
+    gchar *path;
+    gint64 since;
+    gint64 until;
+    guint routine_mask;
+} ViewQuery;
+
+static void samaya_history_model_list_model_init(GListModelInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(SamayaHistoryModel, samaya_history_model, G_TYPE_OBJECT,
+                              G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL,
+                                                    samaya_history_model_list_model_init))
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+// Replaces the view with a fresh one and returns the previous item count.
+static guint set_view(SamayaHistoryModel *self, HistoryView *view)
+{
+    guint old_n_items = self->n_items;
+
+    g_clear_pointer(&self->view, history_view_free);
+
+    self->view = view;
+    self->n_items = (view != NULL) ? history_view_get_n_records(view) : 0;
+
+    return old_n_items;
+}
+
+static HistoryView *open_view(const gchar *path, gint64 since, gint64 until, guint routine_mask,
+                              GError **error)
+{
+    GError *open_error = NULL;
+    HistoryView *view = history_view_open(path, since, until, routine_mask, &open_error);
+
+    // No history yet is just an empty model.
+    if (view == NULL && !g_error_matches(open_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+        g_propagate_error(error, open_error);
+    } else {
+        g_clear_error(&open_error);
+    }
+
+    return view;
+}
+
+static void view_query_free(ViewQuery *query)
+{
+    g_free(query->path);
+    g_free(query);
+}
+
+static void open_view_thread(GTask *task, gpointer source_object, gpointer task_data,
+                             GCancellable *cancellable)
+{
+    ViewQuery *query = task_data;
+    GError *error = NULL;
+    HistoryView *view =
+        open_view(query->path, query->since, query->until, query->routine_mask, &error);
+
+    if (error != NULL) {
+        g_task_return_error(task, error);
+    } else {
+        g_task_return_pointer(task, view, (GDestroyNotify) history_view_free);
+    }
+}
+
+static void on_view_opened(GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+    g_autoptr(GError) error = NULL;
+    HistoryView *view = g_task_propagate_pointer(G_TASK(result), &error);
+
+    // Superseded by a newer filter or reload, or the model is gone.
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        return;
+    }
+
+    SamayaHistoryModel *self = SAMAYA_HISTORY_MODEL(source_object);
+    gboolean filter_changed = self->filter_changed;
+
+    g_clear_object(&self->loading);
+    self->filter_changed = FALSE;
+
+    if (error != NULL) {
+        g_warning("Failed to open the session history: %s", error->message);
+    }
+
+    guint old_n_items = set_view(self, view);
+
+    /*  Sessions are only ever added, and finished ones are the newest, so a reload under the same
+        filter is normally a few insertions at the top, which keeps the rows the list already shows
+        and its scroll position. Anything else is reported as a full change.
+    */
+    if (!filter_changed && self->n_items > old_n_items) {
+        g_list_model_items_changed(G_LIST_MODEL(self), 0, 0, self->n_items - old_n_items);
+    } else if (filter_changed ? (old_n_items > 0 || self->n_items > 0)
+                              : self->n_items != old_n_items) {
+        g_list_model_items_changed(G_LIST_MODEL(self), 0, old_n_items, self->n_items);
+    }
+}
+
+/*  Opens a view for the current filter on a worker thread. A routine filter has to decode every
+    record in range to count them, which would stall the dialog for a long history, so the model
+    keeps serving the previous view until the new one is swapped in. A newer load cancels the one
+    in flight, whose result is then dropped.
+*/
+static void start_loading(SamayaHistoryModel *self)
+{
+    ViewQuery *query = g_new0(ViewQuery, 1);
+    query->path = g_strdup(self->path);
+    query->since = self->since;
+    query->until = self->until;
+    query->routine_mask = self->routine_mask;
+
+    if (self->loading != NULL) {
+        g_cancellable_cancel(self->loading);
+        g_object_unref(self->loading);
+    }
+    self->loading = g_cancellable_new();
+
+    g_autoptr(GTask) task = g_task_new(self, self->loading, on_view_opened, NULL);
+    g_task_set_source_tag(task, start_loading);
+    g_task_set_task_data(task, query, (GDestroyNotify) view_query_free);
+    g_task_run_in_thread(task, open_view_thread);
+}
+
+
+/* ============================================================================
+ * GListModel Implementation
+ * ============================================================================ */
+
+static GType samaya_history_model_get_item_type(GListModel *list)
+{
+    return SAMAYA_TYPE_HISTORY_ITEM;
+}
+
+static guint samaya_history_model_get_n_items(GListModel *list)
+{
+    return SAMAYA_HISTORY_MODEL(list)->n_items;
+}
+
+static gpointer samaya_history_model_get_item(GListModel *list, guint position)
+{
+    SamayaHistoryModel *self = SAMAYA_HISTORY_MODEL(list);
+
+    if (position >= self->n_items) {
+        return NULL;
+    }
+
+    SamayaHistoryItem *item = g_object_new(SAMAYA_TYPE_HISTORY_ITEM, NULL);
+
+    // The view counts from the oldest session. A record that cannot be read stays zeroed rather
+    // than breaking the item count the list was told about.
+    history_view_get(self->view, self->n_items - 1 - position, &item->record);
+
+    return item;
+}
+
+static void samaya_history_model_list_model_init(GListModelInterface *iface)
+{
+    iface->get_item_type = samaya_history_model_get_item_type;
+    iface->get_n_items = samaya_history_model_get_n_items;
+    iface->get_item = samaya_history_model_get_item;
+}
+
+
+/* ============================================================================
+ * Samaya History Model Methods
+ * ============================================================================ */
+
+static void samaya_history_item_class_init(SamayaHistoryItemClass *klass)
+{
+}
+
+static void samaya_history_item_init(SamayaHistoryItem *self)
+{
+}
+
+static void samaya_history_model_dispose(GObject *object)
+{
+    SamayaHistoryModel *self = SAMAYA_HISTORY_MODEL(object);
+
+    if (self->loading != NULL) {
+        g_cancellable_cancel(self->loading);
+    }
+    g_clear_object(&self->loading);
+
+    G_OBJECT_CLASS(samaya_history_model_parent_class)->dispose(object);
+}
+
+static void samaya_history_model_finalize(GObject *object)
+{
+    SamayaHistoryModel *self = SAMAYA_HISTORY_MODEL(object);
+
+    g_clear_pointer(&self->view, history_view_free);
+    g_free(self->path);
+
+    G_OBJECT_CLASS(samaya_history_model_parent_class)->finalize(object);
+}
+
+static void samaya_history_model_class_init(SamayaHistoryModelClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+    object_class->dispose = samaya_history_model_dispose;
+    object_class->finalize = samaya_history_model_finalize;
+}
+
+static void samaya_history_model_init(SamayaHistoryModel *self)
+{
+    self->since = 0;
+    self->until = G_MAXINT64;
+    self->routine_mask = HISTORY_ROUTINES_ALL;
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+const HistoryRecord *samaya_history_item_get_record(SamayaHistoryItem *self)
+{
+    g_return_val_if_fail(SAMAYA_IS_HISTORY_ITEM(self), NULL);
+
+    return &self->record;
+}
+
+SamayaHistoryModel *samaya_history_model_new(const gchar *path)
+{
+    SamayaHistoryModel *self = g_object_new(SAMAYA_TYPE_HISTORY_MODEL, NULL);
+
+    g_autoptr(GError) error = NULL;
+
+    self->path = g_strdup(path);
+
+    // Without a filter the rows are counted from the segment headers, cheap enough to do here.
+    set_view(self, open_view(path, self->since, self->until, self->routine_mask, &error));
+
+    if (error != NULL) {
+        g_warning("Failed to open the session history: %s", error->message);
+    }
+
+    return self;
+}
+
+void samaya_history_model_set_filter(SamayaHistoryModel *self, gint64 since, gint64 until,
+                                     guint routine_mask)
+{
+    g_return_if_fail(SAMAYA_IS_HISTORY_MODEL(self));
+
+    if (self->since == since && self->until == until && self->routine_mask == routine_mask) {
+        return;
+    }
+
+    self->since = since;
+    self->until = until;
+    self->routine_mask = routine_mask;
+    self->filter_changed = TRUE;
+
+    start_loading(self);
+}
+
+void samaya_history_model_reload(SamayaHistoryModel *self)
+{
+    g_return_if_fail(SAMAYA_IS_HISTORY_MODEL(self));
+
+    start_loading(self);
+}
+
+gboolean samaya_history_model_is_loading(SamayaHistoryModel *self)
+{
+    g_return_val_if_fail(SAMAYA_IS_HISTORY_MODEL(self), FALSE);
+
+    return self->loading != NULL;
+}
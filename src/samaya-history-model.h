@@ -0,0 +1,62 @@
+/* samaya-history-model.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "samaya-history.h"
+
+G_BEGIN_DECLS
+
+#define SAMAYA_TYPE_HISTORY_ITEM (samaya_history_item_get_type())
+
+G_DECLARE_FINAL_TYPE(SamayaHistoryItem, samaya_history_item, SAMAYA, HISTORY_ITEM, GObject)
+
+const HistoryRecord *samaya_history_item_get_record(SamayaHistoryItem *self);
+
+#define SAMAYA_TYPE_HISTORY_MODEL (samaya_history_model_get_type())
+
+G_DECLARE_FINAL_TYPE(SamayaHistoryModel, samaya_history_model, SAMAYA, HISTORY_MODEL, GObject)
+
+/*  A GListModel of SamayaHistoryItem over the history at path (or the default one if NULL), newest
+    session first.
+
+    Items are created when they are asked for, from a HistoryView, so the model costs the same to
+    hold and scroll through whether the history has a hundred sessions or a million.
+*/
+SamayaHistoryModel *samaya_history_model_new(const gchar *path);
+
+/*  Limits the model to sessions started within [since, until] whose routine is in routine_mask,
+    see history_view_open.
+
+    The rows are counted on a worker thread. The model keeps its previous items until they are
+    replaced, with a single items-changed, once the count is done.
+*/
+void samaya_history_model_set_filter(SamayaHistoryModel *self, gint64 since, gint64 until,
+                                     guint routine_mask);
+
+// Picks up sessions that were added to the history since the model was filled, like
+// samaya_history_model_set_filter on a worker thread.
+void samaya_history_model_reload(SamayaHistoryModel *self);
+
+// Whether a filter change or reload is still being counted.
+gboolean samaya_history_model_is_loading(SamayaHistoryModel *self);
+
+G_END_DECLS
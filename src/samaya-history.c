@@ -0,0 +1,1576 @@
+/* samaya-history.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <errno.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <time.h>
+#include "samaya-history.h"
+#include "samaya-routine.h"
+#include "samaya-utils.h"
+
+
+/* ============================================================================
+ * On-disk Format
+ * ============================================================================
+ *
+ * The history is a directory of per-month segments, named YYYY-MM.seg after the UTC month their
+ * sessions started in. Inside a segment records are sorted by started_at, so a date range maps
+ * to a binary search over the segment names and then one inside the first segment.
+ *
+ *   header: magic[8] "SMYHSEG\n" | u32 version | u32 encoding | u32 record count |
+ *           u32 index entry count
+ *
+ * The open segment, the current month of the wall clock, uses the raw encoding, fixed size little
+ * endian records that are cheap to append to. Its record count is left at 0 and derived from the
+ * file size.
+ *
+ *   record: i64 started_at | u32 planned_seconds | u32 elapsed_seconds | u8 routine | u8 flags |
+ *           u8 reserved[6]
+ *
+ * Once a newer month gets its first session, older segments are rewritten with the compact
+ * encoding: a sparse index with an entry for every HISTORY_INDEX_INTERVAL records, followed by
+ * variable length records. The started_at delta is relative to the previous record of the same
+ * index block, the first record of a block stores the absolute time, so decoding can start at any
+ * index entry.
+ *
+ *   index:  i64 started_at of the block | u32 offset of the block from the end of the index
+ *   record: zigzag varint started_at delta | varint planned_seconds |
+ *           zigzag varint planned_seconds - elapsed_seconds | u8 routine | u8 flags
+ *
+ * Version 1 histories, a single history.bin file of raw records next to the directory, are split
+ * into segments the first time the history is used and kept as history.bin.v1. The file is read a
+ * chunk at a time into a staging directory, so its size does not matter.
+ *
+ * Next to it lives a small file of per-day focus totals, kept up to date on every append so views
+ * like the heatmap never have to scan the raw sessions. Entries are sorted by day.
+ *
+ *   header: magic[8] "SMYDAILY" | u32 version | u32 entry size
+ *   entry:  u32 julian day (local time) | u32 focus seconds
+ */
+
+#define HISTORY_MAGIC_LEN 8
+#define HISTORY_HEADER_SIZE 16
+#define HISTORY_RECORD_SIZE 24
+
+#define SEGMENT_MAGIC "SMYHSEG\n"
+#define SEGMENT_VERSION 2
+#define SEGMENT_HEADER_SIZE 24
+#define SEGMENT_SUFFIX ".seg"
+#define SEGMENT_NAME_LEN 11
+#define SEGMENT_ENCODING_RAW 0
+#define SEGMENT_ENCODING_COMPACT 1
+
+#define HISTORY_INDEX_INTERVAL 64
+#define HISTORY_INDEX_ENTRY_SIZE 12
+#define HISTORY_VARINT_SIZE_MAX 10
+
+#define HISTORY_VIEW_CACHE_PAGES 8
+
+#define LEGACY_FILE_NAME "history.bin"
+#define LEGACY_MAGIC "SMYHIST\n"
+#define LEGACY_VERSION 1
+
+#define DAILY_FILE_NAME "daily.bin"
+#define DAILY_MAGIC "SMYDAILY"
+#define DAILY_VERSION 1
+#define DAILY_ENTRY_SIZE 8
+
+typedef struct
+{
+    guint32 encoding;
+    guint32 record_count;
+    guint32 index_count;
+} SegmentHeader;
+
+// Sequential decoder over a single memory mapped segment.
+typedef struct
+{
+    GMappedFile *mapped;
+    SegmentHeader header;
+
+    const guint8 *index;
+    const guint8 *data;
+    const guint8 *end;
+
+    const guint8 *position;
+    guint32 record_index;
+    gint64 previous_started_at;
+} SegmentCursor;
+
+struct HistoryReader
+{
+    gchar *dir;
+
+    // Segment file names in ascending order, opened one at a time as the reader reaches them.
+    GPtrArray *segments;
+    guint next_segment;
+
+    SegmentCursor cursor;
+    gboolean cursor_open;
+
+    gint64 since;
+    gint64 until;
+};
+
+// One index block of a segment, the unit a view counts, decodes and caches records in.
+typedef struct
+{
+    guint32 segment;
+    guint32 block;
+
+    // Number of matching records in this page and all the ones before it.
+    guint32 end;
+} HistoryPage;
+
+typedef struct
+{
+    guint32 page;
+    guint32 count;
+
+    // 0 while the slot is unused, otherwise when it was last looked up.
+    guint64 last_used;
+
+    HistoryRecord records[HISTORY_INDEX_INTERVAL];
+} HistoryPageCache;
+
+struct HistoryView
+{
+    // A cursor per segment in range. The segments stay mapped for the lifetime of the view but
+    // only the pages that are looked up are ever read.
+    GArray *cursors;
+    GArray *pages;
+
+    gint64 since;
+    gint64 until;
+    guint routine_mask;
+
+    HistoryPageCache cache[HISTORY_VIEW_CACHE_PAGES];
+    guint64 cache_clock;
+};
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static void encode_file_header(guint8 *out, const char *magic, guint32 version,
+                               guint32 record_size)
+{
+    version = GUINT32_TO_LE(version);
+    record_size = GUINT32_TO_LE(record_size);
+
+    memcpy(out, magic, HISTORY_MAGIC_LEN);
+    memcpy(out + 8, &version, sizeof(version));
+    memcpy(out + 12, &record_size, sizeof(record_size));
+}
+
+static gboolean check_file_header(const guint8 *in, const char *magic, guint32 expected_version,
+                                  guint32 expected_record_size)
+{
+    guint32 version;
+    guint32 record_size;
+
+    memcpy(&version, in + 8, sizeof(version));
+    memcpy(&record_size, in + 12, sizeof(record_size));
+
+    return memcmp(in, magic, HISTORY_MAGIC_LEN) == 0 &&
+           GUINT32_FROM_LE(version) == expected_version &&
+           GUINT32_FROM_LE(record_size) == expected_record_size;
+}
+
+static void encode_record(const HistoryRecord *record, guint8 *out)
+{
+    gint64 started_at = GINT64_TO_LE(record->started_at);
+    guint32 planned = GUINT32_TO_LE(record->planned_seconds);
+    guint32 elapsed = GUINT32_TO_LE(record->elapsed_seconds);
+
+    memset(out, 0, HISTORY_RECORD_SIZE);
+    memcpy(out, &started_at, sizeof(started_at));
+    memcpy(out + 8, &planned, sizeof(planned));
+    memcpy(out + 12, &elapsed, sizeof(elapsed));
+    out[16] = record->routine;
+    out[17] = record->flags;
+}
+
+static void decode_record(const guint8 *in, HistoryRecord *record)
+{
+    gint64 started_at;
+    guint32 planned;
+    guint32 elapsed;
+
+    memcpy(&started_at, in, sizeof(started_at));
+    memcpy(&planned, in + 8, sizeof(planned));
+    memcpy(&elapsed, in + 12, sizeof(elapsed));
+
+    record->started_at = GINT64_FROM_LE(started_at);
+    record->planned_seconds = GUINT32_FROM_LE(planned);
+    record->elapsed_seconds = GUINT32_FROM_LE(elapsed);
+    record->routine = in[16];
+    record->flags = in[17];
+}
+
+static gint64 read_started_at(const guint8 *in)
+{
+    gint64 started_at;
+
+    memcpy(&started_at, in, sizeof(started_at));
+    return GINT64_FROM_LE(started_at);
+}
+
+static guint32 read_u32(const guint8 *in)
+{
+    guint32 value;
+
+    memcpy(&value, in, sizeof(value));
+    return GUINT32_FROM_LE(value);
+}
+
+static void write_u32(guint8 *out, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    memcpy(out, &value, sizeof(value));
+}
+
+static void encode_segment_header(guint8 *out, const SegmentHeader *header)
+{
+    encode_file_header(out, SEGMENT_MAGIC, SEGMENT_VERSION, header->encoding);
+    write_u32(out + 16, header->record_count);
+    write_u32(out + 20, header->index_count);
+}
+
+static gboolean decode_segment_header(const guint8 *in, gsize size, SegmentHeader *header)
+{
+    if (size < SEGMENT_HEADER_SIZE || memcmp(in, SEGMENT_MAGIC, HISTORY_MAGIC_LEN) != 0 ||
+        read_u32(in + 8) != SEGMENT_VERSION) {
+        return FALSE;
+    }
+
+    header->encoding = read_u32(in + 12);
+    header->record_count = read_u32(in + 16);
+    header->index_count = read_u32(in + 20);
+
+    return header->encoding == SEGMENT_ENCODING_RAW ||
+           header->encoding == SEGMENT_ENCODING_COMPACT;
+}
+
+static void segment_name_for_time(gint64 started_at, char *out, gsize out_len)
+{
+    g_autoptr(GDateTime) date_time = g_date_time_new_from_unix_utc(started_at);
+
+    if (date_time == NULL) {
+        // Outside of what GDateTime can represent, sort before or after every real month.
+        g_strlcpy(out, started_at < 0 ? "0000-00" SEGMENT_SUFFIX : "9999-99" SEGMENT_SUFFIX,
+                  out_len);
+        return;
+    }
+
+    g_snprintf(out, out_len, "%04d-%02d" SEGMENT_SUFFIX, g_date_time_get_year(date_time),
+               g_date_time_get_month(date_time));
+}
+
+static gint compare_segment_names(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*(const gchar *const *) a, *(const gchar *const *) b);
+}
+
+static GPtrArray *list_segments(const gchar *dir)
+{
+    GPtrArray *segments = g_ptr_array_new_with_free_func(g_free);
+    GDir *handle = g_dir_open(dir, 0, NULL);
+    const gchar *name;
+
+    if (handle == NULL) {
+        return segments;
+    }
+
+    while ((name = g_dir_read_name(handle)) != NULL) {
+        if (strlen(name) == SEGMENT_NAME_LEN && g_str_has_suffix(name, SEGMENT_SUFFIX)) {
+            g_ptr_array_add(segments, g_strdup(name));
+        }
+    }
+    g_dir_close(handle);
+
+    g_ptr_array_sort(segments, compare_segment_names);
+    return segments;
+}
+
+// Returns the index of the first segment whose name is not before name.
+static guint find_segment(GPtrArray *segments, const char *name)
+{
+    guint low = 0;
+    guint high = segments->len;
+
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+
+        if (strcmp(g_ptr_array_index(segments, mid), name) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static void segment_cursor_close(SegmentCursor *cursor)
+{
+    g_clear_pointer(&cursor->mapped, g_mapped_file_unref);
+}
+
+static gboolean segment_cursor_open(SegmentCursor *cursor, const gchar *path, GError **error)
+{
+    memset(cursor, 0, sizeof(*cursor));
+
+    cursor->mapped = g_mapped_file_new(path, FALSE, error);
+    if (cursor->mapped == NULL) {
+        return FALSE;
+    }
+
+    const guint8 *base = (const guint8 *) g_mapped_file_get_contents(cursor->mapped);
+    gsize size = g_mapped_file_get_length(cursor->mapped);
+
+    if (!decode_segment_header(base, size, &cursor->header)) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                    "%s is not a supported history segment", path);
+        segment_cursor_close(cursor);
+        return FALSE;
+    }
+
+    cursor->end = base + size;
+
+    if (cursor->header.encoding == SEGMENT_ENCODING_RAW) {
+        cursor->data = base + SEGMENT_HEADER_SIZE;
+        cursor->header.record_count = (size - SEGMENT_HEADER_SIZE) / HISTORY_RECORD_SIZE;
+        cursor->header.index_count = 0;
+    } else {
+        gsize index_size = (gsize) cursor->header.index_count * HISTORY_INDEX_ENTRY_SIZE;
+
+        if (index_size > size - SEGMENT_HEADER_SIZE) {
+            g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                        "History segment %s is truncated", path);
+            segment_cursor_close(cursor);
+            return FALSE;
+        }
+
+        cursor->index = base + SEGMENT_HEADER_SIZE;
+        cursor->data = cursor->index + index_size;
+    }
+
+    cursor->position = cursor->data;
+    return TRUE;
+}
+
+// Positions the cursor on the first record of an index block. Leaves it untouched and returns
+// FALSE if the segment has no such block.
+static gboolean segment_cursor_seek_block(SegmentCursor *cursor, guint32 block)
+{
+    guint64 first = (guint64) block * HISTORY_INDEX_INTERVAL;
+
+    if (first >= cursor->header.record_count) {
+        return FALSE;
+    }
+
+    if (cursor->header.encoding == SEGMENT_ENCODING_RAW) {
+        cursor->position = cursor->data + first * HISTORY_RECORD_SIZE;
+        cursor->record_index = (guint32) first;
+        return TRUE;
+    }
+
+    if (block >= cursor->header.index_count) {
+        return FALSE;
+    }
+
+    guint32 offset = read_u32(cursor->index + (gsize) block * HISTORY_INDEX_ENTRY_SIZE + 8);
+    if (offset > (gsize) (cursor->end - cursor->data)) {
+        return FALSE;
+    }
+
+    cursor->position = cursor->data + offset;
+    cursor->record_index = (guint32) first;
+    return TRUE;
+}
+
+// Positions the cursor on the first record that could have started at or after since. Raw
+// segments are searched record by record, compact ones through their sparse index, after which at
+// most one index block has to be decoded and skipped.
+static void segment_cursor_seek(SegmentCursor *cursor, gint64 since)
+{
+    guint32 low = 0;
+
+    if (cursor->header.encoding == SEGMENT_ENCODING_RAW) {
+        guint32 high = cursor->header.record_count;
+
+        while (low < high) {
+            guint32 mid = low + (high - low) / 2;
+
+            if (read_started_at(cursor->data + (gsize) mid * HISTORY_RECORD_SIZE) < since) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        cursor->position = cursor->data + (gsize) low * HISTORY_RECORD_SIZE;
+        cursor->record_index = low;
+        return;
+    }
+
+    guint32 high = cursor->header.index_count;
+
+    while (low < high) {
+        guint32 mid = low + (high - low) / 2;
+
+        if (read_started_at(cursor->index + (gsize) mid * HISTORY_INDEX_ENTRY_SIZE) < since) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    // The block before the first one starting at or after since may still contain matches.
+    segment_cursor_seek_block(cursor, (low > 0) ? low - 1 : 0);
+}
+
+static gboolean segment_cursor_next(SegmentCursor *cursor, HistoryRecord *record)
+{
+    if (cursor->record_index >= cursor->header.record_count) {
+        return FALSE;
+    }
+
+    if (cursor->header.encoding == SEGMENT_ENCODING_RAW) {
+        if (cursor->end - cursor->position < HISTORY_RECORD_SIZE) {
+            return FALSE;
+        }
+
+        decode_record(cursor->position, record);
+        cursor->position += HISTORY_RECORD_SIZE;
+        cursor->record_index++;
+        return TRUE;
+    }
+
+    guint64 delta, planned, difference;
+
+    if (cursor->record_index % HISTORY_INDEX_INTERVAL == 0) {
+        cursor->previous_started_at = 0;
+    }
+
+    if (!get_varint(&cursor->position, cursor->end, &delta) ||
+        !get_varint(&cursor->position, cursor->end, &planned) ||
+        !get_varint(&cursor->position, cursor->end, &difference) ||
+        cursor->end - cursor->position < 2) {
+        return FALSE;
+    }
+
+    record->started_at = cursor->previous_started_at + zigzag_decode(delta);
+    record->planned_seconds = (guint32) planned;
+    record->elapsed_seconds = (guint32) ((gint64) planned - zigzag_decode(difference));
+    record->routine = *cursor->position++;
+    record->flags = *cursor->position++;
+
+    cursor->previous_started_at = record->started_at;
+    cursor->record_index++;
+
+    return TRUE;
+}
+
+static gboolean load_segment(const gchar *path, GArray *records, GError **error)
+{
+    SegmentCursor cursor;
+    HistoryRecord record;
+
+    if (!segment_cursor_open(&cursor, path, error)) {
+        return FALSE;
+    }
+
+    while (segment_cursor_next(&cursor, &record)) {
+        g_array_append_val(records, record);
+    }
+
+    segment_cursor_close(&cursor);
+    return TRUE;
+}
+
+static gboolean write_segment(const gchar *path, const HistoryRecord *records, guint count,
+                              guint32 encoding, GError **error)
+{
+    SegmentHeader header = {.encoding = encoding};
+    g_autoptr(GByteArray) buffer = g_byte_array_new();
+    guint8 scratch[MAX(HISTORY_RECORD_SIZE, 3 * HISTORY_VARINT_SIZE_MAX + 2)];
+
+    if (encoding == SEGMENT_ENCODING_COMPACT) {
+        header.record_count = count;
+        header.index_count = (count + HISTORY_INDEX_INTERVAL - 1) / HISTORY_INDEX_INTERVAL;
+    }
+
+    gsize data_start = SEGMENT_HEADER_SIZE + (gsize) header.index_count * HISTORY_INDEX_ENTRY_SIZE;
+    g_byte_array_set_size(buffer, data_start);
+    memset(buffer->data, 0, data_start);
+    encode_segment_header(buffer->data, &header);
+
+    gint64 previous_started_at = 0;
+
+    for (guint i = 0; i < count; i++) {
+        const HistoryRecord *record = &records[i];
+
+        if (encoding == SEGMENT_ENCODING_RAW) {
+            encode_record(record, scratch);
+            g_byte_array_append(buffer, scratch, HISTORY_RECORD_SIZE);
+            continue;
+        }
+
+        if (i % HISTORY_INDEX_INTERVAL == 0) {
+            guint8 *entry = buffer->data + SEGMENT_HEADER_SIZE +
+                            (gsize) (i / HISTORY_INDEX_INTERVAL) * HISTORY_INDEX_ENTRY_SIZE;
+            gint64 started_at = GINT64_TO_LE(record->started_at);
+
+            memcpy(entry, &started_at, sizeof(started_at));
+            write_u32(entry + 8, (guint32) (buffer->len - data_start));
+            previous_started_at = 0;
+        }
+
+        gsize length = 0;
+        length += put_varint(scratch + length,
+                             zigzag_encode(record->started_at - previous_started_at));
+        length += put_varint(scratch + length, record->planned_seconds);
+        length += put_varint(scratch + length, zigzag_encode((gint64) record->planned_seconds -
+                                                             record->elapsed_seconds));
+        scratch[length++] = record->routine;
+        scratch[length++] = record->flags;
+
+        g_byte_array_append(buffer, scratch, length);
+        previous_started_at = record->started_at;
+    }
+
+    return g_file_set_contents(path, (const gchar *) buffer->data, buffer->len, error);
+}
+
+static gint compare_records(gconstpointer a, gconstpointer b)
+{
+    gint64 first = ((const HistoryRecord *) a)->started_at;
+    gint64 second = ((const HistoryRecord *) b)->started_at;
+
+    return (first > second) - (first < second);
+}
+
+/*  Adds record to the segment at path, creating it if needed. Appending to the end of a raw
+    segment is a plain write, anything else (a compacted month or a record older than the newest
+    one, after the wall clock was moved back) rewrites the segment with the record in place. The
+    open segment is always rewritten raw, so it is cheap to append to again.
+*/
+static gboolean add_to_segment(const gchar *path, const HistoryRecord *record, gboolean open,
+                               gboolean *created, GError **error)
+{
+    SegmentCursor cursor;
+
+    *created = !g_file_test(path, G_FILE_TEST_EXISTS);
+    if (*created) {
+        return write_segment(path, record, 1, SEGMENT_ENCODING_RAW, error);
+    }
+
+    if (!segment_cursor_open(&cursor, path, error)) {
+        return FALSE;
+    }
+
+    guint32 encoding = cursor.header.encoding;
+    guint32 count = cursor.header.record_count;
+    gboolean append = (encoding == SEGMENT_ENCODING_RAW) &&
+                      (count == 0 || read_started_at(cursor.data + (gsize) (count - 1) *
+                                                                       HISTORY_RECORD_SIZE) <=
+                                         record->started_at);
+    segment_cursor_close(&cursor);
+
+    if (append) {
+        guint8 raw[HISTORY_RECORD_SIZE];
+        FILE *file = g_fopen(path, "ab");
+
+        if (file == NULL) {
+            int saved_errno = errno;
+            g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                        "Failed to open history segment %s: %s", path, g_strerror(saved_errno));
+            return FALSE;
+        }
+
+        encode_record(record, raw);
+        gboolean ok = fwrite(raw, sizeof(raw), 1, file) == 1;
+        ok = (fclose(file) == 0) && ok;
+
+        if (!ok) {
+            g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_IO,
+                        "Failed to write history segment %s", path);
+        }
+        return ok;
+    }
+
+    g_autoptr(GArray) records = g_array_new(FALSE, FALSE, sizeof(HistoryRecord));
+    if (!load_segment(path, records, error)) {
+        return FALSE;
+    }
+
+    guint position = records->len;
+    while (position > 0 &&
+           g_array_index(records, HistoryRecord, position - 1).started_at > record->started_at) {
+        position--;
+    }
+    g_array_insert_val(records, position, *record);
+
+    return write_segment(path, (const HistoryRecord *) records->data, records->len,
+                         open ? SEGMENT_ENCODING_RAW : encoding, error);
+}
+
+static gboolean merge_into_segment(const gchar *dir, const char *name,
+                                   const HistoryRecord *records, guint count, GError **error)
+{
+    g_autofree gchar *path = g_build_filename(dir, name, NULL);
+    g_autoptr(GArray) merged = g_array_new(FALSE, FALSE, sizeof(HistoryRecord));
+
+    if (g_file_test(path, G_FILE_TEST_EXISTS) && !load_segment(path, merged, error)) {
+        return FALSE;
+    }
+
+    gboolean sorted = merged->len == 0 ||
+                      g_array_index(merged, HistoryRecord, merged->len - 1).started_at <=
+                          records[0].started_at;
+
+    g_array_append_vals(merged, records, count);
+    if (!sorted) {
+        g_array_sort(merged, compare_records);
+    }
+
+    // Written raw, compact_segments takes care of every month but the open one.
+    return write_segment(path, (const HistoryRecord *) merged->data, merged->len,
+                         SEGMENT_ENCODING_RAW, error);
+}
+
+// Merges records, sorted by started_at, into the segments of their months in dir.
+static gboolean merge_sorted_records(const gchar *dir, const HistoryRecord *records, guint count,
+                                     GError **error)
+{
+    char name[32];
+    char next_name[32];
+    guint start = 0;
+
+    if (count == 0) {
+        return TRUE;
+    }
+
+    segment_name_for_time(records[0].started_at, name, sizeof(name));
+
+    while (start < count) {
+        guint end = start + 1;
+
+        for (; end < count; end++) {
+            segment_name_for_time(records[end].started_at, next_name, sizeof(next_name));
+            if (strcmp(next_name, name) != 0) {
+                break;
+            }
+        }
+
+        if (!merge_into_segment(dir, name, records + start, end - start, error)) {
+            return FALSE;
+        }
+
+        g_strlcpy(name, next_name, sizeof(name));
+        start = end;
+    }
+
+    return TRUE;
+}
+
+// Sets out to the name of the segment sessions are appended to now, the UTC month of the clock.
+static void get_open_segment_name(char *out, gsize out_len)
+{
+    segment_name_for_time(g_get_real_time() / G_USEC_PER_SEC, out, out_len);
+}
+
+/*  Rewrites every raw segment but open_name with the compact encoding. The open segment is named
+    explicitly rather than taken to be the newest one, as a session dated in the future (a wall
+    clock set ahead, or an import) must not get the month that is still being appended to
+    compacted.
+*/
+static gboolean compact_segments(const gchar *dir, const char *open_name, GError **error)
+{
+    g_autoptr(GPtrArray) segments = list_segments(dir);
+
+    for (guint i = 0; i < segments->len; i++) {
+        if (strcmp(g_ptr_array_index(segments, i), open_name) == 0) {
+            continue;
+        }
+
+        g_autofree gchar *path = g_build_filename(dir, g_ptr_array_index(segments, i), NULL);
+        g_autoptr(GArray) records = g_array_new(FALSE, FALSE, sizeof(HistoryRecord));
+        SegmentCursor cursor;
+
+        if (!segment_cursor_open(&cursor, path, error)) {
+            return FALSE;
+        }
+
+        guint32 encoding = cursor.header.encoding;
+        segment_cursor_close(&cursor);
+
+        if (encoding == SEGMENT_ENCODING_COMPACT) {
+            continue;
+        }
+
+        if (!load_segment(path, records, error) ||
+            !write_segment(path, (const HistoryRecord *) records->data, records->len,
+                           SEGMENT_ENCODING_COMPACT, error)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+#define LEGACY_MIGRATION_CHUNK 65536
+
+// Removes the segments in dir and then dir itself, which must hold nothing else.
+static void remove_segments_dir(const gchar *dir)
+{
+    g_autoptr(GPtrArray) segments = list_segments(dir);
+
+    for (guint i = 0; i < segments->len; i++) {
+        g_autofree gchar *path = g_build_filename(dir, g_ptr_array_index(segments, i), NULL);
+        g_remove(path);
+    }
+
+    g_rmdir(dir);
+}
+
+/*  Splits a version 1 history file, if one is left next to dir, into segments.
+
+    The file is read LEGACY_MIGRATION_CHUNK records at a time and merged into segments in a staging
+    directory next to dir, so memory use is bounded by a chunk and the largest month. Only once
+    every record is in, the segments are moved into dir and the file is put aside, so a migration
+    that was interrupted simply starts over.
+*/
+static gboolean migrate_legacy_history(const gchar *dir, GError **error)
+{
+    g_autofree gchar *parent = g_path_get_dirname(dir);
+    g_autofree gchar *legacy_path = g_build_filename(parent, LEGACY_FILE_NAME, NULL);
+
+    if (!g_file_test(legacy_path, G_FILE_TEST_IS_REGULAR)) {
+        return TRUE;
+    }
+
+    guint8 header[HISTORY_HEADER_SIZE];
+    guint8 raw[HISTORY_RECORD_SIZE];
+    HistoryRecord record;
+
+    FILE *file = g_fopen(legacy_path, "rb");
+    if (file == NULL) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to open history file %s: %s", legacy_path, g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    if (fread(header, sizeof(header), 1, file) != 1 ||
+        !check_file_header(header, LEGACY_MAGIC, LEGACY_VERSION, HISTORY_RECORD_SIZE)) {
+        fclose(file);
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                    "%s is not a supported history file", legacy_path);
+        return FALSE;
+    }
+
+    g_autofree gchar *staging = g_strconcat(dir, ".migrating", NULL);
+    remove_segments_dir(staging);
+
+    if (g_mkdir_with_parents(staging, 0700) != 0 || g_mkdir_with_parents(dir, 0700) != 0) {
+        int saved_errno = errno;
+        fclose(file);
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to create history directory %s: %s", dir, g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    g_autoptr(GArray) chunk =
+        g_array_sized_new(FALSE, FALSE, sizeof(HistoryRecord), LEGACY_MIGRATION_CHUNK);
+    guint64 migrated = 0;
+    gboolean ok = TRUE;
+
+    while (ok) {
+        g_array_set_size(chunk, 0);
+        while (chunk->len < LEGACY_MIGRATION_CHUNK && fread(raw, sizeof(raw), 1, file) == 1) {
+            decode_record(raw, &record);
+            g_array_append_val(chunk, record);
+        }
+
+        if (chunk->len == 0) {
+            break;
+        }
+
+        // Sessions are mostly in order already, so a month is rarely rewritten more than once.
+        g_array_sort(chunk, compare_records);
+        ok = merge_sorted_records(staging, (const HistoryRecord *) chunk->data, chunk->len, error);
+        migrated += chunk->len;
+    }
+
+    if (ok && ferror(file)) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_IO, "Failed to read history file %s",
+                    legacy_path);
+        ok = FALSE;
+    }
+    fclose(file);
+
+    g_autoptr(GPtrArray) segments = list_segments(staging);
+    for (guint i = 0; ok && i < segments->len; i++) {
+        g_autofree gchar *from = g_build_filename(staging, g_ptr_array_index(segments, i), NULL);
+        g_autofree gchar *to = g_build_filename(dir, g_ptr_array_index(segments, i), NULL);
+
+        if (g_rename(from, to) != 0) {
+            int saved_errno = errno;
+            g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                        "Failed to move %s into the history: %s", from, g_strerror(saved_errno));
+            ok = FALSE;
+        }
+    }
+
+    remove_segments_dir(staging);
+    if (!ok) {
+        return FALSE;
+    }
+
+    char open_name[32];
+    g_autoptr(GError) compact_error = NULL;
+    get_open_segment_name(open_name, sizeof(open_name));
+    if (!compact_segments(dir, open_name, &compact_error)) {
+        g_warning("Failed to compact history segments: %s", compact_error->message);
+    }
+
+    g_autofree gchar *kept_path = g_strconcat(legacy_path, ".v1", NULL);
+    if (g_rename(legacy_path, kept_path) != 0) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to move %s aside: %s", legacy_path, g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    g_info("Migrated %" G_GUINT64_FORMAT " sessions from %s", migrated, legacy_path);
+    return TRUE;
+}
+
+static gchar *get_daily_path(const gchar *history_path)
+{
+    g_autofree gchar *dir = g_path_get_dirname(history_path);
+    return g_build_filename(dir, DAILY_FILE_NAME, NULL);
+}
+
+static gboolean read_daily_entry(FILE *file, gint64 index, guint32 *julian_day, guint32 *seconds)
+{
+    guint32 raw[2];
+
+    if (fseeko(file, HISTORY_HEADER_SIZE + index * DAILY_ENTRY_SIZE, SEEK_SET) != 0 ||
+        fread(raw, sizeof(raw), 1, file) != 1) {
+        return FALSE;
+    }
+
+    *julian_day = GUINT32_FROM_LE(raw[0]);
+    *seconds = GUINT32_FROM_LE(raw[1]);
+    return TRUE;
+}
+
+static gboolean write_daily_entry(FILE *file, gint64 index, guint32 julian_day, guint32 seconds)
+{
+    guint32 raw[2] = {GUINT32_TO_LE(julian_day), GUINT32_TO_LE(seconds)};
+
+    return fseeko(file, HISTORY_HEADER_SIZE + index * DAILY_ENTRY_SIZE, SEEK_SET) == 0 &&
+           fwrite(raw, sizeof(raw), 1, file) == 1;
+}
+
+static gint64 count_daily_entries(FILE *file)
+{
+    if (fseeko(file, 0, SEEK_END) != 0) {
+        return -1;
+    }
+
+    return (ftello(file) - HISTORY_HEADER_SIZE) / DAILY_ENTRY_SIZE;
+}
+
+// Returns the index of the first entry whose day is not before julian_day, or -1 on read errors.
+static gint64 find_daily_entry(FILE *file, gint64 count, guint32 julian_day)
+{
+    gint64 low = 0;
+    gint64 high = count;
+
+    while (low < high) {
+        gint64 mid = low + (high - low) / 2;
+        guint32 day, seconds;
+
+        if (!read_daily_entry(file, mid, &day, &seconds)) {
+            return -1;
+        }
+
+        if (day < julian_day) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/*  Writes the daily totals again from the session records, replacing a file that is damaged or
+    could not be written. A missing day file is not an error anywhere, so when even this fails the
+    damaged file is removed rather than left behind.
+*/
+static gboolean rebuild_daily_aggregate(const gchar *history_path, const gchar *path)
+{
+    g_autoptr(GByteArray) buffer = g_byte_array_new();
+    guint8 header[HISTORY_HEADER_SIZE];
+    guint32 day = 0, total = 0;
+
+    encode_file_header(header, DAILY_MAGIC, DAILY_VERSION, DAILY_ENTRY_SIZE);
+    g_byte_array_append(buffer, header, sizeof(header));
+
+    HistoryReader *reader = history_reader_open(history_path, G_MININT64, G_MAXINT64, NULL);
+    HistoryRecord record;
+    GDate date;
+    g_date_clear(&date, 1);
+
+    while (reader != NULL && history_reader_next(reader, &record)) {
+        if (record.routine != Working || record.elapsed_seconds == 0) {
+            continue;
+        }
+
+        g_date_set_time_t(&date, (time_t) record.started_at);
+        guint32 julian_day = g_date_get_julian(&date);
+
+        if (julian_day != day && total > 0) {
+            guint32 raw[2] = {GUINT32_TO_LE(day), GUINT32_TO_LE(total)};
+            g_byte_array_append(buffer, (const guint8 *) raw, sizeof(raw));
+            total = 0;
+        }
+
+        day = julian_day;
+        total += record.elapsed_seconds;
+    }
+
+    if (total > 0) {
+        guint32 raw[2] = {GUINT32_TO_LE(day), GUINT32_TO_LE(total)};
+        g_byte_array_append(buffer, (const guint8 *) raw, sizeof(raw));
+    }
+
+    g_autoptr(GError) error = NULL;
+    if (reader == NULL ||
+        !g_file_set_contents(path, (const gchar *) buffer->data, buffer->len, &error)) {
+        g_warning("Failed to rebuild %s, removing it: %s", path,
+                  error != NULL ? error->message : "history not readable");
+        g_remove(path);
+        g_clear_pointer(&reader, history_reader_free);
+        return FALSE;
+    }
+
+    history_reader_free(reader);
+    g_info("Rebuilt the daily focus totals in %s", path);
+    return TRUE;
+}
+
+/*  Adds seconds to the total of the day started_at falls on. When the file turns out damaged it is
+    rebuilt from the session records, which already hold this one, and rebuilt is set.
+*/
+static gboolean add_to_daily_aggregate(const gchar *history_path, gint64 started_at,
+                                       guint32 seconds, gboolean *rebuilt)
+{
+    g_autofree gchar *path = get_daily_path(history_path);
+    guint8 header[HISTORY_HEADER_SIZE];
+
+    GDate date;
+    g_date_clear(&date, 1);
+    g_date_set_time_t(&date, (time_t) started_at);
+    guint32 julian_day = g_date_get_julian(&date);
+
+    FILE *file = g_fopen(path, "r+b");
+    if (file == NULL && errno == ENOENT) {
+        file = g_fopen(path, "w+b");
+        if (file != NULL) {
+            encode_file_header(header, DAILY_MAGIC, DAILY_VERSION, DAILY_ENTRY_SIZE);
+            if (fwrite(header, sizeof(header), 1, file) != 1) {
+                // Without a header every later update would fail on it.
+                fclose(file);
+                *rebuilt = TRUE;
+                return rebuild_daily_aggregate(history_path, path);
+            }
+        }
+    } else if (file != NULL) {
+        if (fread(header, sizeof(header), 1, file) != 1 ||
+            !check_file_header(header, DAILY_MAGIC, DAILY_VERSION, DAILY_ENTRY_SIZE)) {
+            fclose(file);
+            *rebuilt = TRUE;
+            return rebuild_daily_aggregate(history_path, path);
+        }
+    }
+
+    if (file == NULL) {
+        return FALSE;
+    }
+
+    gint64 count = count_daily_entries(file);
+    gint64 index = count < 0 ? -1 : find_daily_entry(file, count, julian_day);
+    gboolean ok = index >= 0;
+
+    guint32 day = 0, total = 0;
+    if (ok && index < count) {
+        ok = read_daily_entry(file, index, &day, &total);
+    }
+
+    if (ok && index < count && day == julian_day) {
+        ok = write_daily_entry(file, index, julian_day, total + seconds);
+    } else if (ok && index == count) {
+        ok = write_daily_entry(file, index, julian_day, seconds);
+    } else if (ok) {
+        // A day before the newest one, only happens after the wall clock was moved back. The
+        // file is a few kilobytes per year, so shifting the tail is cheap.
+        gsize tail_size = (count - index) * DAILY_ENTRY_SIZE;
+        g_autofree guint8 *tail = g_malloc(tail_size);
+
+        ok = fseeko(file, HISTORY_HEADER_SIZE + index * DAILY_ENTRY_SIZE, SEEK_SET) == 0 &&
+             fread(tail, tail_size, 1, file) == 1 &&
+             write_daily_entry(file, index, julian_day, seconds) &&
+             fwrite(tail, tail_size, 1, file) == 1;
+    }
+
+    return (fclose(file) == 0) && ok;
+}
+
+static gboolean record_in_view(const HistoryView *view, const HistoryRecord *record)
+{
+    return record->started_at >= view->since && record->started_at <= view->until &&
+           (view->routine_mask == HISTORY_ROUTINES_ALL ||
+            (record->routine < 32 && (view->routine_mask & (1u << record->routine)) != 0));
+}
+
+// Decodes the records of page that match the view into records, returning how many did.
+static guint32 decode_page(HistoryView *view, const HistoryPage *page, HistoryRecord *records)
+{
+    SegmentCursor *cursor = &g_array_index(view->cursors, SegmentCursor, page->segment);
+    guint64 block_end = ((guint64) page->block + 1) * HISTORY_INDEX_INTERVAL;
+    HistoryRecord record;
+    guint32 count = 0;
+
+    if (!segment_cursor_seek_block(cursor, page->block)) {
+        return 0;
+    }
+
+    while (cursor->record_index < block_end && segment_cursor_next(cursor, &record)) {
+        if (record_in_view(view, &record)) {
+            records[count++] = record;
+        }
+    }
+
+    return count;
+}
+
+static const HistoryPageCache *lookup_page(HistoryView *view, guint32 page)
+{
+    HistoryPageCache *victim = &view->cache[0];
+
+    for (guint i = 0; i < HISTORY_VIEW_CACHE_PAGES; i++) {
+        HistoryPageCache *entry = &view->cache[i];
+
+        if (entry->last_used > 0 && entry->page == page) {
+            entry->last_used = ++view->cache_clock;
+            return entry;
+        }
+        if (entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+
+    victim->page = page;
+    victim->count = decode_page(view, &g_array_index(view->pages, HistoryPage, page),
+                                victim->records);
+    victim->last_used = ++view->cache_clock;
+
+    return victim;
+}
+
+// Writes records, sorted by started_at and all from the month of name, into that segment along
+// with the ones it already holds.
+static gboolean open_history_dir(const gchar *path, GError **error)
+{
+    if (!migrate_legacy_history(path, error)) {
+        return FALSE;
+    }
+
+    if (!g_file_test(path, G_FILE_TEST_IS_DIR)) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_NOENT, "Failed to open history %s: %s",
+                    path, g_strerror(ENOENT));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void format_timestamp(gint64 unix_seconds, char *out, gsize out_len)
+{
+    time_t time_value = (time_t) unix_seconds;
+    struct tm utc;
+
+    if (gmtime_r(&time_value, &utc) == NULL ||
+        strftime(out, out_len, "%Y-%m-%dT%H:%M:%SZ", &utc) == 0) {
+        g_strlcpy(out, "", out_len);
+    }
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+const gchar *history_get_default_path(void)
+{
+    static gchar *path = NULL;
+
+    if (g_once_init_enter(&path)) {
+        gchar *default_path = g_build_filename(g_get_user_data_dir(), "samaya", "history", NULL);
+        g_once_init_leave(&path, default_path);
+    }
+
+    return path;
+}
+
+gboolean history_append(const gchar *path, const HistoryRecord *record, GError **error)
+{
+    if (path == NULL) {
+        path = history_get_default_path();
+    }
+
+    if (g_mkdir_with_parents(path, 0700) != 0) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to create history directory %s: %s", path, g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    if (!migrate_legacy_history(path, error)) {
+        return FALSE;
+    }
+
+    char name[32];
+    char open_name[32];
+    segment_name_for_time(record->started_at, name, sizeof(name));
+    get_open_segment_name(open_name, sizeof(open_name));
+    g_autofree gchar *segment_path = g_build_filename(path, name, NULL);
+    gboolean created = FALSE;
+
+    if (!add_to_segment(segment_path, record, strcmp(name, open_name) == 0, &created, error)) {
+        return FALSE;
+    }
+
+    // A new month started, the previous ones will rarely change again.
+    g_autoptr(GError) compact_error = NULL;
+    if (created && !compact_segments(path, open_name, &compact_error)) {
+        g_warning("Failed to compact history segments: %s", compact_error->message);
+    }
+
+    // Focus time only, a RoutineType of 0 is Working.
+    gboolean rebuilt = FALSE;
+    if (record->routine == 0 && record->elapsed_seconds > 0 &&
+        !add_to_daily_aggregate(path, record->started_at, record->elapsed_seconds, &rebuilt)) {
+        g_warning("Failed to update daily focus totals next to %s", path);
+    }
+
+    return TRUE;
+}
+
+gboolean history_append_many(const gchar *path, const HistoryRecord *records, guint count,
+                             GError **error)
+{
+    if (path == NULL) {
+        path = history_get_default_path();
+    }
+
+    if (count == 0) {
+        return TRUE;
+    }
+
+    if (g_mkdir_with_parents(path, 0700) != 0) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to create history directory %s: %s", path, g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    if (!migrate_legacy_history(path, error)) {
+        return FALSE;
+    }
+
+    g_autoptr(GArray) sorted = g_array_sized_new(FALSE, FALSE, sizeof(HistoryRecord), count);
+    g_array_append_vals(sorted, records, count);
+    g_array_sort(sorted, compare_records);
+
+    const HistoryRecord *first = (const HistoryRecord *) sorted->data;
+    char open_name[32];
+
+    if (!merge_sorted_records(path, first, count, error)) {
+        return FALSE;
+    }
+
+    get_open_segment_name(open_name, sizeof(open_name));
+    g_autoptr(GError) compact_error = NULL;
+    if (!compact_segments(path, open_name, &compact_error)) {
+        g_warning("Failed to compact history segments: %s", compact_error->message);
+    }
+
+    // One update per day of focus time rather than per session.
+    GDate date;
+    guint32 day_seconds = 0;
+    guint32 day = 0;
+    gint64 day_started_at = 0;
+    // A rebuild from the segments already counted every record of this call.
+    gboolean rebuilt = FALSE;
+
+    g_date_clear(&date, 1);
+
+    for (guint i = 0; i <= count && !rebuilt; i++) {
+        guint32 julian_day = 0;
+
+        if (i < count) {
+            if (first[i].routine != 0 || first[i].elapsed_seconds == 0) {
+                continue;
+            }
+
+            g_date_set_time_t(&date, (time_t) first[i].started_at);
+            julian_day = g_date_get_julian(&date);
+        }
+
+        if (julian_day != day && day_seconds > 0 &&
+            !add_to_daily_aggregate(path, day_started_at, day_seconds, &rebuilt)) {
+            g_warning("Failed to update daily focus totals next to %s", path);
+        }
+
+        if (julian_day != day) {
+            day = julian_day;
+            day_started_at = (i < count) ? first[i].started_at : 0;
+            day_seconds = 0;
+        }
+
+        if (i < count) {
+            day_seconds += first[i].elapsed_seconds;
+        }
+    }
+
+    return TRUE;
+}
+
+gboolean history_get_daily_focus(const gchar *path, GDateYear year, guint32 *seconds_by_day,
+                                 GError **error)
+{
+    if (path == NULL) {
+        path = history_get_default_path();
+    }
+
+    memset(seconds_by_day, 0, HISTORY_DAYS_PER_YEAR_MAX * sizeof(*seconds_by_day));
+
+    g_autofree gchar *daily_path = get_daily_path(path);
+    FILE *file = g_fopen(daily_path, "rb");
+    if (file == NULL) {
+        int saved_errno = errno;
+        if (saved_errno == ENOENT) {
+            return TRUE;
+        }
+
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to open %s: %s", daily_path, g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    guint8 header[HISTORY_HEADER_SIZE];
+    if (fread(header, sizeof(header), 1, file) != 1 ||
+        !check_file_header(header, DAILY_MAGIC, DAILY_VERSION, DAILY_ENTRY_SIZE)) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s is not a supported file",
+                    daily_path);
+        fclose(file);
+        return FALSE;
+    }
+
+    GDate first_day;
+    g_date_clear(&first_day, 1);
+    g_date_set_dmy(&first_day, 1, G_DATE_JANUARY, year);
+    guint32 first_julian = g_date_get_julian(&first_day);
+    guint32 days_in_year = g_date_is_leap_year(year) ? 366 : 365;
+
+    gint64 count = count_daily_entries(file);
+    gint64 index = count < 0 ? -1 : find_daily_entry(file, count, first_julian);
+    guint32 day, seconds;
+
+    for (; index >= 0 && index < count; index++) {
+        if (!read_daily_entry(file, index, &day, &seconds) ||
+            day >= first_julian + days_in_year) {
+            break;
+        }
+
+        seconds_by_day[day - first_julian] = seconds;
+    }
+
+    fclose(file);
+    return TRUE;
+}
+
+HistoryReader *history_reader_open(const gchar *path, gint64 since, gint64 until, GError **error)
+{
+    if (path == NULL) {
+        path = history_get_default_path();
+    }
+
+    if (!open_history_dir(path, error)) {
+        return NULL;
+    }
+
+    char first_name[32];
+    segment_name_for_time(since, first_name, sizeof(first_name));
+
+    HistoryReader *reader = g_new0(HistoryReader, 1);
+    reader->dir = g_strdup(path);
+    reader->segments = list_segments(path);
+    reader->next_segment = find_segment(reader->segments, first_name);
+    reader->since = since;
+    reader->until = until;
+
+    return reader;
+}
+
+gboolean history_reader_next(HistoryReader *reader, HistoryRecord *record)
+{
+    while (reader->cursor_open || reader->next_segment < reader->segments->len) {
+        if (!reader->cursor_open) {
+            const gchar *name = g_ptr_array_index(reader->segments, reader->next_segment);
+            g_autofree gchar *segment_path = g_build_filename(reader->dir, name, NULL);
+            g_autoptr(GError) error = NULL;
+
+            reader->next_segment++;
+
+            if (!segment_cursor_open(&reader->cursor, segment_path, &error)) {
+                g_warning("Skipping history segment: %s", error->message);
+                continue;
+            }
+
+            segment_cursor_seek(&reader->cursor, reader->since);
+            reader->cursor_open = TRUE;
+        }
+
+        while (segment_cursor_next(&reader->cursor, record)) {
+            if (record->started_at > reader->until) {
+                // Later segments only hold later sessions.
+                reader->next_segment = reader->segments->len;
+                segment_cursor_close(&reader->cursor);
+                reader->cursor_open = FALSE;
+                return FALSE;
+            }
+            if (record->started_at >= reader->since) {
+                return TRUE;
+            }
+        }
+
+        segment_cursor_close(&reader->cursor);
+        reader->cursor_open = FALSE;
+    }
+
+    return FALSE;
+}
+
+void history_reader_free(HistoryReader *reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+
+    segment_cursor_close(&reader->cursor);
+    g_ptr_array_unref(reader->segments);
+    g_free(reader->dir);
+    g_free(reader);
+}
+
+HistoryView *history_view_open(const gchar *path, gint64 since, gint64 until, guint routine_mask,
+                               GError **error)
+{
+    if (path == NULL) {
+        path = history_get_default_path();
+    }
+
+    if (!open_history_dir(path, error)) {
+        return NULL;
+    }
+
+    char first_name[32];
+    char last_name[32];
+    segment_name_for_time(since, first_name, sizeof(first_name));
+    segment_name_for_time(until, last_name, sizeof(last_name));
+
+    g_autoptr(GPtrArray) segments = list_segments(path);
+    HistoryRecord scratch[HISTORY_INDEX_INTERVAL];
+    guint32 total = 0;
+
+    HistoryView *view = g_new0(HistoryView, 1);
+    view->cursors = g_array_new(FALSE, FALSE, sizeof(SegmentCursor));
+    view->pages = g_array_new(FALSE, FALSE, sizeof(HistoryPage));
+    view->since = since;
+    view->until = until;
+    view->routine_mask = routine_mask;
+
+    for (guint i = find_segment(segments, first_name); i < segments->len; i++) {
+        const gchar *name = g_ptr_array_index(segments, i);
+        g_autofree gchar *segment_path = g_build_filename(path, name, NULL);
+        g_autoptr(GError) segment_error = NULL;
+        SegmentCursor cursor;
+
+        if (strcmp(name, last_name) > 0) {
+            break;
+        }
+
+        if (!segment_cursor_open(&cursor, segment_path, &segment_error)) {
+            g_warning("Skipping history segment: %s", segment_error->message);
+            continue;
+        }
+
+        g_array_append_val(view->cursors, cursor);
+
+        /*  Pages are counted from the segment headers alone where possible. Only the months the
+            range starts and ends in can hold records outside of it, and only a routine filter
+            needs every record looked at, once, without keeping any of them around.
+        */
+        gboolean exact = (routine_mask != HISTORY_ROUTINES_ALL) ||
+                         strcmp(name, first_name) == 0 || strcmp(name, last_name) == 0;
+        guint32 record_count = cursor.header.record_count;
+        guint32 blocks = (guint32) (((guint64) record_count + HISTORY_INDEX_INTERVAL - 1) /
+                                    HISTORY_INDEX_INTERVAL);
+
+        for (guint32 block = 0; block < blocks; block++) {
+            HistoryPage page = {.segment = view->cursors->len - 1, .block = block};
+            guint32 count = exact ? decode_page(view, &page, scratch)
+                                  : MIN(HISTORY_INDEX_INTERVAL,
+                                        record_count - block * HISTORY_INDEX_INTERVAL);
+
+            // A GListModel counts items in a guint.
+            if (count == 0 || count > G_MAXUINT32 - total) {
+                continue;
+            }
+
+            total += count;
+            page.end = total;
+            g_array_append_val(view->pages, page);
+        }
+    }
+
+    return view;
+}
+
+guint history_view_get_n_records(HistoryView *view)
+{
+    return view->pages->len > 0
+               ? g_array_index(view->pages, HistoryPage, view->pages->len - 1).end
+               : 0;
+}
+
+gboolean history_view_get(HistoryView *view, guint position, HistoryRecord *record)
+{
+    guint low = 0;
+    guint high = view->pages->len;
+
+    // The first page ending after position.
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+
+        if (g_array_index(view->pages, HistoryPage, mid).end <= position) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low >= view->pages->len) {
+        return FALSE;
+    }
+
+    guint32 start = (low > 0) ? g_array_index(view->pages, HistoryPage, low - 1).end : 0;
+    const HistoryPageCache *entry = lookup_page(view, low);
+
+    if (position - start >= entry->count) {
+        return FALSE;
+    }
+
+    *record = entry->records[position - start];
+    return TRUE;
+}
+
+void history_view_free(HistoryView *view)
+{
+    if (view == NULL) {
+        return;
+    }
+
+    for (guint i = 0; i < view->cursors->len; i++) {
+        segment_cursor_close(&g_array_index(view->cursors, SegmentCursor, i));
+    }
+
+    g_array_unref(view->cursors);
+    g_array_unref(view->pages);
+    g_free(view);
+}
+
+gboolean history_export(FILE *out, HistoryFormat format, gint64 since, gint64 until,
+                        GError **error)
+{
+    HistoryReader *reader = history_reader_open(NULL, since, until, error);
+    if (reader == NULL) {
+        return FALSE;
+    }
+
+    HistoryRecord record;
+    char timestamp[32];
+
+    if (format == HistoryFormatCsv) {
+        fputs("started_at,routine,planned_seconds,elapsed_seconds,skipped\n", out);
+    }
+
+    while (history_reader_next(reader, &record)) {
+        gboolean skipped = (record.flags & HISTORY_FLAG_SKIPPED) != 0;
+        format_timestamp(record.started_at, timestamp, sizeof(timestamp));
+
+        switch (format) {
+            case HistoryFormatCsv:
+                fprintf(out, "%s,%s,%" G_GUINT32_FORMAT ",%" G_GUINT32_FORMAT ",%s\n", timestamp,
+                        routine_to_nick(record.routine), record.planned_seconds,
+                        record.elapsed_seconds, skipped ? "true" : "false");
+                break;
+            case HistoryFormatJsonLines:
+                fprintf(out,
+                        "{\"started_at\":\"%s\",\"routine\":\"%s\",\"planned_seconds\":%" G_GUINT32_FORMAT
+                        ",\"elapsed_seconds\":%" G_GUINT32_FORMAT ",\"skipped\":%s}\n",
+                        timestamp, routine_to_nick(record.routine), record.planned_seconds,
+                        record.elapsed_seconds, skipped ? "true" : "false");
+                break;
+            default:
+                g_assert_not_reached();
+        }
+    }
+
+    history_reader_free(reader);
+
+    if (fflush(out) != 0 || ferror(out)) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_IO, "Failed to write exported history");
+        return FALSE;
+    }
+
+    return TRUE;
+}
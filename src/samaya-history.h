@@ -0,0 +1,106 @@
+/* samaya-history.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <stdio.h>
+
+#define HISTORY_FLAG_SKIPPED (1 << 0)
+#define HISTORY_DAYS_PER_YEAR_MAX 366
+#define HISTORY_ROUTINES_ALL G_MAXUINT
+
+typedef struct
+{
+    // Wall clock time the session was first started at, in seconds since the unix epoch.
+    gint64 started_at;
+
+    guint32 planned_seconds;
+    guint32 elapsed_seconds;
+
+    // A RoutineType value.
+    guint8 routine;
+    guint8 flags;
+} HistoryRecord;
+
+typedef enum
+{
+    HistoryFormatCsv,
+    HistoryFormatJsonLines,
+} HistoryFormat;
+
+typedef struct HistoryReader HistoryReader;
+typedef struct HistoryView HistoryView;
+
+// Returns the path of the history directory in the user data directory. The string is owned by
+// GLib.
+const gchar *history_get_default_path(void);
+
+// Appends a single session record to the history at path (or the default one if NULL).
+gboolean history_append(const gchar *path, const HistoryRecord *record, GError **error);
+
+/*  Appends many records at once, for imports and tools. Records may be in any order. Every
+    affected segment is rewritten once, and the daily totals are updated once per day.
+*/
+gboolean history_append_many(const gchar *path, const HistoryRecord *records, guint count,
+                             GError **error);
+
+/*  Opens the history at path (or the default one if NULL) for sequential reading.
+
+    Only records whose started_at lies within [since, until] are returned, pass 0 and G_MAXINT64
+    for an unbounded range. The first record is found by binary search over the monthly segments,
+    and segments are memory mapped one at a time as the reader reaches them.
+*/
+HistoryReader *history_reader_open(const gchar *path, gint64 since, gint64 until, GError **error);
+
+// Reads the next record in range into record. Returns FALSE once the range is exhausted.
+gboolean history_reader_next(HistoryReader *reader, HistoryRecord *record);
+
+void history_reader_free(HistoryReader *reader);
+
+/*  Opens a random access view of the records in [since, until] whose routine has its bit
+    (1 << routine) set in routine_mask, or of every routine for HISTORY_ROUTINES_ALL.
+
+    Records are numbered from the oldest one. Opening only counts them, mostly from the segment
+    headers, and records are decoded an index block at a time when they are first looked up, with
+    the most recently used blocks kept in a small cache. The view is a snapshot, sessions appended
+    after it was opened need a new view.
+*/
+HistoryView *history_view_open(const gchar *path, gint64 since, gint64 until, guint routine_mask,
+                               GError **error);
+
+guint history_view_get_n_records(HistoryView *view);
+
+// Reads the record at position into record. Returns FALSE if it is out of range or unreadable.
+gboolean history_view_get(HistoryView *view, guint position, HistoryRecord *record);
+
+void history_view_free(HistoryView *view);
+
+/*  Fills seconds_by_day (HISTORY_DAYS_PER_YEAR_MAX entries, indexed by day of year - 1) with the
+    focus time of each day in year.
+
+    This reads the per-day totals maintained by history_append, never the raw session records.
+*/
+gboolean history_get_daily_focus(const gchar *path, GDateYear year, guint32 *seconds_by_day,
+                                 GError **error);
+
+// Streams every record in [since, until] to out in the given format.
+gboolean history_export(FILE *out, HistoryFormat format, gint64 since, gint64 until,
+                        GError **error);
@@ -0,0 +1,480 @@
+/* samaya-hooks.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <gio/gio.h>
+#include <string.h>
+#if defined(G_OS_UNIX)
+#include <signal.h>
+#include <unistd.h>
+#endif
+#include "samaya-hooks.h"
+#include "samaya-timer.h"
+
+#define HOOK_LOG_FILE_NAME "hooks.log"
+#define HOOK_OUTPUT_LOG_LIMIT (64 * 1024)
+#define HOOK_OUTPUT_READ_SIZE 4096
+
+struct Hooks
+{
+    SessionManagerPtr session_manager;
+    gulong state_changed_id;
+    gulong session_complete_id;
+
+    gchar *commands[N_HOOK_EVENTS];
+    guint max_concurrent;
+    guint timeout_seconds;
+
+    // Timer state seen by the previous transition, to tell a start apart from a resume.
+    TmState last_state;
+
+    guint running;
+    GQueue pending;
+
+    // Log lines are written one after the other, a stream only allows one pending operation.
+    GOutputStream *log_stream;
+    GQueue log_queue;
+    gboolean log_writing;
+};
+
+typedef struct
+{
+    // Holds a reference on the Hooks reference counted box.
+    HooksPtr hooks;
+
+    HookEvent event;
+    gchar *command;
+    gchar **environment;
+
+    GSubprocess *process;
+    // Process id of the shell, which leads the process group of everything the command starts.
+    gint64 pid;
+    guint timeout_source_id;
+    gboolean timed_out;
+
+    // The first HOOK_OUTPUT_LOG_LIMIT bytes of output, whatever their encoding. The rest is read
+    // and dropped so the command never blocks on a full pipe.
+    GByteArray *output;
+    gboolean output_truncated;
+    guint8 read_buffer[HOOK_OUTPUT_READ_SIZE];
+    // Stops reading once the hook timed out, even if something it started keeps the pipe open.
+    GCancellable *read_cancellable;
+} HookJob;
+
+static const char *const hookEventNames[N_HOOK_EVENTS] = {
+    [HookWorkStart] = "work-start",
+    [HookBreakStart] = "break-start",
+    [HookPause] = "pause",
+    [HookComplete] = "complete",
+};
+
+
+/* ============================================================================
+ * Function Definitions
+ * ============================================================================ */
+
+static void start_next_jobs(HooksPtr self);
+
+static void write_next_log_entry(HooksPtr self);
+
+
+/* ============================================================================
+ * Log Writer
+ * ============================================================================ */
+
+static GOutputStream *ensure_log_stream(HooksPtr self)
+{
+    if (self->log_stream != NULL) {
+        return self->log_stream;
+    }
+
+    g_autofree gchar *dir = g_build_filename(g_get_user_state_dir(), "samaya", NULL);
+    g_autofree gchar *path = g_build_filename(dir, HOOK_LOG_FILE_NAME, NULL);
+    g_autoptr(GFile) file = g_file_new_for_path(path);
+    g_autoptr(GError) error = NULL;
+
+    g_mkdir_with_parents(dir, 0700);
+
+    self->log_stream = G_OUTPUT_STREAM(g_file_append_to(file, G_FILE_CREATE_NONE, NULL, &error));
+    if (self->log_stream == NULL) {
+        g_warning("Failed to open hook log %s: %s", path, error->message);
+    }
+
+    return self->log_stream;
+}
+
+static void on_log_entry_written(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    HooksPtr self = user_data;
+    g_autoptr(GError) error = NULL;
+
+    if (!g_output_stream_write_all_finish(G_OUTPUT_STREAM(source), result, NULL, &error)) {
+        g_warning("Failed to write hook log: %s", error->message);
+    }
+
+    g_bytes_unref(g_queue_pop_head(&self->log_queue));
+    self->log_writing = FALSE;
+
+    write_next_log_entry(self);
+    g_rc_box_release(self);
+}
+
+static void write_next_log_entry(HooksPtr self)
+{
+    if (self->log_writing || g_queue_is_empty(&self->log_queue) ||
+        ensure_log_stream(self) == NULL) {
+        return;
+    }
+
+    GBytes *entry = g_queue_peek_head(&self->log_queue);
+    gsize size;
+    gconstpointer data = g_bytes_get_data(entry, &size);
+
+    self->log_writing = TRUE;
+    g_output_stream_write_all_async(self->log_stream, data, size, G_PRIORITY_LOW, NULL,
+                                    on_log_entry_written, g_rc_box_acquire(self));
+}
+
+static void append_log_entry(HooksPtr self, HookJob *job)
+{
+    g_autoptr(GDateTime) now = g_date_time_new_now_local();
+    g_autofree gchar *timestamp = g_date_time_format_iso8601(now);
+    GString *entry = g_string_new(NULL);
+    GSubprocess *process = job->process;
+
+    g_string_append_printf(entry, "[%s] %s: %s\n", timestamp, hookEventNames[job->event],
+                           job->command);
+
+    if (job->timed_out) {
+        g_string_append_printf(entry, "killed after %u seconds\n", self->timeout_seconds);
+    } else if (g_subprocess_get_if_exited(process)) {
+        g_string_append_printf(entry, "exited with status %d\n",
+                               g_subprocess_get_exit_status(process));
+    } else if (g_subprocess_get_if_signaled(process)) {
+        g_string_append_printf(entry, "terminated by signal %d\n",
+                               g_subprocess_get_term_sig(process));
+    }
+
+    if (job->output->len > 0) {
+        // The log is text, invalid sequences become U+FFFD.
+        g_autofree gchar *output =
+            g_utf8_make_valid((const gchar *) job->output->data, job->output->len);
+
+        g_string_append(entry, output);
+        if (job->output_truncated) {
+            g_string_append(entry, "\n[output truncated]");
+        }
+        if (entry->str[entry->len - 1] != '\n') {
+            g_string_append_c(entry, '\n');
+        }
+    }
+
+    g_queue_push_tail(&self->log_queue, g_string_free_to_bytes(entry));
+    write_next_log_entry(self);
+}
+
+
+/* ============================================================================
+ * Hook Jobs
+ * ============================================================================ */
+
+static void hook_job_free(HookJob *job)
+{
+    g_clear_handle_id(&job->timeout_source_id, g_source_remove);
+    g_clear_object(&job->process);
+    g_clear_object(&job->read_cancellable);
+    g_clear_pointer(&job->output, g_byte_array_unref);
+    g_free(job->command);
+    g_strfreev(job->environment);
+    g_rc_box_release(job->hooks);
+    g_free(job);
+}
+
+#if defined(G_OS_UNIX)
+static void setup_hook_process(gpointer user_data)
+{
+    setpgid(0, 0);
+}
+#endif
+
+// Kills the shell and everything it started, not just the shell.
+static void kill_job(HookJob *job)
+{
+#if defined(G_OS_UNIX)
+    if (job->pid > 0 && kill(-(pid_t) job->pid, SIGKILL) == 0) {
+        return;
+    }
+#endif
+    g_subprocess_force_exit(job->process);
+}
+
+static gboolean on_hook_timeout(gpointer user_data)
+{
+    HookJob *job = user_data;
+
+    job->timeout_source_id = 0;
+    job->timed_out = TRUE;
+    kill_job(job);
+    g_cancellable_cancel(job->read_cancellable);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void on_hook_exited(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    HookJob *job = user_data;
+    HooksPtr self = job->hooks;
+    g_autoptr(GError) error = NULL;
+
+    if (!g_subprocess_wait_finish(G_SUBPROCESS(source), result, &error)) {
+        g_warning("Failed to wait for the %s hook: %s", hookEventNames[job->event],
+                  error->message);
+    }
+
+    append_log_entry(self, job);
+
+    self->running--;
+    hook_job_free(job);
+
+    start_next_jobs(self);
+}
+
+static void read_next_output(HookJob *job);
+
+static void on_output_read(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    HookJob *job = user_data;
+    g_autoptr(GError) error = NULL;
+    gssize size = g_input_stream_read_finish(G_INPUT_STREAM(source), result, &error);
+
+    if (size > 0) {
+        guint kept = MIN((guint) size, HOOK_OUTPUT_LOG_LIMIT - job->output->len);
+
+        g_byte_array_append(job->output, job->read_buffer, kept);
+        job->output_truncated |= kept < (guint) size;
+
+        read_next_output(job);
+        return;
+    }
+
+    if (size < 0 && !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_warning("Failed to read the output of the %s hook: %s", hookEventNames[job->event],
+                  error->message);
+    }
+
+    // The pipe was closed or is no longer read. A command that keeps running is still timed out.
+    g_subprocess_wait_async(job->process, NULL, on_hook_exited, job);
+}
+
+static void read_next_output(HookJob *job)
+{
+    g_input_stream_read_async(g_subprocess_get_stdout_pipe(job->process), job->read_buffer,
+                              sizeof(job->read_buffer), G_PRIORITY_LOW, job->read_cancellable,
+                              on_output_read, job);
+}
+
+static void start_job(HooksPtr self, HookJob *job)
+{
+    g_autoptr(GSubprocessLauncher) launcher =
+        g_subprocess_launcher_new(G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_MERGE);
+    g_autoptr(GError) error = NULL;
+
+    g_subprocess_launcher_set_environ(launcher, job->environment);
+#if defined(G_OS_UNIX)
+    // A process group of its own, so a timeout can kill everything the command started.
+    g_subprocess_launcher_set_child_setup(launcher, setup_hook_process, NULL, NULL);
+#endif
+
+    job->process =
+        g_subprocess_launcher_spawn(launcher, &error, "/bin/sh", "-c", job->command, NULL);
+    if (job->process == NULL) {
+        g_warning("Failed to run the %s hook: %s", hookEventNames[job->event], error->message);
+        hook_job_free(job);
+        return;
+    }
+
+    const gchar *identifier = g_subprocess_get_identifier(job->process);
+    job->pid = identifier != NULL ? g_ascii_strtoll(identifier, NULL, 10) : 0;
+    job->output = g_byte_array_new();
+    job->read_cancellable = g_cancellable_new();
+
+    self->running++;
+
+    if (self->timeout_seconds > 0) {
+        job->timeout_source_id = g_timeout_add_seconds(self->timeout_seconds, on_hook_timeout, job);
+    }
+
+    read_next_output(job);
+}
+
+static void start_next_jobs(HooksPtr self)
+{
+    while (!g_queue_is_empty(&self->pending) &&
+           (self->max_concurrent == 0 || self->running < self->max_concurrent)) {
+        start_job(self, g_queue_pop_head(&self->pending));
+    }
+}
+
+// Snapshot of the session at the time of the event, so queued hooks still see that moment.
+static gchar **build_environment(HookEvent event, SessionManagerPtr session_manager)
+{
+    TimerPtr timer = session_manager->timer_instance;
+    gboolean complete = (event == HookComplete);
+    // A completion describes the session that just ended, not the one the timer now holds.
+    RoutineType routine =
+        complete ? session_manager->last_completed_routine : session_manager->current_routine;
+    guint64 duration_ms =
+        complete ? session_manager->last_session_duration_ms : tm_get_duration_ms(timer);
+    gint64 remaining_ms = complete ? (gint64) session_manager->last_session_remaining_ms
+                                   : tm_get_remaining_time_ms(timer);
+    char number[32];
+    gchar **environment = g_get_environ();
+
+    environment = g_environ_setenv(environment, "SAMAYA_EVENT", hookEventNames[event], TRUE);
+    environment = g_environ_setenv(environment, "SAMAYA_ROUTINE", routine_to_nick(routine), TRUE);
+
+    g_snprintf(number, sizeof(number), "%" G_GUINT64_FORMAT, duration_ms);
+    environment = g_environ_setenv(environment, "SAMAYA_DURATION_MS", number, TRUE);
+
+    g_snprintf(number, sizeof(number), "%" G_GINT64_FORMAT, remaining_ms);
+    environment = g_environ_setenv(environment, "SAMAYA_REMAINING_MS", number, TRUE);
+
+    g_snprintf(number, sizeof(number), "%u", session_manager->sessions_completed);
+    environment = g_environ_setenv(environment, "SAMAYA_SESSIONS_COMPLETED", number, TRUE);
+
+    g_snprintf(number, sizeof(number), "%" G_GUINT64_FORMAT,
+               session_manager->total_sessions_counted);
+    environment = g_environ_setenv(environment, "SAMAYA_TOTAL_SESSIONS", number, TRUE);
+
+    if (complete) {
+        environment = g_environ_setenv(environment, "SAMAYA_SKIPPED",
+                                       session_manager->last_session_skipped ? "1" : "0", TRUE);
+    }
+
+    return environment;
+}
+
+static void run_hook(HooksPtr self, HookEvent event)
+{
+    const gchar *command = self->commands[event];
+    if (command == NULL) {
+        return;
+    }
+
+    HookJob *job = g_new0(HookJob, 1);
+    job->hooks = g_rc_box_acquire(self);
+    job->event = event;
+    job->command = g_strdup(command);
+    job->environment = build_environment(event, self->session_manager);
+
+    g_queue_push_tail(&self->pending, job);
+    start_next_jobs(self);
+}
+
+static void on_state_changed(SessionManagerPtr session_manager, gpointer user_data)
+{
+    HooksPtr self = user_data;
+    TmState state = tm_get_state(session_manager->timer_instance);
+    TmState previous_state = self->last_state;
+
+    self->last_state = state;
+
+    if (state == StRunning && previous_state == StIdle) {
+        run_hook(self, session_manager->current_routine == Working ? HookWorkStart
+                                                                   : HookBreakStart);
+    } else if (state == StPaused && previous_state == StRunning) {
+        run_hook(self, HookPause);
+    }
+}
+
+static void on_session_complete(SessionManagerPtr session_manager, gpointer user_data)
+{
+    HooksPtr self = user_data;
+
+    // A following session that started on its own was never idle, it still counts as a start.
+    self->last_state = StIdle;
+    run_hook(self, HookComplete);
+}
+
+static void hooks_clear(gpointer data)
+{
+    HooksPtr self = data;
+
+    for (guint i = 0; i < N_HOOK_EVENTS; i++) {
+        g_free(self->commands[i]);
+    }
+
+    g_queue_clear_full(&self->log_queue, (GDestroyNotify) g_bytes_unref);
+    g_clear_object(&self->log_stream);
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+HooksPtr hooks_new(SessionManagerPtr session_manager)
+{
+    HooksPtr hooks = g_rc_box_new0(Hooks);
+
+    hooks->session_manager = session_manager;
+    hooks->max_concurrent = 2;
+    hooks->timeout_seconds = 30;
+    hooks->last_state = tm_get_state(session_manager->timer_instance);
+    g_queue_init(&hooks->pending);
+    g_queue_init(&hooks->log_queue);
+
+    hooks->state_changed_id = sm_connect_state_changed(session_manager, on_state_changed, hooks);
+    hooks->session_complete_id =
+        sm_connect_session_complete(session_manager, on_session_complete, hooks);
+
+    return hooks;
+}
+
+void hooks_free(HooksPtr self)
+{
+    if (self == NULL) {
+        return;
+    }
+
+    sm_disconnect_state_changed(self->session_manager, self->state_changed_id);
+    sm_disconnect_session_complete(self->session_manager, self->session_complete_id);
+    self->session_manager = NULL;
+
+    // Each queued job holds a reference, so they have to go before the last one can.
+    g_queue_clear_full(&self->pending, (GDestroyNotify) hook_job_free);
+
+    g_rc_box_release_full(self, hooks_clear);
+}
+
+void hooks_set_command(HooksPtr self, HookEvent event, const gchar *command)
+{
+    g_return_if_fail(event < N_HOOK_EVENTS);
+
+    g_free(self->commands[event]);
+    self->commands[event] = (command != NULL && command[0] != '\0') ? g_strdup(command) : NULL;
+}
+
+void hooks_set_limits(HooksPtr self, guint max_concurrent, guint timeout_seconds)
+{
+    self->max_concurrent = max_concurrent;
+    self->timeout_seconds = timeout_seconds;
+
+    start_next_jobs(self);
+}
@@ -0,0 +1,56 @@
+/* samaya-hooks.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include "samaya-session.h"
+
+typedef enum
+{
+    HookWorkStart,
+    HookBreakStart,
+    HookPause,
+    HookComplete,
+    N_HOOK_EVENTS
+} HookEvent;
+
+typedef struct Hooks Hooks;
+typedef Hooks *HooksPtr;
+
+/*  Constructs the hook runner and subscribes it to the session manager transitions.
+
+    Hook commands are run through /bin/sh with GSubprocess, fully asynchronously: at most
+    max_concurrent of them run at once and the rest wait in a queue, each one is killed along with
+    everything it started once it exceeds the timeout, and the first 64 KiB of their output are
+    appended to hooks.log in the user state directory. The routine and timing data are passed in
+    SAMAYA_* environment variables, for "complete" those of the session that just ended.
+*/
+HooksPtr hooks_new(SessionManagerPtr session_manager);
+
+/*  Stops listening to the session manager and drops the hooks that wait in the queue. Hooks that
+    are still running are left alone.
+*/
+void hooks_free(HooksPtr self);
+
+// Sets the shell command for event, NULL or an empty string disables the hook.
+void hooks_set_command(HooksPtr self, HookEvent event, const gchar *command);
+
+void hooks_set_limits(HooksPtr self, guint max_concurrent, guint timeout_seconds);
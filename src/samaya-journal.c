@@ -0,0 +1,260 @@
+/* samaya-journal.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include "samaya-journal.h"
+#include "samaya-utils.h"
+
+/*  header: magic[8] "SMYJRNL\n" | u32 version | u32 reserved
+    entry:  u8 type | varint time delta in microseconds | payload
+
+    Event and Routine carry a u8 code, Setting a u8 id and a little endian f64, Extend a u8
+    target and the minutes as the same f64, Tick a varint of the remaining milliseconds. Skip and
+    Complete have no payload.
+*/
+#define JOURNAL_MAGIC "SMYJRNL\n"
+#define JOURNAL_MAGIC_LEN 8
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE 16
+#define JOURNAL_ENTRY_SIZE_MAX 32
+
+struct Journal
+{
+    GMutex lock;
+    FILE *file;
+    gint64 last_time_us;
+};
+
+struct JournalReader
+{
+    gchar *contents;
+    const guint8 *position;
+    const guint8 *end;
+    gint64 last_time_us;
+};
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static gsize encode_entry(const JournalEntry *entry, gint64 delta_us, guint8 *out)
+{
+    gsize length = 0;
+
+    out[length++] = (guint8) entry->type;
+    length += put_varint(out + length, (guint64) delta_us);
+
+    switch (entry->type) {
+        case JournalEntryEvent:
+        case JournalEntryRoutine:
+            out[length++] = (guint8) entry->code;
+            break;
+        case JournalEntrySetting:
+        case JournalEntryExtend: {
+            guint64 bits;
+            memcpy(&bits, &entry->value, sizeof(bits));
+            bits = GUINT64_TO_LE(bits);
+
+            out[length++] = (guint8) entry->code;
+            memcpy(out + length, &bits, sizeof(bits));
+            length += sizeof(bits);
+            break;
+        }
+        case JournalEntryTick:
+            length += put_varint(out + length, entry->remaining_ms);
+            break;
+        case JournalEntrySkip:
+        case JournalEntryComplete:
+        case N_JOURNAL_ENTRY_TYPES:
+        default:
+            break;
+    }
+
+    return length;
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+JournalPtr journal_open(const gchar *path, GError **error)
+{
+    FILE *file = g_fopen(path, "wb");
+    if (file == NULL) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to create journal %s: %s", path, g_strerror(saved_errno));
+        return NULL;
+    }
+
+    guint8 header[JOURNAL_HEADER_SIZE] = {0};
+    guint32 version = GUINT32_TO_LE(JOURNAL_VERSION);
+
+    memcpy(header, JOURNAL_MAGIC, JOURNAL_MAGIC_LEN);
+    memcpy(header + 8, &version, sizeof(version));
+
+    if (fwrite(header, sizeof(header), 1, file) != 1 || fflush(file) != 0) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_IO, "Failed to write journal %s", path);
+        fclose(file);
+        return NULL;
+    }
+
+    JournalPtr journal = g_new0(Journal, 1);
+    g_mutex_init(&journal->lock);
+    journal->file = file;
+
+    return journal;
+}
+
+void journal_close(JournalPtr self)
+{
+    if (self == NULL) {
+        return;
+    }
+
+    fclose(self->file);
+    g_mutex_clear(&self->lock);
+    g_free(self);
+}
+
+void journal_record(JournalPtr self, JournalEntry *entry)
+{
+    guint8 raw[JOURNAL_ENTRY_SIZE_MAX];
+
+    // Reading the clock under the lock keeps entries from several threads in time order.
+    g_mutex_lock(&self->lock);
+
+    entry->time_us = g_get_monotonic_time();
+    gsize length = encode_entry(entry, entry->time_us - self->last_time_us, raw);
+    self->last_time_us = entry->time_us;
+
+    if (fwrite(raw, length, 1, self->file) != 1 || fflush(self->file) != 0) {
+        g_warning("Failed to write journal entry: %s", g_strerror(errno));
+    }
+
+    g_mutex_unlock(&self->lock);
+}
+
+JournalReader *journal_reader_open(const gchar *path, GError **error)
+{
+    gchar *contents;
+    gsize length;
+
+    if (!g_file_get_contents(path, &contents, &length, error)) {
+        return NULL;
+    }
+
+    guint32 version = 0;
+    if (length >= JOURNAL_HEADER_SIZE) {
+        memcpy(&version, contents + 8, sizeof(version));
+    }
+
+    if (length < JOURNAL_HEADER_SIZE || memcmp(contents, JOURNAL_MAGIC, JOURNAL_MAGIC_LEN) != 0 ||
+        GUINT32_FROM_LE(version) != JOURNAL_VERSION) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s is not a supported journal", path);
+        g_free(contents);
+        return NULL;
+    }
+
+    JournalReader *reader = g_new0(JournalReader, 1);
+    reader->contents = contents;
+    reader->position = (const guint8 *) contents + JOURNAL_HEADER_SIZE;
+    reader->end = (const guint8 *) contents + length;
+
+    return reader;
+}
+
+gboolean journal_reader_next(JournalReader *reader, JournalEntry *entry)
+{
+    const guint8 *position = reader->position;
+    const guint8 *end = reader->end;
+    guint64 delta;
+
+    if (position >= end) {
+        return FALSE;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->type = (JournalEntryType) *position++;
+
+    if (entry->type >= N_JOURNAL_ENTRY_TYPES || !get_varint(&position, end, &delta)) {
+        return FALSE;
+    }
+
+    switch (entry->type) {
+        case JournalEntryEvent:
+        case JournalEntryRoutine:
+            if (position >= end) {
+                return FALSE;
+            }
+            entry->code = *position++;
+            break;
+        case JournalEntrySetting:
+        case JournalEntryExtend: {
+            guint64 bits;
+
+            if (end - position < 1 + (gssize) sizeof(bits)) {
+                return FALSE;
+            }
+
+            entry->code = *position++;
+            memcpy(&bits, position, sizeof(bits));
+            bits = GUINT64_FROM_LE(bits);
+            memcpy(&entry->value, &bits, sizeof(bits));
+            position += sizeof(bits);
+            break;
+        }
+        case JournalEntryTick:
+            if (!get_varint(&position, end, &entry->remaining_ms)) {
+                return FALSE;
+            }
+            break;
+        case JournalEntrySkip:
+        case JournalEntryComplete:
+        case N_JOURNAL_ENTRY_TYPES:
+        default:
+            break;
+    }
+
+    entry->time_us = reader->last_time_us + (gint64) delta;
+    reader->last_time_us = entry->time_us;
+    reader->position = position;
+
+    return TRUE;
+}
+
+gboolean journal_reader_is_complete(JournalReader *reader)
+{
+    return reader->position == reader->end;
+}
+
+void journal_reader_free(JournalReader *reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+
+    g_free(reader->contents);
+    g_free(reader);
+}
@@ -0,0 +1,100 @@
+/* samaya-journal.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef enum
+{
+    // An external tm event, code is the TmEvent.
+    JournalEntryEvent,
+    // A routine picked from outside the session manager, code is the RoutineType.
+    JournalEntryRoutine,
+    JournalEntrySkip,
+    // A setting change, code is a JournalSettingId and value the new value.
+    JournalEntrySetting,
+    // Observed output: a tick and the remaining time it left, and a session running out.
+    JournalEntryTick,
+    JournalEntryComplete,
+    // Time added to a session, code is a JournalExtendTarget and value is in minutes.
+    JournalEntryExtend,
+    N_JOURNAL_ENTRY_TYPES
+} JournalEntryType;
+
+typedef enum
+{
+    // The current session, see sm_extend_session.
+    JournalExtendCurrent,
+    // The session that just ran out, see sm_extend_completed_session.
+    JournalExtendCompleted,
+} JournalExtendTarget;
+
+typedef enum
+{
+    JournalSettingWorkDuration,
+    JournalSettingShortBreakDuration,
+    JournalSettingLongBreakDuration,
+    JournalSettingSessionsToComplete,
+    JournalSettingAutoStartBreaks,
+    JournalSettingAutoStartWork,
+    JournalSettingLowPowerMode,
+    N_JOURNAL_SETTINGS
+} JournalSettingId;
+
+typedef struct
+{
+    JournalEntryType type;
+
+    // Monotonic clock reading the entry was recorded at.
+    gint64 time_us;
+
+    guint32 code;
+    gdouble value;
+    guint64 remaining_ms;
+} JournalEntry;
+
+typedef struct Journal Journal;
+typedef Journal *JournalPtr;
+
+typedef struct JournalReader JournalReader;
+
+/*  Creates (or truncates) a journal at path.
+
+    Entries are a type byte, a varint delta of the clock reading from the previous entry and a
+    short payload, so a tick costs three to five bytes. Every entry is flushed right away, so the
+    journal survives a crash of the app it is meant to debug.
+*/
+JournalPtr journal_open(const gchar *path, GError **error);
+
+void journal_close(JournalPtr self);
+
+// Stamps entry with the current monotonic time and appends it. Safe to call from any thread.
+void journal_record(JournalPtr self, JournalEntry *entry);
+
+JournalReader *journal_reader_open(const gchar *path, GError **error);
+
+// Decodes the next entry. Returns FALSE at the end of the journal or at a damaged entry.
+gboolean journal_reader_next(JournalReader *reader, JournalEntry *entry);
+
+// Returns whether the reader stopped at the end of the journal rather than at a damaged entry.
+gboolean journal_reader_is_complete(JournalReader *reader);
+
+void journal_reader_free(JournalReader *reader);
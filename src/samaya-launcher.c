@@ -0,0 +1,241 @@
+/* samaya-launcher.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "samaya-launcher.h"
+
+#define LAUNCHER_INTERFACE "com.canonical.Unity.LauncherEntry"
+#define LAUNCHER_PATH_PREFIX "/com/canonical/unity/launcherentry/"
+
+// Ticks land a second apart, the slack keeps a slightly early one from being held back.
+#define LAUNCHER_MIN_INTERVAL_US (900 * G_TIME_SPAN_MILLISECOND)
+
+static const gchar launcherInterfaceXml[] =
+    "<node>"
+    "  <interface name='" LAUNCHER_INTERFACE "'>"
+    "    <method name='Query'>"
+    "      <arg name='properties' type='a{sv}' direction='out'/>"
+    "    </method>"
+    "    <signal name='Update'>"
+    "      <arg name='app_uri' type='s'/>"
+    "      <arg name='properties' type='a{sv}'/>"
+    "    </signal>"
+    "  </interface>"
+    "</node>";
+
+typedef struct
+{
+    guint step;
+    gboolean progress_visible;
+    guint64 count;
+} LauncherState;
+
+struct Launcher
+{
+    SessionManagerPtr session_manager;
+    gulong state_changed_id;
+    gulong time_changed_id;
+    gulong session_complete_id;
+
+    GDBusConnection *connection;
+    GDBusNodeInfo *node_info;
+    guint registration_id;
+    gchar *app_uri;
+    gchar *object_path;
+
+    LauncherState shown;
+    // Timer time of the last update, in the clock of the session timer.
+    gint64 shown_us;
+};
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static void get_current_state(LauncherPtr self, LauncherState *state, gint64 *updated_us)
+{
+    SessionManagerPtr session_manager = self->session_manager;
+    TmSnapshot snapshot;
+
+    tm_snapshot(session_manager->timer_instance, &snapshot);
+
+    // The dock bar fills up as the session goes, unlike the ring which empties.
+    gfloat elapsed = 1.0f - CLAMP(tm_get_progress(session_manager->timer_instance), 0.0f, 1.0f);
+
+    state->step = (guint) (elapsed * LAUNCHER_PROGRESS_STEPS);
+    state->progress_visible = (snapshot.state == StRunning || snapshot.state == StPaused);
+    state->count = session_manager->total_sessions_counted;
+    *updated_us = snapshot.updated_us;
+}
+
+static GVariant *build_properties(const LauncherState *state)
+{
+    GVariantBuilder builder;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "progress",
+                          g_variant_new_double((gdouble) state->step / LAUNCHER_PROGRESS_STEPS));
+    g_variant_builder_add(&builder, "{sv}", "progress-visible",
+                          g_variant_new_boolean(state->progress_visible));
+    g_variant_builder_add(&builder, "{sv}", "count", g_variant_new_int64((gint64) state->count));
+    g_variant_builder_add(&builder, "{sv}", "count-visible",
+                          g_variant_new_boolean(state->count > 0));
+
+    return g_variant_builder_end(&builder);
+}
+
+static void send_update(LauncherPtr self)
+{
+    g_autoptr(GError) error = NULL;
+
+    if (!g_dbus_connection_emit_signal(self->connection, NULL, self->object_path,
+                                       LAUNCHER_INTERFACE, "Update",
+                                       g_variant_new("(s@a{sv})", self->app_uri,
+                                                     build_properties(&self->shown)),
+                                       &error)) {
+        g_warning("Failed to update the launcher entry: %s", error->message);
+    }
+}
+
+// Runs on every timer tick, but only publishes once something visible changed.
+static void on_time_changed(SessionManagerPtr session_manager, gpointer user_data)
+{
+    LauncherPtr self = user_data;
+    LauncherState state;
+    gint64 updated_us;
+
+    get_current_state(self, &state, &updated_us);
+
+    gboolean bar_only = (state.progress_visible == self->shown.progress_visible &&
+                         state.count == self->shown.count);
+
+    if (bar_only && (state.step == self->shown.step || !state.progress_visible ||
+                     updated_us - self->shown_us < LAUNCHER_MIN_INTERVAL_US)) {
+        return;
+    }
+
+    self->shown = state;
+    self->shown_us = updated_us;
+    send_update(self);
+}
+
+// The bar moves one step per LAUNCHER_PROGRESS_STEPS-th of the session, but at most once a second.
+static void request_time_resolution(LauncherPtr self)
+{
+    guint64 step_ms =
+        tm_get_duration_ms(self->session_manager->timer_instance) / LAUNCHER_PROGRESS_STEPS;
+
+    sm_request_time_resolution(self->session_manager, self, MAX(step_ms, TM_TICK_INTERVAL_SECONDS));
+}
+
+static void on_state_changed(SessionManagerPtr session_manager, gpointer user_data)
+{
+    LauncherPtr self = user_data;
+
+    request_time_resolution(self);
+    on_time_changed(session_manager, self);
+}
+
+static void launcher_method_call(GDBusConnection *connection, const gchar *sender,
+                                 const gchar *object_path, const gchar *interface_name,
+                                 const gchar *method_name, GVariant *parameters,
+                                 GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    LauncherPtr self = user_data;
+
+    // Query is the only method, for docks that start after the last update went out.
+    GVariant *properties = build_properties(&self->shown);
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(@a{sv})", properties));
+}
+
+static const GDBusInterfaceVTable launcherInterfaceVTable = {
+    .method_call = launcher_method_call,
+};
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+LauncherPtr launcher_new(SessionManagerPtr session_manager, const gchar *app_id,
+                         GDBusConnection *connection)
+{
+    g_autoptr(GError) error = NULL;
+
+    LauncherPtr launcher = g_new0(Launcher, 1);
+    launcher->session_manager = session_manager;
+    launcher->connection = g_object_ref(connection);
+    launcher->node_info = g_dbus_node_info_new_for_xml(launcherInterfaceXml, NULL);
+    launcher->app_uri = g_strdup_printf("application://%s.desktop", app_id);
+    launcher->object_path =
+        g_strdup_printf(LAUNCHER_PATH_PREFIX "%u", g_str_hash(launcher->app_uri));
+
+    launcher->registration_id = g_dbus_connection_register_object(
+        connection, launcher->object_path, launcher->node_info->interfaces[0],
+        &launcherInterfaceVTable, launcher, NULL, &error);
+    if (launcher->registration_id == 0) {
+        g_warning("Failed to export the launcher entry: %s", error->message);
+        launcher_free(launcher);
+        return NULL;
+    }
+
+    get_current_state(launcher, &launcher->shown, &launcher->shown_us);
+    send_update(launcher);
+
+    launcher->state_changed_id =
+        sm_connect_state_changed(session_manager, on_state_changed, launcher);
+    launcher->time_changed_id = sm_connect_time_changed(session_manager, on_time_changed, launcher);
+    launcher->session_complete_id =
+        sm_connect_session_complete(session_manager, on_state_changed, launcher);
+    request_time_resolution(launcher);
+
+    return launcher;
+}
+
+void launcher_free(LauncherPtr self)
+{
+    if (self == NULL) {
+        return;
+    }
+
+    // Nothing was connected yet when exporting the entry failed.
+    if (self->state_changed_id != 0) {
+        sm_disconnect_state_changed(self->session_manager, self->state_changed_id);
+        sm_request_time_resolution(self->session_manager, self, 0);
+    }
+    if (self->time_changed_id != 0) {
+        sm_disconnect_time_changed(self->session_manager, self->time_changed_id);
+    }
+    if (self->session_complete_id != 0) {
+        sm_disconnect_session_complete(self->session_manager, self->session_complete_id);
+    }
+
+    if (self->registration_id != 0) {
+        self->shown = (LauncherState) {0};
+        send_update(self);
+        g_dbus_connection_unregister_object(self->connection, self->registration_id);
+    }
+
+    g_dbus_node_info_unref(self->node_info);
+    g_object_unref(self->connection);
+    g_free(self->app_uri);
+    g_free(self->object_path);
+    g_free(self);
+}
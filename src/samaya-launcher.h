@@ -0,0 +1,44 @@
+/* samaya-launcher.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "samaya-session.h"
+
+// The launcher progress is quantized to this many steps, about the width in pixels of the bar a
+// dock draws under a large icon.
+#define LAUNCHER_PROGRESS_STEPS 64
+
+typedef struct Launcher Launcher;
+typedef Launcher *LauncherPtr;
+
+/*  Shows the elapsed part of the session as a progress bar, and the finished work sessions as a
+    count, on the launcher icon of docks and taskbars implementing com.canonical.Unity.LauncherEntry
+    for the desktop file app_id.desktop.
+
+    An Update signal only goes out once the quantized bar, its visibility or the count changes,
+    and changes of the bar alone at most once per second of timer time.
+*/
+LauncherPtr launcher_new(SessionManagerPtr session_manager, const gchar *app_id,
+                         GDBusConnection *connection);
+
+// Hides the progress and the count again and stops listening to the session manager.
+void launcher_free(LauncherPtr self);
@@ -0,0 +1,278 @@
+/* samaya-metrics.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <gio/gio.h>
+#include <string.h>
+#include "samaya-metrics.h"
+
+#if defined(G_OS_UNIX)
+#include <errno.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+#endif
+
+#define METRIC_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+struct MetricsServer
+{
+    GSocketService *service;
+    gchar *path;
+};
+
+typedef struct
+{
+    const char *name;
+    const char *help;
+} MetricFamily;
+
+Metrics metrics;
+
+static const MetricFamily counterFamilies[N_METRIC_COUNTERS] = {
+    [MetricTimerWakeups] = {"samaya_timer_wakeups", "Wakeups of the timekeeping thread."},
+    [MetricLabelUpdates] = {"samaya_label_updates", "Updates of the remaining time label."},
+    [MetricRingFrames] = {"samaya_ring_frames", "Frames the progress ring was drawn in."},
+    [MetricNotifications] = {"samaya_notifications", "Desktop notifications sent."},
+};
+
+static const MetricFamily histogramFamilies[N_METRIC_HISTOGRAMS] = {
+    [MetricTickLateness] = {"samaya_tick_lateness_seconds",
+                            "How long after their deadline timer ticks ran."},
+    [MetricRingDrawTime] = {"samaya_ring_draw_seconds",
+                            "Time spent building a frame of the progress ring."},
+    [MetricCompletionLateness] = {"samaya_completion_lateness_seconds",
+                                  "How long after their deadline finished sessions rang."},
+};
+
+// Upper bounds of every bucket but +Inf, from 50us to 100ms.
+static const gint64 bucketBoundsUs[METRIC_HISTOGRAM_BUCKETS - 1] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+};
+
+// The same bounds in seconds, written out so the output does not depend on the locale.
+static const char *const bucketLabels[METRIC_HISTOGRAM_BUCKETS] = {
+    "0.00005", "0.0001", "0.00025", "0.0005", "0.001", "0.0025",
+    "0.005",   "0.01",   "0.025",   "0.05",   "0.1",   "+Inf",
+};
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static void append_seconds(GString *out, guint64 microseconds)
+{
+    g_string_append_printf(out, "%" G_GUINT64_FORMAT ".%06u", microseconds / G_USEC_PER_SEC,
+                           (guint) (microseconds % G_USEC_PER_SEC));
+}
+
+static void append_histogram(GString *out, MetricHistogram histogram)
+{
+    const MetricFamily *family = &histogramFamilies[histogram];
+    guint64 cumulative = 0;
+
+    g_string_append_printf(out, "# TYPE %s histogram\n# UNIT %s seconds\n# HELP %s %s\n",
+                           family->name, family->name, family->name, family->help);
+
+    for (guint i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        cumulative += METRIC_LOAD(metrics.histogram_buckets[histogram][i]);
+        g_string_append_printf(out, "%s_bucket{le=\"%s\"} %" G_GUINT64_FORMAT "\n", family->name,
+                               bucketLabels[i], cumulative);
+    }
+
+    g_string_append_printf(out, "%s_sum ", family->name);
+    append_seconds(out, METRIC_LOAD(metrics.histogram_sums_us[histogram]));
+    g_string_append_printf(out, "\n%s_count %" G_GUINT64_FORMAT "\n", family->name, cumulative);
+}
+
+#if defined(G_OS_UNIX)
+static gchar *get_socket_path(void)
+{
+    return g_build_filename(g_get_user_runtime_dir(), "samaya", "metrics", NULL);
+}
+
+static gboolean on_incoming(GSocketService *service, GSocketConnection *connection,
+                            GObject *source_object, gpointer user_data)
+{
+    g_autofree gchar *text = metrics_format();
+    g_autoptr(GError) error = NULL;
+    GOutputStream *out = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+
+    // A few kilobytes, which always fit into the socket buffer, so this never blocks.
+    if (!g_output_stream_write_all(out, text, strlen(text), NULL, NULL, &error)) {
+        g_debug("Failed to write metrics: %s", error->message);
+    }
+
+    g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+    return TRUE;
+}
+#endif
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+void metrics_observe_us(MetricHistogram histogram, gint64 value_us)
+{
+    guint bucket = 0;
+
+    value_us = MAX(value_us, 0);
+    while (bucket < G_N_ELEMENTS(bucketBoundsUs) && value_us > bucketBoundsUs[bucket]) {
+        bucket++;
+    }
+
+    __atomic_fetch_add(&metrics.histogram_buckets[histogram][bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&metrics.histogram_sums_us[histogram], (guint64) value_us,
+                       __ATOMIC_RELAXED);
+}
+
+gchar *metrics_format(void)
+{
+    GString *out = g_string_sized_new(4096);
+
+    for (guint i = 0; i < N_METRIC_COUNTERS; i++) {
+        const MetricFamily *family = &counterFamilies[i];
+
+        g_string_append_printf(out, "# TYPE %s counter\n# HELP %s %s\n", family->name,
+                               family->name, family->help);
+        g_string_append_printf(out, "%s_total %" G_GUINT64_FORMAT "\n", family->name,
+                               METRIC_LOAD(metrics.counters[i]));
+    }
+
+    g_string_append(out, "# TYPE samaya_sessions counter\n"
+                         "# HELP samaya_sessions Finished and skipped sessions by routine.\n");
+    for (guint routine = 0; routine < METRIC_ROUTINES; routine++) {
+        for (guint skipped = 0; skipped < 2; skipped++) {
+            g_string_append_printf(
+                out, "samaya_sessions_total{routine=\"%s\",skipped=\"%s\"} %" G_GUINT64_FORMAT "\n",
+                routine_to_nick(routine), skipped ? "true" : "false",
+                METRIC_LOAD(metrics.sessions[routine][skipped]));
+        }
+    }
+
+    for (guint i = 0; i < N_METRIC_HISTOGRAMS; i++) {
+        append_histogram(out, i);
+    }
+
+    g_string_append(out, "# EOF\n");
+    return g_string_free(out, FALSE);
+}
+
+#if defined(G_OS_UNIX)
+
+MetricsServerPtr metrics_server_new(void)
+{
+    g_autofree gchar *path = get_socket_path();
+    g_autofree gchar *dir = g_path_get_dirname(path);
+    g_autoptr(GError) error = NULL;
+
+    if (g_mkdir_with_parents(dir, 0700) != 0) {
+        g_warning("Failed to create %s: %s", dir, g_strerror(errno));
+        return NULL;
+    }
+
+    // Left behind by an instance that did not exit cleanly. Only the primary instance serves.
+    g_unlink(path);
+
+    g_autoptr(GSocketAddress) address = g_unix_socket_address_new(path);
+    GSocketService *service = g_socket_service_new();
+
+    if (!g_socket_listener_add_address(G_SOCKET_LISTENER(service), address, G_SOCKET_TYPE_STREAM,
+                                       G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, &error)) {
+        g_warning("Failed to serve metrics on %s: %s", path, error->message);
+        g_object_unref(service);
+        return NULL;
+    }
+
+    g_signal_connect(service, "incoming", G_CALLBACK(on_incoming), NULL);
+    g_socket_service_start(service);
+
+    MetricsServerPtr self = g_new0(MetricsServer, 1);
+    self->service = service;
+    self->path = g_steal_pointer(&path);
+
+    return self;
+}
+
+void metrics_server_free(MetricsServerPtr self)
+{
+    if (self == NULL) {
+        return;
+    }
+
+    g_socket_service_stop(self->service);
+    g_socket_listener_close(G_SOCKET_LISTENER(self->service));
+    g_object_unref(self->service);
+
+    g_unlink(self->path);
+    g_free(self->path);
+    g_free(self);
+}
+
+gchar *metrics_fetch(GError **error)
+{
+    g_autofree gchar *path = get_socket_path();
+    g_autoptr(GSocketAddress) address = g_unix_socket_address_new(path);
+    g_autoptr(GSocketClient) client = g_socket_client_new();
+    g_autoptr(GSocketConnection) connection =
+        g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, error);
+
+    if (connection == NULL) {
+        return NULL;
+    }
+
+    GInputStream *in = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+    GString *text = g_string_new(NULL);
+    char buffer[4096];
+    gssize length;
+
+    while ((length = g_input_stream_read(in, buffer, sizeof(buffer), NULL, error)) > 0) {
+        g_string_append_len(text, buffer, length);
+    }
+
+    if (length < 0) {
+        g_string_free(text, TRUE);
+        return NULL;
+    }
+
+    return g_string_free(text, FALSE);
+}
+
+#else
+
+// Unix sockets are only available on unix systems.
+
+MetricsServerPtr metrics_server_new(void)
+{
+    return NULL;
+}
+
+void metrics_server_free(MetricsServerPtr self)
+{
+}
+
+gchar *metrics_fetch(GError **error)
+{
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                "Metrics are only served on unix systems");
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,95 @@
+/* samaya-metrics.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include "samaya-routine.h"
+
+typedef enum
+{
+    MetricTimerWakeups,
+    MetricLabelUpdates,
+    MetricRingFrames,
+    MetricNotifications,
+    N_METRIC_COUNTERS,
+} MetricCounter;
+
+typedef enum
+{
+    MetricTickLateness,
+    MetricRingDrawTime,
+    MetricCompletionLateness,
+    N_METRIC_HISTOGRAMS,
+} MetricHistogram;
+
+// Buckets of every histogram, the last one is +Inf.
+#define METRIC_HISTOGRAM_BUCKETS 12
+#define METRIC_ROUTINES N_ROUTINES
+
+typedef struct
+{
+    guint64 counters[N_METRIC_COUNTERS];
+
+    // Indexed by routine, then by whether the session was skipped.
+    guint64 sessions[METRIC_ROUTINES][2];
+
+    // Per bucket, not cumulative, and the sum of every observation in microseconds.
+    guint64 histogram_buckets[N_METRIC_HISTOGRAMS][METRIC_HISTOGRAM_BUCKETS];
+    guint64 histogram_sums_us[N_METRIC_HISTOGRAMS];
+} Metrics;
+
+// Process wide metrics. Only ever touched through the functions below.
+extern Metrics metrics;
+
+// Adds one to counter. A single relaxed atomic add, safe to call from any thread.
+static inline void metrics_count(MetricCounter counter)
+{
+    __atomic_fetch_add(&metrics.counters[counter], 1, __ATOMIC_RELAXED);
+}
+
+// Counts a finished session of routine, a RoutineType value.
+static inline void metrics_count_session(guint routine, gboolean skipped)
+{
+    if (routine < METRIC_ROUTINES) {
+        __atomic_fetch_add(&metrics.sessions[routine][skipped ? 1 : 0], 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Records a duration in microseconds, negative ones count as 0. Safe to call from any thread.
+void metrics_observe_us(MetricHistogram histogram, gint64 value_us);
+
+// Renders every metric in the OpenMetrics text format.
+gchar *metrics_format(void);
+
+typedef struct MetricsServer MetricsServer;
+typedef MetricsServer *MetricsServerPtr;
+
+/*  Serves the metrics on the unix socket $XDG_RUNTIME_DIR/samaya/metrics. Every connection is
+    answered with the current metrics and closed, so `socat - UNIX-CONNECT:...` or a scraper that
+    speaks plain text can read them. Returns NULL where unix sockets are not available.
+*/
+MetricsServerPtr metrics_server_new(void);
+
+// Stops serving and removes the socket.
+void metrics_server_free(MetricsServerPtr self);
+
+// Reads the metrics from the socket of a running instance, for `samaya --metrics`.
+gchar *metrics_fetch(GError **error);
@@ -0,0 +1,349 @@
+/* samaya-noise.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <math.h>
+#include <string.h>
+#include "samaya-noise.h"
+
+/*  The white noise comes from four xoshiro128+ generators run side by side in the lanes of one
+    128 bit vector, which GCC and Clang lower to SSE2 or NEON, the baseline of every target built
+    for. Pink noise is Paul Kellet's refined filter with its poles kept in the lanes of two
+    vectors, so a sample costs two vector multiply-adds and a horizontal sum. Brown noise is a
+    leaky integrator and rain is high passed pink noise swelling with a slow brown gust, with
+    sparse decaying droplets.
+*/
+
+#define NOISE_LANES 4
+
+typedef guint32 NoiseU32x4 __attribute__((vector_size(NOISE_LANES * sizeof(guint32))));
+typedef gfloat NoiseF32x4 __attribute__((vector_size(NOISE_LANES * sizeof(gfloat))));
+
+// Loudness of each color, brown and pink get more power as hearing is less sensitive to the bass.
+#define NOISE_WHITE_LEVEL 0.1f
+#define NOISE_PINK_LEVEL 0.045f
+#define NOISE_BROWN_LEVEL 2.0f
+#define NOISE_RAIN_LEVEL 0.09f
+
+#define NOISE_RAIN_CUTOFF_HZ 600.0f
+#define NOISE_RAIN_DROP_MS 8.0f
+// White samples above this start a droplet, about 20 per second at 48 kHz.
+#define NOISE_RAIN_DROP_THRESHOLD 0.9992f
+// Below this a droplet is over, cut before its tail decays into slow denormals.
+#define NOISE_RAIN_DROP_FLOOR 1e-4f
+
+struct NoiseGenerator
+{
+    // State of the four generators, one per lane.
+    NoiseU32x4 rng[4];
+
+    NoiseF32x4 white[NOISE_BLOCK_FRAMES / NOISE_LANES];
+
+    // One pole of the pink filter per lane, the last two are the direct terms.
+    NoiseF32x4 pink[2];
+    gfloat brown;
+    gfloat rain_last;
+    gfloat rain_highpass;
+    gfloat rain_drop;
+
+    gfloat rain_highpass_coefficient;
+    gfloat rain_drop_decay;
+
+    gfloat gain;
+    gfloat gain_step;
+
+    // The color the filter state belongs to, only touched by the rendering thread.
+    NoiseColor rendered;
+
+    // Written from any thread.
+    gint color;
+    gint playing;
+    // Set by the rendering thread while it renders nothing but silence, read from any thread.
+    gint silent;
+};
+
+static const NoiseF32x4 pinkPoles[2] = {
+    {0.99886f, 0.99332f, 0.96900f, 0.86650f},
+    {0.55000f, -0.7616f, 0.0f, 0.0f},
+};
+static const NoiseF32x4 pinkGains[2] = {
+    {0.0555179f, 0.0750759f, 0.1538520f, 0.3104856f},
+    {0.5329522f, -0.0168980f, 0.115926f, 0.5362f},
+};
+
+static const gchar *const noiseColorNicks[N_NOISE_COLORS] = {
+    [NoiseOff] = "off",     [NoiseWhite] = "white", [NoisePink] = "pink",
+    [NoiseBrown] = "brown", [NoiseRain] = "rain",
+};
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static guint64 splitmix64(guint64 *state)
+{
+    guint64 z = (*state += G_GUINT64_CONSTANT(0x9e3779b97f4a7c15));
+    z = (z ^ (z >> 30)) * G_GUINT64_CONSTANT(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * G_GUINT64_CONSTANT(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+static inline NoiseU32x4 rotate_left(NoiseU32x4 value, guint bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// Advances every lane by one step and returns their outputs as uniform floats in [-1, 1).
+static inline NoiseF32x4 next_white(NoiseU32x4 *rng)
+{
+    NoiseU32x4 result = rng[0] + rng[3];
+    NoiseU32x4 shifted = rng[1] << 9;
+
+    rng[2] ^= rng[0];
+    rng[3] ^= rng[1];
+    rng[1] ^= rng[2];
+    rng[0] ^= rng[3];
+    rng[2] ^= shifted;
+    rng[3] = rotate_left(rng[3], 11);
+
+    // The top 23 bits as the mantissa of a float in [1, 2).
+    NoiseU32x4 bits = (result >> 9) | 0x3f800000u;
+    return (NoiseF32x4) bits * 2.0f - 3.0f;
+}
+
+static inline gfloat sum_lanes(NoiseF32x4 value)
+{
+    return (value[0] + value[1]) + (value[2] + value[3]);
+}
+
+static inline gfloat white_at(NoiseGeneratorPtr self, guint frame)
+{
+    return self->white[frame / NOISE_LANES][frame % NOISE_LANES];
+}
+
+static void reset_filters(NoiseGeneratorPtr self)
+{
+    self->pink[0] = self->pink[1] = (NoiseF32x4) {0};
+    self->brown = 0.0f;
+    self->rain_last = 0.0f;
+    self->rain_highpass = 0.0f;
+    self->rain_drop = 0.0f;
+}
+
+static inline gfloat next_pink(NoiseGeneratorPtr self, gfloat white)
+{
+    self->pink[0] = self->pink[0] * pinkPoles[0] + white * pinkGains[0];
+    self->pink[1] = self->pink[1] * pinkPoles[1] + white * pinkGains[1];
+    return sum_lanes(self->pink[0] + self->pink[1]);
+}
+
+static inline gfloat next_brown(NoiseGeneratorPtr self, gfloat white)
+{
+    self->brown = (self->brown + 0.02f * white) * (1.0f / 1.02f);
+    return self->brown;
+}
+
+static void synthesize(NoiseGeneratorPtr self, gfloat *out, guint frames)
+{
+    for (guint i = 0; i < frames; i += NOISE_LANES) {
+        self->white[i / NOISE_LANES] = next_white(self->rng);
+    }
+
+    switch (self->rendered) {
+        case NoiseWhite:
+            for (guint i = 0; i < frames; i++) {
+                out[i] = white_at(self, i) * NOISE_WHITE_LEVEL;
+            }
+            break;
+        case NoisePink:
+            for (guint i = 0; i < frames; i++) {
+                out[i] = next_pink(self, white_at(self, i)) * NOISE_PINK_LEVEL;
+            }
+            break;
+        case NoiseBrown:
+            for (guint i = 0; i < frames; i++) {
+                out[i] = next_brown(self, white_at(self, i)) * NOISE_BROWN_LEVEL;
+            }
+            break;
+        case NoiseRain:
+            for (guint i = 0; i < frames; i++) {
+                gfloat white = white_at(self, i);
+                gfloat pink = next_pink(self, white);
+                gfloat gust = CLAMP(next_brown(self, white) * 4.0f, -1.0f, 1.0f);
+
+                gfloat rise = pink - self->rain_last;
+                self->rain_highpass =
+                    self->rain_highpass_coefficient * (self->rain_highpass + rise);
+                self->rain_last = pink;
+
+                self->rain_drop *= self->rain_drop_decay;
+                if (white > NOISE_RAIN_DROP_THRESHOLD) {
+                    self->rain_drop = 1.0f;
+                } else if (self->rain_drop < NOISE_RAIN_DROP_FLOOR) {
+                    self->rain_drop = 0.0f;
+                }
+
+                out[i] = (self->rain_highpass * (0.75f + 0.25f * gust) +
+                          white * self->rain_drop * 0.5f) *
+                         NOISE_RAIN_LEVEL;
+            }
+            break;
+        case NoiseOff:
+        case N_NOISE_COLORS:
+        default:
+            memset(out, 0, frames * sizeof(gfloat));
+            break;
+    }
+}
+
+// Ramps the gain toward target by a fixed step per frame, shaped as a square to sound even.
+static void apply_gain(NoiseGeneratorPtr self, gfloat *out, guint frames, gfloat target)
+{
+    gfloat gain = self->gain;
+
+    if (gain == target) {
+        if (gain != 1.0f) {
+            for (guint i = 0; i < frames; i++) {
+                out[i] *= gain * gain;
+            }
+        }
+        return;
+    }
+
+    for (guint i = 0; i < frames; i++) {
+        gain = (gain < target) ? MIN(gain + self->gain_step, target)
+                               : MAX(gain - self->gain_step, target);
+        out[i] *= gain * gain;
+    }
+
+    self->gain = gain;
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+NoiseGeneratorPtr noise_new(guint32 sample_rate, guint64 seed)
+{
+    // The vectors need their natural alignment, which malloc does not promise everywhere.
+    NoiseGeneratorPtr self =
+        g_aligned_alloc0(1, sizeof(NoiseGenerator), G_ALIGNOF(NoiseGenerator));
+
+    for (guint word = 0; word < G_N_ELEMENTS(self->rng); word++) {
+        for (guint lane = 0; lane < NOISE_LANES; lane++) {
+            self->rng[word][lane] = (guint32) (splitmix64(&seed) >> 32);
+        }
+    }
+
+    gfloat dt = 1.0f / sample_rate;
+    gfloat rc = 1.0f / (2.0f * G_PI * NOISE_RAIN_CUTOFF_HZ);
+    self->rain_highpass_coefficient = rc / (rc + dt);
+    self->rain_drop_decay = expf(-1000.0f / (NOISE_RAIN_DROP_MS * sample_rate));
+
+    self->gain_step = 1000.0f / (NOISE_FADE_MS * (gfloat) sample_rate);
+    self->rendered = NoiseOff;
+    self->silent = TRUE;
+
+    return self;
+}
+
+void noise_free(NoiseGeneratorPtr self)
+{
+    g_aligned_free(self);
+}
+
+void noise_set_color(NoiseGeneratorPtr self, NoiseColor color)
+{
+    g_atomic_int_set(&self->color, color);
+}
+
+void noise_set_playing(NoiseGeneratorPtr self, gboolean playing)
+{
+    g_atomic_int_set(&self->playing, !!playing);
+}
+
+gboolean noise_is_silent(NoiseGeneratorPtr self)
+{
+    return !g_atomic_int_get(&self->playing) && g_atomic_int_get(&self->silent);
+}
+
+void noise_render(NoiseGeneratorPtr self, gfloat *out, guint frames)
+{
+    NoiseColor color = (NoiseColor) g_atomic_int_get(&self->color);
+    gfloat target = (g_atomic_int_get(&self->playing) && color != NoiseOff) ? 1.0f : 0.0f;
+
+    // A new color only takes over the filters once the old one has faded out.
+    if (color != self->rendered && color != NoiseOff) {
+        if (self->gain == 0.0f) {
+            self->rendered = color;
+            reset_filters(self);
+        } else {
+            target = 0.0f;
+        }
+    }
+
+    if (self->gain == 0.0f && target == 0.0f) {
+        if (!g_atomic_int_get(&self->silent)) {
+            g_atomic_int_set(&self->silent, TRUE);
+        }
+        memset(out, 0, frames * sizeof(gfloat));
+        return;
+    }
+
+    if (g_atomic_int_get(&self->silent)) {
+        g_atomic_int_set(&self->silent, FALSE);
+    }
+
+    while (frames > 0) {
+        guint count = MIN(frames, NOISE_BLOCK_FRAMES);
+
+        synthesize(self, out, count);
+        apply_gain(self, out, count, target);
+
+        out += count;
+        frames -= count;
+    }
+
+    // The fade out ended within this pass, no need to wait for the next one to report it.
+    if (self->gain == 0.0f && target == 0.0f) {
+        g_atomic_int_set(&self->silent, TRUE);
+    }
+}
+
+const gchar *noise_color_to_nick(NoiseColor color)
+{
+    if ((guint) color >= N_NOISE_COLORS) {
+        return noiseColorNicks[NoiseOff];
+    }
+
+    return noiseColorNicks[color];
+}
+
+NoiseColor noise_color_from_nick(const gchar *nick)
+{
+    for (guint i = 0; i < N_NOISE_COLORS; i++) {
+        if (g_strcmp0(nick, noiseColorNicks[i]) == 0) {
+            return (NoiseColor) i;
+        }
+    }
+
+    return NoiseOff;
+}
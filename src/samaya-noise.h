@@ -0,0 +1,67 @@
+/* samaya-noise.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+// The order matches the choices of the ambient-noise setting and the preferences combo row.
+typedef enum
+{
+    NoiseOff,
+    NoiseWhite,
+    NoisePink,
+    NoiseBrown,
+    NoiseRain,
+    N_NOISE_COLORS,
+} NoiseColor;
+
+// Frames synthesized per pass, the generator never allocates while rendering.
+#define NOISE_BLOCK_FRAMES 512
+// Length of the fade in and out when playback starts, stops or changes color.
+#define NOISE_FADE_MS 800
+
+typedef struct NoiseGenerator NoiseGenerator;
+typedef NoiseGenerator *NoiseGeneratorPtr;
+
+NoiseGeneratorPtr noise_new(guint32 sample_rate, guint64 seed);
+
+void noise_free(NoiseGeneratorPtr self);
+
+/*  Picks the color played and starts or stops playback. Both are safe to call from any thread
+    while another one renders, the change is faded in over the next NOISE_FADE_MS of rendering. A
+    color change while playing fades the old color out before the new one fades in.
+*/
+void noise_set_color(NoiseGeneratorPtr self, NoiseColor color);
+
+void noise_set_playing(NoiseGeneratorPtr self, gboolean playing);
+
+// Whether playback is stopped and the fade out was rendered to its end. Safe from any thread.
+gboolean noise_is_silent(NoiseGeneratorPtr self);
+
+/*  Writes frames mono float samples to out. Meant for the audio thread, it takes no locks and
+    never allocates, and once faded out it only clears out.
+*/
+void noise_render(NoiseGeneratorPtr self, gfloat *out, guint frames);
+
+// The nick of color as used by the ambient-noise setting, and back. Unknown nicks map to NoiseOff.
+const gchar *noise_color_to_nick(NoiseColor color);
+
+NoiseColor noise_color_from_nick(const gchar *nick);
@@ -20,12 +20,14 @@
 
 #include "samaya-preferences-dialog.h"
 #include <glib/gi18n.h>
-#include "samaya-session.h"
+#include "samaya-noise.h"
 
 struct _SamayaPreferencesDialog
 {
     AdwPreferencesDialog parent_instance;
 
+    GSettings *settings;
+
     AdwSpinRow *work_duration_row;
     AdwSpinRow *short_break_row;
     AdwSpinRow *long_break_row;
@@ -34,140 +36,36 @@ struct _SamayaPreferencesDialog
 
     AdwSwitchRow *auto_start_breaks_row;
     AdwSwitchRow *auto_start_work_row;
+
+    AdwSwitchRow *ticking_sound_row;
+    AdwComboRow *ambient_noise_row;
+    AdwSwitchRow *ambient_noise_breaks_row;
+
+    AdwSwitchRow *tray_icon_row;
 };
 
 G_DEFINE_FINAL_TYPE(SamayaPreferencesDialog, samaya_preferences_dialog, ADW_TYPE_PREFERENCES_DIALOG)
 
 
 /* ============================================================================
- * Preferences change Handlers
+ * Samaya Preferences Dialog Methods
  * ============================================================================ */
 
-static void on_work_duration_changed(AdwSpinRow *row, GParamSpec *pspec, gpointer user_data)
+static void samaya_preferences_dialog_dispose(GObject *object)
 {
-    SessionManagerPtr session_manager = sm_get_default();
-    if (session_manager) {
-        gdouble val = adw_spin_row_get_value(row);
-        sm_set_work_duration(session_manager, val);
-
-        GSettings *settings = g_settings_new("io.github.redddfoxxyy.samaya");
-        g_settings_set_double(settings, "work-duration", val);
-        g_object_unref(settings);
-    }
-}
+    SamayaPreferencesDialog *self = SAMAYA_PREFERENCES_DIALOG(object);
 
-static void on_short_break_changed(AdwSpinRow *row, GParamSpec *pspec, gpointer user_data)
-{
-    SessionManagerPtr session_manager = sm_get_default();
-    if (session_manager) {
-        gdouble val = adw_spin_row_get_value(row);
-        sm_set_short_break_duration(session_manager, val);
-
-        GSettings *settings = g_settings_new("io.github.redddfoxxyy.samaya");
-        g_settings_set_double(settings, "short-break-duration", val);
-        g_object_unref(settings);
-    }
-}
+    g_clear_object(&self->settings);
 
-static void on_long_break_changed(AdwSpinRow *row, GParamSpec *pspec, gpointer user_data)
-{
-    SessionManagerPtr session_manager = sm_get_default();
-    if (session_manager) {
-        gdouble val = adw_spin_row_get_value(row);
-        sm_set_long_break_duration(session_manager, val);
-
-        GSettings *settings = g_settings_new("io.github.redddfoxxyy.samaya");
-        g_settings_set_double(settings, "long-break-duration", val);
-        g_object_unref(settings);
-    }
-}
-
-static void on_sessions_count_changed(AdwSpinRow *row, GParamSpec *pspec, gpointer user_data)
-{
-    SessionManagerPtr session_manager = sm_get_default();
-    if (session_manager) {
-        guint16 val = (guint16) adw_spin_row_get_value(row);
-        sm_set_sessions_to_complete(session_manager, val);
-
-        GSettings *settings = g_settings_new("io.github.redddfoxxyy.samaya");
-        GVariant *variant = g_variant_new_uint16(val);
-        g_settings_set_value(settings, "sessions-to-complete", variant);
-        g_object_unref(settings);
-    }
-}
-
-static void on_auto_start_breaks_changed(AdwSwitchRow *row, GParamSpec *pspec, gpointer user_data)
-{
-    SessionManagerPtr session_manager = sm_get_default();
-    if (session_manager) {
-        gboolean val = adw_switch_row_get_active(row);
-        sm_set_auto_start_breaks(session_manager, val);
-
-        GSettings *settings = g_settings_new("io.github.redddfoxxyy.samaya");
-        g_settings_set_boolean(settings, "auto-start-breaks", val);
-        g_object_unref(settings);
-    }
-}
-
-static void on_auto_start_work_changed(AdwSwitchRow *row, GParamSpec *pspec, gpointer user_data)
-{
-    SessionManagerPtr session_manager = sm_get_default();
-    if (session_manager) {
-        gboolean val = adw_switch_row_get_active(row);
-        sm_set_auto_start_work(session_manager, val);
-
-        GSettings *settings = g_settings_new("io.github.redddfoxxyy.samaya");
-        g_settings_set_boolean(settings, "auto-start-work", val);
-        g_object_unref(settings);
-    }
+    G_OBJECT_CLASS(samaya_preferences_dialog_parent_class)->dispose(object);
 }
 
-static void set_initial_preference_values(SessionManagerPtr session_manager,
-                                          SamayaPreferencesDialog *self)
-{
-    if (session_manager != NULL) {
-        g_signal_handlers_block_by_func(self->work_duration_row, on_work_duration_changed, self);
-        adw_spin_row_set_value(self->work_duration_row, sm_get_work_duration(session_manager));
-        g_signal_handlers_unblock_by_func(self->work_duration_row, on_work_duration_changed, self);
-
-        g_signal_handlers_block_by_func(self->short_break_row, on_short_break_changed, self);
-        adw_spin_row_set_value(self->short_break_row, sm_get_short_break_duration(session_manager));
-        g_signal_handlers_unblock_by_func(self->short_break_row, on_short_break_changed, self);
-
-        g_signal_handlers_block_by_func(self->long_break_row, on_long_break_changed, self);
-        adw_spin_row_set_value(self->long_break_row, sm_get_long_break_duration(session_manager));
-        g_signal_handlers_unblock_by_func(self->long_break_row, on_long_break_changed, self);
-
-        g_signal_handlers_block_by_func(self->sessions_count_row, on_sessions_count_changed, self);
-        adw_spin_row_set_value(self->sessions_count_row,
-                               sm_get_sessions_to_complete(session_manager));
-        g_signal_handlers_unblock_by_func(self->sessions_count_row, on_sessions_count_changed,
-                                          self);
-
-        g_signal_handlers_block_by_func(self->auto_start_breaks_row, on_auto_start_breaks_changed,
-                                        self);
-        adw_switch_row_set_active(self->auto_start_breaks_row,
-                                  sm_get_auto_start_breaks(session_manager));
-        g_signal_handlers_unblock_by_func(self->auto_start_breaks_row, on_auto_start_breaks_changed,
-                                          self);
-
-        g_signal_handlers_block_by_func(self->auto_start_work_row, on_auto_start_work_changed,
-                                        self);
-        adw_switch_row_set_active(self->auto_start_work_row,
-                                  sm_get_auto_start_work(session_manager));
-        g_signal_handlers_unblock_by_func(self->auto_start_work_row, on_auto_start_work_changed,
-                                          self);
-    }
-}
-
-
-/* ============================================================================
- * Samaya Preferences Dialog Methods
- * ============================================================================ */
-
 static void samaya_preferences_dialog_class_init(SamayaPreferencesDialogClass *klass)
 {
     GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+    object_class->dispose = samaya_preferences_dialog_dispose;
 
     gtk_widget_class_set_template_from_resource(
         widget_class, "/io/github/redddfoxxyy/samaya/preferences-dialog.ui");
@@ -180,22 +78,57 @@ static void samaya_preferences_dialog_class_init(SamayaPreferencesDialogClass *k
                                          auto_start_breaks_row);
     gtk_widget_class_bind_template_child(widget_class, SamayaPreferencesDialog,
                                          auto_start_work_row);
+    gtk_widget_class_bind_template_child(widget_class, SamayaPreferencesDialog, ticking_sound_row);
+    gtk_widget_class_bind_template_child(widget_class, SamayaPreferencesDialog, ambient_noise_row);
+    gtk_widget_class_bind_template_child(widget_class, SamayaPreferencesDialog,
+                                         ambient_noise_breaks_row);
+    gtk_widget_class_bind_template_child(widget_class, SamayaPreferencesDialog, tray_icon_row);
+}
+
+// The combo row items are listed in NoiseColor order, so the selected position is the color.
+static gboolean get_noise_position(GValue *value, GVariant *variant, gpointer user_data)
+{
+    g_value_set_uint(value, noise_color_from_nick(g_variant_get_string(variant, NULL)));
+    return TRUE;
+}
 
-    gtk_widget_class_bind_template_callback(widget_class, on_work_duration_changed);
-    gtk_widget_class_bind_template_callback(widget_class, on_short_break_changed);
-    gtk_widget_class_bind_template_callback(widget_class, on_long_break_changed);
-    gtk_widget_class_bind_template_callback(widget_class, on_sessions_count_changed);
-    gtk_widget_class_bind_template_callback(widget_class, on_auto_start_breaks_changed);
-    gtk_widget_class_bind_template_callback(widget_class, on_auto_start_work_changed);
+static GVariant *set_noise_position(const GValue *value, const GVariantType *expected_type,
+                                    gpointer user_data)
+{
+    return g_variant_new_string(noise_color_to_nick(g_value_get_uint(value)));
 }
 
+/*  The rows are bound to GSettings both ways and the dialog never talks to the session manager.
+    SamayaApplication applies every change from dconf, whether it came from here, gsettings or
+    another process, so the dialog also follows changes made elsewhere while it is open.
+*/
 static void samaya_preferences_dialog_init(SamayaPreferencesDialog *self)
 {
     gtk_widget_init_template(GTK_WIDGET(self));
 
-    SessionManagerPtr session_manager = sm_get_default();
-
-    set_initial_preference_values(session_manager, self);
+    self->settings = g_settings_new("io.github.redddfoxxyy.samaya");
+
+    g_settings_bind(self->settings, "work-duration", self->work_duration_row, "value",
+                    G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind(self->settings, "short-break-duration", self->short_break_row, "value",
+                    G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind(self->settings, "long-break-duration", self->long_break_row, "value",
+                    G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind(self->settings, "sessions-to-complete", self->sessions_count_row, "value",
+                    G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind(self->settings, "auto-start-breaks", self->auto_start_breaks_row, "active",
+                    G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind(self->settings, "auto-start-work", self->auto_start_work_row, "active",
+                    G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind(self->settings, "ticking-sound", self->ticking_sound_row, "active",
+                    G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind_with_mapping(self->settings, "ambient-noise", self->ambient_noise_row,
+                                 "selected", G_SETTINGS_BIND_DEFAULT, get_noise_position,
+                                 set_noise_position, NULL, NULL);
+    g_settings_bind(self->settings, "ambient-noise-breaks", self->ambient_noise_breaks_row,
+                    "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind(self->settings, "tray-icon", self->tray_icon_row, "active",
+                    G_SETTINGS_BIND_DEFAULT);
 }
 
 SamayaPreferencesDialog *samaya_preferences_dialog_new(void)
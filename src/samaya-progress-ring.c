@@ -0,0 +1,274 @@
+/* samaya-progress-ring.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <math.h>
+#include "samaya-metrics.h"
+#include "samaya-progress-ring.h"
+
+#define RING_LINE_WIDTH 10.0f
+#define RING_TRACK_ALPHA 0.2f
+
+/*  The ring is emitted as two GSK stroke nodes, a faint full circle as the track and the progress
+    arc on top. Unlike a cairo draw function nothing is rasterized on the CPU and uploaded per
+    frame, the renderer strokes the paths itself. The track only depends on the widget size, so
+    its path is kept between frames.
+*/
+struct _SamayaProgressRing
+{
+    GtkWidget parent_instance;
+
+    gfloat progress;
+
+    GskStroke *stroke;
+
+    GskPath *track_path;
+    int track_width;
+    int track_height;
+};
+
+G_DEFINE_FINAL_TYPE(SamayaProgressRing, samaya_progress_ring, GTK_TYPE_WIDGET)
+
+enum
+{
+    PROP_0,
+    PROP_PROGRESS,
+    N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS];
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static GskPath *build_arc_path(const graphene_point_t *center, float radius, gfloat progress)
+{
+    GskPathBuilder *builder = gsk_path_builder_new();
+
+    if (progress >= 1.0f) {
+        gsk_path_builder_add_circle(builder, center, radius);
+    } else {
+        // Clockwise from 12 o'clock, same as the arc the cairo implementation drew.
+        double end_angle = -M_PI / 2 + 2 * M_PI * progress;
+
+        gsk_path_builder_move_to(builder, center->x, center->y - radius);
+        gsk_path_builder_svg_arc_to(builder, radius, radius, 0, progress > 0.5f, TRUE,
+                                    center->x + radius * cos(end_angle),
+                                    center->y + radius * sin(end_angle));
+    }
+
+    return gsk_path_builder_free_to_path(builder);
+}
+
+static GskPath *ensure_track_path(SamayaProgressRing *self, int width, int height,
+                                  const graphene_point_t *center, float radius)
+{
+    if (self->track_path == NULL || self->track_width != width || self->track_height != height) {
+        g_clear_pointer(&self->track_path, gsk_path_unref);
+
+        GskPathBuilder *builder = gsk_path_builder_new();
+        gsk_path_builder_add_circle(builder, center, radius);
+
+        self->track_path = gsk_path_builder_free_to_path(builder);
+        self->track_width = width;
+        self->track_height = height;
+    }
+
+    return self->track_path;
+}
+
+static GskStroke *new_ring_stroke(void)
+{
+    GskStroke *stroke = gsk_stroke_new(RING_LINE_WIDTH);
+    gsk_stroke_set_line_cap(stroke, GSK_LINE_CAP_ROUND);
+
+    return stroke;
+}
+
+static gboolean get_ring_geometry(int width, int height, graphene_point_t *center, float *radius)
+{
+    graphene_point_init(center, width / 2.0f, height / 2.0f);
+    *radius = MIN(width, height) / 2.0f - RING_LINE_WIDTH;
+
+    return *radius > 0;
+}
+
+static void append_ring(GtkSnapshot *snapshot, GskStroke *stroke, GskPath *track_path,
+                        const graphene_point_t *center, float radius, const GdkRGBA *color,
+                        gfloat progress)
+{
+    GdkRGBA track_color = *color;
+    track_color.alpha *= RING_TRACK_ALPHA;
+
+    gtk_snapshot_append_stroke(snapshot, track_path, stroke, &track_color);
+
+    if (progress > 0.0f) {
+        GskPath *arc_path = build_arc_path(center, radius, progress);
+        gtk_snapshot_append_stroke(snapshot, arc_path, stroke, color);
+        gsk_path_unref(arc_path);
+    }
+}
+
+
+/* ============================================================================
+ * Samaya Progress Ring Methods
+ * ============================================================================ */
+
+static void samaya_progress_ring_snapshot(GtkWidget *widget, GtkSnapshot *snapshot)
+{
+    SamayaProgressRing *self = SAMAYA_PROGRESS_RING(widget);
+    gint64 started_us = g_get_monotonic_time();
+
+    metrics_count(MetricRingFrames);
+
+    int width = gtk_widget_get_width(widget);
+    int height = gtk_widget_get_height(widget);
+
+    graphene_point_t center;
+    float radius;
+
+    if (!get_ring_geometry(width, height, &center, &radius)) {
+        return;
+    }
+
+    GdkRGBA color;
+    gtk_widget_get_color(widget, &color);
+
+    GskPath *track_path = ensure_track_path(self, width, height, &center, radius);
+    append_ring(snapshot, self->stroke, track_path, &center, radius, &color, self->progress);
+
+    metrics_observe_us(MetricRingDrawTime, g_get_monotonic_time() - started_us);
+}
+
+static void samaya_progress_ring_get_property(GObject *object, guint prop_id, GValue *value,
+                                              GParamSpec *pspec)
+{
+    SamayaProgressRing *self = SAMAYA_PROGRESS_RING(object);
+
+    switch (prop_id) {
+        case PROP_PROGRESS:
+            g_value_set_float(value, self->progress);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void samaya_progress_ring_set_property(GObject *object, guint prop_id,
+                                              const GValue *value, GParamSpec *pspec)
+{
+    SamayaProgressRing *self = SAMAYA_PROGRESS_RING(object);
+
+    switch (prop_id) {
+        case PROP_PROGRESS:
+            samaya_progress_ring_set_progress(self, g_value_get_float(value));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void samaya_progress_ring_finalize(GObject *object)
+{
+    SamayaProgressRing *self = SAMAYA_PROGRESS_RING(object);
+
+    g_clear_pointer(&self->track_path, gsk_path_unref);
+    g_clear_pointer(&self->stroke, gsk_stroke_free);
+
+    G_OBJECT_CLASS(samaya_progress_ring_parent_class)->finalize(object);
+}
+
+static void samaya_progress_ring_class_init(SamayaProgressRingClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+
+    object_class->get_property = samaya_progress_ring_get_property;
+    object_class->set_property = samaya_progress_ring_set_property;
+    object_class->finalize = samaya_progress_ring_finalize;
+
+    widget_class->snapshot = samaya_progress_ring_snapshot;
+
+    properties[PROP_PROGRESS] =
+        g_param_spec_float("progress", NULL, NULL, 0.0f, 1.0f, 1.0f,
+                           G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties(object_class, N_PROPS, properties);
+
+    gtk_widget_class_set_css_name(widget_class, "progressring");
+}
+
+static void samaya_progress_ring_init(SamayaProgressRing *self)
+{
+    self->progress = 1.0f;
+
+    self->stroke = new_ring_stroke();
+}
+
+GtkWidget *samaya_progress_ring_new(void)
+{
+    return g_object_new(SAMAYA_TYPE_PROGRESS_RING, NULL);
+}
+
+void samaya_progress_ring_set_progress(SamayaProgressRing *self, gfloat progress)
+{
+    g_return_if_fail(SAMAYA_IS_PROGRESS_RING(self));
+
+    progress = CLAMP(progress, 0.0f, 1.0f);
+    if (self->progress == progress) {
+        return;
+    }
+
+    self->progress = progress;
+
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+    g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_PROGRESS]);
+}
+
+gfloat samaya_progress_ring_get_progress(SamayaProgressRing *self)
+{
+    g_return_val_if_fail(SAMAYA_IS_PROGRESS_RING(self), 0.0f);
+
+    return self->progress;
+}
+
+void samaya_progress_ring_append(GtkSnapshot *snapshot, int width, int height,
+                                 const GdkRGBA *color, gfloat progress)
+{
+    graphene_point_t center;
+    float radius;
+
+    if (!get_ring_geometry(width, height, &center, &radius)) {
+        return;
+    }
+
+    GskStroke *stroke = new_ring_stroke();
+
+    GskPathBuilder *builder = gsk_path_builder_new();
+    gsk_path_builder_add_circle(builder, &center, radius);
+    GskPath *track_path = gsk_path_builder_free_to_path(builder);
+
+    append_ring(snapshot, stroke, track_path, &center, radius, color,
+                CLAMP(progress, 0.0f, 1.0f));
+
+    gsk_path_unref(track_path);
+    gsk_stroke_free(stroke);
+}
@@ -0,0 +1,44 @@
+/* samaya-progress-ring.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define SAMAYA_TYPE_PROGRESS_RING (samaya_progress_ring_get_type())
+
+G_DECLARE_FINAL_TYPE(SamayaProgressRing, samaya_progress_ring, SAMAYA, PROGRESS_RING, GtkWidget)
+
+GtkWidget *samaya_progress_ring_new(void);
+
+// Sets the filled fraction of the ring, from 0 (empty) to 1 (full circle).
+void samaya_progress_ring_set_progress(SamayaProgressRing *self, gfloat progress);
+
+gfloat samaya_progress_ring_get_progress(SamayaProgressRing *self);
+
+/*  Appends the ring a width x height widget shows in color with progress filled to snapshot. This
+    draws exactly what the widget does but needs no widget or display, for rendering it offscreen.
+*/
+void samaya_progress_ring_append(GtkSnapshot *snapshot, int width, int height,
+                                 const GdkRGBA *color, gfloat progress);
+
+G_END_DECLS
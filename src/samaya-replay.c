@@ -0,0 +1,250 @@
+/* samaya-replay.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  Replays a journal recorded with samaya --journal through the timer and session manager,
+    headless and on a virtual clock, so a run of hours finishes in milliseconds.
+
+    Recorded ticks are replayed at their clock readings and the remaining time they produced is
+    compared with the recording, as are the sessions that ran out. The run fails on any
+    divergence. With --repeat the journal is replayed several times and the mean time per replay
+    is printed, which makes a journal usable as a performance workload.
+*/
+
+#include <stdlib.h>
+#include "samaya-journal.h"
+#include "samaya-session.h"
+
+// Ticks are recorded on the timer thread right after it read the clock, allow for that gap.
+#define REPLAY_TICK_TOLERANCE_MS 2
+
+typedef struct
+{
+    gint64 now_us;
+    gboolean verbose;
+
+    guint ticks;
+    guint mismatches;
+    guint completions;
+    guint expected_completions;
+} Replay;
+
+static gint64 replay_clock(gpointer replay_ptr)
+{
+    Replay *replay = replay_ptr;
+    return replay->now_us;
+}
+
+static void on_replay_session_complete(SessionManagerPtr session_manager, gpointer replay_ptr)
+{
+    Replay *replay = replay_ptr;
+
+    if (!session_manager->last_session_skipped) {
+        replay->completions++;
+    }
+}
+
+static void report_mismatch(Replay *replay, const JournalEntry *entry, const char *message)
+{
+    replay->mismatches++;
+
+    if (replay->verbose) {
+        g_printerr("%" G_GINT64_FORMAT ": %s\n", entry->time_us, message);
+    }
+}
+
+static void apply_setting(SessionManagerPtr session_manager, const JournalEntry *entry)
+{
+    switch ((JournalSettingId) entry->code) {
+        case JournalSettingWorkDuration:
+            sm_set_work_duration(session_manager, entry->value);
+            break;
+        case JournalSettingShortBreakDuration:
+            sm_set_short_break_duration(session_manager, entry->value);
+            break;
+        case JournalSettingLongBreakDuration:
+            sm_set_long_break_duration(session_manager, entry->value);
+            break;
+        case JournalSettingSessionsToComplete:
+            sm_set_sessions_to_complete(session_manager, (guint16) entry->value);
+            break;
+        case JournalSettingAutoStartBreaks:
+            sm_set_auto_start_breaks(session_manager, entry->value != 0);
+            break;
+        case JournalSettingAutoStartWork:
+            sm_set_auto_start_work(session_manager, entry->value != 0);
+            break;
+        case JournalSettingLowPowerMode:
+            sm_set_low_power_mode(session_manager, entry->value != 0);
+            break;
+        case N_JOURNAL_SETTINGS:
+        default:
+            g_warning("Unknown setting %u in journal", entry->code);
+            break;
+    }
+}
+
+static void replay_entry(Replay *replay, SessionManagerPtr session_manager,
+                         const JournalEntry *entry)
+{
+    TimerPtr timer = session_manager->timer_instance;
+
+    replay->now_us = entry->time_us;
+
+    switch (entry->type) {
+        case JournalEntryEvent:
+            if (entry->code <= EvReset) {
+                sm_trigger_event(session_manager, (TmEvent) entry->code);
+            }
+            break;
+        case JournalEntryRoutine:
+            if (entry->code <= LongBreak) {
+                sm_set_routine((RoutineType) entry->code, session_manager);
+            }
+            break;
+        case JournalEntrySkip:
+            sm_skip_session();
+            break;
+        case JournalEntrySetting:
+            apply_setting(session_manager, entry);
+            break;
+        case JournalEntryExtend:
+            if (entry->code == JournalExtendCompleted) {
+                sm_extend_completed_session(session_manager, entry->value);
+            } else {
+                sm_extend_session(session_manager, entry->value);
+            }
+            break;
+        case JournalEntryTick: {
+            replay->ticks++;
+
+            if (tm_get_state(timer) != StRunning) {
+                report_mismatch(replay, entry, "tick recorded while the replayed timer is stopped");
+                break;
+            }
+
+            tm_tick(timer);
+
+            gint64 difference = tm_get_remaining_time_ms(timer) - (gint64) entry->remaining_ms;
+            if (ABS(difference) > REPLAY_TICK_TOLERANCE_MS) {
+                g_autofree gchar *message = g_strdup_printf(
+                    "tick left %" G_GUINT64_FORMAT " ms, replay left %" G_GINT64_FORMAT " ms",
+                    entry->remaining_ms, tm_get_remaining_time_ms(timer));
+                report_mismatch(replay, entry, message);
+            }
+            break;
+        }
+        case JournalEntryComplete:
+            replay->expected_completions++;
+            break;
+        case N_JOURNAL_ENTRY_TYPES:
+        default:
+            break;
+    }
+}
+
+static void replay_journal(Replay *replay, GArray *entries)
+{
+    // The journal starts with the configuration, the values passed here are overwritten by it.
+    SessionManagerPtr session_manager = sm_init(4, 25, 5, 15, FALSE, FALSE, NULL, NULL);
+
+    sm_set_headless(session_manager, TRUE);
+    tm_set_clock(session_manager->timer_instance, replay_clock, replay);
+    sm_connect_session_complete(session_manager, on_replay_session_complete, replay);
+
+    for (guint i = 0; i < entries->len; i++) {
+        replay_entry(replay, session_manager, &g_array_index(entries, JournalEntry, i));
+    }
+
+    sm_deinit(session_manager);
+}
+
+int main(int argc, char *argv[])
+{
+    gint repeat = 1;
+    gboolean verbose = FALSE;
+    g_autoptr(GError) error = NULL;
+
+    GOptionEntry options[] = {
+        {"repeat", 'r', 0, G_OPTION_ARG_INT, &repeat, "Replay the journal N times", "N"},
+        {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "Print every divergence", NULL},
+        G_OPTION_ENTRY_NULL,
+    };
+
+    g_autoptr(GOptionContext) context = g_option_context_new("JOURNAL");
+    g_option_context_add_main_entries(context, options, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    if (argc != 2 || repeat < 1) {
+        g_printerr("Usage: %s [--repeat N] [--verbose] JOURNAL\n", g_get_prgname());
+        return EXIT_FAILURE;
+    }
+
+    JournalReader *reader = journal_reader_open(argv[1], &error);
+    if (reader == NULL) {
+        g_printerr("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_autoptr(GArray) entries = g_array_new(FALSE, FALSE, sizeof(JournalEntry));
+    JournalEntry entry;
+
+    while (journal_reader_next(reader, &entry)) {
+        g_array_append_val(entries, entry);
+    }
+
+    if (!journal_reader_is_complete(reader)) {
+        g_printerr("Journal is damaged after %u entries, replaying those\n", entries->len);
+    }
+    journal_reader_free(reader);
+
+    if (entries->len == 0) {
+        g_printerr("Journal is empty\n");
+        return EXIT_FAILURE;
+    }
+
+    Replay replay = {0};
+    gint64 started_us = g_get_monotonic_time();
+
+    for (gint run = 0; run < repeat; run++) {
+        replay = (Replay) {.verbose = verbose && run == 0};
+        replay_journal(&replay, entries);
+    }
+
+    gint64 wall_us = (g_get_monotonic_time() - started_us) / repeat;
+    gint64 virtual_us = g_array_index(entries, JournalEntry, entries->len - 1).time_us -
+                        g_array_index(entries, JournalEntry, 0).time_us;
+
+    g_print("entries:     %u\n", entries->len);
+    g_print("ticks:       %u\n", replay.ticks);
+    g_print("completions: %u replayed, %u recorded\n", replay.completions,
+            replay.expected_completions);
+    g_print("divergences: %u\n", replay.mismatches);
+    g_print("recorded:    %.3f s\n", virtual_us / (gdouble) G_USEC_PER_SEC);
+    g_print("replay:      %.3f ms per run (%.0fx real time)\n", wall_us / 1000.0,
+            wall_us > 0 ? (gdouble) virtual_us / wall_us : 0.0);
+
+    gboolean diverged =
+        replay.mismatches > 0 || replay.completions != replay.expected_completions;
+    return diverged ? EXIT_FAILURE : EXIT_SUCCESS;
+}
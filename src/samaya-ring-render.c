@@ -0,0 +1,540 @@
+/* samaya-ring-render.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  Renders the progress ring offscreen and checks it against golden images.
+
+    Every combination of widget size, scale factor, routine color and progress is snapshotted
+    through samaya_progress_ring_append and rasterized to a texture with the software cairo
+    renderer. GTK is never initialized, so no display is needed. Each combination is rendered for
+    at least --min-time milliseconds, measured over several rounds, and the median time a frame
+    took from snapshot to pixels is reported, as a single JSON object like samaya-bench prints.
+
+    The routine colors are resolved from the .routine-* rules of samaya-style.css, see --style, so
+    the images follow the stylesheet the window uses.
+
+    With --golden the last frame of each combination is compared against DIR/<name>.png. A pixel
+    differs when any channel is more than --tolerance apart, and the run fails when more than
+    --max-differing percent of the pixels differ, or an image is missing. Failed frames are saved
+    to the temporary directory for inspection. --update writes the golden images instead, from a
+    build whose rendering has been checked by eye. The ring-render test checks tests/golden/ring
+    with the default thresholds, and the update-ring-goldens target rewrites it.
+
+    Every combination is also rendered the way the ring was drawn before SamayaProgressRing: a
+    GtkDrawingArea cairo draw function, which GTK records as a cairo node. These "cairo/..."
+    entries are the baseline for the "ring/..." ones and are not checked against golden images.
+    Besides the frame time each entry reports what its render nodes leave for the CPU to rasterize
+    into images that a GPU renderer then uploads every frame:
+
+    - cairo_upload_bytes, the surfaces of cairo nodes, at device scale.
+    - path_mask_bytes, the bounds of stroke and fill nodes, at device scale. An upper bound of what
+      a GPU renderer uploads for paths it masks on the CPU rather than drawing them in a shader.
+*/
+
+#include <gtk/gtk.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "samaya-progress-ring.h"
+
+#define RENDER_ROUNDS 5
+// Stroke width of the cairo ring before SamayaProgressRing, which keeps the same look.
+#define LEGACY_LINE_WIDTH 10.0
+
+typedef enum
+{
+    RingPathSnapshot,
+    RingPathLegacyCairo,
+} RingPath;
+
+typedef struct
+{
+    const char *name;
+    // The samaya-style.css class that colors the ring in this routine.
+    const char *css_class;
+} RenderRoutine;
+
+typedef struct
+{
+    GskRenderer *renderer;
+    gint64 min_time_us;
+    const gchar *golden_dir;
+    gboolean update;
+    gint tolerance;
+    gdouble max_differing;
+} RenderOptions;
+
+typedef enum
+{
+    GoldenNone,
+    GoldenMatch,
+    GoldenMismatch,
+    GoldenMissing,
+    GoldenUpdated,
+} GoldenResult;
+
+static const int sizes[] = {96, 240, 400};
+static const int scales[] = {1, 2};
+static const gfloat progresses[] = {0.0f, 0.25f, 0.5f, 0.75f, 1.0f};
+
+static const RenderRoutine routines[] = {
+    {"working", "routine-working"},
+    {"short-break", "routine-short-break"},
+    {"long-break", "routine-long-break"},
+};
+
+static const char *ring_path_nicks[] = {
+    [RingPathSnapshot] = "ring",
+    [RingPathLegacyCairo] = "cairo",
+};
+
+static const char *golden_result_nicks[] = {
+    [GoldenNone] = "none",
+    [GoldenMatch] = "match",
+    [GoldenMismatch] = "mismatch",
+    [GoldenMissing] = "missing",
+    [GoldenUpdated] = "updated",
+};
+
+
+/* ============================================================================
+ * Rendering
+ * ============================================================================ */
+
+// The draw function of the GtkDrawingArea the ring used to be, unchanged but for its inputs.
+static void draw_legacy_ring(cairo_t *cr, int width, int height, const GdkRGBA *color,
+                             gfloat progress)
+{
+    double center_x = width / 2.0;
+    double center_y = height / 2.0;
+    double radius = MIN(width, height) / 2.0 - LEGACY_LINE_WIDTH;
+
+    cairo_set_line_width(cr, LEGACY_LINE_WIDTH);
+    cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+
+    cairo_set_source_rgba(cr, color->red, color->green, color->blue, 0.2);
+    cairo_arc(cr, center_x, center_y, radius, 0, 2 * G_PI);
+    cairo_stroke(cr);
+
+    double start_angle = -G_PI / 2;
+    double end_angle = start_angle + (2 * G_PI * progress);
+    gdk_cairo_set_source_rgba(cr, color);
+    cairo_arc(cr, center_x, center_y, radius, start_angle, end_angle);
+    cairo_stroke(cr);
+}
+
+static GskRenderNode *snapshot_ring(RingPath path, int size, int scale, const GdkRGBA *color,
+                                    gfloat progress)
+{
+    GtkSnapshot *snapshot = gtk_snapshot_new();
+
+    gtk_snapshot_scale(snapshot, scale, scale);
+
+    if (path == RingPathLegacyCairo) {
+        // What GtkDrawingArea does with its draw function in snapshot().
+        cairo_t *cr = gtk_snapshot_append_cairo(snapshot, &GRAPHENE_RECT_INIT(0, 0, size, size));
+        draw_legacy_ring(cr, size, size, color, progress);
+        cairo_destroy(cr);
+    } else {
+        samaya_progress_ring_append(snapshot, size, size, color, progress);
+    }
+
+    return gtk_snapshot_free_to_node(snapshot);
+}
+
+static GdkTexture *render_ring(GskRenderer *renderer, RingPath path, int size, int scale,
+                               const GdkRGBA *color, gfloat progress)
+{
+    GskRenderNode *node = snapshot_ring(path, size, scale, color, progress);
+    graphene_rect_t viewport = GRAPHENE_RECT_INIT(0, 0, size * scale, size * scale);
+
+    GdkTexture *texture = gsk_renderer_render_texture(renderer, node, &viewport);
+    gsk_render_node_unref(node);
+
+    return texture;
+}
+
+static guint64 get_device_bytes(GskRenderNode *node, int scale)
+{
+    graphene_rect_t bounds;
+    gsk_render_node_get_bounds(node, &bounds);
+
+    guint64 width = (guint64) ceilf(bounds.size.width * scale);
+    guint64 height = (guint64) ceilf(bounds.size.height * scale);
+
+    return width * height * 4;
+}
+
+// Adds up the image data the CPU rasterizes for node, see the top of the file. Not a hot path.
+static void count_upload_bytes(GskRenderNode *node, int scale, guint64 *cairo_bytes,
+                               guint64 *mask_bytes)
+{
+    GskRenderNodeType type = gsk_render_node_get_node_type(node);
+
+    if (type == GSK_CAIRO_NODE) {
+        *cairo_bytes += get_device_bytes(node, scale);
+    } else if (type == GSK_STROKE_NODE || type == GSK_FILL_NODE) {
+        *mask_bytes += get_device_bytes(node, scale);
+    } else if (type == GSK_CONTAINER_NODE) {
+        for (guint i = 0; i < gsk_container_node_get_n_children(node); i++) {
+            count_upload_bytes(gsk_container_node_get_child(node, i), scale, cairo_bytes,
+                               mask_bytes);
+        }
+    } else if (type == GSK_TRANSFORM_NODE) {
+        // Only the scale factor transforms the ring, already accounted for by scale.
+        count_upload_bytes(gsk_transform_node_get_child(node), scale, cairo_bytes, mask_bytes);
+    }
+}
+
+static gint compare_doubles(gconstpointer a, gconstpointer b)
+{
+    gdouble first = *(const gdouble *) a;
+    gdouble second = *(const gdouble *) b;
+
+    return (first > second) - (first < second);
+}
+
+
+/* ============================================================================
+ * Style
+ * ============================================================================ */
+
+static gchar *match_css_value(const gchar *css, const gchar *pattern)
+{
+    g_autoptr(GRegex) regex = g_regex_new(pattern, G_REGEX_MULTILINE, 0, NULL);
+    g_autoptr(GMatchInfo) match_info = NULL;
+
+    if (!g_regex_match(regex, css, 0, &match_info)) {
+        return NULL;
+    }
+
+    return g_strstrip(g_match_info_fetch(match_info, 1));
+}
+
+/*  Resolves the color the rule for css_class sets, following @define-color names. This is not a
+    CSS parser, it only understands the flat rules and definitions samaya-style.css uses.
+*/
+static gboolean resolve_style_color(const gchar *css, const gchar *css_class, GdkRGBA *color)
+{
+    g_autofree gchar *escaped = g_regex_escape_string(css_class, -1);
+    g_autofree gchar *rule_pattern =
+        g_strdup_printf("\\.%s\\s*\\{[^}]*?(?:^|[\\s;{])color\\s*:([^;}]+)", escaped);
+    g_autofree gchar *value = match_css_value(css, rule_pattern);
+
+    if (value == NULL) {
+        g_printerr("No color is set for .%s\n", css_class);
+        return FALSE;
+    }
+
+    if (value[0] == '@') {
+        g_autofree gchar *name = g_regex_escape_string(value + 1, -1);
+        g_autofree gchar *define_pattern =
+            g_strdup_printf("^\\s*@define-color\\s+%s\\s+([^;]+);", name);
+
+        g_free(value);
+        value = match_css_value(css, define_pattern);
+
+        if (value == NULL) {
+            g_printerr("The color of .%s is not defined\n", css_class);
+            return FALSE;
+        }
+    }
+
+    if (!gdk_rgba_parse(color, value)) {
+        g_printerr("The color of .%s, %s, is not a plain color\n", css_class, value);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/* ============================================================================
+ * Golden Images
+ * ============================================================================ */
+
+static guchar *download_texture(GdkTexture *texture)
+{
+    gsize stride = (gsize) gdk_texture_get_width(texture) * 4;
+    guchar *data = g_malloc(stride * gdk_texture_get_height(texture));
+
+    gdk_texture_download(texture, data, stride);
+
+    return data;
+}
+
+/*  Compares two textures pixel by pixel. Returns FALSE if their sizes differ, otherwise sets the
+    largest difference of any channel and the number of pixels that differ by more than tolerance.
+*/
+static gboolean compare_textures(GdkTexture *actual, GdkTexture *golden, gint tolerance,
+                                 gint *max_diff, guint *differing)
+{
+    int width = gdk_texture_get_width(actual);
+    int height = gdk_texture_get_height(actual);
+
+    if (gdk_texture_get_width(golden) != width || gdk_texture_get_height(golden) != height) {
+        return FALSE;
+    }
+
+    g_autofree guchar *actual_data = download_texture(actual);
+    g_autofree guchar *golden_data = download_texture(golden);
+
+    *max_diff = 0;
+    *differing = 0;
+
+    for (gsize pixel = 0; pixel < (gsize) width * height; pixel++) {
+        gint pixel_diff = 0;
+
+        for (guint channel = 0; channel < 4; channel++) {
+            gint diff = ABS(actual_data[pixel * 4 + channel] - golden_data[pixel * 4 + channel]);
+            pixel_diff = MAX(pixel_diff, diff);
+        }
+
+        *max_diff = MAX(*max_diff, pixel_diff);
+        if (pixel_diff > tolerance) {
+            (*differing)++;
+        }
+    }
+
+    return TRUE;
+}
+
+static GoldenResult check_golden(const RenderOptions *options, const gchar *file_name,
+                                 GdkTexture *texture, gint *max_diff, guint *differing)
+{
+    if (options->golden_dir == NULL) {
+        return GoldenNone;
+    }
+
+    g_autofree gchar *path = g_build_filename(options->golden_dir, file_name, NULL);
+
+    if (options->update) {
+        if (!gdk_texture_save_to_png(texture, path)) {
+            g_printerr("Failed to write %s\n", path);
+            return GoldenMissing;
+        }
+        return GoldenUpdated;
+    }
+
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GdkTexture) golden = gdk_texture_new_from_filename(path, &error);
+
+    if (golden == NULL) {
+        g_printerr("%s\n", error->message);
+        return GoldenMissing;
+    }
+
+    int pixels = gdk_texture_get_width(texture) * gdk_texture_get_height(texture);
+
+    if (compare_textures(texture, golden, options->tolerance, max_diff, differing) &&
+        *differing * 100.0 <= options->max_differing * pixels) {
+        return GoldenMatch;
+    }
+
+    g_autofree gchar *actual_path = g_build_filename(g_get_tmp_dir(), file_name, NULL);
+    gdk_texture_save_to_png(texture, actual_path);
+    g_printerr("%s does not match its golden image, the frame was saved to %s\n", file_name,
+               actual_path);
+
+    return GoldenMismatch;
+}
+
+
+/* ============================================================================
+ * Runner
+ * ============================================================================ */
+
+// Renders one combination and prints its result. Returns FALSE if it failed its golden image.
+static gboolean run_render(const RenderOptions *options, RingPath path, const gchar *name,
+                           int size, int scale, const GdkRGBA *color, gfloat progress,
+                           gboolean first)
+{
+    g_autofree gchar *file_name = g_strdelimit(g_strconcat(name, ".png", NULL), "/", '-');
+
+    GdkTexture *texture = NULL;
+    guint64 frames = 1;
+    gdouble us_per_frame[RENDER_ROUNDS];
+
+    // Grow the round until it is long enough to measure.
+    for (;;) {
+        gint64 started_us = g_get_monotonic_time();
+        for (guint64 i = 0; i < frames; i++) {
+            g_clear_object(&texture);
+            texture = render_ring(options->renderer, path, size, scale, color, progress);
+        }
+
+        if (g_get_monotonic_time() - started_us >= options->min_time_us ||
+            frames >= G_MAXUINT32) {
+            break;
+        }
+        frames *= 2;
+    }
+
+    for (guint round = 0; round < RENDER_ROUNDS; round++) {
+        gint64 started_us = g_get_monotonic_time();
+
+        for (guint64 i = 0; i < frames; i++) {
+            g_clear_object(&texture);
+            texture = render_ring(options->renderer, path, size, scale, color, progress);
+        }
+
+        us_per_frame[round] = (gdouble) (g_get_monotonic_time() - started_us) / frames;
+    }
+
+    qsort(us_per_frame, RENDER_ROUNDS, sizeof(gdouble), compare_doubles);
+
+    GskRenderNode *node = snapshot_ring(path, size, scale, color, progress);
+    guint64 cairo_bytes = 0;
+    guint64 mask_bytes = 0;
+    count_upload_bytes(node, scale, &cairo_bytes, &mask_bytes);
+    gsk_render_node_unref(node);
+
+    gint max_diff = 0;
+    guint differing = 0;
+    GoldenResult golden = path == RingPathSnapshot
+                              ? check_golden(options, file_name, texture, &max_diff, &differing)
+                              : GoldenNone;
+
+    g_print("%s\n    {\"name\": \"%s\", \"frames\": %" G_GUINT64_FORMAT
+            ", \"us_per_frame\": %.2f, \"us_per_frame_min\": %.2f, \"cairo_upload_bytes\": %"
+            G_GUINT64_FORMAT ", \"path_mask_bytes\": %" G_GUINT64_FORMAT ", \"golden\": \"%s\"",
+            first ? "" : ",", name, frames, us_per_frame[RENDER_ROUNDS / 2], us_per_frame[0],
+            cairo_bytes, mask_bytes, golden_result_nicks[golden]);
+
+    if (golden == GoldenMatch || golden == GoldenMismatch) {
+        g_print(", \"max_channel_diff\": %d, \"differing_pixels\": %u", max_diff, differing);
+    }
+
+    g_print("}");
+
+    g_object_unref(texture);
+    return golden != GoldenMismatch && golden != GoldenMissing;
+}
+
+int main(int argc, char *argv[])
+{
+    gint min_time_ms = 20;
+    gchar *golden_dir = NULL;
+    gchar *filter = NULL;
+    gchar *style_path = NULL;
+    RenderOptions render_options = {
+        .tolerance = 8,
+        .max_differing = 0.1,
+    };
+    g_autoptr(GError) error = NULL;
+
+    GOptionEntry options[] = {
+        {"min-time", 't', 0, G_OPTION_ARG_INT, &min_time_ms,
+         "Minimum duration of a measured round in milliseconds", "MS"},
+        {"filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+         "Only render combinations whose name contains TEXT", "TEXT"},
+        {"style", 's', 0, G_OPTION_ARG_FILENAME, &style_path,
+         "Take the routine colors from the stylesheet FILE instead of samaya-style.css", "FILE"},
+        {"golden", 'g', 0, G_OPTION_ARG_FILENAME, &golden_dir,
+         "Compare the frames against the golden images in DIR", "DIR"},
+        {"update", 'u', 0, G_OPTION_ARG_NONE, &render_options.update,
+         "Write the golden images instead of comparing against them", NULL},
+        {"tolerance", 0, 0, G_OPTION_ARG_INT, &render_options.tolerance,
+         "Largest channel difference of a matching pixel, out of 255", "N"},
+        {"max-differing", 0, 0, G_OPTION_ARG_DOUBLE, &render_options.max_differing,
+         "Percentage of pixels that may differ from the golden image", "PERCENT"},
+        G_OPTION_ENTRY_NULL,
+    };
+
+    g_autoptr(GOptionContext) context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, options, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    if (render_options.update && golden_dir == NULL) {
+        g_printerr("--update needs --golden\n");
+        return EXIT_FAILURE;
+    }
+
+    if (render_options.update && g_mkdir_with_parents(golden_dir, 0755) != 0) {
+        g_printerr("Failed to create %s\n", golden_dir);
+        return EXIT_FAILURE;
+    }
+
+    g_autofree gchar *css = NULL;
+    if (!g_file_get_contents(style_path != NULL ? style_path : RING_STYLE_CSS, &css, NULL,
+                             &error)) {
+        g_printerr("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    GdkRGBA routine_colors[G_N_ELEMENTS(routines)];
+    for (guint routine = 0; routine < G_N_ELEMENTS(routines); routine++) {
+        if (!resolve_style_color(css, routines[routine].css_class, &routine_colors[routine])) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Software rendering gives the same pixels on every machine, and needs no surface.
+    g_autoptr(GskRenderer) renderer = gsk_cairo_renderer_new();
+    if (!gsk_renderer_realize(renderer, NULL, &error)) {
+        g_printerr("Failed to realize the renderer: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    render_options.renderer = renderer;
+    render_options.min_time_us = (gint64) MAX(min_time_ms, 1) * 1000;
+    render_options.golden_dir = golden_dir;
+
+    g_print("{\n  \"version\": \"%s\",\n  \"renders\": [", PACKAGE_VERSION);
+
+    gboolean first = TRUE;
+    gboolean passed = TRUE;
+
+    for (guint size = 0; size < G_N_ELEMENTS(sizes); size++) {
+        for (guint scale = 0; scale < G_N_ELEMENTS(scales); scale++) {
+            for (guint routine = 0; routine < G_N_ELEMENTS(routines); routine++) {
+                for (guint progress = 0; progress < G_N_ELEMENTS(progresses); progress++) {
+                    for (guint path = 0; path < G_N_ELEMENTS(ring_path_nicks); path++) {
+                        g_autofree gchar *name = g_strdup_printf(
+                            "%s/%d@%dx/%s/%u", ring_path_nicks[path], sizes[size], scales[scale],
+                            routines[routine].name, (guint) (progresses[progress] * 100 + 0.5f));
+
+                        if (filter != NULL && strstr(name, filter) == NULL) {
+                            continue;
+                        }
+
+                        passed &= run_render(&render_options, path, name, sizes[size],
+                                             scales[scale], &routine_colors[routine],
+                                             progresses[progress], first);
+                        first = FALSE;
+                    }
+                }
+            }
+        }
+    }
+
+    g_print("\n  ]\n}\n");
+
+    gsk_renderer_unrealize(renderer);
+    g_free(golden_dir);
+    g_free(filter);
+    g_free(style_path);
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,55 @@
+/* samaya-routine.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef enum
+{
+    Working,
+    ShortBreak,
+    LongBreak,
+} RoutineType;
+
+#define N_ROUTINES (LongBreak + 1)
+
+/*  Returns the stable name of routine, as used in the history export, hook environments and
+    schedules, or "unknown" for a value out of range (e.g. from a corrupt record).
+*/
+static inline const char *routine_to_nick(guint routine)
+{
+    static const char *const nicks[N_ROUTINES] = {"work", "short-break", "long-break"};
+
+    return routine < N_ROUTINES ? nicks[routine] : "unknown";
+}
+
+// Sets routine to the one named nick. Returns FALSE, leaving routine alone, for an unknown name.
+static inline gboolean routine_from_nick(const char *nick, RoutineType *routine)
+{
+    for (guint i = 0; i < N_ROUTINES; i++) {
+        if (g_strcmp0(nick, routine_to_nick(i)) == 0) {
+            *routine = (RoutineType) i;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
@@ -0,0 +1,445 @@
+/* samaya-schedule.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "samaya-schedule.h"
+#include "samaya-timer.h"
+
+#define MINUTES_PER_DAY (24 * 60)
+#define DAY_US ((gint64) MINUTES_PER_DAY * 60 * G_USEC_PER_SEC)
+#define SCHEDULE_MAX_SLEEP_S 60
+
+struct ScheduleBlock
+{
+    // Wall clock time of the next start or end of the block, in microseconds.
+    gint64 deadline_us;
+    guint heap_index;
+
+    guint16 start_minute;
+    guint16 end_minute;
+    RoutineType routine;
+
+    gboolean in_progress;
+};
+
+struct Schedule
+{
+    // Binary min-heap of ScheduleBlock ordered by deadline_us, every block knows its own index.
+    GPtrArray *heap;
+
+    guint wakeup_source_id;
+
+    // Wall clock minus monotonic time when the wakeup was armed, used to notice clock changes.
+    gint64 wall_offset_us;
+};
+
+
+/* ============================================================================
+ * Function Definitions
+ * ============================================================================ */
+
+static gboolean on_schedule_wakeup(gpointer user_data);
+
+
+/* ============================================================================
+ * Min-heap
+ * ============================================================================ */
+
+static inline ScheduleBlock *heap_get(SchedulePtr self, guint index)
+{
+    return g_ptr_array_index(self->heap, index);
+}
+
+static void heap_swap(SchedulePtr self, guint a, guint b)
+{
+    ScheduleBlock *block_a = heap_get(self, a);
+    ScheduleBlock *block_b = heap_get(self, b);
+
+    self->heap->pdata[a] = block_b;
+    self->heap->pdata[b] = block_a;
+    block_a->heap_index = b;
+    block_b->heap_index = a;
+}
+
+static void heap_sift_up(SchedulePtr self, guint index)
+{
+    while (index > 0) {
+        guint parent = (index - 1) / 2;
+
+        if (heap_get(self, parent)->deadline_us <= heap_get(self, index)->deadline_us) {
+            break;
+        }
+
+        heap_swap(self, parent, index);
+        index = parent;
+    }
+}
+
+static void heap_sift_down(SchedulePtr self, guint index)
+{
+    guint len = self->heap->len;
+
+    while (TRUE) {
+        guint left = 2 * index + 1;
+        guint right = left + 1;
+        guint smallest = index;
+
+        if (left < len &&
+            heap_get(self, left)->deadline_us < heap_get(self, smallest)->deadline_us) {
+            smallest = left;
+        }
+        if (right < len &&
+            heap_get(self, right)->deadline_us < heap_get(self, smallest)->deadline_us) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+
+        heap_swap(self, index, smallest);
+        index = smallest;
+    }
+}
+
+static void heap_push(SchedulePtr self, ScheduleBlock *block)
+{
+    block->heap_index = self->heap->len;
+    g_ptr_array_add(self->heap, block);
+    heap_sift_up(self, block->heap_index);
+}
+
+// Restores the heap property after any number of deadlines changed.
+static void heap_rebuild(SchedulePtr self)
+{
+    for (guint i = self->heap->len / 2; i-- > 0;) {
+        heap_sift_down(self, i);
+    }
+}
+
+// Removes and frees the block at index, keeping the heap property.
+static void heap_remove(SchedulePtr self, guint index)
+{
+    guint last = self->heap->len - 1;
+
+    if (index != last) {
+        heap_swap(self, index, last);
+    }
+    g_ptr_array_remove_index(self->heap, last);
+
+    if (index < self->heap->len) {
+        heap_sift_down(self, index);
+        heap_sift_up(self, index);
+    }
+}
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+// Returns the first wall clock time strictly after after_us that is minute_of_day in local time.
+static gint64 get_next_occurrence(guint16 minute_of_day, gint64 after_us)
+{
+    g_autoptr(GDateTime) after = g_date_time_new_from_unix_local(after_us / G_USEC_PER_SEC);
+
+    for (gint day = 0; after != NULL && day <= 1; day++) {
+        g_autoptr(GDateTime) date = g_date_time_add_days(after, day);
+        g_autoptr(GDateTime) candidate =
+            g_date_time_new_local(g_date_time_get_year(date), g_date_time_get_month(date),
+                                  g_date_time_get_day_of_month(date), minute_of_day / 60,
+                                  minute_of_day % 60, 0);
+
+        if (candidate != NULL && g_date_time_to_unix(candidate) * G_USEC_PER_SEC > after_us) {
+            return g_date_time_to_unix(candidate) * G_USEC_PER_SEC;
+        }
+    }
+
+    return after_us + DAY_US;
+}
+
+/*  Finds the latest window of block that started at or before now_us, or else the next one.
+    Returns whether now_us is inside it.
+*/
+static gboolean get_current_window(const ScheduleBlock *block, gint64 now_us, gint64 *start_us,
+                                   gint64 *end_us)
+{
+    *start_us = get_next_occurrence(block->start_minute, now_us - DAY_US);
+    *end_us = get_next_occurrence(block->end_minute, *start_us);
+
+    return *start_us <= now_us && *end_us > now_us;
+}
+
+/*  Points block at its next start. A window that is already open is due right away instead, so the
+    block starts for the rest of it, as if the application had been running when it opened.
+*/
+static void schedule_block(ScheduleBlock *block, gint64 now_us)
+{
+    gint64 start_us, end_us;
+
+    block->in_progress = FALSE;
+    block->deadline_us = get_current_window(block, now_us, &start_us, &end_us)
+                             ? start_us
+                             : get_next_occurrence(block->start_minute, now_us);
+}
+
+static void start_routine(RoutineType routine)
+{
+    SessionManagerPtr session_manager = sm_get_default();
+    if (session_manager == NULL) {
+        return;
+    }
+
+    sm_set_routine(routine, session_manager);
+    sm_trigger_event(session_manager, EvStart);
+}
+
+static void stop_routine(void)
+{
+    SessionManagerPtr session_manager = sm_get_default();
+    if (session_manager == NULL) {
+        return;
+    }
+
+    if (tm_get_state(session_manager->timer_instance) != StIdle) {
+        sm_trigger_event(session_manager, EvReset);
+    }
+}
+
+static void fire_block(SchedulePtr self, ScheduleBlock *block, gint64 now_us)
+{
+    if (block->in_progress) {
+        g_info("Scheduled block ended, stopping the timer");
+        stop_routine();
+
+        block->in_progress = FALSE;
+        block->deadline_us = get_next_occurrence(block->start_minute, now_us);
+    } else {
+        gint64 end_us = get_next_occurrence(block->end_minute, block->deadline_us);
+
+        if (end_us > now_us) {
+            g_info("Scheduled block started");
+            start_routine(block->routine);
+
+            block->in_progress = TRUE;
+            block->deadline_us = end_us;
+        } else {
+            // The whole block was missed, e.g. while the system was suspended.
+            block->deadline_us = get_next_occurrence(block->start_minute, now_us);
+        }
+    }
+
+    heap_sift_down(self, block->heap_index);
+}
+
+/*  Recomputes every deadline from scratch after the wall clock was moved backwards, which would
+    otherwise leave blocks waiting for times that have already passed once. A running block keeps
+    running if the new time is still inside its window, and is stopped otherwise.
+*/
+static void reschedule_all(SchedulePtr self, gint64 now_us)
+{
+    for (guint i = 0; i < self->heap->len; i++) {
+        ScheduleBlock *block = heap_get(self, i);
+        gint64 start_us, end_us;
+
+        if (block->in_progress && get_current_window(block, now_us, &start_us, &end_us)) {
+            block->deadline_us = end_us;
+            continue;
+        }
+
+        if (block->in_progress) {
+            g_info("Scheduled block is no longer open, stopping the timer");
+            stop_routine();
+        }
+
+        schedule_block(block, now_us);
+    }
+
+    heap_rebuild(self);
+}
+
+static void arm_wakeup(SchedulePtr self)
+{
+    g_clear_handle_id(&self->wakeup_source_id, g_source_remove);
+
+    if (self->heap->len == 0) {
+        return;
+    }
+
+    gint64 now_us = g_get_real_time();
+    gint64 delay_us = heap_get(self, 0)->deadline_us - now_us;
+    self->wall_offset_us = now_us - g_get_monotonic_time();
+
+    // GLib timeouts follow the monotonic clock, which neither sees wall clock changes nor counts
+    // time spent suspended, so long waits are split into coalescable one minute steps.
+    if (delay_us > (gint64) SCHEDULE_MAX_SLEEP_S * G_USEC_PER_SEC) {
+        self->wakeup_source_id =
+            g_timeout_add_seconds(SCHEDULE_MAX_SLEEP_S, on_schedule_wakeup, self);
+    } else {
+        guint delay_ms = delay_us > 0 ? (guint) ((delay_us + 999) / 1000) : 0;
+        self->wakeup_source_id = g_timeout_add(delay_ms, on_schedule_wakeup, self);
+    }
+}
+
+static gboolean on_schedule_wakeup(gpointer user_data)
+{
+    SchedulePtr self = user_data;
+    self->wakeup_source_id = 0;
+
+    gint64 now_us = g_get_real_time();
+
+    // Suspending only ever moves the wall clock ahead of the monotonic one.
+    if (now_us - g_get_monotonic_time() < self->wall_offset_us - G_USEC_PER_SEC) {
+        g_info("Wall clock moved backwards, recomputing the schedule");
+        reschedule_all(self, now_us);
+    }
+
+    while (self->heap->len > 0 && heap_get(self, 0)->deadline_us <= now_us) {
+        fire_block(self, heap_get(self, 0), now_us);
+    }
+
+    arm_wakeup(self);
+
+    return G_SOURCE_REMOVE;
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+SchedulePtr schedule_new(void)
+{
+    SchedulePtr schedule = g_new0(Schedule, 1);
+
+    schedule->heap = g_ptr_array_new_with_free_func(g_free);
+
+    return schedule;
+}
+
+void schedule_free(SchedulePtr self)
+{
+    if (self == NULL) {
+        return;
+    }
+
+    g_clear_handle_id(&self->wakeup_source_id, g_source_remove);
+    g_ptr_array_unref(self->heap);
+
+    g_free(self);
+}
+
+ScheduleBlock *schedule_add_block(SchedulePtr self, guint16 start_minute, guint16 end_minute,
+                                  RoutineType routine)
+{
+    g_return_val_if_fail(start_minute < MINUTES_PER_DAY && end_minute < MINUTES_PER_DAY, NULL);
+    g_return_val_if_fail(start_minute != end_minute, NULL);
+
+    ScheduleBlock *block = g_new0(ScheduleBlock, 1);
+    block->start_minute = start_minute;
+    block->end_minute = end_minute;
+    block->routine = routine;
+    schedule_block(block, g_get_real_time());
+
+    heap_push(self, block);
+
+    // Only the earliest deadline decides when the shared source has to wake up.
+    if (block->heap_index == 0) {
+        arm_wakeup(self);
+    }
+
+    return block;
+}
+
+void schedule_remove_block(SchedulePtr self, ScheduleBlock *block)
+{
+    g_return_if_fail(block->heap_index < self->heap->len &&
+                     heap_get(self, block->heap_index) == block);
+
+    gboolean was_next = (block->heap_index == 0);
+
+    heap_remove(self, block->heap_index);
+
+    if (was_next) {
+        arm_wakeup(self);
+    }
+}
+
+void schedule_clear(SchedulePtr self)
+{
+    g_ptr_array_set_size(self->heap, 0);
+    arm_wakeup(self);
+}
+
+void schedule_load(SchedulePtr self, GVariant *blocks)
+{
+    GVariantIter iter;
+    guint16 start_minute, end_minute;
+    const char *routine_name;
+    gint64 now_us = g_get_real_time();
+
+    // Blocks that are running now, so that the ones the new schedule keeps are not started again.
+    g_autoptr(GArray) running = g_array_new(FALSE, FALSE, sizeof(ScheduleBlock));
+    for (guint i = 0; i < self->heap->len; i++) {
+        if (heap_get(self, i)->in_progress) {
+            g_array_append_val(running, *heap_get(self, i));
+        }
+    }
+
+    schedule_clear(self);
+
+    g_variant_iter_init(&iter, blocks);
+    while (g_variant_iter_loop(&iter, "(qq&s)", &start_minute, &end_minute, &routine_name)) {
+        RoutineType routine;
+
+        if (!routine_from_nick(routine_name, &routine) || start_minute >= MINUTES_PER_DAY ||
+            end_minute >= MINUTES_PER_DAY || start_minute == end_minute) {
+            g_warning("Ignoring invalid scheduled block (%u, %u, %s)", start_minute, end_minute,
+                      routine_name);
+            continue;
+        }
+
+        schedule_add_block(self, start_minute, end_minute, routine);
+    }
+
+    for (guint i = 0; i < running->len; i++) {
+        const ScheduleBlock *old = &g_array_index(running, ScheduleBlock, i);
+        gboolean kept = FALSE;
+
+        for (guint j = 0; j < self->heap->len && !kept; j++) {
+            ScheduleBlock *block = heap_get(self, j);
+            gint64 start_us, end_us;
+
+            if (block->start_minute == old->start_minute &&
+                block->end_minute == old->end_minute && block->routine == old->routine &&
+                !block->in_progress && get_current_window(block, now_us, &start_us, &end_us)) {
+                block->in_progress = TRUE;
+                block->deadline_us = end_us;
+                kept = TRUE;
+            }
+        }
+
+        if (!kept) {
+            g_info("Scheduled block was removed, stopping the timer");
+            stop_routine();
+        }
+    }
+
+    heap_rebuild(self);
+    arm_wakeup(self);
+}
@@ -0,0 +1,58 @@
+/* samaya-schedule.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include "samaya-session.h"
+
+typedef struct ScheduleBlock ScheduleBlock;
+
+typedef struct Schedule Schedule;
+typedef Schedule *SchedulePtr;
+
+/*  Constructs an empty schedule of daily focus blocks.
+
+    All blocks share a single wakeup source armed for the earliest pending deadline. Deadlines
+    are wall clock times and the source never sleeps longer than a minute, so a block still fires
+    close to its time after the clock was changed or the system was suspended.
+*/
+SchedulePtr schedule_new(void);
+
+void schedule_free(SchedulePtr self);
+
+/*  Adds a block that starts routine every day at start_minute and stops the timer again at
+    end_minute, both counted in minutes since local midnight. An end before the start means the
+    block spans midnight. A block whose window is already open starts right away, for the rest of
+    it. Runs in O(log n), the returned block is owned by the schedule.
+*/
+ScheduleBlock *schedule_add_block(SchedulePtr self, guint16 start_minute, guint16 end_minute,
+                                  RoutineType routine);
+
+// Removes a block previously returned by schedule_add_block in O(log n).
+void schedule_remove_block(SchedulePtr self, ScheduleBlock *block);
+
+void schedule_clear(SchedulePtr self);
+
+/*  Replaces all blocks with the ones in a GSettings "a(qqs)" value of (start minute, end minute,
+    routine) tuples, where routine is one of "work", "short-break" or "long-break". A running block
+    that the new schedule keeps carries on, the timer is stopped for one that it drops.
+*/
+void schedule_load(SchedulePtr self, GVariant *blocks);
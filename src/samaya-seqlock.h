@@ -0,0 +1,65 @@
+/* samaya-seqlock.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  The seqlock shared by the timer snapshot and the status page.
+
+    A writer makes the sequence odd, stores every field with release ordering and makes the
+    sequence even again with a release store. A reader loads the sequence, then every field with
+    acquire ordering, and keeps the copy only if the sequence was even and is unchanged. A reader
+    that sees any field of an update therefore also sees the odd sequence that preceded it.
+
+    Ordering the fields themselves, rather than fencing around relaxed accesses, costs nothing on
+    x86, works the same across processes on a shared mapping, and is understood by
+    ThreadSanitizer. Fields must be naturally aligned scalars of at most 8 bytes, floating point
+    ones go through __atomic_store and __atomic_load with the same orders.
+
+    There is a single writer at a time, the caller serializes writers. This header only depends on
+    libc, like samaya-status-reader.h which uses it.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define SAMAYA_SEQLOCK_STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELEASE)
+#define SAMAYA_SEQLOCK_LOAD(field) __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+
+static inline void samaya_seqlock_write_begin(uint32_t *sequence)
+{
+    // The release stores of the fields keep this one before them.
+    __atomic_store_n(sequence, __atomic_load_n(sequence, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+static inline void samaya_seqlock_write_end(uint32_t *sequence)
+{
+    __atomic_store_n(sequence, __atomic_load_n(sequence, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+// Returns the sequence to pass to samaya_seqlock_read_retry. An odd one means a write is underway.
+static inline uint32_t samaya_seqlock_read_begin(const uint32_t *sequence)
+{
+    return __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+}
+
+// Whether the fields loaded since samaya_seqlock_read_begin may be torn and must be read again.
+static inline int samaya_seqlock_read_retry(const uint32_t *sequence, uint32_t begin)
+{
+    return (begin & 1) || __atomic_load_n(sequence, __ATOMIC_ACQUIRE) != begin;
+}
@@ -20,8 +20,11 @@
 
 #include <gio/gio.h>
 #include <glib/gi18n.h>
+#include "samaya-history.h"
+#include "samaya-metrics.h"
 #include "samaya-session.h"
 #include "samaya-timer.h"
+#include "samaya-utils.h"
 
 
 /* ============================================================================
@@ -59,18 +62,49 @@ SessionManagerPtr sm_get_default(void)
 #if defined(__linux__)
 static void play_completion_sound(GSoundContext *g_sound_ctx);
 #else
-static void play_completion_sound(ma_engine *engine);
+static void play_completion_sound(ma_sound *bell_sound);
 #endif
 
-static void display_notification(SessionManagerPtr session_manager);
+static void sync_ticking_sound(SessionManagerPtr self);
 
-static void sm_format_time(SessionManagerPtr self, gint64 timeMS);
+static void sync_ambient_noise(SessionManagerPtr self);
+
+static void display_notification(SessionManagerPtr session_manager, RoutineType routine,
+                                 gboolean next_starts);
+
+static void apply_routine(SessionManagerPtr self, RoutineType routine);
+
+static void sync_expiry_plan(SessionManagerPtr self);
+
+static void marshal_session_hook(GHook *hook, gpointer session_manager);
 
 
 /* ============================================================================
  * Internal Implementation
  * ============================================================================ */
 
+static void journal_entry(SessionManagerPtr self, JournalEntryType type, guint32 code,
+                          gdouble value, guint64 remaining_ms)
+{
+    JournalPtr journal = g_atomic_pointer_get(&self->journal);
+    if (journal == NULL) {
+        return;
+    }
+
+    JournalEntry entry = {
+        .type = type,
+        .code = code,
+        .value = value,
+        .remaining_ms = remaining_ms,
+    };
+    journal_record(journal, &entry);
+}
+
+static void journal_setting(SessionManagerPtr self, JournalSettingId setting, gdouble value)
+{
+    journal_entry(self, JournalEntrySetting, setting, value, 0);
+}
+
 static void on_timer_tick(gpointer remaining_time_ms)
 {
     SessionManager *session_manager = sm_get_default();
@@ -83,21 +117,211 @@ static void on_timer_tick(gpointer remaining_time_ms)
     if (session_manager->sm_timer_tick_callback) {
         session_manager->sm_timer_tick_callback(session_manager->user_data);
     }
+
+    g_hook_list_marshal(&session_manager->time_changed_hooks, TRUE, marshal_session_hook,
+                        session_manager);
 }
 
-static void on_session_complete(gpointer notify)
+/*  The two callbacks below run on the timer's own thread, so the journal, the ticks, the bell, the
+    notification and the start of the next session are not held back by a busy UI main loop. They
+    only touch the journal, the sound contexts and the application, which are thread safe, the
+    ticking flag, which is written atomically, and the expiry fields under their lock. Recording
+    the finished session and moving the routine on happen on the owner thread in
+    on_session_complete.
+*/
+static void on_timekeeping_tick(gpointer remaining_time_ms)
 {
     SessionManagerPtr session_manager = sm_get_default();
+    if (session_manager == NULL) {
+        return;
+    }
+
+    journal_entry(session_manager, JournalEntryTick, 0, 0, *(guint64 *) remaining_time_ms);
+}
+
+static void on_timekeeping_expired(gpointer timer_ptr)
+{
+    SessionManagerPtr session_manager = sm_get_default();
+    if (session_manager == NULL) {
+        return;
+    }
+
+    // Taken before the next session starts, updated_us is the deadline the session ran out at.
+    TmSnapshot expired;
+    tm_snapshot(timer_ptr, &expired);
+
+    journal_entry(session_manager, JournalEntryComplete, 0, 0, 0);
+
+    g_mutex_lock(&session_manager->expiry_lock);
+    RoutineType routine = session_manager->expiry_routine;
+    guint64 next_duration_ms = session_manager->expiry_next_duration_ms;
+    session_manager->expired_duration_ms = expired.duration_ms;
+    session_manager->expired_at = g_get_real_time() / G_USEC_PER_SEC;
+    session_manager->expired_started_next = (next_duration_ms > 0);
+    g_mutex_unlock(&session_manager->expiry_lock);
+
+    if (next_duration_ms > 0) {
+        tm_start_next(timer_ptr, next_duration_ms);
+    }
+
+    if (!session_manager->headless) {
+        // Silence the ticks right away, the owner thread restarts them if the next session needs.
+        if (g_atomic_int_compare_and_exchange(&session_manager->ticking_active, TRUE, FALSE) &&
+            session_manager->tick_sound != NULL) {
+            ma_sound_stop(session_manager->tick_sound);
+        }
 
-    if (notify != NULL) {
 #if defined(__linux__)
         play_completion_sound(session_manager->gsound_ctx);
 #else
-        play_completion_sound(session_manager->miniaudio_engine);
+        play_completion_sound(session_manager->bell_sound);
 #endif
-        display_notification(session_manager);
+        display_notification(session_manager, routine, next_duration_ms > 0);
+    }
+
+    metrics_observe_us(MetricCompletionLateness, tm_get_time_us(timer_ptr) - expired.updated_us);
+}
+
+static void marshal_session_hook(GHook *hook, gpointer session_manager)
+{
+    SmSessionCallback callback = (SmSessionCallback) hook->func;
+    callback(session_manager, hook->data);
+}
+
+static gulong connect_hook(GHookList *hook_list, SmSessionCallback callback, gpointer user_data)
+{
+    GHook *hook = g_hook_alloc(hook_list);
+    hook->func = (gpointer) callback;
+    hook->data = user_data;
+    g_hook_append(hook_list, hook);
+
+    return hook->hook_id;
+}
+
+static void on_timer_event(gpointer timer_ptr)
+{
+    SessionManagerPtr session_manager = sm_get_default();
+    if (session_manager == NULL) {
+        return;
     }
 
+    switch (tm_get_state(timer_ptr)) {
+        case StRunning:
+            if (session_manager->session_started_at == 0) {
+                session_manager->session_started_at = g_get_real_time() / G_USEC_PER_SEC;
+            }
+            break;
+        case StIdle:
+            session_manager->session_started_at = 0;
+            break;
+        case StPaused:
+        case StExited:
+        default:
+            break;
+    }
+
+    sync_ticking_sound(session_manager);
+    sync_ambient_noise(session_manager);
+    sync_expiry_plan(session_manager);
+
+    g_hook_list_marshal(&session_manager->state_changed_hooks, TRUE, marshal_session_hook,
+                        session_manager);
+}
+
+static void append_record(SessionManagerPtr self, const HistoryRecord *record)
+{
+    metrics_count_session(record->routine, record->flags & HISTORY_FLAG_SKIPPED);
+
+    if (record->started_at == 0 || (self->headless && self->history_path == NULL)) {
+        return;
+    }
+
+    g_autoptr(GError) error = NULL;
+    if (!history_append(self->history_path, record, &error)) {
+        g_warning("Failed to record session in history: %s", error->message);
+    }
+}
+
+// Records the session that ran out once nothing can extend it anymore.
+static void release_held_record(SessionManagerPtr self)
+{
+    if (!self->held_record_valid) {
+        return;
+    }
+
+    self->held_record_valid = FALSE;
+    self->extending_held_record = FALSE;
+    append_record(self, &self->held_record);
+}
+
+static void record_session(SessionManagerPtr self, gboolean skipped, guint64 duration_ms,
+                           guint64 remaining_ms)
+{
+    guint64 elapsed_ms = guint64_sat_sub(duration_ms, remaining_ms);
+
+    HistoryRecord record = {
+        .started_at = self->session_started_at,
+        .planned_seconds = (guint32) (duration_ms / 1000),
+        .elapsed_seconds = (guint32) (elapsed_ms / 1000),
+        .routine = (guint8) self->current_routine,
+        .flags = skipped ? HISTORY_FLAG_SKIPPED : 0,
+    };
+    self->session_started_at = 0;
+
+    // An extension continues the held session rather than adding one of its own.
+    if (self->extending_held_record) {
+        record.started_at = self->held_record.started_at;
+        record.planned_seconds += self->held_record.planned_seconds;
+        record.elapsed_seconds += self->held_record.elapsed_seconds;
+        self->held_record_valid = FALSE;
+        self->extending_held_record = FALSE;
+    } else {
+        release_held_record(self);
+    }
+
+    // Only a session that ran out can be extended, see sm_extend_completed_session.
+    if (!skipped) {
+        self->held_record = record;
+        self->held_record_valid = TRUE;
+        return;
+    }
+
+    append_record(self, &record);
+}
+
+static void on_session_complete(gpointer notify)
+{
+    SessionManagerPtr session_manager = sm_get_default();
+    TimerPtr timer = session_manager->timer_instance;
+
+    guint64 duration_ms = tm_get_duration_ms(timer);
+    guint64 remaining_ms = MAX(tm_get_remaining_time_ms(timer), 0);
+    gboolean started_next = FALSE;
+    gint64 expired_at = 0;
+
+    // A session that ran out already rang on the timekeeping thread, which may also have started
+    // the following one, so the timer only describes the finished session as it was left there.
+    if (notify != NULL) {
+        g_mutex_lock(&session_manager->expiry_lock);
+        duration_ms = session_manager->expired_duration_ms;
+        remaining_ms = 0;
+        started_next = session_manager->expired_started_next;
+        expired_at = session_manager->expired_at;
+        session_manager->expired_started_next = FALSE;
+        g_mutex_unlock(&session_manager->expiry_lock);
+    }
+
+    sync_ticking_sound(session_manager);
+    sync_ambient_noise(session_manager);
+    record_session(session_manager, notify == NULL, duration_ms, remaining_ms);
+
+    session_manager->last_completed_routine = session_manager->current_routine;
+    session_manager->last_session_skipped = (notify == NULL);
+    session_manager->last_session_duration_ms = duration_ms;
+    session_manager->last_session_remaining_ms = remaining_ms;
+
+    guint8 sessions_completed = session_manager->sessions_completed;
+
     switch (session_manager->current_routine) {
         case Working:
             session_manager->sessions_completed++;
@@ -121,17 +345,88 @@ static void on_session_complete(gpointer notify)
             break;
     }
 
-    sm_set_routine(session_manager->current_routine, session_manager);
+    if (started_next) {
+        // The timer already runs the following session, which started when this one ran out.
+        session_manager->session_started_at = expired_at;
+        if (session_manager->sm_routine_update_callback) {
+            session_manager->sm_routine_update_callback(session_manager->user_data);
+        }
+    } else {
+        apply_routine(session_manager, session_manager->current_routine);
+    }
+
+    // Only a session that ran out offers more time, see sm_extend_completed_session.
+    session_manager->last_session_extendable = (notify != NULL);
+    session_manager->last_sessions_completed = sessions_completed;
+
+    // The timer reports a session that started on its own after this, so listeners see the
+    // completion first.
+    g_hook_list_marshal(&session_manager->session_complete_hooks, TRUE, marshal_session_hook,
+                        session_manager);
+}
+
+#define BELL_SOUND_PATH "/app/share/sounds/bell.oga"
+#define TICK_SOUND_PATH "/app/share/sounds/tick.wav"
+
+// Decodes a sound file into memory once, so playing it later only rewinds and starts it.
+static ma_sound *load_sound(ma_engine *engine, const char *sound_path)
+{
+    ma_sound *sound = g_new0(ma_sound, 1);
+
+    if (ma_sound_init_from_file(engine, sound_path, MA_SOUND_FLAG_DECODE, NULL, NULL, sound) !=
+        MA_SUCCESS) {
+        g_warning("Failed to load the sound from %s.", sound_path);
+        g_free(sound);
+        return NULL;
+    }
+
+    return sound;
+}
+
+static void free_sound(ma_sound *sound)
+{
+    if (sound) {
+        ma_sound_uninit(sound);
+        g_free(sound);
+    }
+}
+
+/*  The tick sample is one second long with the click at its start. It is played as a gapless
+    loop, restarted from the click whenever the timer starts running, so the timer never has to
+    wake up for it.
+*/
+static ma_sound *load_tick_sound(ma_engine *engine)
+{
+    ma_sound *sound = load_sound(engine, TICK_SOUND_PATH);
 
-    gboolean is_working_session = (session_manager->current_routine == Working);
-    gboolean should_autostart = (is_working_session && session_manager->auto_start_work) ||
-                                (!is_working_session && session_manager->auto_start_breaks);
-    if (should_autostart && notify != NULL) {
-        tm_trigger_event(session_manager->timer_instance, EvStart);
+    if (sound) {
+        ma_sound_set_looping(sound, MA_TRUE);
     }
+
+    return sound;
 }
 
 #if defined(__linux__)
+/*  The bell is played under a fixed event id with permanent cache control, so libcanberra uploads
+    the decoded sample to the sound server once and every later play replays it from that cache
+    instead of opening and decoding the file again.
+*/
+#define BELL_SOUND_EVENT_ID "samaya-bell"
+
+static void cache_sound(GSoundContext *g_sound_ctx, const char *event_id, const char *sound_path)
+{
+    g_autoptr(GError) error = NULL;
+
+    if (!g_sound_ctx) {
+        return;
+    }
+
+    if (!gsound_context_cache(g_sound_ctx, &error, GSOUND_ATTR_EVENT_ID, event_id,
+                              GSOUND_ATTR_MEDIA_FILENAME, sound_path, NULL)) {
+        g_warning("Failed to preload %s: %s", sound_path, error->message);
+    }
+}
+
 static void play_completion_sound(GSoundContext *g_sound_ctx)
 {
     if (!g_sound_ctx) {
@@ -139,66 +434,380 @@ static void play_completion_sound(GSoundContext *g_sound_ctx)
         return;
     }
 
-    char *sound_path = g_build_filename("/app", "share", "sounds", "bell.oga", NULL);
-    gsound_context_play_full(g_sound_ctx, NULL, NULL, NULL, GSOUND_ATTR_MEDIA_FILENAME, sound_path, NULL);
-    g_free(sound_path);
+    gsound_context_play_simple(g_sound_ctx, NULL, NULL, GSOUND_ATTR_EVENT_ID, BELL_SOUND_EVENT_ID,
+                               GSOUND_ATTR_MEDIA_FILENAME, BELL_SOUND_PATH,
+                               GSOUND_ATTR_CANBERRA_CACHE_CONTROL, "permanent", NULL);
 }
 #else
-static void play_completion_sound(ma_engine *engine)
+static void play_completion_sound(ma_sound *bell_sound)
 {
-    if (!engine) {
-        g_warning("Failed to play completion sound, miniaudio engine is not set.");
+    if (!bell_sound) {
+        g_warning("Failed to play completion sound, the bell sound is not loaded.");
         return;
     }
 
-    char *sound_path = g_build_filename("/app", "share", "sounds", "bell.oga", NULL);
-    ma_engine_play_sound(engine, sound_path, NULL);
-    g_free(sound_path);
+    ma_sound_seek_to_pcm_frame(bell_sound, 0);
+    ma_sound_start(bell_sound);
 }
 #endif
 
-static void display_notification(SessionManagerPtr session_manager)
+/*  The ambient noise is synthesized on the audio thread by a data source which never ends. It is
+    played for as long as the engine lives, starting and stopping the noise only moves the target
+    of the generator, which fades in and out by itself and renders silence for free when faded.
+*/
+struct NoiseSound
 {
-    GApplication *app = G_APPLICATION(session_manager->user_data);
-    if (app == NULL) {
+    ma_data_source_base base;
+    NoiseGeneratorPtr generator;
+    ma_uint32 sample_rate;
+    ma_sound sound;
+};
+
+static ma_result noise_source_read(ma_data_source *source, void *frames_out, ma_uint64 frame_count,
+                                   ma_uint64 *frames_read)
+{
+    struct NoiseSound *noise = source;
+
+    noise_render(noise->generator, frames_out, (guint) frame_count);
+    if (frames_read) {
+        *frames_read = frame_count;
+    }
+
+    return MA_SUCCESS;
+}
+
+static ma_result noise_source_seek(ma_data_source *source, ma_uint64 frame_index)
+{
+    return MA_SUCCESS;
+}
+
+static ma_result noise_source_get_data_format(ma_data_source *source, ma_format *format,
+                                              ma_uint32 *channels, ma_uint32 *sample_rate,
+                                              ma_channel *channel_map, size_t channel_map_cap)
+{
+    struct NoiseSound *noise = source;
+
+    *format = ma_format_f32;
+    *channels = 1;
+    *sample_rate = noise->sample_rate;
+    if (channel_map) {
+        ma_channel_map_init_standard(ma_standard_channel_map_default, channel_map,
+                                     channel_map_cap, 1);
+    }
+
+    return MA_SUCCESS;
+}
+
+static ma_data_source_vtable noiseSourceVtable = {
+    .onRead = noise_source_read,
+    .onSeek = noise_source_seek,
+    .onGetDataFormat = noise_source_get_data_format,
+};
+
+static struct NoiseSound *load_noise_sound(ma_engine *engine)
+{
+    struct NoiseSound *noise = g_new0(struct NoiseSound, 1);
+    ma_data_source_config config = ma_data_source_config_init();
+    config.vtable = &noiseSourceVtable;
+
+    if (ma_data_source_init(&config, &noise->base) != MA_SUCCESS) {
+        g_warning("Failed to set up the ambient noise.");
+        g_free(noise);
+        return NULL;
+    }
+
+    noise->sample_rate = ma_engine_get_sample_rate(engine);
+    noise->generator = noise_new(noise->sample_rate, g_get_real_time());
+
+    if (ma_sound_init_from_data_source(engine, noise, MA_SOUND_FLAG_NO_SPATIALIZATION, NULL,
+                                       &noise->sound) != MA_SUCCESS) {
+        g_warning("Failed to set up the ambient noise.");
+        noise_free(noise->generator);
+        ma_data_source_uninit(&noise->base);
+        g_free(noise);
+        return NULL;
+    }
+
+    ma_sound_start(&noise->sound);
+
+    return noise;
+}
+
+static void free_noise_sound(struct NoiseSound *noise)
+{
+    if (noise) {
+        ma_sound_uninit(&noise->sound);
+        ma_data_source_uninit(&noise->base);
+        noise_free(noise->generator);
+        g_free(noise);
+    }
+}
+
+#if defined(__linux__)
+/*  GSound can neither loop the tick without a gap nor play the synthesized noise, so those get a
+    miniaudio engine like on the other platforms. It is only opened the first time either of them
+    plays, which keeps the audio device closed for everyone who never turns them on.
+*/
+static ma_engine *open_miniaudio_engine(SessionManagerPtr self)
+{
+    if (self->miniaudio_engine != NULL) {
+        return self->miniaudio_engine;
+    }
+
+    ma_engine *engine = g_new0(ma_engine, 1);
+
+    if (ma_engine_init(NULL, engine) != MA_SUCCESS) {
+        g_warning("Failed to initialize miniaudio engine, the ticking sound and the ambient noise "
+                  "are disabled.");
+        g_free(engine);
+        return NULL;
+    }
+
+    self->miniaudio_engine = engine;
+    return engine;
+}
+
+static gboolean on_audio_device_idle(gpointer user_data)
+{
+    SessionManagerPtr self = user_data;
+
+    // Checked again every fade length until the noise rendered its fade out to the end.
+    if (self->noise_sound != NULL && !noise_is_silent(self->noise_sound->generator)) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    ma_engine_stop(self->miniaudio_engine);
+    self->audio_device_stopped = TRUE;
+    self->audio_device_stop_id = 0;
+
+    return G_SOURCE_REMOVE;
+}
+
+/*  The audio device keeps the audio thread waking up for as long as it runs, silence or not. It is
+    stopped once the ticks are off and the noise faded out, and started again before either plays.
+*/
+static void sync_audio_device(SessionManagerPtr self)
+{
+    if (self->miniaudio_engine == NULL) {
+        return;
+    }
+
+    gboolean needed = g_atomic_int_get(&self->ticking_active) || self->ambient_noise_active;
+
+    if (needed) {
+        g_clear_handle_id(&self->audio_device_stop_id, g_source_remove);
+
+        if (self->audio_device_stopped && ma_engine_start(self->miniaudio_engine) == MA_SUCCESS) {
+            self->audio_device_stopped = FALSE;
+        }
+    } else if (!self->audio_device_stopped && self->audio_device_stop_id == 0) {
+        self->audio_device_stop_id = g_timeout_add(NOISE_FADE_MS, on_audio_device_idle, self);
+    }
+}
+#endif
+
+static void on_power_saver_changed(GPowerProfileMonitor *monitor, GParamSpec *pspec,
+                                   gpointer session_manager)
+{
+    sm_set_low_power_mode(session_manager,
+                          g_power_profile_monitor_get_power_saver_enabled(monitor));
+}
+
+static void set_ticking(SessionManagerPtr self, gboolean ticking)
+{
+#if defined(__linux__)
+    // Loaded before the flag is raised, the timekeeping thread only stops it once the flag is set.
+    if (ticking && self->tick_sound == NULL && !self->headless) {
+        ma_engine *engine = open_miniaudio_engine(self);
+        self->tick_sound = (engine != NULL) ? load_tick_sound(engine) : NULL;
+    }
+#endif
+
+    g_atomic_int_set(&self->ticking_active, ticking);
+
+    if (self->tick_sound == NULL) {
+        return;
+    }
+
+    if (ticking) {
+        ma_sound_seek_to_pcm_frame(self->tick_sound, 0);
+        ma_sound_start(self->tick_sound);
+    } else {
+        ma_sound_stop(self->tick_sound);
+    }
+}
+
+static void sync_ticking_sound(SessionManagerPtr self)
+{
+    gboolean should_tick = self->ticking_sound && self->current_routine == Working &&
+                           tm_get_state(self->timer_instance) == StRunning;
+
+    if (should_tick != g_atomic_int_get(&self->ticking_active)) {
+        set_ticking(self, should_tick);
+    }
+
+#if defined(__linux__)
+    // The timekeeping thread may have silenced the ticks on its own, so this runs either way.
+    sync_audio_device(self);
+#endif
+}
+
+static void sync_ambient_noise(SessionManagerPtr self)
+{
+    gboolean should_play = !self->headless && self->ambient_noise != NoiseOff &&
+                           (self->current_routine == Working || self->ambient_noise_breaks) &&
+                           tm_get_state(self->timer_instance) == StRunning;
+
+    if (should_play == self->ambient_noise_active) {
         return;
     }
 
-    const char *title = _("Samaya");
+    self->ambient_noise_active = should_play;
+
+#if defined(__linux__)
+    if (should_play && self->noise_sound == NULL) {
+        ma_engine *engine = open_miniaudio_engine(self);
+        self->noise_sound = (engine != NULL) ? load_noise_sound(engine) : NULL;
+
+        if (self->noise_sound != NULL) {
+            noise_set_color(self->noise_sound->generator, self->ambient_noise);
+        }
+    }
+#endif
+
+    if (self->noise_sound != NULL) {
+        noise_set_playing(self->noise_sound->generator, should_play);
+    }
+
+#if defined(__linux__)
+    sync_audio_device(self);
+#endif
+}
+
+/*  The buttons point at application actions which act on the session manager directly, so
+    answering a notification never needs the window. When the next session has already started on
+    its own, the first button pauses it instead of starting it.
+*/
+static GNotification *new_completion_notification(RoutineType routine, gboolean next_starts)
+{
     const char *body = NULL;
+    const char *start_label = NULL;
 
-    switch (session_manager->current_routine) {
+    switch (routine) {
         case Working:
             body = _("Focus session complete! Time for a break.");
+            start_label = _("Start Break");
             break;
         case ShortBreak:
         case LongBreak:
             body = _("Break over! Time to get back to work.");
+            start_label = _("Start Focus");
             break;
         default:
             body = _("Timer finished.");
+            start_label = _("Start");
             break;
     }
 
-    GNotification *note = g_notification_new(title);
+    GNotification *note = g_notification_new(_("Samaya"));
     g_notification_set_body(note, body);
     g_notification_set_priority(note, G_NOTIFICATION_PRIORITY_HIGH);
 
     g_notification_set_default_action(note, "app.activate");
 
+    if (next_starts) {
+        g_notification_add_button(note, _("Pause"), "app.pause-timer");
+    } else {
+        g_notification_add_button(note, start_label, "app.start-timer");
+    }
+    g_notification_add_button(note, _("Skip"), "app.skip-session");
+    g_notification_add_button(note, _("+5 min"), "app.extend-session");
+
+    return note;
+}
+
+static void display_notification(SessionManagerPtr session_manager, RoutineType routine,
+                                 gboolean next_starts)
+{
+    GApplication *app = G_APPLICATION(session_manager->user_data);
+    if (app == NULL) {
+        return;
+    }
+
+    if ((guint) routine >= G_N_ELEMENTS(session_manager->completion_notifications)) {
+        g_critical("Invalid Routine Type! Not sending the completion notification.");
+        return;
+    }
+
+    GNotification *note = session_manager->completion_notifications[routine][next_starts ? 1 : 0];
+
     g_application_send_notification(app, "timer-complete", note);
-    g_object_unref(note);
+    metrics_count(MetricNotifications);
 }
 
-static void sm_format_time(SessionManagerPtr self, gint64 timeMS)
+static void apply_routine_duration(SessionManagerPtr session_manager, RoutineType routine,
+                                   gfloat duration)
 {
-    GString *input_string = self->remaining_time_minutes_string;
+    session_manager->current_routine = routine;
+    // The session that ran out is no longer the one before the current one.
+    session_manager->last_session_extendable = FALSE;
 
-    gint64 total_seconds = timeMS / 1000;
-    gint64 minutes = total_seconds / 60;
-    gint64 seconds = total_seconds % 60;
+    Timer *timer = session_manager->timer_instance;
+    tm_set_duration(timer, duration);
+    tm_trigger_event(timer, EvReset);
 
-    g_string_printf(input_string, "%02" G_GINT64_FORMAT ":%02" G_GINT64_FORMAT, minutes, seconds);
+    if (session_manager->sm_routine_update_callback) {
+        session_manager->sm_routine_update_callback(session_manager->user_data);
+    }
+}
+
+static gfloat get_routine_duration(SessionManagerPtr session_manager, RoutineType routine)
+{
+    switch (routine) {
+        case Working:
+            return session_manager->work_duration;
+        case ShortBreak:
+            return session_manager->short_break_duration;
+        case LongBreak:
+            return session_manager->long_break_duration;
+        default:
+            g_critical("Invalid Routine Type! Work duration is being used as default value.");
+            return session_manager->work_duration;
+    }
+}
+
+static void apply_routine(SessionManagerPtr session_manager, RoutineType routine)
+{
+    apply_routine_duration(session_manager, routine,
+                           get_routine_duration(session_manager, routine));
+}
+
+// The routine on_session_complete moves on to once the current session is done.
+static RoutineType get_next_routine(SessionManagerPtr self)
+{
+    if (self->current_routine != Working) {
+        return Working;
+    }
+
+    return (self->sessions_completed + 1 == self->sessions_to_complete) ? LongBreak : ShortBreak;
+}
+
+/*  Tells the timekeeping thread which routine is running and how long the following session runs
+    if it starts on its own, so it can ring and start that session the moment this one runs out.
+    Called on every timer transition and whenever a setting that decides either changes.
+*/
+static void sync_expiry_plan(SessionManagerPtr self)
+{
+    RoutineType next_routine = get_next_routine(self);
+    gboolean next_starts =
+        (next_routine == Working) ? self->auto_start_work : self->auto_start_breaks;
+    guint64 next_duration_ms =
+        next_starts ? (guint64) (get_routine_duration(self, next_routine) * 60 * 1000) : 0;
+
+    g_mutex_lock(&self->expiry_lock);
+    self->expiry_routine = self->current_routine;
+    self->expiry_next_duration_ms = next_duration_ms;
+    g_mutex_unlock(&self->expiry_lock);
 }
 
 
@@ -225,10 +834,12 @@ SessionManagerPtr sm_init(guint16 sessions_to_complete, gdouble work_duration,
 
         .sessions_to_complete = sessions_to_complete,
         .sessions_completed = 0,
+        .time_resolution_ms = TM_TICK_INTERVAL_SECONDS,
+        .time_resolution_requests = g_hash_table_new(NULL, NULL),
         .total_sessions_counted = 0,
-        .remaining_time_minutes_string = g_string_new(NULL),
 
-        .timer_instance = tm_new(work_duration, on_session_complete, on_timer_tick, NULL),
+        .timer_instance =
+            tm_new(work_duration, on_session_complete, on_timer_tick, on_timer_event),
 #if defined(__linux__)
         .gsound_ctx = gsound_context_new(NULL, NULL),
 #else
@@ -239,12 +850,30 @@ SessionManagerPtr sm_init(guint16 sessions_to_complete, gdouble work_duration,
 
         .sm_timer_tick_callback = timer_instance_tick_callback,
     };
-    sm_format_time(session_manager, session_manager->timer_instance->initial_time_ms);
+    g_mutex_init(&session_manager->expiry_lock);
+    sync_expiry_plan(session_manager);
+    g_hook_list_init(&session_manager->session_complete_hooks, sizeof(GHook));
+    g_hook_list_init(&session_manager->state_changed_hooks, sizeof(GHook));
+    g_hook_list_init(&session_manager->time_changed_hooks, sizeof(GHook));
+    for (guint i = 0; i < G_N_ELEMENTS(session_manager->completion_notifications); i++) {
+        session_manager->completion_notifications[i][FALSE] = new_completion_notification(i, FALSE);
+        session_manager->completion_notifications[i][TRUE] = new_completion_notification(i, TRUE);
+    }
+    tm_set_timekeeping_callbacks(session_manager->timer_instance, on_timekeeping_tick,
+                                 on_timekeeping_expired);
+    sm_format_time(session_manager, tm_get_duration_ms(session_manager->timer_instance));
     globalSessionManagerPtr = session_manager;
 
-#if !defined(__linux__)
+#if defined(__linux__)
+    cache_sound(session_manager->gsound_ctx, BELL_SOUND_EVENT_ID, BELL_SOUND_PATH);
+#else
     if (ma_engine_init(NULL, session_manager->miniaudio_engine) != MA_SUCCESS) {
         g_warning("Failed to initialize miniaudio engine.");
+    } else {
+        session_manager->bell_sound =
+            load_sound(session_manager->miniaudio_engine, BELL_SOUND_PATH);
+        session_manager->tick_sound = load_tick_sound(session_manager->miniaudio_engine);
+        session_manager->noise_sound = load_noise_sound(session_manager->miniaudio_engine);
     }
 #endif
 
@@ -255,27 +884,133 @@ void sm_deinit(SessionManager *session_manager)
 {
     Timer *timer = session_manager->timer_instance;
 
+    if (session_manager->power_monitor) {
+        g_clear_signal_handler(&session_manager->power_saver_handler_id,
+                               session_manager->power_monitor);
+        g_clear_object(&session_manager->power_monitor);
+    }
+
     if (timer) {
         tm_free(session_manager->timer_instance);
     }
 
-#if !defined(__linux__)
-    ma_engine_uninit(session_manager->miniaudio_engine);
-    g_free(session_manager->miniaudio_engine);
+    g_hash_table_unref(session_manager->time_resolution_requests);
+    g_hook_list_clear(&session_manager->session_complete_hooks);
+    g_hook_list_clear(&session_manager->state_changed_hooks);
+    g_hook_list_clear(&session_manager->time_changed_hooks);
+
+    for (guint i = 0; i < G_N_ELEMENTS(session_manager->completion_notifications); i++) {
+        g_clear_object(&session_manager->completion_notifications[i][FALSE]);
+        g_clear_object(&session_manager->completion_notifications[i][TRUE]);
+    }
+
+#if defined(__linux__)
+    g_clear_handle_id(&session_manager->audio_device_stop_id, g_source_remove);
 #endif
+    free_noise_sound(session_manager->noise_sound);
+    free_sound(session_manager->tick_sound);
+#if defined(__linux__)
+    g_clear_object(&session_manager->gsound_ctx);
+#else
+    free_sound(session_manager->bell_sound);
+#endif
+    if (session_manager->miniaudio_engine) {
+        ma_engine_uninit(session_manager->miniaudio_engine);
+        g_free(session_manager->miniaudio_engine);
+    }
+
+    release_held_record(session_manager);
+    g_free(session_manager->history_path);
 
     globalSessionManagerPtr = NULL;
 
+    g_mutex_clear(&session_manager->expiry_lock);
     g_free(session_manager);
 }
 
 void sm_skip_session(void)
 {
+    SessionManagerPtr session_manager = sm_get_default();
+
+    journal_entry(session_manager, JournalEntrySkip, 0, 0, 0);
     on_session_complete(FALSE);
 }
 
+void sm_trigger_event(SessionManagerPtr self, TmEvent event)
+{
+    journal_entry(self, JournalEntryEvent, event, 0, 0);
+
+    // Starting or resetting the following session by hand commits to it, pausing it does not.
+    if (event != EvStop) {
+        self->last_session_extendable = FALSE;
+    }
+    // Resuming an extension keeps it going, resetting it gives the extra time up.
+    if ((event == EvStart && !self->extending_held_record) || event == EvReset) {
+        release_held_record(self);
+    }
+
+    tm_trigger_event(self->timer_instance, event);
+}
+
+void sm_extend_session(SessionManagerPtr self, gdouble minutes)
+{
+    journal_entry(self, JournalEntryExtend, JournalExtendCurrent, minutes, 0);
+    tm_extend(self->timer_instance, (guint64) (minutes * 60 * 1000));
+}
+
+void sm_extend_completed_session(SessionManagerPtr self, gdouble minutes)
+{
+    if (!self->last_session_extendable) {
+        return;
+    }
+
+    journal_entry(self, JournalEntryExtend, JournalExtendCompleted, minutes, 0);
+
+    // The completion is taken back, the session counts again once the extra time ran out.
+    if (self->last_completed_routine == Working) {
+        self->total_sessions_counted--;
+    }
+    self->sessions_completed = self->last_sessions_completed;
+    self->extending_held_record = TRUE;
+
+    apply_routine_duration(self, self->last_completed_routine, (gfloat) minutes);
+    tm_trigger_event(self->timer_instance, EvStart);
+}
+
+void sm_set_journal(SessionManagerPtr self, JournalPtr journal)
+{
+    g_atomic_pointer_set(&self->journal, journal);
+
+    if (journal == NULL) {
+        return;
+    }
+
+    // Start with the configuration so a replay begins from the same state.
+    journal_setting(self, JournalSettingWorkDuration, self->work_duration);
+    journal_setting(self, JournalSettingShortBreakDuration, self->short_break_duration);
+    journal_setting(self, JournalSettingLongBreakDuration, self->long_break_duration);
+    journal_setting(self, JournalSettingSessionsToComplete, self->sessions_to_complete);
+    journal_setting(self, JournalSettingAutoStartBreaks, self->auto_start_breaks);
+    journal_setting(self, JournalSettingAutoStartWork, self->auto_start_work);
+    journal_setting(self, JournalSettingLowPowerMode, self->low_power_mode);
+    journal_entry(self, JournalEntryRoutine, self->current_routine, 0, 0);
+}
+
+void sm_set_headless(SessionManagerPtr self, gboolean headless)
+{
+    self->headless = !!headless;
+}
+
+void sm_set_history_path(SessionManagerPtr self, const gchar *path)
+{
+    g_free(self->history_path);
+    self->history_path = g_strdup(path);
+}
+
 void sm_set_work_duration(SessionManagerPtr self, gdouble value)
 {
+    journal_setting(self, JournalSettingWorkDuration, value);
+
     self->work_duration = (gfloat) value;
     TimerPtr timer = self->timer_instance;
     gboolean is_work_session = (self->current_routine == Working);
@@ -285,10 +1020,14 @@ void sm_set_work_duration(SessionManagerPtr self, gdouble value)
         tm_trigger_event(timer, EvReset);
         tm_set_duration(timer, self->work_duration);
     }
+
+    sync_expiry_plan(self);
 }
 
 void sm_set_short_break_duration(SessionManagerPtr self, gdouble value)
 {
+    journal_setting(self, JournalSettingShortBreakDuration, value);
+
     self->short_break_duration = (gfloat) value;
     Timer *timer = self->timer_instance;
     gboolean is_short_break_session = (self->current_routine == ShortBreak);
@@ -297,10 +1036,14 @@ void sm_set_short_break_duration(SessionManagerPtr self, gdouble value)
         tm_trigger_event(timer, EvReset);
         tm_set_duration(timer, self->short_break_duration);
     }
+
+    sync_expiry_plan(self);
 }
 
 void sm_set_long_break_duration(SessionManagerPtr self, gdouble value)
 {
+    journal_setting(self, JournalSettingLongBreakDuration, value);
+
     self->long_break_duration = (gfloat) value;
     Timer *timer = self->timer_instance;
     gboolean is_long_break_session = (self->current_routine == LongBreak);
@@ -309,53 +1052,142 @@ void sm_set_long_break_duration(SessionManagerPtr self, gdouble value)
         tm_trigger_event(timer, EvReset);
         tm_set_duration(timer, self->long_break_duration);
     }
+
+    sync_expiry_plan(self);
 }
 
 void sm_set_sessions_to_complete(SessionManager *session_manager, guint16 value)
 {
+    journal_setting(session_manager, JournalSettingSessionsToComplete, value);
+
     session_manager->sessions_to_complete = value;
+
+    sync_expiry_plan(session_manager);
 }
 
 void sm_set_auto_start_breaks(SessionManagerPtr self, gboolean value)
 {
-    self->auto_start_breaks = value;
+    journal_setting(self, JournalSettingAutoStartBreaks, value);
+
+    g_atomic_int_set(&self->auto_start_breaks, value);
+
+    sync_expiry_plan(self);
 }
 
 void sm_set_auto_start_work(SessionManagerPtr self, gboolean value)
 {
-    self->auto_start_work = value;
+    journal_setting(self, JournalSettingAutoStartWork, value);
+
+    g_atomic_int_set(&self->auto_start_work, value);
+
+    sync_expiry_plan(self);
 }
 
-void sm_set_routine(RoutineType routine, SessionManager *session_manager)
+void sm_set_low_power_mode(SessionManagerPtr self, gboolean value)
 {
-    session_manager->current_routine = routine;
+    value = !!value;
+    if (self->low_power_mode == value) {
+        return;
+    }
 
-    Timer *timer = session_manager->timer_instance;
+    journal_setting(self, JournalSettingLowPowerMode, value);
 
-    gfloat duration;
+    self->low_power_mode = value;
+    tm_set_low_power(self->timer_instance, value);
 
-    switch (routine) {
-        case Working:
-            duration = session_manager->work_duration;
-            break;
-        case ShortBreak:
-            duration = session_manager->short_break_duration;
-            break;
-        case LongBreak:
-            duration = session_manager->long_break_duration;
-            break;
-        default:
-            g_critical("Invalid Routine Type! Work duration is being used as default value.");
-            duration = session_manager->work_duration;
-            break;
+    g_info("Low power mode %s", value ? "enabled" : "disabled");
+
+    // Let the UI drop or restore the per-frame ring animation.
+    if (self->sm_timer_tick_callback) {
+        g_idle_add(self->sm_timer_tick_callback, self->user_data);
     }
+}
 
-    tm_set_duration(timer, duration);
-    tm_trigger_event(timer, EvReset);
+void sm_set_power_profile_monitor(SessionManagerPtr self, GPowerProfileMonitor *monitor)
+{
+    g_return_if_fail(monitor == NULL || G_IS_POWER_PROFILE_MONITOR(monitor));
 
-    if (session_manager->sm_routine_update_callback) {
-        session_manager->sm_routine_update_callback(session_manager->user_data);
+    if (self->power_monitor == monitor) {
+        return;
+    }
+
+    if (self->power_monitor) {
+        g_clear_signal_handler(&self->power_saver_handler_id, self->power_monitor);
+        g_clear_object(&self->power_monitor);
+    }
+
+    if (monitor == NULL) {
+        sm_set_low_power_mode(self, FALSE);
+        return;
+    }
+
+    self->power_monitor = g_object_ref(monitor);
+    self->power_saver_handler_id = g_signal_connect(
+        monitor, "notify::power-saver-enabled", G_CALLBACK(on_power_saver_changed), self);
+
+    on_power_saver_changed(monitor, NULL, self);
+}
+
+void sm_set_ticking_sound(SessionManagerPtr self, gboolean value)
+{
+    self->ticking_sound = !!value;
+    sync_ticking_sound(self);
+}
+
+static void sync_tick_interval(SessionManagerPtr self)
+{
+    guint64 interval_ms = self->time_resolution_ms;
+    GHashTableIter iter;
+    gpointer requested;
+
+    g_hash_table_iter_init(&iter, self->time_resolution_requests);
+    while (g_hash_table_iter_next(&iter, NULL, &requested)) {
+        interval_ms = MIN(interval_ms, GPOINTER_TO_UINT(requested));
+    }
+
+    tm_set_tick_interval(self->timer_instance, interval_ms);
+}
+
+void sm_set_time_resolution(SessionManagerPtr self, guint64 resolution_ms)
+{
+    self->time_resolution_ms = resolution_ms;
+    sync_tick_interval(self);
+}
+
+void sm_request_time_resolution(SessionManagerPtr self, gconstpointer view, guint64 resolution_ms)
+{
+    if (resolution_ms == 0) {
+        g_hash_table_remove(self->time_resolution_requests, view);
+    } else {
+        g_hash_table_insert(self->time_resolution_requests, (gpointer) view,
+                            GUINT_TO_POINTER((guint) MIN(resolution_ms, G_MAXUINT)));
+    }
+
+    sync_tick_interval(self);
+}
+
+void sm_set_ambient_noise(SessionManagerPtr self, NoiseColor color)
+{
+    self->ambient_noise = ((guint) color < N_NOISE_COLORS) ? color : NoiseOff;
+
+    if (self->noise_sound != NULL) {
+        noise_set_color(self->noise_sound->generator, self->ambient_noise);
     }
+
+    sync_ambient_noise(self);
+}
+
+void sm_set_ambient_noise_breaks(SessionManagerPtr self, gboolean value)
+{
+    self->ambient_noise_breaks = !!value;
+    sync_ambient_noise(self);
+}
+
+void sm_set_routine(RoutineType routine, SessionManager *session_manager)
+{
+    journal_entry(session_manager, JournalEntryRoutine, routine, 0, 0);
+    release_held_record(session_manager);
+    apply_routine(session_manager, routine);
 }
 
 void sm_set_timer_tick_callback(gboolean (*timer_instance_tick_callback)(gpointer user_data))
@@ -394,6 +1226,39 @@ void sm_set_routine_update_callback(gboolean (*routine_update_callback)(gpointer
     }
 }
 
+gulong sm_connect_session_complete(SessionManagerPtr self, SmSessionCallback callback,
+                                   gpointer user_data)
+{
+    return connect_hook(&self->session_complete_hooks, callback, user_data);
+}
+
+void sm_disconnect_session_complete(SessionManagerPtr self, gulong handler_id)
+{
+    g_hook_destroy(&self->session_complete_hooks, handler_id);
+}
+
+gulong sm_connect_state_changed(SessionManagerPtr self, SmSessionCallback callback,
+                                gpointer user_data)
+{
+    return connect_hook(&self->state_changed_hooks, callback, user_data);
+}
+
+void sm_disconnect_state_changed(SessionManagerPtr self, gulong handler_id)
+{
+    g_hook_destroy(&self->state_changed_hooks, handler_id);
+}
+
+gulong sm_connect_time_changed(SessionManagerPtr self, SmSessionCallback callback,
+                               gpointer user_data)
+{
+    return connect_hook(&self->time_changed_hooks, callback, user_data);
+}
+
+void sm_disconnect_time_changed(SessionManagerPtr self, gulong handler_id)
+{
+    g_hook_destroy(&self->time_changed_hooks, handler_id);
+}
+
 gdouble sm_get_work_duration(SessionManagerPtr session_manager)
 {
     return session_manager->work_duration;
@@ -424,8 +1289,57 @@ gboolean sm_get_auto_start_work(SessionManagerPtr self)
     return self->auto_start_work;
 }
 
+gboolean sm_get_low_power_mode(SessionManagerPtr self)
+{
+    return self->low_power_mode;
+}
+
+gboolean sm_get_ticking_sound(SessionManagerPtr self)
+{
+    return self->ticking_sound;
+}
+
+NoiseColor sm_get_ambient_noise(SessionManagerPtr self)
+{
+    return self->ambient_noise;
+}
+
+gboolean sm_get_ambient_noise_breaks(SessionManagerPtr self)
+{
+    return self->ambient_noise_breaks;
+}
+
+void sm_format_time(SessionManagerPtr self, gint64 timeMS)
+{
+    // Written out by hand, this runs every second and has to stay free of allocations.
+    guint64 total_seconds = (timeMS > 0) ? (guint64) timeMS / 1000 : 0;
+    guint64 minutes = total_seconds / 60;
+    guint seconds = total_seconds % 60;
+
+    gchar digits[20];
+    gsize digit_count = 0;
+
+    do {
+        digits[digit_count++] = (gchar) ('0' + minutes % 10);
+        minutes /= 10;
+    } while (minutes > 0);
+
+    if (digit_count < 2) {
+        digits[digit_count++] = '0';
+    }
+
+    gchar *out = self->remaining_time_text;
+    while (digit_count > 0) {
+        *out++ = digits[--digit_count];
+    }
+
+    *out++ = ':';
+    *out++ = (gchar) ('0' + seconds / 10);
+    *out++ = (gchar) ('0' + seconds % 10);
+    *out = '\0';
+}
+
 gchar *sm_get_formatted_time(SessionManagerPtr self)
 {
-    gchar *time_str = self->remaining_time_minutes_string->str;
-    return time_str;
+    return self->remaining_time_text;
 }
@@ -20,20 +20,20 @@
 
 #pragma once
 
+#include <gio/gio.h>
 #include <glib.h>
 #if defined(__linux__)
 #include <gsound.h>
-#else
-#include <miniaudio.h>
 #endif
+#include <miniaudio.h>
+#include "samaya-history.h"
+#include "samaya-journal.h"
+#include "samaya-noise.h"
+#include "samaya-routine.h"
 #include "samaya-timer.h"
 
-typedef enum
-{
-    Working,
-    ShortBreak,
-    LongBreak,
-} RoutineType;
+// Fits MM:SS for any minute count a gint64 of milliseconds can hold.
+#define SM_TIME_TEXT_SIZE 24
 
 typedef struct
 {
@@ -44,6 +44,30 @@ typedef struct
     gboolean auto_start_breaks;
     gboolean auto_start_work;
 
+    gboolean low_power_mode;
+
+    // Followed by low_power_mode when set, see sm_set_power_profile_monitor.
+    GPowerProfileMonitor *power_monitor;
+    gulong power_saver_handler_id;
+
+    // Skips sounds, notifications and the history, for driving the session logic without a UI.
+    gboolean headless;
+    // Where finished sessions are recorded, see sm_set_history_path.
+    gchar *history_path;
+
+    gboolean ticking_sound;
+    gboolean ticking_active;
+
+    // How current the remaining time has to be kept, see sm_set_time_resolution.
+    guint64 time_resolution_ms;
+    // Finer resolutions asked for by other views, by view, see sm_request_time_resolution.
+    GHashTable *time_resolution_requests;
+
+    // Played while a work session runs, and while breaks run too if ambient_noise_breaks is set.
+    NoiseColor ambient_noise;
+    gboolean ambient_noise_breaks;
+    gboolean ambient_noise_active;
+
     RoutineType current_routine;
     RoutineType routines_list[3];
 
@@ -51,24 +75,80 @@ typedef struct
     guint8 sessions_completed;
     guint64 total_sessions_counted;
 
-    GString *remaining_time_minutes_string;
+    // Wall clock time in seconds the current session was first started at, 0 if not started.
+    gint64 session_started_at;
+
+    // Guards the fields below, shared with the timekeeping thread, see on_timekeeping_expired.
+    GMutex expiry_lock;
+    // Routine of the running session, and the duration of the following one if it starts on its
+    // own or 0, kept current by the owner in sync_expiry_plan.
+    RoutineType expiry_routine;
+    guint64 expiry_next_duration_ms;
+    // Left by the timekeeping thread for on_session_complete: the planned duration of the session
+    // that ran out, the wall clock second it did, and whether the following one started already.
+    guint64 expired_duration_ms;
+    gint64 expired_at;
+    gboolean expired_started_next;
+
+    // Routine of the last finished or skipped session, and whether it was skipped.
+    RoutineType last_completed_routine;
+    gboolean last_session_skipped;
+    // Its planned duration, and the time that was left of it, 0 unless it was skipped.
+    guint64 last_session_duration_ms;
+    guint64 last_session_remaining_ms;
+    // Whether sm_extend_completed_session can still resume it, and the work session count from
+    // before it completed.
+    gboolean last_session_extendable;
+    guint8 last_sessions_completed;
+    /*  A session that ran out is kept out of the history and the metrics while it can still be
+        extended, and recorded once with its extensions, from when it first started.
+    */
+    HistoryRecord held_record;
+    gboolean held_record_valid;
+    gboolean extending_held_record;
+
+    // Rewritten in place every second, see sm_format_time.
+    gchar remaining_time_text[SM_TIME_TEXT_SIZE];
+
+    // Completion notifications built once and resent as is, indexed by the finished routine and
+    // by whether the next session starts on its own.
+    GNotification *completion_notifications[N_ROUTINES][2];
 
     TimerPtr timer_instance;
 #if defined(__linux__)
     GSoundContext *gsound_ctx;
 #else
+    ma_sound *bell_sound;
+#endif
+    // On Linux only opened once the ticking sound or the ambient noise first plays, see
+    // open_miniaudio_engine.
     ma_engine *miniaudio_engine;
+    ma_sound *tick_sound;
+    struct NoiseSound *noise_sound;
+#if defined(__linux__)
+    // Its device is stopped while nothing plays, see sync_audio_device.
+    gboolean audio_device_stopped;
+    guint audio_device_stop_id;
 #endif
 
     gpointer user_data;
 
+    // Records external input when set, see sm_set_journal.
+    JournalPtr journal;
+
     gboolean (*sm_timer_tick_callback)(gpointer user_data);
 
     gboolean (*sm_routine_update_callback)(gpointer user_data);
+
+    GHookList session_complete_hooks;
+    GHookList state_changed_hooks;
+    GHookList time_changed_hooks;
 } SessionManager;
 
 typedef SessionManager *SessionManagerPtr;
 
+typedef void (*SmSessionCallback)(SessionManagerPtr self, gpointer user_data);
+
 
 SessionManagerPtr sm_get_default(void);
 
@@ -94,8 +174,59 @@ void sm_set_auto_start_work(SessionManagerPtr self, gboolean value);
 
 void sm_set_routine(RoutineType routine, SessionManager *session_manager);
 
+void sm_set_low_power_mode(SessionManagerPtr self, gboolean value);
+
+/*  Switches low power mode on and off with the power saver state of monitor. Passing NULL stops
+    watching the power profile and restores full fidelity. Tests drive the low power path through
+    a fake GPowerProfileMonitor implementation.
+*/
+void sm_set_power_profile_monitor(SessionManagerPtr self, GPowerProfileMonitor *monitor);
+
+void sm_set_ticking_sound(SessionManagerPtr self, gboolean value);
+
+/*  Sets how current the remaining time has to be kept for the main view, TM_TICK_INTERVAL_SECONDS
+    by default. The timer ticks at this interval, or at the finest one another view asked for with
+    sm_request_time_resolution, and the time changed hooks run as often. The ticking sound loops on
+    its own and needs no ticks.
+*/
+void sm_set_time_resolution(SessionManagerPtr self, guint64 resolution_ms);
+
+/*  Asks for the remaining time to be kept current to within resolution_ms on behalf of view,
+    replacing what it asked for before. 0 withdraws the request.
+*/
+void sm_request_time_resolution(SessionManagerPtr self, gconstpointer view, guint64 resolution_ms);
+
+void sm_set_ambient_noise(SessionManagerPtr self, NoiseColor color);
+
+void sm_set_ambient_noise_breaks(SessionManagerPtr self, gboolean value);
+
 void sm_skip_session(void);
 
+// Passes event to the timer, recording it in the journal first.
+void sm_trigger_event(SessionManagerPtr self, TmEvent event);
+
+// Adds minutes to the current session, running or not.
+void sm_extend_session(SessionManagerPtr self, gdouble minutes);
+
+/*  Runs the routine of the session that just ran out again for minutes, in place of the session
+    that followed it, which is reset even if it already started on its own. The work session count
+    goes back to what it was before the completion. Does nothing if the last session was skipped,
+    or once the following one was started, reset or replaced by hand. The history and the metrics
+    count the session once, with the extra time, when it finally ends.
+*/
+void sm_extend_completed_session(SessionManagerPtr self, gdouble minutes);
+
+/*  Records every external input (timer events, routine picks, skips and setting changes) and the
+    timer ticks to journal, starting with a snapshot of the current configuration. The journal is
+    not owned, pass NULL before freeing it.
+*/
+void sm_set_journal(SessionManagerPtr self, JournalPtr journal);
+
+void sm_set_headless(SessionManagerPtr self, gboolean headless);
+
+// Records finished sessions to the history at path, even when headless. NULL restores the default.
+void sm_set_history_path(SessionManagerPtr self, const gchar *path);
+
 void sm_set_timer_tick_callback(gboolean (*timer_instance_tick_callback)(gpointer));
 
 void sm_set_timer_tick_callback_with_data(gboolean (*timer_instance_tick_callback)(gpointer),
@@ -103,6 +234,28 @@ void sm_set_timer_tick_callback_with_data(gboolean (*timer_instance_tick_callbac
 
 void sm_set_routine_update_callback(gboolean (*routine_update_callback)(gpointer));
 
+/*  Registers a callback run after every finished or skipped session, once it has been written to
+    the history and the next routine was selected. Returns an id for sm_disconnect_session_complete.
+*/
+gulong sm_connect_session_complete(SessionManagerPtr self, SmSessionCallback callback,
+                                   gpointer user_data);
+
+void sm_disconnect_session_complete(SessionManagerPtr self, gulong handler_id);
+
+// Registers a callback run after every transition of the timer state machine.
+gulong sm_connect_state_changed(SessionManagerPtr self, SmSessionCallback callback,
+                                gpointer user_data);
+
+void sm_disconnect_state_changed(SessionManagerPtr self, gulong handler_id);
+
+/*  Registers a callback run on the owner context whenever the remaining time changes, which is
+    about once per second while a session runs. Callbacks should be cheap and not allocate.
+*/
+gulong sm_connect_time_changed(SessionManagerPtr self, SmSessionCallback callback,
+                               gpointer user_data);
+
+void sm_disconnect_time_changed(SessionManagerPtr self, gulong handler_id);
+
 gdouble sm_get_work_duration(SessionManagerPtr session_manager);
 
 gdouble sm_get_short_break_duration(SessionManagerPtr session_manager);
@@ -115,4 +268,15 @@ gboolean sm_get_auto_start_breaks(SessionManagerPtr self);
 
 gboolean sm_get_auto_start_work(SessionManagerPtr self);
 
+gboolean sm_get_low_power_mode(SessionManagerPtr self);
+
+gboolean sm_get_ticking_sound(SessionManagerPtr self);
+
+NoiseColor sm_get_ambient_noise(SessionManagerPtr self);
+
+gboolean sm_get_ambient_noise_breaks(SessionManagerPtr self);
+
+// Formats timeMS as MM:SS into the string returned by sm_get_formatted_time. Does not allocate.
+void sm_format_time(SessionManagerPtr self, gint64 timeMS);
+
 gchar *sm_get_formatted_time(SessionManagerPtr self);
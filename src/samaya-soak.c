@@ -0,0 +1,431 @@
+/* samaya-soak.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  Soak test for leaving Samaya open for weeks.
+
+    Runs the real application, window included, with its session manager on a virtual clock, and
+    drives it through simulated days of use: sessions running out with their bell and notification,
+    skips, resets, pauses and starts through the window actions, routine switches, extensions,
+    notification buttons and preference changes through GSettings, picked from a seeded random
+    sequence so every run is the same. The clock advances one timer wakeup per main loop iteration,
+    so the window handles every tick like it would in real use, and it is closed and opened again
+    every night.
+
+    After each day the resident set size and the number of live heap allocations are sampled. The
+    first week is a warm-up, growth over the remaining weeks beyond the budgets fails the run.
+
+    It needs a display, for example with GDK_BACKEND=broadway and a running gtk4-broadwayd, or
+    under xvfb-run, and dbus-daemon for a private session bus. Settings live in memory and the
+    history in a temporary directory, so the soak never touches the user's.
+*/
+
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <stdlib.h>
+#include "samaya-alloc-stats.h"
+#include "samaya-application.h"
+#include "samaya-session.h"
+#include "samaya-timer.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#define SOAK_APP_ID "io.github.redddfoxxyy.samaya.Soak"
+#define SOAK_SCHEMA_ID "io.github.redddfoxxyy.samaya"
+#define SOAK_DAY_US (24 * G_GINT64_CONSTANT(3600) * G_USEC_PER_SEC)
+#define SOAK_ACTIVE_US (16 * G_GINT64_CONSTANT(3600) * G_USEC_PER_SEC)
+#define SOAK_WARMUP_DAYS 7
+
+typedef struct
+{
+    GApplication *app;
+    SessionManagerPtr session_manager;
+    TimerPtr timer;
+    GSettings *settings;
+    GRand *rand;
+    gint64 now_us;
+
+    // The running session ticks until then before the next action is picked.
+    gint64 run_until_us;
+    gint64 active_end_us;
+    gint64 day_end_us;
+
+    gint day;
+    gint total_days;
+    gboolean verbose;
+    gint64 rss_budget_kib;
+    gint64 allocation_budget;
+
+    gint64 baseline_rss_kib;
+    gint64 baseline_allocations;
+    gint64 rss_kib;
+    gint64 allocations;
+    gboolean passed;
+} Soak;
+
+static const char *const noiseNicks[] = {"off", "white", "pink", "brown", "rain"};
+
+
+/* ============================================================================
+ * Sampling
+ * ============================================================================ */
+
+// Resident set size in KiB, or -1 where it cannot be read.
+static gint64 get_rss_kib(void)
+{
+#if defined(__linux__)
+    g_autofree gchar *contents = NULL;
+
+    if (!g_file_get_contents("/proc/self/statm", &contents, NULL, NULL)) {
+        return -1;
+    }
+
+    gchar **fields = g_strsplit(contents, " ", 3);
+    gint64 rss_pages = (g_strv_length(fields) >= 2) ? g_ascii_strtoll(fields[1], NULL, 10) : -1;
+    g_strfreev(fields);
+
+    return (rss_pages >= 0) ? rss_pages * sysconf(_SC_PAGESIZE) / 1024 : -1;
+#else
+    return -1;
+#endif
+}
+
+// Removes the temporary directory the soak ran in, with everything the app wrote there.
+static void remove_tree(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir != NULL) {
+        while ((name = g_dir_read_name(dir)) != NULL) {
+            g_autofree gchar *child = g_build_filename(path, name, NULL);
+
+            if (g_file_test(child, G_FILE_TEST_IS_DIR) &&
+                !g_file_test(child, G_FILE_TEST_IS_SYMLINK)) {
+                remove_tree(child);
+            } else {
+                g_remove(child);
+            }
+        }
+        g_dir_close(dir);
+    }
+
+    g_rmdir(path);
+}
+
+
+/* ============================================================================
+ * Simulated Use
+ * ============================================================================ */
+
+static gint64 soak_clock(gpointer soak_ptr)
+{
+    Soak *soak = soak_ptr;
+    return soak->now_us;
+}
+
+// The window of the app, opened again if it was closed.
+static GtkWidget *get_window(Soak *soak)
+{
+    GtkWindow *window = gtk_application_get_active_window(GTK_APPLICATION(soak->app));
+
+    if (window == NULL) {
+        g_application_activate(soak->app);
+        window = gtk_application_get_active_window(GTK_APPLICATION(soak->app));
+    }
+
+    return GTK_WIDGET(window);
+}
+
+// Changes a preference the way the preferences dialog does, the app applies it on its own.
+static void change_preference(Soak *soak)
+{
+    GSettings *settings = soak->settings;
+
+    switch (g_rand_int_range(soak->rand, 0, 10)) {
+        case 0:
+            g_settings_set_double(settings, "work-duration", g_rand_int_range(soak->rand, 15, 60));
+            break;
+        case 1:
+            g_settings_set_double(settings, "short-break-duration",
+                                  g_rand_int_range(soak->rand, 3, 10));
+            break;
+        case 2:
+            g_settings_set_double(settings, "long-break-duration",
+                                  g_rand_int_range(soak->rand, 10, 30));
+            break;
+        case 3:
+            g_settings_set(settings, "sessions-to-complete", "q",
+                           (guint16) g_rand_int_range(soak->rand, 2, 8));
+            break;
+        case 4:
+            g_settings_set_boolean(settings, "auto-start-breaks", g_rand_boolean(soak->rand));
+            break;
+        case 5:
+            g_settings_set_boolean(settings, "auto-start-work", g_rand_boolean(soak->rand));
+            break;
+        case 6:
+            // Follows the power profile rather than a setting.
+            sm_set_low_power_mode(soak->session_manager, g_rand_boolean(soak->rand));
+            break;
+        case 7:
+            g_settings_set_boolean(settings, "ticking-sound", g_rand_boolean(soak->rand));
+            break;
+        case 8:
+            g_settings_set_string(
+                settings, "ambient-noise",
+                noiseNicks[g_rand_int_range(soak->rand, 0, G_N_ELEMENTS(noiseNicks))]);
+            break;
+        default:
+            g_settings_set_boolean(settings, "tray-icon", g_rand_boolean(soak->rand));
+            break;
+    }
+}
+
+static void soak_step(Soak *soak)
+{
+    GtkWidget *window = get_window(soak);
+    guint choice = g_rand_int_range(soak->rand, 0, 100);
+
+    if (tm_get_state(soak->timer) != StRunning) {
+        gtk_widget_activate_action(window, "win.start-timer", NULL);
+        return;
+    }
+
+    if (choice < 80) {
+        soak->run_until_us =
+            soak->now_us + g_rand_int_range(soak->rand, 1, 20 * 60) * G_USEC_PER_SEC;
+    } else if (choice < 85) {
+        gtk_widget_activate_action(window, "win.skip-session", NULL);
+    } else if (choice < 88) {
+        gtk_widget_activate_action(window, "win.reset-timer", NULL);
+    } else if (choice < 91) {
+        sm_set_routine((RoutineType) g_rand_int_range(soak->rand, Working, LongBreak + 1),
+                       soak->session_manager);
+    } else if (choice < 94) {
+        gtk_widget_activate_action(window, "win.start-timer", NULL);
+        soak->now_us += g_rand_int_range(soak->rand, 1, 30 * 60) * G_USEC_PER_SEC;
+        gtk_widget_activate_action(window, "win.start-timer", NULL);
+    } else if (choice < 96) {
+        sm_extend_session(soak->session_manager, g_rand_int_range(soak->rand, 1, 6));
+    } else if (choice < 98) {
+        // The buttons of the completion notification.
+        const char *action = g_rand_boolean(soak->rand) ? "extend-session" : "pause-timer";
+        g_action_group_activate_action(G_ACTION_GROUP(soak->app), action, NULL);
+    } else {
+        change_preference(soak);
+    }
+}
+
+static void start_day(Soak *soak)
+{
+    soak->day++;
+    soak->active_end_us = soak->now_us + SOAK_ACTIVE_US;
+    soak->day_end_us = soak->now_us + SOAK_DAY_US;
+}
+
+static void finish(Soak *soak)
+{
+    gboolean rss_sampled = (soak->rss_kib >= 0 && soak->baseline_rss_kib >= 0);
+    gint64 rss_growth_kib = rss_sampled ? soak->rss_kib - soak->baseline_rss_kib : 0;
+    gint64 allocation_growth = soak->allocations - soak->baseline_allocations;
+
+    soak->passed = (rss_growth_kib <= soak->rss_budget_kib) &&
+                   (!alloc_stats_supported() || allocation_growth <= soak->allocation_budget);
+
+    g_print("{\"days\": %d, \"sessions\": %" G_GUINT64_FORMAT
+            ", \"rss_growth_kib\": %" G_GINT64_FORMAT ", \"allocation_growth\": ",
+            soak->total_days, soak->session_manager->total_sessions_counted, rss_growth_kib);
+
+    if (alloc_stats_supported()) {
+        g_print("%" G_GINT64_FORMAT, allocation_growth);
+    } else {
+        g_print("null");
+    }
+
+    g_print(", \"passed\": %s}\n", soak->passed ? "true" : "false");
+
+    g_clear_object(&soak->settings);
+    g_application_release(soak->app);
+    g_application_quit(soak->app);
+}
+
+/*  The night: the timer is reset and the window closed, then it is opened again in the morning
+    while the app kept running. Pending work is flushed before sampling memory.
+*/
+static void end_day(Soak *soak)
+{
+    GtkWidget *window = get_window(soak);
+
+    gtk_widget_activate_action(window, "win.reset-timer", NULL);
+    gtk_window_destroy(GTK_WINDOW(window));
+    soak->now_us = MAX(soak->now_us, soak->day_end_us);
+    get_window(soak);
+
+    while (g_main_context_iteration(NULL, FALSE)) {
+    }
+
+    soak->rss_kib = get_rss_kib();
+    soak->allocations = alloc_stats_get_live();
+
+    if (soak->day == SOAK_WARMUP_DAYS) {
+        soak->baseline_rss_kib = soak->rss_kib;
+        soak->baseline_allocations = soak->allocations;
+    }
+
+    if (soak->verbose) {
+        g_printerr("day %d: rss %" G_GINT64_FORMAT " KiB, %" G_GINT64_FORMAT
+                   " live allocations, %" G_GUINT64_FORMAT " sessions\n",
+                   soak->day, soak->rss_kib, soak->allocations,
+                   soak->session_manager->total_sessions_counted);
+    }
+}
+
+// One wakeup of the timer or one action per main loop iteration, so the window keeps up.
+static gboolean soak_iterate(gpointer soak_ptr)
+{
+    Soak *soak = soak_ptr;
+
+    if (soak->now_us >= soak->active_end_us) {
+        end_day(soak);
+
+        if (soak->day == soak->total_days) {
+            finish(soak);
+            return G_SOURCE_REMOVE;
+        }
+
+        start_day(soak);
+        return G_SOURCE_CONTINUE;
+    }
+
+    if (soak->now_us < soak->run_until_us) {
+        gint64 wakeup = tm_get_next_wakeup_us(soak->timer);
+
+        if (wakeup >= 0) {
+            soak->now_us = wakeup;
+            tm_tick(soak->timer);
+            return G_SOURCE_CONTINUE;
+        }
+    }
+
+    soak->run_until_us = 0;
+    soak_step(soak);
+    return G_SOURCE_CONTINUE;
+}
+
+// Takes over once the first window is up, later activations just reopen the window.
+static void on_activate(GApplication *app, gpointer user_data)
+{
+    Soak *soak = user_data;
+
+    if (soak->session_manager != NULL) {
+        return;
+    }
+
+    soak->session_manager = sm_get_default();
+    soak->timer = soak->session_manager->timer_instance;
+    soak->settings = g_settings_new(SOAK_SCHEMA_ID);
+    tm_set_clock(soak->timer, soak_clock, soak);
+
+    // Kept alive while the window is closed overnight.
+    g_application_hold(app);
+
+    start_day(soak);
+    g_idle_add(soak_iterate, soak);
+}
+
+
+/* ============================================================================
+ * Runner
+ * ============================================================================ */
+
+int main(int argc, char *argv[])
+{
+    gint weeks = 4;
+    gint seed = 1;
+    gint rss_budget_kib = 1024;
+    gint allocation_budget = 256;
+    gboolean verbose = FALSE;
+    g_autoptr(GError) error = NULL;
+
+    GOptionEntry options[] = {
+        {"weeks", 'w', 0, G_OPTION_ARG_INT, &weeks, "Simulated weeks of use, after a warm-up week",
+         "N"},
+        {"seed", 's', 0, G_OPTION_ARG_INT, &seed, "Seed of the simulated use", "N"},
+        {"rss-budget", 0, 0, G_OPTION_ARG_INT, &rss_budget_kib,
+         "Allowed growth of the resident set size after the warm-up, in KiB", "KIB"},
+        {"allocation-budget", 0, 0, G_OPTION_ARG_INT, &allocation_budget,
+         "Allowed growth of live heap allocations after the warm-up", "N"},
+        {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "Print a sample for every day", NULL},
+        G_OPTION_ENTRY_NULL,
+    };
+
+    g_autoptr(GOptionContext) context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, options, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    // Keep the user's settings, history and runtime files out of it.
+    g_autofree gchar *home = g_dir_make_tmp("samaya-soak-XXXXXX", &error);
+    if (home == NULL) {
+        g_printerr("Failed to create a temporary directory: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_setenv("XDG_DATA_HOME", home, TRUE);
+    g_setenv("XDG_CONFIG_HOME", home, TRUE);
+    g_setenv("XDG_CACHE_HOME", home, TRUE);
+    g_setenv("XDG_STATE_HOME", home, TRUE);
+    g_setenv("XDG_RUNTIME_DIR", home, TRUE);
+    g_setenv("GSETTINGS_BACKEND", "memory", TRUE);
+    g_setenv("GSETTINGS_SCHEMA_DIR", SOAK_SCHEMA_DIR, FALSE);
+
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+
+    Soak soak = {
+        .rand = g_rand_new_with_seed((guint32) seed),
+        .now_us = 1,
+        .total_days = SOAK_WARMUP_DAYS * (MAX(weeks, 0) + 1),
+        .verbose = verbose,
+        .rss_budget_kib = rss_budget_kib,
+        .allocation_budget = allocation_budget,
+        .baseline_rss_kib = -1,
+        .rss_kib = -1,
+    };
+
+    soak.app = G_APPLICATION(samaya_application_new(SOAK_APP_ID, G_APPLICATION_NON_UNIQUE));
+    g_signal_connect_after(soak.app, "activate", G_CALLBACK(on_activate), &soak);
+
+    // Only the program name, the soak options were consumed above.
+    gint status = g_application_run(soak.app, 1, argv);
+
+    g_object_unref(soak.app);
+    g_rand_free(soak.rand);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+    remove_tree(home);
+
+    return (status == EXIT_SUCCESS && soak.passed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,203 @@
+/* samaya-status-reader.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  Reader for the status page Samaya publishes in $XDG_RUNTIME_DIR/samaya/status.
+
+    The page is a small fixed layout struct in a shared memory mapping, rewritten by the app only
+    when the timer changes state. Readers map it once and then read it without any syscall: the
+    remaining time of a running session is derived from the published deadline and the
+    CLOCK_MONOTONIC time, which is served from the vDSO.
+
+    This header and samaya-seqlock.h, which it includes, only depend on libc and can be copied
+    together into shell prompt helpers or panel applets.
+
+        SamayaStatusReader reader;
+        SamayaStatusSnapshot snapshot;
+
+        if (samaya_status_reader_open(&reader, NULL) == 0) {
+            if (samaya_status_reader_read(&reader, &snapshot) == 0)
+                printf("%lld\n", (long long) snapshot.remaining_ms / 1000);
+            samaya_status_reader_close(&reader);
+        }
+*/
+
+#pragma once
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "samaya-seqlock.h"
+
+#define SAMAYA_STATUS_MAGIC 0x53594d53u /* "SMYS" */
+#define SAMAYA_STATUS_VERSION 1
+#define SAMAYA_STATUS_READ_RETRIES 64
+
+// Values of the state field, they match the TmState enumeration of the timer.
+enum
+{
+    SAMAYA_STATUS_IDLE,
+    SAMAYA_STATUS_RUNNING,
+    SAMAYA_STATUS_PAUSED,
+    SAMAYA_STATUS_EXITED,
+};
+
+// Values of the routine field, they match the RoutineType enumeration of the session manager.
+enum
+{
+    SAMAYA_STATUS_WORK,
+    SAMAYA_STATUS_SHORT_BREAK,
+    SAMAYA_STATUS_LONG_BREAK,
+};
+
+/*  Layout of the shared page, in host byte order.
+
+    sequence is a seqlock, see samaya-seqlock.h: it is odd while the writer updates the page, and
+    a read is only valid if it saw the same even value before and after copying the fields.
+*/
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sequence;
+
+    uint32_t state;
+    uint32_t routine;
+    uint32_t sessions_completed;
+    uint32_t sessions_to_complete;
+    uint32_t reserved;
+
+    // CLOCK_MONOTONIC time in microseconds the running session ends at, 0 when not running.
+    int64_t deadline_us;
+
+    // Remaining time when the timer is not running.
+    int64_t remaining_ms;
+    int64_t duration_ms;
+} SamayaStatusPage;
+
+typedef struct
+{
+    uint32_t state;
+    uint32_t routine;
+    uint32_t sessions_completed;
+    uint32_t sessions_to_complete;
+
+    int64_t deadline_us;
+    int64_t remaining_ms;
+    int64_t duration_ms;
+} SamayaStatusSnapshot;
+
+typedef struct
+{
+    const SamayaStatusPage *page;
+} SamayaStatusReader;
+
+// Maps the status page at path, or the default location if path is NULL. Returns 0 on success.
+static inline int samaya_status_reader_open(SamayaStatusReader *reader, const char *path)
+{
+    char default_path[4096];
+
+    reader->page = NULL;
+
+    if (path == NULL) {
+        const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+        if (runtime_dir == NULL) {
+            return -1;
+        }
+
+        snprintf(default_path, sizeof(default_path), "%s/samaya/status", runtime_dir);
+        path = default_path;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    void *mapping = mmap(NULL, sizeof(SamayaStatusPage), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return -1;
+    }
+
+    reader->page = mapping;
+    return 0;
+}
+
+static inline void samaya_status_reader_close(SamayaStatusReader *reader)
+{
+    if (reader->page != NULL) {
+        munmap((void *) reader->page, sizeof(SamayaStatusPage));
+        reader->page = NULL;
+    }
+}
+
+/*  Copies a consistent view of the page into snapshot, filling remaining_ms for running sessions
+    from the deadline. Returns 0 on success, -1 if the page is missing or from another version, or
+    if the writer kept it busy for every retry.
+*/
+static inline int samaya_status_reader_read(const SamayaStatusReader *reader,
+                                            SamayaStatusSnapshot *snapshot)
+{
+    const SamayaStatusPage *page = reader->page;
+
+    if (page == NULL || SAMAYA_SEQLOCK_LOAD(page->magic) != SAMAYA_STATUS_MAGIC ||
+        SAMAYA_SEQLOCK_LOAD(page->version) != SAMAYA_STATUS_VERSION) {
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < SAMAYA_STATUS_READ_RETRIES; attempt++) {
+        uint32_t begin = samaya_seqlock_read_begin(&page->sequence);
+        if (begin & 1) {
+            continue;
+        }
+
+        snapshot->state = SAMAYA_SEQLOCK_LOAD(page->state);
+        snapshot->routine = SAMAYA_SEQLOCK_LOAD(page->routine);
+        snapshot->sessions_completed = SAMAYA_SEQLOCK_LOAD(page->sessions_completed);
+        snapshot->sessions_to_complete = SAMAYA_SEQLOCK_LOAD(page->sessions_to_complete);
+        snapshot->deadline_us = SAMAYA_SEQLOCK_LOAD(page->deadline_us);
+        snapshot->remaining_ms = SAMAYA_SEQLOCK_LOAD(page->remaining_ms);
+        snapshot->duration_ms = SAMAYA_SEQLOCK_LOAD(page->duration_ms);
+
+        if (samaya_seqlock_read_retry(&page->sequence, begin)) {
+            continue;
+        }
+
+        if (snapshot->state == SAMAYA_STATUS_RUNNING) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+
+            int64_t now_us = (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+            int64_t remaining_us = snapshot->deadline_us - now_us;
+            snapshot->remaining_ms = remaining_us > 0 ? remaining_us / 1000 : 0;
+        }
+
+        return 0;
+    }
+
+    return -1;
+}
+
+#undef SAMAYA_STATUS_LOAD
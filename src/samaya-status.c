@@ -0,0 +1,173 @@
+/* samaya-status.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <glib.h>
+#include "samaya-status.h"
+
+#if defined(G_OS_UNIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "samaya-status-reader.h"
+
+struct StatusPage
+{
+    SessionManagerPtr session_manager;
+    gulong state_changed_id;
+    gulong session_complete_id;
+
+    SamayaStatusPage *page;
+};
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+static SamayaStatusPage *map_status_page(void)
+{
+    g_autofree gchar *dir = g_build_filename(g_get_user_runtime_dir(), "samaya", NULL);
+    g_autofree gchar *path = g_build_filename(dir, "status", NULL);
+
+    if (g_mkdir_with_parents(dir, 0700) != 0) {
+        g_warning("Failed to create %s: %s", dir, g_strerror(errno));
+        return NULL;
+    }
+
+    int fd = g_open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        g_warning("Failed to open the status page %s: %s", path, g_strerror(errno));
+        return NULL;
+    }
+
+    void *mapping = MAP_FAILED;
+    if (ftruncate(fd, sizeof(SamayaStatusPage)) == 0) {
+        mapping = mmap(NULL, sizeof(SamayaStatusPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int saved_errno = errno;
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        g_warning("Failed to map the status page %s: %s", path, g_strerror(saved_errno));
+        return NULL;
+    }
+
+    return mapping;
+}
+
+static void on_session_changed(SessionManagerPtr session_manager, gpointer user_data)
+{
+    status_page_publish(user_data);
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+StatusPagePtr status_page_new(SessionManagerPtr session_manager)
+{
+    SamayaStatusPage *page = map_status_page();
+    if (page == NULL) {
+        return NULL;
+    }
+
+    StatusPagePtr status = g_new0(StatusPage, 1);
+    status->session_manager = session_manager;
+    status->page = page;
+
+    // A page left behind by a previous instance may hold an odd sequence, restart it.
+    SAMAYA_SEQLOCK_STORE(page->magic, SAMAYA_STATUS_MAGIC);
+    SAMAYA_SEQLOCK_STORE(page->version, SAMAYA_STATUS_VERSION);
+    SAMAYA_SEQLOCK_STORE(page->sequence, 0);
+
+    status->state_changed_id =
+        sm_connect_state_changed(session_manager, on_session_changed, status);
+    status->session_complete_id =
+        sm_connect_session_complete(session_manager, on_session_changed, status);
+
+    status_page_publish(status);
+    return status;
+}
+
+void status_page_free(StatusPagePtr self)
+{
+    if (self == NULL) {
+        return;
+    }
+
+    sm_disconnect_state_changed(self->session_manager, self->state_changed_id);
+    sm_disconnect_session_complete(self->session_manager, self->session_complete_id);
+
+    samaya_seqlock_write_begin(&self->page->sequence);
+    SAMAYA_SEQLOCK_STORE(self->page->state, (guint32) StExited);
+    SAMAYA_SEQLOCK_STORE(self->page->deadline_us, 0);
+    samaya_seqlock_write_end(&self->page->sequence);
+
+    munmap(self->page, sizeof(SamayaStatusPage));
+    g_free(self);
+}
+
+void status_page_publish(StatusPagePtr self)
+{
+    SessionManagerPtr session_manager = self->session_manager;
+    TimerPtr timer = session_manager->timer_instance;
+    SamayaStatusPage *page = self->page;
+
+    // One snapshot, so the deadline and the remaining time are from the same tick.
+    TmSnapshot snapshot;
+    tm_snapshot(timer, &snapshot);
+
+    gint64 deadline_us = (snapshot.state == StRunning)
+                             ? snapshot.updated_us + (gint64) snapshot.remaining_ms * 1000
+                             : 0;
+
+    samaya_seqlock_write_begin(&page->sequence);
+    SAMAYA_SEQLOCK_STORE(page->state, (guint32) snapshot.state);
+    SAMAYA_SEQLOCK_STORE(page->routine, (guint32) session_manager->current_routine);
+    SAMAYA_SEQLOCK_STORE(page->sessions_completed, (guint32) session_manager->sessions_completed);
+    SAMAYA_SEQLOCK_STORE(page->sessions_to_complete,
+                         (guint32) session_manager->sessions_to_complete);
+    SAMAYA_SEQLOCK_STORE(page->deadline_us, deadline_us);
+    SAMAYA_SEQLOCK_STORE(page->remaining_ms, (gint64) snapshot.remaining_ms);
+    SAMAYA_SEQLOCK_STORE(page->duration_ms, (gint64) snapshot.duration_ms);
+    samaya_seqlock_write_end(&page->sequence);
+}
+
+#else
+
+// Shared mappings of the runtime directory are only available on unix systems.
+
+StatusPagePtr status_page_new(SessionManagerPtr session_manager)
+{
+    return NULL;
+}
+
+void status_page_free(StatusPagePtr self)
+{
+}
+
+void status_page_publish(StatusPagePtr self)
+{
+}
+
+#endif
@@ -0,0 +1,42 @@
+/* samaya-status.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include "samaya-session.h"
+
+typedef struct StatusPage StatusPage;
+typedef StatusPage *StatusPagePtr;
+
+/*  Creates the shared status page in $XDG_RUNTIME_DIR/samaya/status and keeps it in sync with the
+    session manager.
+
+    The page is only rewritten on timer transitions and completed sessions, never per tick, as
+    readers derive the remaining time from the published deadline. See samaya-status-reader.h for
+    the layout and the reader side. Returns NULL where shared mappings are not available.
+*/
+StatusPagePtr status_page_new(SessionManagerPtr session_manager);
+
+// Marks the page as exited, unmaps it and stops listening to the session manager.
+void status_page_free(StatusPagePtr self);
+
+// Writes the current session state to the page.
+void status_page_publish(StatusPagePtr self);
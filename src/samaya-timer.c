@@ -19,10 +19,14 @@
  */
 
 #include "glib.h"
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+#include "samaya-metrics.h"
+#include "samaya-seqlock.h"
 #include "samaya-timer.h"
 #include "samaya-utils.h"
 
-
 /* ============================================================================
  * Internal Implementation
  * ============================================================================ */
@@ -39,6 +43,24 @@ typedef struct
     TmTransitionAction action;
 } TmStateTransition;
 
+/*  A source without prepare or check, it only becomes ready at its ready time. The tick callback
+    moves that time to the next multiple of the tick interval in the remaining time, which makes
+    the last wakeup land exactly on the deadline instead of up to an interval after it.
+*/
+static gboolean deadline_source_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    return callback(user_data);
+}
+
+static GSourceFuncs deadline_source_funcs = {
+    .dispatch = deadline_source_dispatch,
+};
+
+static gint64 tm_now(TimerPtr self)
+{
+    return (self->clock != NULL) ? self->clock(self->clock_data) : g_get_monotonic_time();
+}
+
 static void update_progress(TimerPtr self)
 {
     if (self->initial_time_ms > 0) {
@@ -53,7 +75,7 @@ static gfloat get_instant_progress(TimerPtr self)
     if (self->initial_time_ms <= 0)
         return 0.0f;
 
-    guint64 current_time_us = g_get_monotonic_time();
+    guint64 current_time_us = tm_now(self);
     guint64 elapsed_since_update_us = guint64_sat_sub(current_time_us, self->last_updated_time_us);
 
     guint64 elapsed_since_update_ms = elapsed_since_update_us / 1000;
@@ -63,43 +85,184 @@ static gfloat get_instant_progress(TimerPtr self)
     return (gfloat) real_remaining_ms / (gfloat) self->initial_time_ms;
 }
 
-static void notify_time_update(TimerPtr self)
+// Moves the time elapsed since the last update out of the remaining time. The sub-millisecond
+// remainder is kept in last_updated_time_us so the ticks do not drift, and a timer that ran out
+// is left at its deadline rather than at the moment that was noticed.
+static void consume_elapsed_time(TimerPtr self)
 {
+    guint64 current_time_us = tm_now(self);
+    guint64 elapsed_time_us = guint64_sat_sub(current_time_us, self->last_updated_time_us);
+
+    guint64 elapsed_time_ms = MIN(elapsed_time_us / 1000, self->remaining_time_ms);
+    self->last_updated_time_us += elapsed_time_ms * 1000;
+    self->remaining_time_ms -= elapsed_time_ms;
+}
+
+// Copies the state into the snapshot readers see. Must be called with the lock held, which makes
+// it the only writer.
+static void publish_snapshot(TimerPtr self)
+{
+    TmSnapshot *published = &self->published;
+    gfloat progress = self->timer_progress;
+
+    samaya_seqlock_write_begin(&self->snapshot_sequence);
+
+    SAMAYA_SEQLOCK_STORE(published->state, self->tm_state);
+    SAMAYA_SEQLOCK_STORE(published->duration_ms, self->initial_time_ms);
+    SAMAYA_SEQLOCK_STORE(published->remaining_ms, self->remaining_time_ms);
+    SAMAYA_SEQLOCK_STORE(published->updated_us, (gint64) self->last_updated_time_us);
+    __atomic_store(&published->progress, &progress, __ATOMIC_RELEASE);
+
+    samaya_seqlock_write_end(&self->snapshot_sequence);
+}
+
+// The time the remaining time next reaches a multiple of the tick interval, or zero.
+static gint64 next_tick_time(TimerPtr self)
+{
+    guint64 until_next_tick_ms = self->remaining_time_ms % self->tick_interval_ms;
+    if (until_next_tick_ms == 0) {
+        until_next_tick_ms = self->tick_interval_ms;
+    }
+
+    return self->last_updated_time_us + until_next_tick_ms * 1000;
+}
+
+// Whether the next tick may fire up to TM_LOW_POWER_SLACK_MS late. The last one never does, so
+// the session completes on its deadline even in low power mode.
+static gboolean next_tick_coarse(TimerPtr self)
+{
+    return self->low_power &&
+           self->remaining_time_ms > self->tick_interval_ms + TM_LOW_POWER_SLACK_MS;
+}
+
+/*  Timer slack is a property of the calling thread, so it is applied on the timekeeping thread
+    before it sleeps until the tick. Returns G_SOURCE_REMOVE to double as an invoke callback.
+*/
+static gboolean sync_timer_slack(gpointer timer_ptr)
+{
+    TimerPtr self = timer_ptr;
+
+    g_mutex_lock(&self->lock);
+    gboolean coarse = (self->tick_source != NULL) && self->tick_coarse;
+    g_mutex_unlock(&self->lock);
+
+    if (coarse != g_atomic_int_get(&self->thread_slack_coarse)) {
+#if defined(__linux__)
+        // Zero restores the slack the thread started with.
+        prctl(PR_SET_TIMERSLACK, coarse ? TM_LOW_POWER_SLACK_MS * 1000000UL : 0UL, 0, 0, 0);
+#endif
+        g_atomic_int_set(&self->thread_slack_coarse, coarse);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void unschedule_tick(TimerPtr self)
+{
+    if (self->tick_source != NULL) {
+        g_source_destroy(self->tick_source);
+        g_clear_pointer(&self->tick_source, g_source_unref);
+    }
+}
+
+static gpointer tm_timekeeping_thread(gpointer timer_ptr);
+
+// A timer that never runs, or only on an injected clock, never needs the thread.
+static void ensure_timekeeping_thread(TimerPtr self)
+{
+    if (self->thread == NULL) {
+        self->thread = g_thread_new("samaya-timer", tm_timekeeping_thread, self);
+    }
+}
+
+static void schedule_tick(TimerPtr self)
+{
+    unschedule_tick(self);
+
+    // With an injected clock the caller drives the ticks through tm_tick.
+    if (self->clock != NULL) {
+        return;
+    }
+
+    ensure_timekeeping_thread(self);
+
+    self->tick_coarse = next_tick_coarse(self);
+
+    self->tick_source = g_source_new(&deadline_source_funcs, sizeof(GSource));
+    g_source_set_ready_time(self->tick_source, next_tick_time(self));
+    g_source_set_static_name(self->tick_source, "samaya-timer-tick");
+    g_source_set_priority(self->tick_source, G_PRIORITY_HIGH);
+    g_source_set_callback(self->tick_source, tm_run_tick, self, NULL);
+    g_source_attach(self->tick_source, self->context);
+
+    // Runs before the thread goes back to sleep, a resumed session may be near its deadline. On
+    // the timekeeping thread itself tm_run_tick applies the slack once the tick is handled.
+    if (self->tick_coarse != g_atomic_int_get(&self->thread_slack_coarse) &&
+        g_thread_self() != self->thread) {
+        g_main_context_invoke_full(self->context, G_PRIORITY_HIGH, sync_timer_slack, self, NULL);
+    }
+}
+
+// Delivers the latest remaining time, and a completion that happened on the timekeeping thread,
+// to the owner context.
+static void dispatch_to_owner(TimerPtr self)
+{
+    g_mutex_lock(&self->lock);
     guint64 remaining = self->remaining_time_ms;
-    if (self->tm_time_update) {
+    gboolean complete = self->complete_pending;
+    gboolean started = self->start_pending;
+    self->complete_pending = FALSE;
+    self->start_pending = FALSE;
+    g_mutex_unlock(&self->lock);
+
+    // The time of a session that already started on its own belongs after the completion.
+    if (!started && self->tm_time_update) {
         self->tm_time_update(&remaining);
     }
+    if (complete && self->tm_time_complete) {
+        self->tm_time_complete(self);
+    }
+    if (started && self->tm_time_update) {
+        self->tm_time_update(&remaining);
+    }
+    if (started && self->tm_event_update) {
+        self->tm_event_update(self);
+    }
 }
 
-static void action_start_timer(TimerPtr self)
+static gboolean on_owner_dispatch(gpointer timer_ptr)
 {
-    self->last_updated_time_us = g_get_monotonic_time();
+    TimerPtr self = timer_ptr;
 
-    if (self->tick_source_id > 0) {
-        g_source_remove(self->tick_source_id);
-    }
+    // Disarm first, so a tick landing while the callbacks run queues another dispatch.
+    g_source_set_ready_time(self->owner_source, -1);
+    dispatch_to_owner(self);
 
-    self->tick_source_id = g_timeout_add(1000, tm_run_tick, self);
+    return G_SOURCE_CONTINUE;
 }
 
-// TODO: This function, tm_run_tick and get_instant_progress all are basically doing the same
-// calcualation but code is repeated again and again in all 3. Make a single function for this and
-// call that function instead.
-static void action_stop_timer(TimerPtr self)
+/*  Queues a dispatch on the owner context. The source is created once in tm_new and only re-armed
+    here, so the per-second hand-off allocates nothing. Arming an already armed source coalesces
+    into the pending dispatch.
+*/
+static void queue_owner_dispatch(TimerPtr self)
 {
-    guint64 current_time_us = g_get_monotonic_time();
-    guint64 elapsed_time_us = guint64_sat_sub(current_time_us, self->last_updated_time_us);
+    g_source_set_ready_time(self->owner_source, 0);
+}
+
+static void action_start_timer(TimerPtr self)
+{
+    self->last_updated_time_us = tm_now(self);
 
-    gint64 elapsed_time_ms = elapsed_time_us / 1000;
-    self->remaining_time_ms = guint64_sat_sub(self->remaining_time_ms, elapsed_time_ms);
+    schedule_tick(self);
+}
 
+static void action_stop_timer(TimerPtr self)
+{
+    consume_elapsed_time(self);
     update_progress(self);
-    notify_time_update(self);
 
-    if (self->tick_source_id > 0) {
-        g_source_remove(self->tick_source_id);
-        self->tick_source_id = 0;
-    }
+    unschedule_tick(self);
 }
 
 static void action_reset(TimerPtr self)
@@ -109,13 +272,11 @@ static void action_reset(TimerPtr self)
     self->remaining_time_ms = self->initial_time_ms;
     self->timer_progress = 1.0f;
 
-    notify_time_update(self);
     g_info("Session Reset");
 }
 
 static void action_sync_time(TimerPtr self)
 {
-    self->last_updated_time_us = g_get_monotonic_time();
     action_start_timer(self);
 }
 
@@ -134,6 +295,8 @@ static const TmStateTransition tmStateTransitionMatrix[] = {
 
 static void tm_process_transition(TimerPtr self, TmEvent event)
 {
+    g_mutex_lock(&self->lock);
+
     TmState current_state = self->tm_state;
     const TmStateTransition *transition = NULL;
 
@@ -146,6 +309,7 @@ static void tm_process_transition(TimerPtr self, TmEvent event)
     }
 
     if (transition == NULL) {
+        g_mutex_unlock(&self->lock);
         g_warning("Invalid transition. State: %d, Event: %d", current_state, event);
         return;
     }
@@ -155,42 +319,112 @@ static void tm_process_transition(TimerPtr self, TmEvent event)
     if (transition->action != NULL) {
         transition->action(self);
     }
+
+    // Stopping and resetting change the remaining time, starting does not.
+    gboolean time_changed = (transition->action == action_stop_timer ||
+                             transition->action == action_reset);
+    guint64 remaining = self->remaining_time_ms;
+
+    publish_snapshot(self);
+    g_mutex_unlock(&self->lock);
+
+    if (time_changed && self->tm_time_update) {
+        self->tm_time_update(&remaining);
+    }
+    if (self->tm_event_update) {
+        self->tm_event_update(self);
+    }
+}
+
+/*  Advances a running timer to the current time and fires the timekeeping callbacks. Must be
+    called with the lock held, which it releases. Returns whether the timer expired.
+*/
+static gboolean process_tick(TimerPtr self)
+{
+    consume_elapsed_time(self);
+    update_progress(self);
+
+    guint64 remaining = self->remaining_time_ms;
+    gboolean expired = (remaining == 0);
+
+    if (expired) {
+        self->tm_state = StIdle;
+        self->complete_pending = TRUE;
+        unschedule_tick(self);
+    } else if (self->tick_source != NULL) {
+        self->tick_coarse = next_tick_coarse(self);
+        g_source_set_ready_time(self->tick_source, next_tick_time(self));
+    }
+
+    TmCallback timekeeping_tick = self->tm_timekeeping_tick;
+    TmCallback timekeeping_expired = self->tm_timekeeping_expired;
+
+    publish_snapshot(self);
+    g_mutex_unlock(&self->lock);
+
+    if (timekeeping_tick) {
+        timekeeping_tick(&remaining);
+    }
+    if (expired && timekeeping_expired) {
+        timekeeping_expired(self);
+    }
+
+    return expired;
 }
 
+// Runs on the timekeeping thread.
 static gboolean tm_run_tick(gpointer timer_ptr)
 {
     TimerPtr self = timer_ptr;
 
-    if (self->tm_state != StRunning) {
-        self->tick_source_id = 0;
+    metrics_count(MetricTimerWakeups);
+
+    g_mutex_lock(&self->lock);
+
+    // The source may have been replaced or stopped from the owner thread while it was dispatched.
+    if (self->tm_state != StRunning || self->tick_source != g_main_current_source()) {
+        g_mutex_unlock(&self->lock);
         return G_SOURCE_REMOVE;
     }
 
-    guint64 current_time_us = g_get_monotonic_time();
-    guint64 elapsed_time_us = guint64_sat_sub(current_time_us, self->last_updated_time_us);
-    self->last_updated_time_us = current_time_us;
+    // Ticks under the low power slack are late by design.
+    if (!self->tick_coarse) {
+        metrics_observe_us(MetricTickLateness,
+                           tm_now(self) - g_source_get_ready_time(self->tick_source));
+    }
 
-    gint64 elapsed_time_ms = elapsed_time_us / 1000;
-    self->remaining_time_ms = guint64_sat_sub(self->remaining_time_ms, elapsed_time_ms);
+    gboolean expired = process_tick(self);
+    queue_owner_dispatch(self);
+    sync_timer_slack(self);
 
-    update_progress(self);
-    notify_time_update(self);
+    return expired ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
+}
 
-    if (self->remaining_time_ms == 0) {
-        self->tm_state = StIdle;
+static gpointer tm_timekeeping_thread(gpointer timer_ptr)
+{
+    TimerPtr self = timer_ptr;
 
-        if (self->tm_time_complete) {
-            self->tm_time_complete(self);
-        }
+    g_main_context_push_thread_default(self->context);
+    g_main_loop_run(self->loop);
+    g_main_context_pop_thread_default(self->context);
 
-        if (self->tm_state != StRunning) {
-            self->tick_source_id = 0;
-        }
+    return NULL;
+}
 
-        return G_SOURCE_REMOVE;
-    }
+static gboolean tm_quit_timekeeping(gpointer loop)
+{
+    g_main_loop_quit(loop);
+    return G_SOURCE_REMOVE;
+}
 
-    return G_SOURCE_CONTINUE;
+static void tm_clear(TimerPtr self)
+{
+    g_source_destroy(self->owner_source);
+    g_source_unref(self->owner_source);
+    g_main_loop_unref(self->loop);
+    g_main_context_unref(self->context);
+    g_main_context_unref(self->owner_context);
+    g_mutex_clear(&self->lock);
 }
 
 /* ============================================================================
@@ -202,58 +436,290 @@ TimerPtr tm_new(float duration_minutes, TmCallback time_complete, TmCallback tim
 {
     TimerPtr timer = g_new0(Timer, 1);
 
+    g_mutex_init(&timer->lock);
+
     timer->initial_time_ms = (guint64) (duration_minutes * 60 * 1000);
+    timer->tick_interval_ms = TM_TICK_INTERVAL_SECONDS;
     timer->remaining_time_ms = timer->initial_time_ms;
     timer->timer_progress = 1.0F;
 
     timer->tm_state = StIdle;
+    publish_snapshot(timer);
 
     timer->tm_time_update = time_update;
     timer->tm_time_complete = time_complete;
     timer->tm_event_update = event_update;
 
+    timer->owner_context = g_main_context_ref_thread_default();
+    timer->owner_source = g_source_new(&deadline_source_funcs, sizeof(GSource));
+    g_source_set_static_name(timer->owner_source, "samaya-timer-dispatch");
+    g_source_set_callback(timer->owner_source, on_owner_dispatch, timer, NULL);
+    g_source_attach(timer->owner_source, timer->owner_context);
+
+    timer->context = g_main_context_new();
+    timer->loop = g_main_loop_new(timer->context, FALSE);
+
     return timer;
 }
 
 void tm_free(Timer *self)
 {
-    if (self->tick_source_id > 0) {
-        g_source_remove(self->tick_source_id);
+    // Quitting through the context also works when the loop has not started running yet.
+    if (self->thread != NULL) {
+        g_main_context_invoke(self->context, tm_quit_timekeeping, self->loop);
+        g_thread_join(self->thread);
     }
 
-    self->tm_time_update = NULL;
-    self->tm_time_complete = NULL;
+    g_mutex_lock(&self->lock);
+    unschedule_tick(self);
+    g_mutex_unlock(&self->lock);
 
+    // Destroying the dispatch source on the owner thread drops any dispatch still queued on it.
+    tm_clear(self);
     g_free(self);
 }
 
+void tm_set_timekeeping_callbacks(TimerPtr self, TmCallback tick, TmCallback expired)
+{
+    g_mutex_lock(&self->lock);
+    self->tm_timekeeping_tick = tick;
+    self->tm_timekeeping_expired = expired;
+    g_mutex_unlock(&self->lock);
+}
+
+void tm_set_clock(TimerPtr self, TmClockFunc clock, gpointer clock_data)
+{
+    g_mutex_lock(&self->lock);
+
+    self->clock = clock;
+    self->clock_data = clock_data;
+
+    if (self->tm_state == StRunning) {
+        self->last_updated_time_us = tm_now(self);
+        schedule_tick(self);
+    }
+
+    publish_snapshot(self);
+    g_mutex_unlock(&self->lock);
+}
+
+gint64 tm_get_time_us(TimerPtr self)
+{
+    g_mutex_lock(&self->lock);
+    gint64 now = tm_now(self);
+    g_mutex_unlock(&self->lock);
+
+    return now;
+}
+
+gint64 tm_get_next_wakeup_us(TimerPtr self)
+{
+    g_mutex_lock(&self->lock);
+    gint64 wakeup = (self->tm_state == StRunning) ? next_tick_time(self) : -1;
+    g_mutex_unlock(&self->lock);
+
+    return wakeup;
+}
+
+void tm_tick(TimerPtr self)
+{
+    g_mutex_lock(&self->lock);
+
+    if (self->tm_state != StRunning) {
+        g_mutex_unlock(&self->lock);
+        return;
+    }
+
+    process_tick(self);
+    dispatch_to_owner(self);
+}
+
 void tm_trigger_event(TimerPtr self, TmEvent event)
 {
+    // A completion still waiting for the owner context has to be handled before the next event,
+    // or the event would act on the finished session.
+    g_mutex_lock(&self->lock);
+    gboolean complete_pending = self->complete_pending;
+    g_mutex_unlock(&self->lock);
+
+    if (complete_pending) {
+        dispatch_to_owner(self);
+    }
+
     tm_process_transition(self, event);
 }
 
+void tm_snapshot(TimerPtr self, TmSnapshot *snapshot)
+{
+    TmSnapshot *published = &self->published;
+
+    for (;;) {
+        guint32 begin = samaya_seqlock_read_begin(&self->snapshot_sequence);
+        if (begin & 1) {
+            continue;
+        }
+
+        snapshot->state = SAMAYA_SEQLOCK_LOAD(published->state);
+        snapshot->duration_ms = SAMAYA_SEQLOCK_LOAD(published->duration_ms);
+        snapshot->remaining_ms = SAMAYA_SEQLOCK_LOAD(published->remaining_ms);
+        snapshot->updated_us = SAMAYA_SEQLOCK_LOAD(published->updated_us);
+        __atomic_load(&published->progress, &snapshot->progress, __ATOMIC_ACQUIRE);
+
+        if (!samaya_seqlock_read_retry(&self->snapshot_sequence, begin)) {
+            return;
+        }
+    }
+}
+
 TmState tm_get_state(TimerPtr self)
 {
-    return self->tm_state;
+    return SAMAYA_SEQLOCK_LOAD(self->published.state);
 }
 
 gfloat tm_get_progress(TimerPtr self)
 {
-    if (self->tm_state == StRunning) {
-        return get_instant_progress(self);
-    }
-    return self->timer_progress;
+    g_mutex_lock(&self->lock);
+    gfloat progress =
+        (self->tm_state == StRunning) ? get_instant_progress(self) : self->timer_progress;
+    g_mutex_unlock(&self->lock);
+
+    return progress;
 }
 
 gint64 tm_get_remaining_time_ms(TimerPtr self)
 {
-    return self->remaining_time_ms;
+    return SAMAYA_SEQLOCK_LOAD(self->published.remaining_ms);
+}
+
+gint64 tm_get_deadline_us(TimerPtr self)
+{
+    TmSnapshot snapshot;
+    tm_snapshot(self, &snapshot);
+
+    return (snapshot.state == StRunning)
+               ? snapshot.updated_us + (gint64) snapshot.remaining_ms * 1000
+               : 0;
+}
+
+gfloat tm_snapshot_progress_at(const TmSnapshot *snapshot, gint64 time_us)
+{
+    if (snapshot->state != StRunning || snapshot->duration_ms == 0) {
+        return snapshot->progress;
+    }
+
+    gint64 remaining_us = (gint64) snapshot->remaining_ms * 1000;
+    gint64 deadline_us = snapshot->updated_us + remaining_us;
+    gint64 left_us = CLAMP(deadline_us - time_us, 0, remaining_us);
+
+    return (gfloat) ((gdouble) left_us / ((gdouble) snapshot->duration_ms * 1000));
+}
+
+guint64 tm_get_duration_ms(TimerPtr self)
+{
+    return SAMAYA_SEQLOCK_LOAD(self->published.duration_ms);
 }
 
 void tm_set_duration(TimerPtr self, gfloat initial_time_minutes)
 {
+    g_mutex_lock(&self->lock);
     self->initial_time_ms = (guint64) (initial_time_minutes * 60 * 1000);
     self->remaining_time_ms = self->initial_time_ms;
+    guint64 remaining = self->remaining_time_ms;
+    publish_snapshot(self);
+    g_mutex_unlock(&self->lock);
+
+    if (self->tm_time_update) {
+        self->tm_time_update(&remaining);
+    }
+}
+
+void tm_start_next(TimerPtr self, guint64 duration_ms)
+{
+    g_mutex_lock(&self->lock);
+
+    if (self->tm_state != StIdle || !self->complete_pending || self->start_pending) {
+        g_mutex_unlock(&self->lock);
+        return;
+    }
+
+    // last_updated_time_us is where the last session ran out, the new one counts from there.
+    self->initial_time_ms = duration_ms;
+    self->remaining_time_ms = duration_ms;
+    self->timer_progress = 1.0f;
+    self->tm_state = StRunning;
+    self->start_pending = TRUE;
+
+    schedule_tick(self);
+
+    publish_snapshot(self);
+    g_mutex_unlock(&self->lock);
+}
+
+void tm_extend(TimerPtr self, guint64 extra_ms)
+{
+    g_mutex_lock(&self->lock);
+
+    gboolean running = (self->tm_state == StRunning);
+    if (running) {
+        consume_elapsed_time(self);
+    }
+
+    self->initial_time_ms += extra_ms;
+    self->remaining_time_ms += extra_ms;
+    update_progress(self);
+
+    if (running) {
+        schedule_tick(self);
+    }
+
+    guint64 remaining = self->remaining_time_ms;
+    publish_snapshot(self);
+    g_mutex_unlock(&self->lock);
+
+    if (self->tm_time_update) {
+        self->tm_time_update(&remaining);
+    }
+}
+
+void tm_set_tick_interval(TimerPtr self, guint64 interval_ms)
+{
+    interval_ms = MAX(interval_ms, 1);
+
+    g_mutex_lock(&self->lock);
+
+    if (self->tick_interval_ms != interval_ms) {
+        self->tick_interval_ms = interval_ms;
+
+        if (self->tm_state == StRunning) {
+            schedule_tick(self);
+        }
+    }
+
+    g_mutex_unlock(&self->lock);
+}
+
+guint64 tm_get_tick_interval(TimerPtr self)
+{
+    g_mutex_lock(&self->lock);
+    guint64 interval_ms = self->tick_interval_ms;
+    g_mutex_unlock(&self->lock);
+
+    return interval_ms;
+}
+
+void tm_set_low_power(TimerPtr self, gboolean low_power)
+{
+    low_power = !!low_power;
+
+    g_mutex_lock(&self->lock);
+
+    if (self->low_power != low_power) {
+        self->low_power = low_power;
+
+        if (self->tm_state == StRunning) {
+            schedule_tick(self);
+        }
+    }
 
-    notify_time_update(self);
+    g_mutex_unlock(&self->lock);
 }
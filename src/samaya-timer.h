@@ -22,6 +22,12 @@
 
 #include <glib.h>
 
+// Tick intervals for views showing seconds and whole minutes, see tm_set_tick_interval.
+#define TM_TICK_INTERVAL_SECONDS 1000
+#define TM_TICK_INTERVAL_MINUTES 60000
+// How late a tick may fire in low power mode, see tm_set_low_power.
+#define TM_LOW_POWER_SLACK_MS 500
+
 typedef enum
 {
     StIdle,
@@ -42,9 +48,38 @@ typedef Timer *TimerPtr;
 
 typedef void (*TmCallback)(gpointer callback_data);
 
+// A consistent copy of the timer state, see tm_snapshot.
+typedef struct
+{
+    TmState state;
+
+    guint64 duration_ms;
+    guint64 remaining_ms;
+
+    // Clock time remaining_ms was measured at. A running timer keeps counting down from there.
+    gint64 updated_us;
+
+    gfloat progress;
+} TmSnapshot;
+
+// Returns a monotonic time in microseconds.
+typedef gint64 (*TmClockFunc)(gpointer clock_data);
+
 struct Timer
 {
-    guint tick_source_id;
+    // Guards every field below that is written while the timer is alive.
+    GMutex lock;
+
+    // Context the timer was created on, time updates and completion are delivered there.
+    GMainContext *owner_context;
+
+    // Timekeeping thread running the tick source, independent of the owner context. The thread is
+    // only started the first time the timer runs on the real clock.
+    GMainContext *context;
+    GMainLoop *loop;
+    GThread *thread;
+
+    GSource *tick_source;
     TmState tm_state;
 
     guint64 initial_time_ms;
@@ -55,25 +90,91 @@ struct Timer
 
     guint32 tm_sleep_time_ms;
 
+    // Ticks land where the remaining time crosses a multiple of this, see tm_set_tick_interval.
+    guint64 tick_interval_ms;
+    // Whether the scheduled tick may fire late, see tm_set_low_power.
+    gboolean tick_coarse;
+    // Whether the timekeeping thread runs with the low power timer slack. Only written there.
+    gint thread_slack_coarse;
+
+    gboolean low_power;
+
+    // Replaces g_get_monotonic_time when set, see tm_set_clock.
+    TmClockFunc clock;
+    gpointer clock_data;
+
+    // Armed by the timekeeping thread to hand the latest state to the owner context.
+    GSource *owner_source;
+    // Set by the timekeeping thread, consumed on the owner context. start_pending is set along
+    // with complete_pending when tm_start_next began the following session.
+    gboolean complete_pending;
+    gboolean start_pending;
+
     TmCallback tm_time_update;
     TmCallback tm_time_complete;
     TmCallback tm_event_update;
+
+    TmCallback tm_timekeeping_tick;
+    TmCallback tm_timekeeping_expired;
+
+    // Copy of the state above for tm_snapshot, written with the lock held and read without it.
+    // The sequence is odd while the copy is being written, see samaya-seqlock.h.
+    guint32 snapshot_sequence;
+    TmSnapshot published;
 };
 
 /*  Constructs a new instance of the timer on the heap and returns a pointer to it.
 
+    The timer ticks on a thread of its own, started the first time it runs, so a stalled owner main
+    loop does not delay the moment it expires. The callbacks given here are still invoked on the
+    thread-default main context of the caller.
+
     Timer instance constructed using this function should be de-initialised using tm_free, or else
     will leak memory.
 */
 TimerPtr tm_new(float duration_minutes, TmCallback time_complete, TmCallback time_update,
                 TmCallback event_update);
 
-// De-initialises the timer and frees the allocated memory.
+// De-initialises the timer, stops its thread and releases the allocated memory.
 void tm_free(TimerPtr self);
 
+/*  Sets callbacks invoked directly on the timekeeping thread: tick receives a pointer to the
+    remaining milliseconds on every tick of a running timer, expired receives the timer the moment
+    it runs out, before time_complete is delivered to the owner context.
+
+    They must not touch the UI and should return quickly.
+*/
+void tm_set_timekeeping_callbacks(TimerPtr self, TmCallback tick, TmCallback expired);
+
+/*  Replaces the monotonic clock of the timer, or restores it when clock is NULL.
+
+    With a custom clock the timer no longer schedules wakeups of its own. The caller moves its
+    clock to tm_get_next_wakeup_us and runs tm_tick, which invokes every callback synchronously on
+    the calling thread. This lets the session logic run headless on virtual time.
+*/
+void tm_set_clock(TimerPtr self, TmClockFunc clock, gpointer clock_data);
+
+// Reads the clock of the timer.
+gint64 tm_get_time_us(TimerPtr self);
+
+// Get the clock time the next tick is due at, or -1 if the timer is not running.
+gint64 tm_get_next_wakeup_us(TimerPtr self);
+
+// Runs a tick of a running timer immediately, for callers that drive an injected clock.
+void tm_tick(TimerPtr self);
+
 // Handles external timer state events.
 void tm_trigger_event(TimerPtr timer, TmEvent event);
 
+/*  Copies the state of the timer into snapshot, from any thread and without taking the lock.
+
+    The copy is published by whoever changes the timer, under the lock, and read back through a
+    seqlock, so it never mixes fields of two updates and never blocks on a tick in progress. For a
+    running timer remaining_ms and progress are as of the last tick or event, updated_us tells when
+    that was.
+*/
+void tm_snapshot(TimerPtr self, TmSnapshot *snapshot);
+
 // Get the current running state of the Timer.
 TmState tm_get_state(TimerPtr timer);
 
@@ -83,5 +184,45 @@ gfloat tm_get_progress(TimerPtr self);
 // Get the remaining time for the timer to complete.
 gint64 tm_get_remaining_time_ms(TimerPtr self);
 
+// Get the monotonic time in microseconds a running timer reaches zero at, or 0 if not running.
+gint64 tm_get_deadline_us(TimerPtr self);
+
+/*  Computes the progress snapshot has at time_us on the clock of the timer, counting down toward
+    its deadline if it is running. Reads no clock and takes no lock, for sampling the progress once
+    per frame at the time the frame will be shown.
+*/
+gfloat tm_snapshot_progress_at(const TmSnapshot *snapshot, gint64 time_us);
+
+// Get the full duration of the current session.
+guint64 tm_get_duration_ms(TimerPtr self);
+
 // Sets the duration the timer will tick.
 void tm_set_duration(TimerPtr self, gfloat initial_time_minutes);
+
+/*  Starts the timer again for duration_ms from the moment it ran out, before the completion was
+    delivered to the owner context. Meant for the expired timekeeping callback, so a session that
+    starts on its own does so on the deadline of the last one, however busy the owner is. The
+    owner gets time_complete for the finished session first, then event_update for the new one.
+    Does nothing unless the timer just expired.
+*/
+void tm_start_next(TimerPtr self, guint64 duration_ms);
+
+// Adds extra_ms to both the duration and the remaining time, without changing the state.
+void tm_extend(TimerPtr self, guint64 extra_ms);
+
+/*  Sets how often a running timer wakes up, TM_TICK_INTERVAL_SECONDS by default. Ticks land
+    where the remaining time crosses a multiple of interval_ms, so a view showing whole minutes
+    can sleep a minute at a time and still change the moment the minute does. The last tick
+    always lands on the deadline.
+*/
+void tm_set_tick_interval(TimerPtr self, guint64 interval_ms);
+
+guint64 tm_get_tick_interval(TimerPtr self);
+
+/*  Lets ticks fire late so the kernel can batch them with other wakeups.
+
+    Ticks stay on the same deadlines either way. In low power mode the timekeeping thread runs
+    with a large timer slack on Linux, which allows each wakeup up to TM_LOW_POWER_SLACK_MS late.
+    The final tick is always scheduled without it, so completion is not delayed.
+*/
+void tm_set_low_power(TimerPtr self, gboolean low_power);
@@ -0,0 +1,441 @@
+/* samaya-tray.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <cairo.h>
+#include <glib/gi18n.h>
+#include <math.h>
+#include "samaya-tray.h"
+
+#define TRAY_OBJECT_PATH "/StatusNotifierItem"
+#define TRAY_INTERFACE "org.kde.StatusNotifierItem"
+#define WATCHER_NAME "org.kde.StatusNotifierWatcher"
+#define WATCHER_PATH "/StatusNotifierWatcher"
+
+#define TRAY_ICON_SIZE 24
+#define TRAY_ICON_LINE_WIDTH 3.0
+#define TRAY_TRACK_ALPHA 0.25
+#define TRAY_FRAME_BYTES (TRAY_ICON_SIZE * TRAY_ICON_SIZE * 4)
+
+// The ring is quantized to this many steps, frame i shows i / TRAY_ICON_STEPS of it.
+#define TRAY_ICON_STEPS 60
+#define TRAY_ROUTINES 3
+
+// Same colors as the routine-* classes in samaya-style.css.
+static const double routineColors[TRAY_ROUTINES][3] = {
+    {0x35 / 255.0, 0x84 / 255.0, 0xe4 / 255.0},
+    {0x33 / 255.0, 0xd1 / 255.0, 0x7a / 255.0},
+    {0xff / 255.0, 0xa3 / 255.0, 0x48 / 255.0},
+};
+
+static const gchar trayInterfaceXml[] =
+    "<node>"
+    "  <interface name='" TRAY_INTERFACE "'>"
+    "    <property name='Category' type='s' access='read'/>"
+    "    <property name='Id' type='s' access='read'/>"
+    "    <property name='Title' type='s' access='read'/>"
+    "    <property name='Status' type='s' access='read'/>"
+    "    <property name='WindowId' type='i' access='read'/>"
+    "    <property name='IconName' type='s' access='read'/>"
+    "    <property name='IconPixmap' type='a(iiay)' access='read'/>"
+    "    <property name='ToolTip' type='(sa(iiay)ss)' access='read'/>"
+    "    <property name='ItemIsMenu' type='b' access='read'/>"
+    "    <method name='ContextMenu'>"
+    "      <arg name='x' type='i' direction='in'/>"
+    "      <arg name='y' type='i' direction='in'/>"
+    "    </method>"
+    "    <method name='Activate'>"
+    "      <arg name='x' type='i' direction='in'/>"
+    "      <arg name='y' type='i' direction='in'/>"
+    "    </method>"
+    "    <method name='SecondaryActivate'>"
+    "      <arg name='x' type='i' direction='in'/>"
+    "      <arg name='y' type='i' direction='in'/>"
+    "    </method>"
+    "    <method name='Scroll'>"
+    "      <arg name='delta' type='i' direction='in'/>"
+    "      <arg name='orientation' type='s' direction='in'/>"
+    "    </method>"
+    "    <signal name='NewTitle'/>"
+    "    <signal name='NewIcon'/>"
+    "    <signal name='NewToolTip'/>"
+    "    <signal name='NewStatus'>"
+    "      <arg name='status' type='s'/>"
+    "    </signal>"
+    "  </interface>"
+    "</node>";
+
+struct Tray
+{
+    SessionManagerPtr session_manager;
+    gulong state_changed_id;
+    gulong time_changed_id;
+    gulong session_complete_id;
+
+    GApplication *app;
+    GDBusConnection *connection;
+    GDBusNodeInfo *node_info;
+    guint registration_id;
+    guint watcher_id;
+
+    // Every frame back to back in the pixel format of the spec, TRAY_ICON_STEPS + 1 per routine.
+    // The frame variants below point into it instead of holding copies.
+    GBytes *atlas;
+    GVariant *frames[TRAY_ROUTINES][TRAY_ICON_STEPS + 1];
+
+    guint shown_routine;
+    guint shown_step;
+};
+
+
+/* ============================================================================
+ * Internal Implementation
+ * ============================================================================ */
+
+// Converts cairo's native endian, premultiplied ARGB32 into the straight ARGB32 in network byte
+// order that IconPixmap carries.
+static void convert_to_sni_pixels(guint8 *pixels, gsize n_pixels)
+{
+    guint32 *pixel = (guint32 *) pixels;
+
+    for (gsize i = 0; i < n_pixels; i++) {
+        guint32 value = pixel[i];
+        guint32 alpha = value >> 24;
+
+        if (alpha > 0 && alpha < 255) {
+            guint32 red = ((value >> 16) & 0xff) * 255 / alpha;
+            guint32 green = ((value >> 8) & 0xff) * 255 / alpha;
+            guint32 blue = (value & 0xff) * 255 / alpha;
+
+            value = (alpha << 24) | (red << 16) | (green << 8) | blue;
+        }
+
+        pixel[i] = GUINT32_TO_BE(value);
+    }
+}
+
+static void render_frame(guint8 *pixels, const double *color, double progress)
+{
+    cairo_surface_t *surface =
+        cairo_image_surface_create_for_data(pixels, CAIRO_FORMAT_ARGB32, TRAY_ICON_SIZE,
+                                            TRAY_ICON_SIZE, TRAY_ICON_SIZE * 4);
+    cairo_t *cr = cairo_create(surface);
+
+    double center = TRAY_ICON_SIZE / 2.0;
+    double radius = center - TRAY_ICON_LINE_WIDTH / 2.0 - 1.0;
+
+    cairo_set_line_width(cr, TRAY_ICON_LINE_WIDTH);
+    cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+
+    cairo_set_source_rgba(cr, color[0], color[1], color[2], TRAY_TRACK_ALPHA);
+    cairo_arc(cr, center, center, radius, 0, 2 * M_PI);
+    cairo_stroke(cr);
+
+    if (progress > 0) {
+        // Clockwise from 12 o'clock, like the ring in the window.
+        cairo_set_source_rgb(cr, color[0], color[1], color[2]);
+        cairo_arc(cr, center, center, radius, -M_PI / 2, -M_PI / 2 + 2 * M_PI * progress);
+        cairo_stroke(cr);
+    }
+
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+    cairo_surface_destroy(surface);
+
+    convert_to_sni_pixels(pixels, TRAY_ICON_SIZE * TRAY_ICON_SIZE);
+}
+
+static void build_atlas(TrayPtr self)
+{
+    gsize frame_count = TRAY_ROUTINES * (TRAY_ICON_STEPS + 1);
+    guint8 *pixels = g_malloc0(frame_count * TRAY_FRAME_BYTES);
+
+    for (guint routine = 0; routine < TRAY_ROUTINES; routine++) {
+        for (guint step = 0; step <= TRAY_ICON_STEPS; step++) {
+            gsize offset = (routine * (TRAY_ICON_STEPS + 1) + step) * TRAY_FRAME_BYTES;
+            render_frame(pixels + offset, routineColors[routine], (double) step / TRAY_ICON_STEPS);
+        }
+    }
+
+    self->atlas = g_bytes_new_take(pixels, frame_count * TRAY_FRAME_BYTES);
+
+    for (guint routine = 0; routine < TRAY_ROUTINES; routine++) {
+        for (guint step = 0; step <= TRAY_ICON_STEPS; step++) {
+            gsize offset = (routine * (TRAY_ICON_STEPS + 1) + step) * TRAY_FRAME_BYTES;
+            g_autoptr(GBytes) frame_bytes =
+                g_bytes_new_from_bytes(self->atlas, offset, TRAY_FRAME_BYTES);
+
+            GVariant *data = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, frame_bytes, TRUE);
+            GVariant *pixmap = g_variant_new("(ii@ay)", TRAY_ICON_SIZE, TRAY_ICON_SIZE, data);
+
+            self->frames[routine][step] =
+                g_variant_ref_sink(g_variant_new_array(G_VARIANT_TYPE("(iiay)"), &pixmap, 1));
+        }
+    }
+}
+
+static void get_current_frame(TrayPtr self, guint *routine, guint *step)
+{
+    SessionManagerPtr session_manager = self->session_manager;
+    gfloat progress = CLAMP(tm_get_progress(session_manager->timer_instance), 0.0f, 1.0f);
+
+    *routine = MIN((guint) session_manager->current_routine, TRAY_ROUTINES - 1);
+    *step = (guint) ceilf(progress * TRAY_ICON_STEPS);
+}
+
+static GVariant *build_tooltip(TrayPtr self)
+{
+    SessionManagerPtr session_manager = self->session_manager;
+    const char *title = NULL;
+
+    switch (session_manager->current_routine) {
+        case Working:
+            title = _("Focus");
+            break;
+        case ShortBreak:
+            title = _("Short Break");
+            break;
+        case LongBreak:
+            title = _("Long Break");
+            break;
+        default:
+            title = _("Samaya");
+            break;
+    }
+
+    const char *remaining = sm_get_formatted_time(session_manager);
+    g_autofree gchar *description = NULL;
+
+    if (tm_get_state(session_manager->timer_instance) == StPaused) {
+        description = g_strdup_printf(_("%s left, paused"), remaining);
+    } else {
+        description = g_strdup_printf(_("%s left"), remaining);
+    }
+
+    GVariant *no_pixmaps = g_variant_new_array(G_VARIANT_TYPE("(iiay)"), NULL, 0);
+
+    return g_variant_new("(s@a(iiay)ss)", "", no_pixmaps, title, description);
+}
+
+static void emit_signal(TrayPtr self, const char *signal_name)
+{
+    g_autoptr(GError) error = NULL;
+
+    if (!g_dbus_connection_emit_signal(self->connection, NULL, TRAY_OBJECT_PATH, TRAY_INTERFACE,
+                                       signal_name, NULL, &error)) {
+        g_warning("Failed to emit %s for the tray icon: %s", signal_name, error->message);
+    }
+}
+
+// Runs on every timer tick, but only publishes once the quantized frame changes.
+static void on_time_changed(SessionManagerPtr session_manager, gpointer user_data)
+{
+    TrayPtr self = user_data;
+    guint routine;
+    guint step;
+
+    get_current_frame(self, &routine, &step);
+
+    if (routine == self->shown_routine && step == self->shown_step) {
+        return;
+    }
+
+    self->shown_routine = routine;
+    self->shown_step = step;
+
+    emit_signal(self, "NewIcon");
+    emit_signal(self, "NewToolTip");
+}
+
+// The ring moves a step per TRAY_ICON_STEPS-th of the session, the timer needn't tick more often.
+static void request_time_resolution(TrayPtr self)
+{
+    guint64 duration_ms = tm_get_duration_ms(self->session_manager->timer_instance);
+
+    sm_request_time_resolution(self->session_manager, self,
+                               MAX(duration_ms / TRAY_ICON_STEPS, TM_TICK_INTERVAL_SECONDS));
+}
+
+static void on_state_changed(SessionManagerPtr session_manager, gpointer user_data)
+{
+    TrayPtr self = user_data;
+
+    request_time_resolution(self);
+    emit_signal(self, "NewToolTip");
+    on_time_changed(session_manager, self);
+}
+
+static GVariant *tray_get_property(GDBusConnection *connection, const gchar *sender,
+                                   const gchar *object_path, const gchar *interface_name,
+                                   const gchar *property_name, GError **error, gpointer user_data)
+{
+    TrayPtr self = user_data;
+
+    if (g_strcmp0(property_name, "Category") == 0) {
+        return g_variant_new_string("ApplicationStatus");
+    } else if (g_strcmp0(property_name, "Id") == 0) {
+        const char *id = g_application_get_application_id(self->app);
+        return g_variant_new_string(id != NULL ? id : "samaya");
+    } else if (g_strcmp0(property_name, "Title") == 0) {
+        return g_variant_new_string(_("Samaya"));
+    } else if (g_strcmp0(property_name, "Status") == 0) {
+        return g_variant_new_string("Active");
+    } else if (g_strcmp0(property_name, "WindowId") == 0) {
+        return g_variant_new_int32(0);
+    } else if (g_strcmp0(property_name, "IconName") == 0) {
+        return g_variant_new_string("");
+    } else if (g_strcmp0(property_name, "IconPixmap") == 0) {
+        return g_variant_ref(self->frames[self->shown_routine][self->shown_step]);
+    } else if (g_strcmp0(property_name, "ToolTip") == 0) {
+        return build_tooltip(self);
+    } else if (g_strcmp0(property_name, "ItemIsMenu") == 0) {
+        return g_variant_new_boolean(FALSE);
+    }
+
+    g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property %s",
+                property_name);
+    return NULL;
+}
+
+static void tray_method_call(GDBusConnection *connection, const gchar *sender,
+                             const gchar *object_path, const gchar *interface_name,
+                             const gchar *method_name, GVariant *parameters,
+                             GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    TrayPtr self = user_data;
+
+    if (g_strcmp0(method_name, "Activate") == 0) {
+        g_application_activate(self->app);
+    } else if (g_strcmp0(method_name, "SecondaryActivate") == 0) {
+        gboolean running = (tm_get_state(self->session_manager->timer_instance) == StRunning);
+        g_action_group_activate_action(G_ACTION_GROUP(self->app),
+                                       running ? "pause-timer" : "start-timer", NULL);
+    }
+
+    // There is no menu, ContextMenu and Scroll are accepted and ignored.
+    g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+static const GDBusInterfaceVTable trayInterfaceVTable = {
+    .method_call = tray_method_call,
+    .get_property = tray_get_property,
+};
+
+static void on_register_finished(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GVariant) reply =
+        g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), result, &error);
+
+    if (reply == NULL) {
+        g_warning("Failed to register the tray icon: %s", error->message);
+    }
+}
+
+// Registers again every time a watcher appears, as a restarted panel forgets all items.
+static void on_watcher_appeared(GDBusConnection *connection, const gchar *name,
+                                const gchar *name_owner, gpointer user_data)
+{
+    const gchar *unique_name = g_dbus_connection_get_unique_name(connection);
+    if (unique_name == NULL) {
+        return;
+    }
+
+    g_dbus_connection_call(connection, name_owner, WATCHER_PATH, WATCHER_NAME,
+                           "RegisterStatusNotifierItem", g_variant_new("(s)", unique_name), NULL,
+                           G_DBUS_CALL_FLAGS_NONE, -1, NULL, on_register_finished, NULL);
+}
+
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+TrayPtr tray_new(SessionManagerPtr session_manager, GApplication *app,
+                 GDBusConnection *connection)
+{
+    g_autoptr(GError) error = NULL;
+
+    TrayPtr tray = g_new0(Tray, 1);
+    tray->session_manager = session_manager;
+    tray->app = app;
+    tray->connection = g_object_ref(connection);
+    tray->node_info = g_dbus_node_info_new_for_xml(trayInterfaceXml, NULL);
+
+    build_atlas(tray);
+    get_current_frame(tray, &tray->shown_routine, &tray->shown_step);
+
+    tray->registration_id = g_dbus_connection_register_object(
+        connection, TRAY_OBJECT_PATH, tray->node_info->interfaces[0], &trayInterfaceVTable, tray,
+        NULL, &error);
+    if (tray->registration_id == 0) {
+        g_warning("Failed to export the tray icon: %s", error->message);
+        tray_free(tray);
+        return NULL;
+    }
+
+    tray->watcher_id =
+        g_bus_watch_name_on_connection(connection, WATCHER_NAME, G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                       on_watcher_appeared, NULL, NULL, NULL);
+
+    tray->state_changed_id = sm_connect_state_changed(session_manager, on_state_changed, tray);
+    tray->time_changed_id = sm_connect_time_changed(session_manager, on_time_changed, tray);
+    tray->session_complete_id =
+        sm_connect_session_complete(session_manager, on_state_changed, tray);
+    request_time_resolution(tray);
+
+    return tray;
+}
+
+void tray_free(TrayPtr self)
+{
+    if (self == NULL) {
+        return;
+    }
+
+    // Nothing was connected yet when exporting the item failed.
+    if (self->state_changed_id != 0) {
+        sm_disconnect_state_changed(self->session_manager, self->state_changed_id);
+        sm_request_time_resolution(self->session_manager, self, 0);
+    }
+    if (self->time_changed_id != 0) {
+        sm_disconnect_time_changed(self->session_manager, self->time_changed_id);
+    }
+    if (self->session_complete_id != 0) {
+        sm_disconnect_session_complete(self->session_manager, self->session_complete_id);
+    }
+
+    if (self->watcher_id != 0) {
+        g_bus_unwatch_name(self->watcher_id);
+    }
+    if (self->registration_id != 0) {
+        g_dbus_connection_unregister_object(self->connection, self->registration_id);
+    }
+
+    for (guint routine = 0; routine < TRAY_ROUTINES; routine++) {
+        for (guint step = 0; step <= TRAY_ICON_STEPS; step++) {
+            g_clear_pointer(&self->frames[routine][step], g_variant_unref);
+        }
+    }
+
+    g_bytes_unref(self->atlas);
+    g_dbus_node_info_unref(self->node_info);
+    g_object_unref(self->connection);
+    g_free(self);
+}
@@ -0,0 +1,40 @@
+/* samaya-tray.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "samaya-session.h"
+
+typedef struct Tray Tray;
+typedef Tray *TrayPtr;
+
+/*  Exports a StatusNotifierItem showing the session as a small progress ring on connection, and
+    registers it with the org.kde.StatusNotifierWatcher whenever one is on the bus.
+
+    The icon frames for every routine are rendered once into an atlas, quantized to a fixed number
+    of steps, so a running session only swaps which cached pixmap is published. Activating the
+    item activates app, the secondary action starts or pauses the timer through its actions.
+*/
+TrayPtr tray_new(SessionManagerPtr session_manager, GApplication *app,
+                 GDBusConnection *connection);
+
+// Unexports the item and stops listening to the session manager.
+void tray_free(TrayPtr self);
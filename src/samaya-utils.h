@@ -7,3 +7,51 @@ static inline guint64 G_GNUC_UNUSED guint64_sat_sub(guint64 a, guint64 b)
 {
     return (b > a) ? 0 : (a - b);
 }
+
+// Maps signed values to unsigned ones so that small magnitudes stay small: 0, -1, 1, -2, ...
+static inline guint64 G_GNUC_UNUSED zigzag_encode(gint64 value)
+{
+    return ((guint64) value << 1) ^ (guint64) (value >> 63);
+}
+
+static inline gint64 G_GNUC_UNUSED zigzag_decode(guint64 value)
+{
+    return (gint64) (value >> 1) ^ -(gint64) (value & 1);
+}
+
+// Writes value as a LEB128 varint to out, which must have room for 10 bytes. Returns the length.
+static inline gsize G_GNUC_UNUSED put_varint(guint8 *out, guint64 value)
+{
+    gsize length = 0;
+
+    while (value >= 0x80) {
+        out[length++] = (guint8) (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = (guint8) value;
+
+    return length;
+}
+
+// Reads a varint at *cursor and moves it past the varint. Returns FALSE if it runs past end.
+static inline gboolean G_GNUC_UNUSED get_varint(const guint8 **cursor, const guint8 *end,
+                                                guint64 *value)
+{
+    guint64 result = 0;
+
+    for (guint shift = 0; shift < 64; shift += 7) {
+        if (*cursor >= end) {
+            return FALSE;
+        }
+
+        guint8 byte = *(*cursor)++;
+        result |= (guint64) (byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
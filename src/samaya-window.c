@@ -21,6 +21,8 @@
 #include <glib/gi18n.h>
 #include <math.h>
 #include "samaya-application.h"
+#include "samaya-metrics.h"
+#include "samaya-progress-ring.h"
 #include "samaya-session.h"
 #include "samaya-timer.h"
 #include "samaya-window.h"
@@ -32,7 +34,7 @@ struct _SamayaWindow
     GtkBox *routine_switch_box;
     AdwToggleGroup *routine_toggle_group;
 
-    GtkDrawingArea *progress_circle;
+    SamayaProgressRing *progress_circle;
     GtkLabel *timer_label;
     GtkLabel *sessions_label;
 
@@ -40,6 +42,15 @@ struct _SamayaWindow
     GtkButton *reset_button;
 
     guint tick_callback_id;
+
+    // The progress sampled for the frame with this counter, see sample_frame_progress.
+    gint64 sampled_frame;
+    gfloat sampled_progress;
+
+    // What the labels and buttons currently show, so the per-second update only touches the
+    // widgets whose content changed.
+    guint64 shown_session_count;
+    TmState shown_state;
 };
 
 G_DEFINE_FINAL_TYPE(SamayaWindow, samaya_window, ADW_TYPE_APPLICATION_WINDOW)
@@ -51,9 +62,6 @@ G_DEFINE_FINAL_TYPE(SamayaWindow, samaya_window, ADW_TYPE_APPLICATION_WINDOW)
 static void on_routine_toggled(AdwToggleGroup *toggle_group, GParamSpec *pspec,
                                gpointer samaya_window);
 
-static void on_progress_draw(GtkDrawingArea *area, cairo_t *cr, int width, int height,
-                             gpointer user_data);
-
 static void sync_button_state(SamayaWindow *self);
 
 
@@ -61,22 +69,60 @@ static void sync_button_state(SamayaWindow *self);
  * UI Actions
  * ============================================================================ */
 
+static void sync_progress(SamayaWindow *self)
+{
+    TimerPtr timer = sm_get_default()->timer_instance;
+
+    samaya_progress_ring_set_progress(self->progress_circle, tm_get_progress(timer));
+}
+
+/*  The progress as of the moment the frame being built reaches the screen, or of its frame time
+    while GDK has no prediction yet. Sampling at that target instead of whenever the callback runs
+    moves the arc by even steps, and the sample is taken once per frame from the lock-free timer
+    snapshot, so nothing in the frame reads a clock or waits on the timer thread.
+*/
+static gfloat sample_frame_progress(SamayaWindow *self, GdkFrameClock *frame_clock)
+{
+    gint64 frame = gdk_frame_clock_get_frame_counter(frame_clock);
+    if (frame == self->sampled_frame) {
+        return self->sampled_progress;
+    }
+
+    GdkFrameTimings *timings = gdk_frame_clock_get_current_timings(frame_clock);
+    gint64 target_us = 0;
+    if (timings != NULL) {
+        target_us = gdk_frame_timings_get_predicted_presentation_time(timings);
+    }
+    if (target_us == 0) {
+        target_us = gdk_frame_clock_get_frame_time(frame_clock);
+    }
+
+    TmSnapshot snapshot;
+    tm_snapshot(sm_get_default()->timer_instance, &snapshot);
+
+    self->sampled_frame = frame;
+    self->sampled_progress = tm_snapshot_progress_at(&snapshot, target_us);
+
+    return self->sampled_progress;
+}
+
 static gboolean on_animate_progress(GtkWidget *widget, GdkFrameClock *frame_clock,
                                     gpointer user_data)
 {
     SamayaWindow *self = SAMAYA_WINDOW(user_data);
 
-    gtk_widget_queue_draw(GTK_WIDGET(self->progress_circle));
+    samaya_progress_ring_set_progress(self->progress_circle,
+                                      sample_frame_progress(self, frame_clock));
 
     return G_SOURCE_CONTINUE;
 }
 
 static void update_animation_state(SamayaWindow *self)
 {
-    TimerPtr timer = sm_get_default()->timer_instance;
-    TmState state = tm_get_state(timer);
+    SessionManagerPtr session_manager = sm_get_default();
+    TmState state = tm_get_state(session_manager->timer_instance);
 
-    if (state == StRunning) {
+    if (state == StRunning && !sm_get_low_power_mode(session_manager)) {
         if (self->tick_callback_id == 0) {
             self->tick_callback_id = gtk_widget_add_tick_callback(GTK_WIDGET(self->progress_circle),
                                                                   on_animate_progress, self, NULL);
@@ -88,7 +134,24 @@ static void update_animation_state(SamayaWindow *self)
             self->tick_callback_id = 0;
         }
 
-        gtk_widget_queue_draw(GTK_WIDGET(self->progress_circle));
+        sync_progress(self);
+    }
+}
+
+// In low power mode the ring is not animated per frame, it is only redrawn from the tick update
+// once the arc has moved by at least a pixel along its circumference.
+static void queue_low_power_redraw(SamayaWindow *self, TimerPtr timer)
+{
+    GtkWidget *widget = GTK_WIDGET(self->progress_circle);
+    int width = gtk_widget_get_width(widget);
+    int height = gtk_widget_get_height(widget);
+
+    double circumference = M_PI * MIN(width, height);
+    gfloat progress = tm_get_progress(timer);
+    gfloat drawn_progress = samaya_progress_ring_get_progress(self->progress_circle);
+
+    if (fabs(progress - drawn_progress) * circumference >= 1.0) {
+        samaya_progress_ring_set_progress(self->progress_circle, progress);
     }
 }
 
@@ -117,6 +180,7 @@ static void sync_progress_style(SamayaWindow *self)
             break;
     }
 
+    sync_progress(self);
     gtk_widget_queue_draw(widget);
 }
 
@@ -124,6 +188,12 @@ static gboolean on_tick_update(gpointer user_data)
 {
     SamayaApplication *app = SAMAYA_APPLICATION(user_data);
     GtkWindow *window = gtk_application_get_active_window(GTK_APPLICATION(app));
+
+    // The timer keeps running, and can be driven from notifications, after the window closed.
+    if (window == NULL) {
+        return G_SOURCE_REMOVE;
+    }
+
     SamayaWindow *self = SAMAYA_WINDOW(window);
 
     SessionManagerPtr session_manager = sm_get_default();
@@ -136,15 +206,27 @@ static gboolean on_tick_update(gpointer user_data)
         char *formatted_time = sm_get_formatted_time(session_manager);
 
         gtk_label_set_text(self->timer_label, formatted_time);
+        metrics_count(MetricLabelUpdates);
+
+        if (sm_get_low_power_mode(session_manager) && tm_get_state(timer) == StRunning) {
+            queue_low_power_redraw(self, timer);
+        }
     }
 
-    char *session_text =
-        g_strdup_printf("#%" G_GUINT64_FORMAT, session_manager->total_sessions_counted);
+    if (session_manager->total_sessions_counted != self->shown_session_count) {
+        char session_text[24];
 
-    gtk_label_set_text(self->sessions_label, session_text);
-    g_free(session_text);
+        self->shown_session_count = session_manager->total_sessions_counted;
+        g_snprintf(session_text, sizeof(session_text), "#%" G_GUINT64_FORMAT,
+                   self->shown_session_count);
+        gtk_label_set_text(self->sessions_label, session_text);
+    }
 
-    sync_button_state(self);
+    if (tm_get_state(timer) != self->shown_state) {
+        sync_button_state(self);
+    } else {
+        update_animation_state(self);
+    }
 
     return G_SOURCE_REMOVE;
 }
@@ -153,6 +235,11 @@ static gboolean sync_routine_selection(gpointer user_data)
 {
     SamayaApplication *app = SAMAYA_APPLICATION(user_data);
     GtkWindow *window = gtk_application_get_active_window(GTK_APPLICATION(app));
+
+    if (window == NULL) {
+        return G_SOURCE_REMOVE;
+    }
+
     SamayaWindow *self = SAMAYA_WINDOW(window);
 
     RoutineType current_routine = sm_get_default()->current_routine;
@@ -192,6 +279,8 @@ static void sync_button_state(SamayaWindow *self)
     GtkWidget *reset_btn_widget = GTK_WIDGET(self->reset_button);
     TmState timer_state = tm_get_state(timer);
 
+    self->shown_state = timer_state;
+
     switch (timer_state) {
         case StRunning:
             gtk_button_set_label(GTK_BUTTON(start_btn_widget), _("Stop"));
@@ -263,13 +352,13 @@ static void on_routine_toggled(AdwToggleGroup *toggle_group, GParamSpec *pspec,
 static void on_action_start_stop(GtkWidget *widget, const char *action_name, GVariant *param)
 {
     SamayaWindow *self = SAMAYA_WINDOW(widget);
-    TimerPtr timer = sm_get_default()->timer_instance;
-    TmState timer_state = tm_get_state(timer);
+    SessionManagerPtr session_manager = sm_get_default();
+    TmState timer_state = tm_get_state(session_manager->timer_instance);
 
     if (timer_state == StRunning) {
-        tm_trigger_event(timer, EvStop);
+        sm_trigger_event(session_manager, EvStop);
     } else {
-        tm_trigger_event(timer, EvStart);
+        sm_trigger_event(session_manager, EvStart);
     }
 
     sync_button_state(self);
@@ -278,9 +367,8 @@ static void on_action_start_stop(GtkWidget *widget, const char *action_name, GVa
 static void on_action_reset(GtkWidget *widget, const char *action_name, GVariant *param)
 {
     SamayaWindow *self = SAMAYA_WINDOW(widget);
-    TimerPtr timer = sm_get_default()->timer_instance;
 
-    tm_trigger_event(timer, EvReset);
+    sm_trigger_event(sm_get_default(), EvReset);
 
     sync_button_state(self);
 }
@@ -294,43 +382,42 @@ static void on_action_skip(GtkWidget *widget, const char *action_name, GVariant
 }
 
 /* ============================================================================
- * Rendering Functions
+ * Samaya Window Methods
  * ============================================================================ */
 
-static void on_progress_draw(GtkDrawingArea *area, cairo_t *cr, int width, int height,
-                             gpointer user_data)
+/*  The label shows seconds, so the timer only needs to tick every second while it can be seen.
+    Otherwise it ticks once a minute, or as often as the tray icon or the launcher entry ask for.
+*/
+static void sync_time_resolution(SamayaWindow *self)
 {
-    double line_width = 10.0;
-
-    double center_x = width / 2.0;
-    double center_y = height / 2.0;
-    double radius = MIN(width, height) / 2.0 - line_width;
-
-    gfloat progress = tm_get_progress(sm_get_default()->timer_instance);
-
-    GdkRGBA color;
-    gtk_widget_get_color(GTK_WIDGET(area), &color);
-
-    cairo_set_line_width(cr, line_width);
-    cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
-
-    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.2);
-    cairo_arc(cr, center_x, center_y, radius, 0, 2 * M_PI);
-    cairo_stroke(cr);
+    SessionManagerPtr session_manager = sm_get_default();
+    if (session_manager == NULL) {
+        return;
+    }
 
+    gboolean seen = gtk_widget_get_mapped(GTK_WIDGET(self)) &&
+                    !gtk_window_is_suspended(GTK_WINDOW(self));
 
-    gdk_cairo_set_source_rgba(cr, &color);
+    sm_set_time_resolution(session_manager,
+                           seen ? TM_TICK_INTERVAL_SECONDS : TM_TICK_INTERVAL_MINUTES);
+}
 
-    double start_angle = -M_PI / 2;
-    double end_angle = start_angle + (2 * M_PI * progress);
-    cairo_arc(cr, center_x, center_y, radius, start_angle, end_angle);
-    cairo_stroke(cr);
+static void on_suspended_changed(GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+    sync_time_resolution(SAMAYA_WINDOW(object));
 }
 
+static void samaya_window_map(GtkWidget *widget)
+{
+    GTK_WIDGET_CLASS(samaya_window_parent_class)->map(widget);
+    sync_time_resolution(SAMAYA_WINDOW(widget));
+}
 
-/* ============================================================================
- * Samaya Window Methods
- * ============================================================================ */
+static void samaya_window_unmap(GtkWidget *widget)
+{
+    GTK_WIDGET_CLASS(samaya_window_parent_class)->unmap(widget);
+    sync_time_resolution(SAMAYA_WINDOW(widget));
+}
 
 static void samaya_window_realize(GtkWidget *widget)
 {
@@ -351,7 +438,11 @@ static void samaya_window_class_init(SamayaWindowClass *klass)
 {
     GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
 
+    g_type_ensure(SAMAYA_TYPE_PROGRESS_RING);
+
     widget_class->realize = samaya_window_realize;
+    widget_class->map = samaya_window_map;
+    widget_class->unmap = samaya_window_unmap;
 
     gtk_widget_class_set_template_from_resource(widget_class,
                                                 "/io/github/redddfoxxyy/samaya/samaya-window.ui");
@@ -375,8 +466,10 @@ static void samaya_window_init(SamayaWindow *self)
 {
     gtk_widget_init_template(GTK_WIDGET(self));
 
-    gtk_drawing_area_set_draw_func(self->progress_circle, on_progress_draw, self, NULL);
+    self->shown_session_count = G_MAXUINT64;
+    self->sampled_frame = -1;
 
     g_signal_connect(self->routine_toggle_group, "notify::active-name",
                      G_CALLBACK(on_routine_toggled), self);
+    g_signal_connect(self, "notify::suspended", G_CALLBACK(on_suspended_changed), NULL);
 }
@@ -0,0 +1,281 @@
+/* test-actions.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  The timer actions behind the completion notification buttons, activated over D-Bus through
+    org.freedesktop.Application.ActivateAction the way a notification server does, on a plain
+    GApplication that never builds a window. +5 min resumes the session that ran out rather than
+    extending the one that followed it.
+*/
+
+#include <gio/gio.h>
+#include "samaya-actions.h"
+#include "samaya-history.h"
+#include "samaya-metrics.h"
+#include "test-common.h"
+
+#define TEST_APP_ID "io.github.redddfoxxyy.samaya.ActionsTest"
+#define TEST_APP_PATH "/io/github/redddfoxxyy/samaya/ActionsTest"
+
+typedef struct
+{
+    TestSession session;
+    GTestDBus *bus;
+    GApplication *app;
+    GDBusConnection *client;
+} ActionsTest;
+
+typedef struct
+{
+    GVariant *reply;
+    GError *error;
+    gboolean done;
+} ActionCall;
+
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static void actions_test_init(ActionsTest *test)
+{
+    g_autoptr(GError) error = NULL;
+
+    test_session_init(&test->session, FALSE);
+
+    test->bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(test->bus);
+
+    test->app = g_application_new(TEST_APP_ID, G_APPLICATION_DEFAULT_FLAGS);
+    actions_add_timer_actions(G_ACTION_MAP(test->app), test->session.session_manager);
+    g_assert_true(g_application_register(test->app, NULL, &error));
+    g_assert_no_error(error);
+
+    test->client = g_dbus_connection_new_for_address_sync(
+        g_test_dbus_get_bus_address(test->bus),
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, &error);
+    g_assert_no_error(error);
+}
+
+static void actions_test_clear(ActionsTest *test)
+{
+    g_clear_object(&test->client);
+    g_clear_object(&test->app);
+    g_test_dbus_down(test->bus);
+    g_clear_object(&test->bus);
+    test_session_clear(&test->session);
+}
+
+static void on_call_done(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    ActionCall *call = user_data;
+
+    call->reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), result, &call->error);
+    call->done = TRUE;
+}
+
+/*  Activates the action from the second connection and waits for the reply. The call is async,
+    as the application handles it on this thread's main context.
+*/
+static void activate_over_dbus(ActionsTest *test, const char *name)
+{
+    ActionCall call = {0};
+
+    g_dbus_connection_call(test->client, TEST_APP_ID, TEST_APP_PATH,
+                           "org.freedesktop.Application", "ActivateAction",
+                           g_variant_new_parsed("(%s, @av [], @a{sv} {})", name), NULL,
+                           G_DBUS_CALL_FLAGS_NONE, -1, NULL, on_call_done, &call);
+
+    while (!call.done) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+
+    g_assert_no_error(call.error);
+    g_variant_unref(call.reply);
+}
+
+static TmState get_state(ActionsTest *test)
+{
+    return tm_get_state(test->session.timer);
+}
+
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_start_pause_skip(void)
+{
+    ActionsTest test = {0};
+    actions_test_init(&test);
+    SessionManagerPtr session_manager = test.session.session_manager;
+
+    activate_over_dbus(&test, "start-timer");
+    g_assert_cmpint(get_state(&test), ==, StRunning);
+
+    // Starting again leaves the running session alone.
+    test_session_run_until(&test.session, test.session.now_us + 60 * G_USEC_PER_SEC);
+    gint64 remaining_ms = tm_get_remaining_time_ms(test.session.timer);
+    activate_over_dbus(&test, "start-timer");
+    g_assert_cmpint(get_state(&test), ==, StRunning);
+    g_assert_cmpint(tm_get_remaining_time_ms(test.session.timer), ==, remaining_ms);
+
+    activate_over_dbus(&test, "pause-timer");
+    g_assert_cmpint(get_state(&test), ==, StPaused);
+
+    activate_over_dbus(&test, "skip-session");
+    g_assert_cmpint(session_manager->current_routine, ==, ShortBreak);
+    g_assert_true(session_manager->last_session_skipped);
+    g_assert_cmpint(get_state(&test), ==, StIdle);
+
+    actions_test_clear(&test);
+}
+
+static void test_extend_resumes_completed_session(void)
+{
+    ActionsTest test = {0};
+    actions_test_init(&test);
+    SessionManagerPtr session_manager = test.session.session_manager;
+
+    activate_over_dbus(&test, "start-timer");
+    test_session_run_out(&test.session);
+    g_assert_cmpint(session_manager->current_routine, ==, ShortBreak);
+    g_assert_cmpuint(session_manager->sessions_completed, ==, 1);
+
+    activate_over_dbus(&test, "extend-session");
+    g_assert_cmpint(session_manager->current_routine, ==, Working);
+    g_assert_cmpuint(session_manager->sessions_completed, ==, 0);
+    g_assert_cmpint(get_state(&test), ==, StRunning);
+    g_assert_cmpuint(tm_get_duration_ms(test.session.timer), ==,
+                     ACTIONS_EXTEND_SESSION_MINUTES * 60 * 1000);
+
+    // Once the extra time ran out, the work session counts once.
+    test_session_run_out(&test.session);
+    g_assert_cmpint(session_manager->current_routine, ==, ShortBreak);
+    g_assert_cmpuint(session_manager->sessions_completed, ==, 1);
+    g_assert_cmpuint(session_manager->total_sessions_counted, ==, 1);
+
+    actions_test_clear(&test);
+}
+
+static void test_extend_records_session_once(void)
+{
+    ActionsTest test = {0};
+    actions_test_init(&test);
+    SessionManagerPtr session_manager = test.session.session_manager;
+    g_autofree gchar *path =
+        g_build_filename(g_get_user_data_dir(), "test-actions", "history", NULL);
+    sm_set_history_path(session_manager, path);
+    guint64 work_sessions = metrics.sessions[Working][0];
+
+    activate_over_dbus(&test, "start-timer");
+    test_session_run_out(&test.session);
+    activate_over_dbus(&test, "extend-session");
+    test_session_run_out(&test.session);
+
+    // Nothing is recorded while the session can still be extended.
+    g_assert_cmpuint(metrics.sessions[Working][0], ==, work_sessions);
+
+    // Starting the break commits to the work session, which is recorded once with the extra time.
+    activate_over_dbus(&test, "start-timer");
+    g_assert_cmpuint(metrics.sessions[Working][0], ==, work_sessions + 1);
+
+    g_autoptr(GError) error = NULL;
+    HistoryReader *reader = history_reader_open(path, 0, G_MAXINT64, &error);
+    g_assert_no_error(error);
+
+    HistoryRecord record;
+    guint32 planned_seconds = (25 + ACTIONS_EXTEND_SESSION_MINUTES) * 60;
+    g_assert_true(history_reader_next(reader, &record));
+    g_assert_cmpuint(record.routine, ==, Working);
+    g_assert_cmpuint(record.flags, ==, 0);
+    g_assert_cmpuint(record.planned_seconds, ==, planned_seconds);
+    g_assert_cmpuint(record.elapsed_seconds, ==, planned_seconds);
+    g_assert_false(history_reader_next(reader, &record));
+    history_reader_free(reader);
+
+    actions_test_clear(&test);
+}
+
+static void test_extend_replaces_auto_started_session(void)
+{
+    ActionsTest test = {0};
+    actions_test_init(&test);
+    SessionManagerPtr session_manager = test.session.session_manager;
+
+    sm_set_auto_start_breaks(session_manager, TRUE);
+    activate_over_dbus(&test, "start-timer");
+
+    // Up to the end of the work session and half a minute into the break that follows.
+    gint64 deadline_us = tm_get_deadline_us(test.session.timer);
+    test_session_run_until(&test.session, deadline_us + 30 * G_USEC_PER_SEC);
+    g_assert_cmpint(session_manager->current_routine, ==, ShortBreak);
+    g_assert_cmpint(get_state(&test), ==, StRunning);
+
+    // The break that started on its own gives way to more of the work session.
+    activate_over_dbus(&test, "extend-session");
+    g_assert_cmpint(session_manager->current_routine, ==, Working);
+    g_assert_cmpint(get_state(&test), ==, StRunning);
+    g_assert_cmpint(tm_get_remaining_time_ms(test.session.timer), ==,
+                    ACTIONS_EXTEND_SESSION_MINUTES * 60 * 1000);
+
+    actions_test_clear(&test);
+}
+
+static void test_extend_ignored_after_next_started(void)
+{
+    ActionsTest test = {0};
+    actions_test_init(&test);
+    SessionManagerPtr session_manager = test.session.session_manager;
+
+    activate_over_dbus(&test, "start-timer");
+    test_session_run_out(&test.session);
+
+    // Starting the break by hand commits to it.
+    activate_over_dbus(&test, "start-timer");
+    activate_over_dbus(&test, "extend-session");
+    g_assert_cmpint(session_manager->current_routine, ==, ShortBreak);
+    g_assert_cmpuint(session_manager->sessions_completed, ==, 1);
+
+    // A skipped session offers no more time either.
+    activate_over_dbus(&test, "skip-session");
+    activate_over_dbus(&test, "extend-session");
+    g_assert_cmpint(session_manager->current_routine, ==, Working);
+    g_assert_cmpint(get_state(&test), ==, StIdle);
+
+    actions_test_clear(&test);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+    g_test_add_func("/actions/start-pause-skip", test_start_pause_skip);
+    g_test_add_func("/actions/extend-resumes-completed-session",
+                    test_extend_resumes_completed_session);
+    g_test_add_func("/actions/extend-records-session-once", test_extend_records_session_once);
+    g_test_add_func("/actions/extend-replaces-auto-started-session",
+                    test_extend_replaces_auto_started_session);
+    g_test_add_func("/actions/extend-ignored-after-next-started",
+                    test_extend_ignored_after_next_started);
+
+    return g_test_run();
+}
@@ -0,0 +1,110 @@
+/* test-common.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <string.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "test-common.h"
+
+// Resident set size when the peak was last reset, in KiB.
+static gint64 reset_rss_kb;
+
+static gint64 test_session_clock(gpointer session_ptr)
+{
+    TestSession *session = session_ptr;
+    return session->now_us;
+}
+
+void test_session_init(TestSession *session, gboolean real_clock)
+{
+    *session = (TestSession) {.now_us = 1};
+
+    session->session_manager = sm_init(4, 25, 5, 15, FALSE, FALSE, NULL, NULL);
+    session->timer = session->session_manager->timer_instance;
+    sm_set_headless(session->session_manager, TRUE);
+
+    if (!real_clock) {
+        tm_set_clock(session->timer, test_session_clock, session);
+    }
+}
+
+void test_session_clear(TestSession *session)
+{
+    g_clear_pointer(&session->session_manager, sm_deinit);
+    session->timer = NULL;
+}
+
+guint test_session_run_until(TestSession *session, gint64 until_us)
+{
+    guint ticks = 0;
+    gint64 wakeup_us;
+
+    while ((wakeup_us = tm_get_next_wakeup_us(session->timer)) >= 0 && wakeup_us <= until_us) {
+        session->now_us = wakeup_us;
+        tm_tick(session->timer);
+        ticks++;
+    }
+
+    return ticks;
+}
+
+guint test_session_run_out(TestSession *session)
+{
+    return test_session_run_until(session, G_MAXINT64);
+}
+
+static gint64 read_status_kb(const char *field)
+{
+    g_autofree gchar *status = NULL;
+    g_assert_true(g_file_get_contents("/proc/self/status", &status, NULL, NULL));
+
+    g_autofree gchar *prefix = g_strconcat("\n", field, ":", NULL);
+    const gchar *line = strstr(status, prefix);
+    g_assert_nonnull(line);
+
+    return g_ascii_strtoll(line + strlen(prefix), NULL, 10);
+}
+
+gboolean test_reset_peak_rss(void)
+{
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+
+    FILE *clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs == NULL) {
+        return FALSE;
+    }
+
+    gboolean reset = fputs("5", clear_refs) >= 0;
+    if (fclose(clear_refs) != 0 || !reset) {
+        return FALSE;
+    }
+
+    reset_rss_kb = read_status_kb("VmRSS");
+    return TRUE;
+}
+
+gint64 test_get_peak_rss_growth_kb(void)
+{
+    return read_status_kb("VmHWM") - reset_rss_kb;
+}
@@ -0,0 +1,57 @@
+/* test-common.h
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include "samaya-session.h"
+#include "samaya-timer.h"
+
+/*  A headless session manager for tests. Sounds, notifications and the history are skipped, and
+    unless the real clock is asked for the timer runs on now_us, advanced by the test.
+*/
+typedef struct
+{
+    SessionManagerPtr session_manager;
+    TimerPtr timer;
+    gint64 now_us;
+} TestSession;
+
+// Sets up session with a 4 x 25 minute work cycle, 5 minute short and 15 minute long breaks.
+void test_session_init(TestSession *session, gboolean real_clock);
+
+void test_session_clear(TestSession *session);
+
+/*  Moves the virtual clock from wakeup to wakeup of the running timer, ticking it each time, until
+    it stops running or the next wakeup would be after until_us. Returns the number of ticks.
+*/
+guint test_session_run_until(TestSession *session, gint64 until_us);
+
+// Runs the current session to its end on the virtual clock. Returns the number of ticks.
+guint test_session_run_out(TestSession *session);
+
+/*  Resets the peak resident set size of the process to the current one, after handing freed heap
+    memory back so later allocations can't hide in it. Returns FALSE where the kernel can't do
+    this, tests measuring memory are skipped then.
+*/
+gboolean test_reset_peak_rss(void);
+
+// Returns by how many KiB the peak resident set size grew since test_reset_peak_rss.
+gint64 test_get_peak_rss_growth_kb(void);
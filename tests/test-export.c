@@ -0,0 +1,131 @@
+/* test-export.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  Exporting a ten year history of ten million sessions streams it: the peak resident memory
+    grows by a small, fixed amount while the records alone would take hundreds of megabytes.
+*/
+
+#define _GNU_SOURCE
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include "samaya-history.h"
+#include "samaya-routine.h"
+#include "test-common.h"
+
+#define TEST_SESSIONS 10000000u
+#define TEST_CHUNK_SESSIONS 100000u
+// 2015-01-01T00:00:00Z, and ten years of sessions from there.
+#define TEST_FIRST_STARTED_AT G_GINT64_CONSTANT(1420070400)
+#define TEST_SPAN_SECONDS (G_GINT64_CONSTANT(3653) * 24 * 60 * 60)
+// Generous for the reader, its current segment and stdio, far below the ~230 MiB of records.
+#define TEST_EXPORT_MEMORY_BUDGET_KB (16 * 1024)
+
+
+#if defined(__linux__)
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static ssize_t count_lines_write(void *cookie, const char *buffer, size_t size)
+{
+    guint64 *lines = cookie;
+
+    for (const char *p = buffer; (p = memchr(p, '\n', size - (p - buffer))) != NULL; p++) {
+        (*lines)++;
+    }
+
+    return size;
+}
+
+// Fills the default history with TEST_SESSIONS evenly spread records, a chunk at a time.
+static void write_history(void)
+{
+    g_autoptr(GArray) chunk =
+        g_array_sized_new(FALSE, FALSE, sizeof(HistoryRecord), TEST_CHUNK_SESSIONS);
+
+    for (guint first = 0; first < TEST_SESSIONS; first += TEST_CHUNK_SESSIONS) {
+        g_array_set_size(chunk, 0);
+
+        for (guint i = first; i < first + TEST_CHUNK_SESSIONS; i++) {
+            HistoryRecord record = {
+                .started_at = TEST_FIRST_STARTED_AT + TEST_SPAN_SECONDS * i / TEST_SESSIONS,
+                .planned_seconds = 25 * 60,
+                .elapsed_seconds = 25 * 60,
+                .routine = i % N_ROUTINES,
+                .flags = i % 7 == 0 ? HISTORY_FLAG_SKIPPED : 0,
+            };
+            g_array_append_val(chunk, record);
+        }
+
+        g_autoptr(GError) error = NULL;
+        history_append_many(NULL, (const HistoryRecord *) chunk->data, chunk->len, &error);
+        g_assert_no_error(error);
+    }
+}
+
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_export_constant_memory(void)
+{
+    if (!test_reset_peak_rss()) {
+        g_test_skip("The peak resident set size can't be reset on this system");
+        return;
+    }
+
+    write_history();
+
+    guint64 lines = 0;
+    FILE *out = fopencookie(&lines, "w", (cookie_io_functions_t) {.write = count_lines_write});
+    g_assert_nonnull(out);
+
+    g_assert_true(test_reset_peak_rss());
+
+    g_autoptr(GError) error = NULL;
+    g_assert_true(history_export(out, HistoryFormatCsv, 0, G_MAXINT64, &error));
+    g_assert_no_error(error);
+
+    gint64 growth_kb = test_get_peak_rss_growth_kb();
+    fclose(out);
+
+    // The header, then one line per session.
+    g_assert_cmpuint(lines, ==, TEST_SESSIONS + 1);
+    g_test_message("Export of %u sessions grew the peak RSS by %" G_GINT64_FORMAT " KiB",
+                   TEST_SESSIONS, growth_kb);
+    g_assert_cmpint(growth_kb, <, TEST_EXPORT_MEMORY_BUDGET_KB);
+}
+
+#endif
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+#if defined(__linux__)
+    g_test_add_func("/export/constant-memory", test_export_constant_memory);
+#endif
+
+    return g_test_run();
+}
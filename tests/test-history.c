@@ -0,0 +1,418 @@
+/* test-history.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  The segmented history over ten years of sessions: older months are compacted while the open
+    one, the month of the wall clock, stays raw even when a later month exists, a one day query
+    costs the same at either end of the history, and a version 1 history.bin is migrated a chunk
+    at a time.
+*/
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "samaya-history-model.h"
+#include "samaya-history.h"
+#include "samaya-routine.h"
+#include "test-common.h"
+
+#define TEST_YEARS 10
+#define TEST_SPAN_SECONDS (G_GINT64_CONSTANT(3653) * 24 * 60 * 60)
+#define TEST_DAY_SECONDS (24 * 60 * 60)
+// About 137 sessions a day.
+#define TEST_SESSIONS 500000u
+#define TEST_RAW_RECORD_SIZE 24
+#define TEST_QUERY_REPEATS 15
+// Scheduling noise on a loaded machine, on top of the ratio between query latencies.
+#define TEST_QUERY_SLACK_US 2000
+
+#define TEST_LEGACY_SESSIONS 2000000u
+// Legacy records are written in shuffled blocks of this many, so chunks are not in order.
+#define TEST_LEGACY_BLOCK 4096u
+// Well above a migration chunk and the largest month, far below the ~46 MiB of records.
+#define TEST_MIGRATION_MEMORY_BUDGET_KB (24 * 1024)
+
+#define TEST_MODEL_SESSIONS 300000u
+
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static gchar *get_history_path(void)
+{
+    return g_build_filename(g_get_user_data_dir(), "test-history", "history", NULL);
+}
+
+static gint64 get_now(void)
+{
+    return g_get_real_time() / G_USEC_PER_SEC;
+}
+
+// The i-th of count sessions spread evenly over the ten years that end at last.
+static HistoryRecord make_record(guint i, guint count, gint64 last)
+{
+    return (HistoryRecord) {
+        .started_at = last - TEST_SPAN_SECONDS + TEST_SPAN_SECONDS * (i + 1) / count,
+        .planned_seconds = 25 * 60,
+        .elapsed_seconds = i % 5 == 0 ? 20 * 60 : 25 * 60,
+        .routine = i % N_ROUTINES,
+        .flags = i % 7 == 0 ? HISTORY_FLAG_SKIPPED : 0,
+    };
+}
+
+static gchar *get_segment_name(gint64 started_at)
+{
+    g_autoptr(GDateTime) date_time = g_date_time_new_from_unix_utc(started_at);
+    return g_date_time_format(date_time, "%Y-%m.seg");
+}
+
+// Reads the encoding of a segment, the u32 after its magic and version.
+static guint32 read_segment_encoding(const gchar *path)
+{
+    g_autofree gchar *contents = NULL;
+    gsize length = 0;
+    guint32 encoding;
+
+    g_assert_true(g_file_get_contents(path, &contents, &length, NULL));
+    g_assert_cmpuint(length, >=, 16);
+    g_assert_cmpmem(contents, 8, "SMYHSEG\n", 8);
+
+    memcpy(&encoding, contents + 12, sizeof(encoding));
+    return GUINT32_FROM_LE(encoding);
+}
+
+// Checks that the open segment is raw and every other one compact, returns their total size.
+static guint64 check_segments(const gchar *path)
+{
+    g_autofree gchar *open_name = get_segment_name(get_now());
+    g_autoptr(GDir) dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+    guint64 total_size = 0;
+    gboolean found_open = FALSE;
+
+    g_assert_nonnull(dir);
+
+    while ((name = g_dir_read_name(dir)) != NULL) {
+        g_autofree gchar *segment_path = g_build_filename(path, name, NULL);
+        GStatBuf stat_buf;
+
+        g_assert_cmpint(g_stat(segment_path, &stat_buf), ==, 0);
+        total_size += stat_buf.st_size;
+
+        if (strcmp(name, open_name) == 0) {
+            found_open = TRUE;
+            g_assert_cmpuint(read_segment_encoding(segment_path), ==, 0);
+        } else {
+            g_assert_cmpuint(read_segment_encoding(segment_path), ==, 1);
+        }
+    }
+
+    g_assert_true(found_open);
+    return total_size;
+}
+
+static gint compare_durations(gconstpointer a, gconstpointer b)
+{
+    gint64 first = *(const gint64 *) a;
+    gint64 second = *(const gint64 *) b;
+
+    return (first > second) - (first < second);
+}
+
+/*  Reads the day starting at since from the history, checking every record against the ones it
+    was written from. Returns the median time a read took over TEST_QUERY_REPEATS.
+*/
+static gint64 time_day_query(const gchar *path, const HistoryRecord *written, guint count,
+                             gint64 since)
+{
+    gint64 until = since + TEST_DAY_SECONDS - 1;
+    gint64 durations[TEST_QUERY_REPEATS];
+    guint expected = 0;
+    guint first = 0;
+
+    while (first < count && written[first].started_at < since) {
+        first++;
+    }
+    while (first + expected < count && written[first + expected].started_at <= until) {
+        expected++;
+    }
+    g_assert_cmpuint(expected, >, 0);
+
+    for (guint repeat = 0; repeat < TEST_QUERY_REPEATS; repeat++) {
+        g_autoptr(GError) error = NULL;
+        HistoryRecord record;
+        guint read = 0;
+
+        gint64 start_us = g_get_monotonic_time();
+        HistoryReader *reader = history_reader_open(path, since, until, &error);
+        g_assert_no_error(error);
+
+        while (history_reader_next(reader, &record)) {
+            g_assert_cmpuint(read, <, expected);
+            g_assert_cmpint(record.started_at, ==, written[first + read].started_at);
+            g_assert_cmpuint(record.elapsed_seconds, ==, written[first + read].elapsed_seconds);
+            g_assert_cmpuint(record.routine, ==, written[first + read].routine);
+            g_assert_cmpuint(record.flags, ==, written[first + read].flags);
+            read++;
+        }
+        history_reader_free(reader);
+        durations[repeat] = g_get_monotonic_time() - start_us;
+
+        g_assert_cmpuint(read, ==, expected);
+    }
+
+    qsort(durations, TEST_QUERY_REPEATS, sizeof(gint64), compare_durations);
+    return durations[TEST_QUERY_REPEATS / 2];
+}
+
+static void write_u32(FILE *file, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    g_assert_cmpuint(fwrite(&value, sizeof(value), 1, file), ==, 1);
+}
+
+// Writes a version 1 history.bin of count sessions, in shuffled blocks, next to the history path.
+static void write_legacy_history(const gchar *path, guint count, gint64 last)
+{
+    g_autofree gchar *parent = g_path_get_dirname(path);
+    g_autofree gchar *legacy_path = g_build_filename(parent, "history.bin", NULL);
+    guint n_blocks = (count + TEST_LEGACY_BLOCK - 1) / TEST_LEGACY_BLOCK;
+    g_autofree guint *blocks = g_new(guint, n_blocks);
+    g_autoptr(GRand) rand = g_rand_new_with_seed(34);
+
+    g_assert_cmpint(g_mkdir_with_parents(parent, 0700), ==, 0);
+
+    for (guint i = 0; i < n_blocks; i++) {
+        blocks[i] = i;
+    }
+    for (guint i = n_blocks - 1; i > 0; i--) {
+        guint j = g_rand_int_range(rand, 0, i + 1);
+        guint block = blocks[i];
+        blocks[i] = blocks[j];
+        blocks[j] = block;
+    }
+
+    FILE *file = g_fopen(legacy_path, "wb");
+    g_assert_nonnull(file);
+
+    g_assert_cmpuint(fwrite("SMYHIST\n", 8, 1, file), ==, 1);
+    write_u32(file, 1);
+    write_u32(file, TEST_RAW_RECORD_SIZE);
+
+    for (guint b = 0; b < n_blocks; b++) {
+        guint first = blocks[b] * TEST_LEGACY_BLOCK;
+
+        for (guint i = first; i < MIN(first + TEST_LEGACY_BLOCK, count); i++) {
+            HistoryRecord record = make_record(i, count, last);
+            guint8 raw[TEST_RAW_RECORD_SIZE] = {0};
+            gint64 started_at = GINT64_TO_LE(record.started_at);
+            guint32 planned = GUINT32_TO_LE(record.planned_seconds);
+            guint32 elapsed = GUINT32_TO_LE(record.elapsed_seconds);
+
+            memcpy(raw, &started_at, sizeof(started_at));
+            memcpy(raw + 8, &planned, sizeof(planned));
+            memcpy(raw + 12, &elapsed, sizeof(elapsed));
+            raw[16] = record.routine;
+            raw[17] = record.flags;
+
+            g_assert_cmpuint(fwrite(raw, sizeof(raw), 1, file), ==, 1);
+        }
+    }
+
+    g_assert_cmpint(fclose(file), ==, 0);
+}
+
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_ten_years(void)
+{
+    g_autofree gchar *path = get_history_path();
+    g_autoptr(GError) error = NULL;
+    gint64 now = get_now();
+    g_autofree HistoryRecord *records = g_new(HistoryRecord, TEST_SESSIONS);
+
+    for (guint i = 0; i < TEST_SESSIONS; i++) {
+        records[i] = make_record(i, TEST_SESSIONS, now);
+    }
+
+    g_assert_true(history_append_many(path, records, TEST_SESSIONS, &error));
+    g_assert_no_error(error);
+
+    guint64 size = check_segments(path);
+    g_test_message("%u sessions take %" G_GUINT64_FORMAT " bytes", TEST_SESSIONS, size);
+    g_assert_cmpuint(size, <, (guint64) TEST_SESSIONS * TEST_RAW_RECORD_SIZE / 2);
+
+    // A month that hasn't started yet must not get the open one compacted.
+    HistoryRecord future = make_record(0, 1, now + 62 * TEST_DAY_SECONDS);
+    g_assert_true(history_append(path, &future, &error));
+    g_assert_no_error(error);
+    check_segments(path);
+
+    // A day in the first, a middle and the last full month.
+    gint64 days[] = {
+        records[0].started_at + 15 * TEST_DAY_SECONDS,
+        now - TEST_SPAN_SECONDS / 2,
+        now - 45 * TEST_DAY_SECONDS,
+    };
+    gint64 fastest_us = G_MAXINT64;
+    gint64 slowest_us = 0;
+
+    for (guint i = 0; i < G_N_ELEMENTS(days); i++) {
+        gint64 since = days[i] - days[i] % TEST_DAY_SECONDS;
+        gint64 query_us = time_day_query(path, records, TEST_SESSIONS, since);
+
+        g_test_message("A one day query %u/%u takes %" G_GINT64_FORMAT " us", i + 1,
+                       (guint) G_N_ELEMENTS(days), query_us);
+        fastest_us = MIN(fastest_us, query_us);
+        slowest_us = MAX(slowest_us, query_us);
+    }
+
+    g_assert_cmpint(slowest_us, <, 3 * fastest_us + TEST_QUERY_SLACK_US);
+}
+
+static void test_legacy_migration(void)
+{
+    g_autofree gchar *path = get_history_path();
+    g_autofree gchar *parent = g_path_get_dirname(path);
+    g_autofree gchar *kept_path = g_build_filename(parent, "history.bin.v1", NULL);
+    g_autofree gchar *staging = g_strconcat(path, ".migrating", NULL);
+    g_autoptr(GError) error = NULL;
+    gint64 now = get_now();
+    // The legacy sessions end a year ago, the append below opens the current month.
+    gint64 last = now - 365 * TEST_DAY_SECONDS;
+
+    write_legacy_history(path, TEST_LEGACY_SESSIONS, last);
+
+    gboolean measure = test_reset_peak_rss();
+    HistoryRecord record = make_record(0, 1, now);
+
+    g_assert_true(history_append(path, &record, &error));
+    g_assert_no_error(error);
+
+    if (measure) {
+        gint64 growth_kb = test_get_peak_rss_growth_kb();
+
+        g_test_message("Migrating %u sessions grew the peak RSS by %" G_GINT64_FORMAT " KiB",
+                       TEST_LEGACY_SESSIONS, growth_kb);
+        g_assert_cmpint(growth_kb, <, TEST_MIGRATION_MEMORY_BUDGET_KB);
+    }
+
+    g_assert_true(g_file_test(kept_path, G_FILE_TEST_IS_REGULAR));
+    g_assert_false(g_file_test(staging, G_FILE_TEST_EXISTS));
+    check_segments(path);
+
+    HistoryReader *reader = history_reader_open(path, 0, G_MAXINT64, &error);
+    g_assert_no_error(error);
+
+    HistoryRecord read;
+    guint count = 0;
+    gint64 previous = G_MININT64;
+
+    while (history_reader_next(reader, &read)) {
+        if (count < TEST_LEGACY_SESSIONS) {
+            HistoryRecord expected = make_record(count, TEST_LEGACY_SESSIONS, last);
+            g_assert_cmpint(read.started_at, ==, expected.started_at);
+            g_assert_cmpuint(read.routine, ==, expected.routine);
+        }
+
+        g_assert_cmpint(read.started_at, >=, previous);
+        previous = read.started_at;
+        count++;
+    }
+    history_reader_free(reader);
+
+    g_assert_cmpuint(count, ==, TEST_LEGACY_SESSIONS + 1);
+}
+
+static void on_model_items_changed(GListModel *model, guint position, guint removed, guint added,
+                                   gpointer user_data)
+{
+    guint *changes = user_data;
+
+    g_assert_cmpuint(position, ==, 0);
+    g_assert_cmpuint(removed, ==, TEST_MODEL_SESSIONS);
+    g_assert_cmpuint(added, ==, g_list_model_get_n_items(model));
+    (*changes)++;
+}
+
+static void test_model_filter(void)
+{
+    g_autofree gchar *path = get_history_path();
+    g_autoptr(GError) error = NULL;
+    gint64 now = get_now();
+    g_autofree HistoryRecord *records = g_new(HistoryRecord, TEST_MODEL_SESSIONS);
+    guint changes = 0;
+
+    for (guint i = 0; i < TEST_MODEL_SESSIONS; i++) {
+        records[i] = make_record(i, TEST_MODEL_SESSIONS, now);
+    }
+
+    g_assert_true(history_append_many(path, records, TEST_MODEL_SESSIONS, &error));
+    g_assert_no_error(error);
+
+    g_autoptr(SamayaHistoryModel) model = samaya_history_model_new(path);
+    GListModel *list = G_LIST_MODEL(model);
+    g_assert_cmpuint(g_list_model_get_n_items(list), ==, TEST_MODEL_SESSIONS);
+    g_signal_connect(model, "items-changed", G_CALLBACK(on_model_items_changed), &changes);
+
+    // Counting a routine is left to a worker, the list keeps its rows until the count is in.
+    samaya_history_model_set_filter(model, 0, G_MAXINT64, 1u << LongBreak);
+    samaya_history_model_set_filter(model, 0, G_MAXINT64, 1u << ShortBreak);
+    g_assert_true(samaya_history_model_is_loading(model));
+    g_assert_cmpuint(g_list_model_get_n_items(list), ==, TEST_MODEL_SESSIONS);
+
+    g_autoptr(SamayaHistoryItem) newest = g_list_model_get_item(list, 0);
+    g_assert_cmpint(samaya_history_item_get_record(newest)->started_at, ==,
+                    records[TEST_MODEL_SESSIONS - 1].started_at);
+
+    while (samaya_history_model_is_loading(model)) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+
+    // The superseded filter never reached the list.
+    g_assert_cmpuint(changes, ==, 1);
+
+    guint expected = 0;
+    for (guint i = 0; i < TEST_MODEL_SESSIONS; i++) {
+        expected += (records[i].routine == ShortBreak);
+    }
+    g_assert_cmpuint(g_list_model_get_n_items(list), ==, expected);
+
+    for (guint position = 0; position < expected; position += expected / 16) {
+        g_autoptr(SamayaHistoryItem) item = g_list_model_get_item(list, position);
+        g_assert_cmpuint(samaya_history_item_get_record(item)->routine, ==, ShortBreak);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+    g_test_add_func("/history/ten-years", test_ten_years);
+    g_test_add_func("/history/legacy-migration", test_legacy_migration);
+    g_test_add_func("/history/model-filter", test_model_filter);
+
+    return g_test_run();
+}
@@ -0,0 +1,253 @@
+/* test-hooks.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  Hook commands run by a headless session: the completion hook sees the session that ended and
+    runs before the start of the next one, a timeout kills everything the command started, output
+    that is large or not UTF-8 is logged in part instead of failing the hook, and a slow hook never
+    holds up the timer.
+*/
+
+#include <string.h>
+#include "samaya-hooks.h"
+#include "test-common.h"
+
+#define TEST_WAIT_SECONDS 10
+#define TEST_HOOK_TIMEOUT_SECONDS 1
+// Three ticks on the real clock, far shorter than the hook that runs alongside.
+#define TEST_SLOW_SESSION_MINUTES (3.0f / 60)
+#define TEST_SLOW_HOOK_SECONDS 10
+#define TEST_SLOW_HOOK_COMMAND "sleep " G_STRINGIFY(TEST_SLOW_HOOK_SECONDS)
+#define TEST_TIMING_TOLERANCE_US (100 * 1000)
+
+typedef struct
+{
+    TestSession session;
+    HooksPtr hooks;
+    gchar *log_path;
+} HookFixture;
+
+typedef struct
+{
+    gint64 started_us;
+    gint64 last_tick_us;
+    gint64 longest_tick_gap_us;
+    gint64 completed_us;
+} SessionTiming;
+
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static void hook_fixture_setup(HookFixture *fixture, gconstpointer data)
+{
+    // data asks for the real clock.
+    test_session_init(&fixture->session, GPOINTER_TO_INT(data));
+
+    fixture->hooks = hooks_new(fixture->session.session_manager);
+    hooks_set_limits(fixture->hooks, 1, TEST_HOOK_TIMEOUT_SECONDS);
+    fixture->log_path = g_build_filename(g_get_user_state_dir(), "samaya", "hooks.log", NULL);
+}
+
+static void hook_fixture_teardown(HookFixture *fixture, gconstpointer data)
+{
+    g_clear_pointer(&fixture->hooks, hooks_free);
+    test_session_clear(&fixture->session);
+    g_free(fixture->log_path);
+}
+
+// Runs the main loop until the file at path contains needle, and returns its contents.
+static gchar *wait_for_text(const gchar *path, const gchar *needle)
+{
+    gint64 deadline_us = g_get_monotonic_time() + TEST_WAIT_SECONDS * G_USEC_PER_SEC;
+
+    for (;;) {
+        gchar *contents = NULL;
+
+        if (g_file_get_contents(path, &contents, NULL, NULL) && strstr(contents, needle) != NULL) {
+            return contents;
+        }
+        g_free(contents);
+
+        if (g_get_monotonic_time() > deadline_us) {
+            g_error("%s did not show up in %s within %d seconds", needle, path, TEST_WAIT_SECONDS);
+        }
+
+        while (g_main_context_iteration(NULL, FALSE)) {
+        }
+        g_usleep(10 * 1000);
+    }
+}
+
+static void on_timing_tick(SessionManagerPtr session_manager, gpointer user_data)
+{
+    SessionTiming *timing = user_data;
+    gint64 now_us = g_get_monotonic_time();
+
+    timing->longest_tick_gap_us = MAX(timing->longest_tick_gap_us, now_us - timing->last_tick_us);
+    timing->last_tick_us = now_us;
+}
+
+static void on_timing_complete(SessionManagerPtr session_manager, gpointer user_data)
+{
+    SessionTiming *timing = user_data;
+    timing->completed_us = g_get_monotonic_time();
+}
+
+// Returns FALSE once pid is gone or a zombie, which has nothing left to run.
+static gboolean process_is_running(gint64 pid)
+{
+    g_autofree gchar *stat_path = g_strdup_printf("/proc/%" G_GINT64_FORMAT "/stat", pid);
+    g_autofree gchar *stat = NULL;
+
+    if (!g_file_get_contents(stat_path, &stat, NULL, NULL)) {
+        return FALSE;
+    }
+
+    // The state follows the parenthesized command name, which may contain spaces.
+    const gchar *state = strrchr(stat, ')');
+    return state != NULL && state[1] == ' ' && state[2] != 'Z';
+}
+
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_complete_before_next_start(HookFixture *fixture, gconstpointer data)
+{
+    SessionManagerPtr session_manager = fixture->session.session_manager;
+    g_autofree gchar *events_path = g_build_filename(g_get_user_cache_dir(), "events", NULL);
+    g_autofree gchar *quoted_path = g_shell_quote(events_path);
+    g_autofree gchar *command = g_strdup_printf(
+        "echo \"$SAMAYA_EVENT $SAMAYA_ROUTINE $SAMAYA_DURATION_MS $SAMAYA_REMAINING_MS\" >> %s",
+        quoted_path);
+
+    g_mkdir_with_parents(g_get_user_cache_dir(), 0700);
+    hooks_set_command(fixture->hooks, HookWorkStart, command);
+    hooks_set_command(fixture->hooks, HookBreakStart, command);
+    hooks_set_command(fixture->hooks, HookComplete, command);
+    sm_set_auto_start_breaks(session_manager, TRUE);
+
+    // Only the work session runs out, the break that starts on its own is never ticked.
+    sm_trigger_event(session_manager, EvStart);
+    test_session_run_until(&fixture->session, tm_get_deadline_us(fixture->session.timer));
+    g_assert_cmpint(session_manager->current_routine, ==, ShortBreak);
+
+    g_autofree gchar *events = wait_for_text(events_path, "break-start");
+    g_auto(GStrv) lines = g_strsplit(events, "\n", -1);
+
+    // One hook at a time, so the lines are in the order the hooks were queued.
+    g_assert_cmpuint(g_strv_length(lines), ==, 4);
+    g_assert_true(g_str_has_prefix(lines[0], "work-start work 1500000 "));
+    g_assert_cmpstr(lines[1], ==, "complete work 1500000 0");
+    g_assert_true(g_str_has_prefix(lines[2], "break-start short-break 300000 "));
+    g_assert_cmpstr(lines[3], ==, "");
+}
+
+static void test_slow_hook_does_not_delay_timer(HookFixture *fixture, gconstpointer data)
+{
+    SessionManagerPtr session_manager = fixture->session.session_manager;
+    SessionTiming timing = {0};
+
+    // No timeout, the queued completion hook waits the whole time behind the start hook.
+    hooks_set_limits(fixture->hooks, 1, 0);
+    hooks_set_command(fixture->hooks, HookWorkStart, TEST_SLOW_HOOK_COMMAND);
+    hooks_set_command(fixture->hooks, HookComplete, TEST_SLOW_HOOK_COMMAND);
+    sm_set_work_duration(session_manager, TEST_SLOW_SESSION_MINUTES);
+
+    gulong tick_id = sm_connect_time_changed(session_manager, on_timing_tick, &timing);
+    gulong complete_id = sm_connect_session_complete(session_manager, on_timing_complete, &timing);
+
+    timing.started_us = timing.last_tick_us = g_get_monotonic_time();
+    sm_trigger_event(session_manager, EvStart);
+    gint64 deadline_us = tm_get_deadline_us(fixture->session.timer);
+
+    while (timing.completed_us == 0) {
+        g_assert_cmpint(g_get_monotonic_time() - timing.started_us, <,
+                        TEST_WAIT_SECONDS * G_USEC_PER_SEC);
+        g_main_context_iteration(NULL, TRUE);
+    }
+
+    // The session ticked every second and ended on time while the start hook was still running.
+    g_assert_cmpint(timing.longest_tick_gap_us, <, G_USEC_PER_SEC + TEST_TIMING_TOLERANCE_US);
+    g_assert_cmpint(timing.completed_us, >=, deadline_us);
+    g_assert_cmpint(timing.completed_us - deadline_us, <, TEST_TIMING_TOLERANCE_US);
+    g_assert_cmpint(timing.completed_us - timing.started_us, <, TEST_SLOW_HOOK_SECONDS * G_USEC_PER_SEC);
+
+    sm_disconnect_time_changed(session_manager, tick_id);
+    sm_disconnect_session_complete(session_manager, complete_id);
+}
+
+static void test_timeout_kills_process_group(HookFixture *fixture, gconstpointer data)
+{
+    g_autofree gchar *pid_path = g_build_filename(g_get_user_cache_dir(), "pid", NULL);
+    g_autofree gchar *quoted_path = g_shell_quote(pid_path);
+    // The background sleep keeps the output pipe open after the shell is gone.
+    g_autofree gchar *command = g_strdup_printf("sleep 60 & echo $! > %s; wait", quoted_path);
+
+    g_mkdir_with_parents(g_get_user_cache_dir(), 0700);
+    hooks_set_command(fixture->hooks, HookWorkStart, command);
+    sm_trigger_event(fixture->session.session_manager, EvStart);
+
+    g_autofree gchar *log = wait_for_text(fixture->log_path, "killed after 1 seconds");
+    g_autofree gchar *pid_text = NULL;
+    g_assert_true(g_file_get_contents(pid_path, &pid_text, NULL, NULL));
+
+    gint64 pid = g_ascii_strtoll(pid_text, NULL, 10);
+    gint64 deadline_us = g_get_monotonic_time() + TEST_WAIT_SECONDS * G_USEC_PER_SEC;
+    g_assert_cmpint(pid, >, 0);
+
+    while (process_is_running(pid)) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline_us);
+        g_usleep(10 * 1000);
+    }
+}
+
+static void test_output_is_bounded(HookFixture *fixture, gconstpointer data)
+{
+    // Invalid UTF-8 first, then more than the 64 KiB that are logged.
+    hooks_set_command(fixture->hooks, HookWorkStart, "printf '\\377\\376'; yes | head -c 100000");
+    sm_trigger_event(fixture->session.session_manager, EvStart);
+
+    g_autofree gchar *log = wait_for_text(fixture->log_path, "[output truncated]");
+
+    g_assert_nonnull(strstr(log, "exited with status 0"));
+    // U+FFFD replaces the invalid bytes.
+    g_assert_nonnull(strstr(log, "\xef\xbf\xbd"));
+    g_assert_true(g_utf8_validate(log, -1, NULL));
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+    g_test_add("/hooks/complete-before-next-start", HookFixture, NULL, hook_fixture_setup,
+               test_complete_before_next_start, hook_fixture_teardown);
+    g_test_add("/hooks/timeout-kills-process-group", HookFixture, NULL, hook_fixture_setup,
+               test_timeout_kills_process_group, hook_fixture_teardown);
+    g_test_add("/hooks/output-is-bounded", HookFixture, NULL, hook_fixture_setup,
+               test_output_is_bounded, hook_fixture_teardown);
+    // Last, the hook it leaves running outlives the test.
+    g_test_add("/hooks/slow-hook-does-not-delay-timer", HookFixture, GINT_TO_POINTER(TRUE),
+               hook_fixture_setup, test_slow_hook_does_not_delay_timer, hook_fixture_teardown);
+
+    return g_test_run();
+}
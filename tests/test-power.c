@@ -0,0 +1,294 @@
+/* test-power.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  Low power mode driven by a fake power profile monitor: the session follows the power saver
+    setting, asks the window to drop the ring animation, and still completes on its deadline with
+    the second-granular ticks of low power mode.
+*/
+
+#include <gio/gio.h>
+#include "test-common.h"
+
+// A session short enough to run on the real clock, with a coarse tick before the precise one.
+#define TEST_SHORT_SESSION_MINUTES (3.0 / 60)
+#define TEST_COMPLETION_TOLERANCE_US (50 * 1000)
+// How long the timekeeping thread may take to pick up its timer slack.
+#define TEST_SLACK_TIMEOUT_US (500 * 1000)
+
+
+/* ============================================================================
+ * Fake Power Profile Monitor
+ * ============================================================================ */
+
+#define TEST_TYPE_POWER_MONITOR (test_power_monitor_get_type())
+
+G_DECLARE_FINAL_TYPE(TestPowerMonitor, test_power_monitor, TEST, POWER_MONITOR, GObject)
+
+struct _TestPowerMonitor
+{
+    GObject parent_instance;
+
+    gboolean power_saver;
+};
+
+enum
+{
+    PROP_0,
+    PROP_POWER_SAVER_ENABLED,
+};
+
+static gboolean test_power_monitor_initable_init(GInitable *initable, GCancellable *cancellable,
+                                                 GError **error)
+{
+    return TRUE;
+}
+
+static void test_power_monitor_initable_iface_init(GInitableIface *iface)
+{
+    iface->init = test_power_monitor_initable_init;
+}
+
+static void test_power_monitor_iface_init(GPowerProfileMonitorInterface *iface)
+{
+}
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(TestPowerMonitor, test_power_monitor, G_TYPE_OBJECT,
+                              G_IMPLEMENT_INTERFACE(G_TYPE_INITABLE,
+                                                    test_power_monitor_initable_iface_init)
+                                  G_IMPLEMENT_INTERFACE(G_TYPE_POWER_PROFILE_MONITOR,
+                                                        test_power_monitor_iface_init))
+
+static void test_power_monitor_get_property(GObject *object, guint prop_id, GValue *value,
+                                            GParamSpec *pspec)
+{
+    TestPowerMonitor *self = TEST_POWER_MONITOR(object);
+
+    switch (prop_id) {
+        case PROP_POWER_SAVER_ENABLED:
+            g_value_set_boolean(value, self->power_saver);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void test_power_monitor_class_init(TestPowerMonitorClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+    object_class->get_property = test_power_monitor_get_property;
+
+    g_object_class_override_property(object_class, PROP_POWER_SAVER_ENABLED,
+                                     "power-saver-enabled");
+}
+
+static void test_power_monitor_init(TestPowerMonitor *self)
+{
+}
+
+static void test_power_monitor_set_power_saver(TestPowerMonitor *self, gboolean power_saver)
+{
+    self->power_saver = power_saver;
+    g_object_notify(G_OBJECT(self), "power-saver-enabled");
+}
+
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static gboolean count_tick_updates(gpointer counter_ptr)
+{
+    (*(guint *) counter_ptr)++;
+    return G_SOURCE_REMOVE;
+}
+
+static void drain_main_context(void)
+{
+    while (g_main_context_iteration(NULL, FALSE)) {
+    }
+}
+
+static void test_follows_power_saver(void)
+{
+    TestSession session;
+    test_session_init(&session, FALSE);
+
+    SessionManagerPtr session_manager = session.session_manager;
+    g_autoptr(TestPowerMonitor) monitor = g_object_new(TEST_TYPE_POWER_MONITOR, NULL);
+
+    sm_set_power_profile_monitor(session_manager, G_POWER_PROFILE_MONITOR(monitor));
+    g_assert_false(sm_get_low_power_mode(session_manager));
+    g_assert_false(session.timer->low_power);
+
+    test_power_monitor_set_power_saver(monitor, TRUE);
+    g_assert_true(sm_get_low_power_mode(session_manager));
+    g_assert_true(session.timer->low_power);
+
+    test_power_monitor_set_power_saver(monitor, FALSE);
+    g_assert_false(sm_get_low_power_mode(session_manager));
+    g_assert_false(session.timer->low_power);
+
+    // Dropping the monitor restores full fidelity, and later changes are no longer followed.
+    test_power_monitor_set_power_saver(monitor, TRUE);
+    sm_set_power_profile_monitor(session_manager, NULL);
+    g_assert_false(sm_get_low_power_mode(session_manager));
+
+    test_power_monitor_set_power_saver(monitor, FALSE);
+    test_power_monitor_set_power_saver(monitor, TRUE);
+    g_assert_false(sm_get_low_power_mode(session_manager));
+
+    test_session_clear(&session);
+}
+
+// The window drops and restores its per-frame ring animation from the tick update.
+static void test_notifies_view(void)
+{
+    TestSession session;
+    test_session_init(&session, FALSE);
+
+    SessionManagerPtr session_manager = session.session_manager;
+    g_autoptr(TestPowerMonitor) monitor = g_object_new(TEST_TYPE_POWER_MONITOR, NULL);
+    guint tick_updates = 0;
+
+    session_manager->sm_timer_tick_callback = count_tick_updates;
+    session_manager->user_data = &tick_updates;
+
+    sm_set_power_profile_monitor(session_manager, G_POWER_PROFILE_MONITOR(monitor));
+    drain_main_context();
+    tick_updates = 0;
+
+    test_power_monitor_set_power_saver(monitor, TRUE);
+    drain_main_context();
+    g_assert_cmpuint(tick_updates, ==, 1);
+
+    test_power_monitor_set_power_saver(monitor, FALSE);
+    drain_main_context();
+    g_assert_cmpuint(tick_updates, ==, 2);
+
+    session_manager->sm_timer_tick_callback = NULL;
+    test_session_clear(&session);
+}
+
+#if defined(__linux__)
+// The timer slack of the first thread called name, or of the process for NULL, or -1.
+static gint64 read_timer_slack_ns(const gchar *name)
+{
+    g_autofree gchar *slack = NULL;
+
+    if (name == NULL) {
+        return g_file_get_contents("/proc/self/timerslack_ns", &slack, NULL, NULL)
+                   ? g_ascii_strtoll(slack, NULL, 10)
+                   : -1;
+    }
+
+    g_autoptr(GDir) dir = g_dir_open("/proc/self/task", 0, NULL);
+    const gchar *task;
+
+    g_assert_nonnull(dir);
+    while ((task = g_dir_read_name(dir)) != NULL) {
+        g_autofree gchar *comm_path = g_build_filename("/proc/self/task", task, "comm", NULL);
+        g_autofree gchar *comm = NULL;
+
+        if (!g_file_get_contents(comm_path, &comm, NULL, NULL) ||
+            g_strcmp0(g_strchomp(comm), name) != 0) {
+            continue;
+        }
+
+        // The slack of a thread is only exposed in its own directory at the top of /proc.
+        g_autofree gchar *slack_path = g_build_filename("/proc", task, "timerslack_ns", NULL);
+        return g_file_get_contents(slack_path, &slack, NULL, NULL)
+                   ? g_ascii_strtoll(slack, NULL, 10)
+                   : -1;
+    }
+
+    return -1;
+}
+
+// The thread applies its slack on its own, give it a moment to do so.
+static gint64 wait_for_timer_slack_ns(const gchar *name, gint64 slack_ns)
+{
+    gint64 until_us = g_get_monotonic_time() + TEST_SLACK_TIMEOUT_US;
+    gint64 current_ns;
+
+    while ((current_ns = read_timer_slack_ns(name)) != slack_ns &&
+           g_get_monotonic_time() < until_us) {
+        g_usleep(1000);
+    }
+
+    return current_ns;
+}
+#endif
+
+static void on_real_session_complete(SessionManagerPtr session_manager, gpointer completed_us)
+{
+    *(gint64 *) completed_us = g_get_monotonic_time();
+}
+
+/*  On the real clock, the coarse ticks of low power mode still end the session on its deadline.
+    On Linux the timekeeping thread sleeps with the low power timer slack until the last tick.
+*/
+static void test_completes_on_deadline(void)
+{
+    TestSession session;
+    test_session_init(&session, TRUE);
+
+    SessionManagerPtr session_manager = session.session_manager;
+    g_autoptr(TestPowerMonitor) monitor = g_object_new(TEST_TYPE_POWER_MONITOR, NULL);
+    gint64 completed_us = 0;
+
+    test_power_monitor_set_power_saver(monitor, TRUE);
+    sm_set_power_profile_monitor(session_manager, G_POWER_PROFILE_MONITOR(monitor));
+    sm_connect_session_complete(session_manager, on_real_session_complete, &completed_us);
+
+    sm_set_work_duration(session_manager, TEST_SHORT_SESSION_MINUTES);
+    sm_trigger_event(session_manager, EvStart);
+    gint64 deadline_us = tm_get_deadline_us(session.timer);
+
+#if defined(__linux__)
+    gint64 default_slack_ns = read_timer_slack_ns(NULL);
+    g_assert_cmpint(wait_for_timer_slack_ns("samaya-timer", TM_LOW_POWER_SLACK_MS * 1000000),
+                    ==, TM_LOW_POWER_SLACK_MS * 1000000);
+#endif
+
+    while (completed_us == 0) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+
+    g_assert_cmpint(completed_us, >=, deadline_us);
+    g_assert_cmpint(completed_us - deadline_us, <, TEST_COMPLETION_TOLERANCE_US);
+#if defined(__linux__)
+    g_assert_cmpint(wait_for_timer_slack_ns("samaya-timer", default_slack_ns), ==,
+                    default_slack_ns);
+#endif
+
+    test_session_clear(&session);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+    g_test_add_func("/power/follows-power-saver", test_follows_power_saver);
+    g_test_add_func("/power/notifies-view", test_notifies_view);
+    g_test_add_func("/power/completes-on-deadline", test_completes_on_deadline);
+
+    return g_test_run();
+}
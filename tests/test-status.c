@@ -0,0 +1,130 @@
+/* test-status.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  The shared status page: a reader polling it while the writer republishes as fast as it can
+    never sees a mix of two publishes, and the page is marked as exited when it is freed.
+*/
+
+#include "samaya-status.h"
+#include "test-common.h"
+
+#define TEST_PUBLISHES 2000000u
+
+
+#if defined(G_OS_UNIX)
+#include "samaya-status-reader.h"
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+typedef struct
+{
+    TestSession session;
+    StatusPagePtr status_page;
+    gint done;
+} TornReadTest;
+
+static gchar *get_status_path(void)
+{
+    return g_build_filename(g_get_user_runtime_dir(), "samaya", "status", NULL);
+}
+
+/*  Publishes session states whose fields are tied together, sessions_to_complete and the routine
+    both follow from sessions_completed, so a read mixing two publishes breaks the relation.
+*/
+static gpointer publish_thread(gpointer user_data)
+{
+    TornReadTest *test = user_data;
+    SessionManagerPtr session_manager = test->session.session_manager;
+
+    for (guint i = 0; i < TEST_PUBLISHES; i++) {
+        guint8 completed = (guint8) i;
+
+        session_manager->sessions_completed = completed;
+        session_manager->sessions_to_complete = (guint8) (completed * 7 + 3);
+        session_manager->current_routine = completed % N_ROUTINES;
+        status_page_publish(test->status_page);
+    }
+
+    g_atomic_int_set(&test->done, TRUE);
+    return NULL;
+}
+
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_no_torn_reads(void)
+{
+    TornReadTest test = {0};
+    g_autofree gchar *path = get_status_path();
+    SamayaStatusReader reader;
+    SamayaStatusSnapshot snapshot;
+    guint64 reads = 0;
+    guint64 busy = 0;
+
+    test_session_init(&test.session, FALSE);
+    test.status_page = status_page_new(test.session.session_manager);
+    g_assert_nonnull(test.status_page);
+    g_assert_cmpint(samaya_status_reader_open(&reader, path), ==, 0);
+
+    GThread *writer = g_thread_new("status-writer", publish_thread, &test);
+
+    while (!g_atomic_int_get(&test.done)) {
+        if (samaya_status_reader_read(&reader, &snapshot) != 0) {
+            busy++;
+            continue;
+        }
+
+        g_assert_cmpuint(snapshot.sessions_to_complete, ==,
+                         (guint8) (snapshot.sessions_completed * 7 + 3));
+        g_assert_cmpuint(snapshot.routine, ==, snapshot.sessions_completed % N_ROUTINES);
+        g_assert_cmpuint(snapshot.state, ==, SAMAYA_STATUS_IDLE);
+        reads++;
+    }
+    g_thread_join(writer);
+
+    g_test_message("%" G_GUINT64_FORMAT " consistent reads, %" G_GUINT64_FORMAT
+                   " gave up on a busy page",
+                   reads, busy);
+    g_assert_cmpuint(reads, >, 0);
+
+    status_page_free(test.status_page);
+    g_assert_cmpint(samaya_status_reader_read(&reader, &snapshot), ==, 0);
+    g_assert_cmpuint(snapshot.state, ==, SAMAYA_STATUS_EXITED);
+
+    samaya_status_reader_close(&reader);
+    test_session_clear(&test.session);
+}
+
+#endif
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+#if defined(G_OS_UNIX)
+    g_test_add_func("/status/no-torn-reads", test_no_torn_reads);
+#endif
+
+    return g_test_run();
+}
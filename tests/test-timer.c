@@ -0,0 +1,295 @@
+/* test-timer.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  The timekeeping thread: a timer expires on its deadline while the owner main loop is stalled,
+    delivers the completion to the owner once that loop runs again, and only starts its thread
+    when it first runs on the real clock. A session rings and the next one starts on time through
+    the same stall. Readers of tm_snapshot on other threads never see a mix of two ticks.
+*/
+
+#include "samaya-metrics.h"
+#include "samaya-timer.h"
+#include "test-common.h"
+
+// One second, and a break that outlasts the stall.
+#define TEST_SESSION_MINUTES (1.0f / 60)
+#define TEST_BREAK_MINUTES 1.0
+// How long the owner thread is blocked, well past the end of the session.
+#define TEST_STALL_US (2 * G_USEC_PER_SEC)
+#define TEST_EXPIRY_TOLERANCE_US (5 * 1000)
+
+#define TEST_SNAPSHOT_READERS 3
+// Ticks one millisecond apart, well within the session so it never runs out.
+#define TEST_SNAPSHOT_TICKS 2000000
+#define TEST_SNAPSHOT_MINUTES 60.0f
+
+// Written by the timer callbacks, which carry no user data.
+static gint64 expired_us;
+static GThread *expired_thread;
+static gint64 completed_us;
+static GThread *completed_thread;
+
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static void on_expired(gpointer timer_ptr)
+{
+    __atomic_store_n(&expired_thread, g_thread_self(), __ATOMIC_RELAXED);
+    __atomic_store_n(&expired_us, g_get_monotonic_time(), __ATOMIC_RELEASE);
+}
+
+static void on_complete(gpointer timer_ptr)
+{
+    completed_thread = g_thread_self();
+    completed_us = g_get_monotonic_time();
+}
+
+typedef struct
+{
+    TimerPtr timer;
+    gint64 now_us;
+    gint64 deadline_us;
+    gint done;
+
+    guint64 reads;
+    guint64 torn_reads;
+} SnapshotTest;
+
+static gint64 snapshot_test_clock(gpointer test_ptr)
+{
+    SnapshotTest *test = test_ptr;
+    return test->now_us;
+}
+
+/*  Every tick publishes a remaining time, the progress computed from it and the time it was taken
+    at, which always add up to the same deadline. A snapshot where they disagree mixes two ticks.
+*/
+static gpointer read_snapshots(gpointer test_ptr)
+{
+    SnapshotTest *test = test_ptr;
+    TmSnapshot snapshot;
+    guint64 reads = 0;
+    guint64 torn_reads = 0;
+
+    while (!g_atomic_int_get(&test->done)) {
+        tm_snapshot(test->timer, &snapshot);
+        reads++;
+
+        if (snapshot.state != StRunning || snapshot.remaining_ms > snapshot.duration_ms ||
+            snapshot.progress != (gfloat) snapshot.remaining_ms / (gfloat) snapshot.duration_ms ||
+            snapshot.updated_us + (gint64) snapshot.remaining_ms * 1000 != test->deadline_us) {
+            torn_reads++;
+        }
+    }
+
+    __atomic_fetch_add(&test->reads, reads, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&test->torn_reads, torn_reads, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static guint64 count_completions_rung(void)
+{
+    guint64 count = 0;
+
+    for (guint i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        count += __atomic_load_n(&metrics.histogram_buckets[MetricCompletionLateness][i],
+                                 __ATOMIC_RELAXED);
+    }
+
+    return count;
+}
+
+#if defined(__linux__)
+static guint count_threads(void)
+{
+    g_autoptr(GDir) dir = g_dir_open("/proc/self/task", 0, NULL);
+    guint threads = 0;
+
+    g_assert_nonnull(dir);
+    while (g_dir_read_name(dir) != NULL) {
+        threads++;
+    }
+
+    return threads;
+}
+#endif
+
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_expires_while_owner_stalls(void)
+{
+    expired_us = completed_us = 0;
+    expired_thread = completed_thread = NULL;
+
+    TimerPtr timer = tm_new(TEST_SESSION_MINUTES, on_complete, NULL, NULL);
+    tm_set_timekeeping_callbacks(timer, NULL, on_expired);
+
+    tm_trigger_event(timer, EvStart);
+    gint64 deadline_us = tm_get_deadline_us(timer);
+
+    // Block the owner thread the way a busy UI would, nothing is dispatched on it meanwhile.
+    g_usleep(TEST_STALL_US);
+
+    gint64 expired_at_us = __atomic_load_n(&expired_us, __ATOMIC_ACQUIRE);
+    g_assert_cmpint(expired_at_us, >=, deadline_us);
+    g_assert_cmpint(expired_at_us - deadline_us, <, TEST_EXPIRY_TOLERANCE_US);
+    g_assert_true(__atomic_load_n(&expired_thread, __ATOMIC_RELAXED) != g_thread_self());
+    g_assert_cmpint(tm_get_state(timer), ==, StIdle);
+
+    // The completion waits for the owner context, and is handled on its thread.
+    g_assert_cmpint(completed_us, ==, 0);
+    while (completed_us == 0) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_true(completed_thread == g_thread_self());
+
+    tm_free(timer);
+}
+
+static void test_session_rings_while_owner_stalls(void)
+{
+    TestSession session;
+    test_session_init(&session, TRUE);
+    SessionManagerPtr session_manager = session.session_manager;
+
+    sm_set_work_duration(session_manager, TEST_SESSION_MINUTES);
+    sm_set_short_break_duration(session_manager, TEST_BREAK_MINUTES);
+    sm_set_auto_start_breaks(session_manager, TRUE);
+
+    guint64 rung = count_completions_rung();
+    guint64 lateness_us =
+        __atomic_load_n(&metrics.histogram_sums_us[MetricCompletionLateness], __ATOMIC_RELAXED);
+
+    sm_trigger_event(session_manager, EvStart);
+    gint64 deadline_us = tm_get_deadline_us(session.timer);
+
+    g_usleep(TEST_STALL_US);
+
+    // The bell and the notification went out from the timekeeping thread, on time.
+    g_assert_cmpuint(count_completions_rung(), ==, rung + 1);
+    lateness_us =
+        __atomic_load_n(&metrics.histogram_sums_us[MetricCompletionLateness], __ATOMIC_RELAXED) -
+        lateness_us;
+    g_assert_cmpuint(lateness_us, <, TEST_EXPIRY_TOLERANCE_US);
+
+    // The break started on the deadline of the work session, before the owner heard of either.
+    TmSnapshot snapshot;
+    tm_snapshot(session.timer, &snapshot);
+    g_assert_cmpint(snapshot.state, ==, StRunning);
+    g_assert_cmpuint(snapshot.duration_ms, ==, (guint64) (TEST_BREAK_MINUTES * 60 * 1000));
+    g_assert_cmpint(snapshot.updated_us + (gint64) snapshot.remaining_ms * 1000, ==,
+                    deadline_us + (gint64) snapshot.duration_ms * 1000);
+    g_assert_cmpint(session_manager->current_routine, ==, Working);
+
+    // The owner catches up with the routine once its loop runs again, and keeps the break going.
+    while (session_manager->current_routine == Working) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpint(session_manager->current_routine, ==, ShortBreak);
+    g_assert_cmpint(tm_get_state(session.timer), ==, StRunning);
+    g_assert_cmpuint(session_manager->last_session_duration_ms, ==,
+                     (guint64) (TEST_SESSION_MINUTES * 60 * 1000));
+    g_assert_cmpuint(session_manager->last_session_remaining_ms, ==, 0);
+
+    test_session_clear(&session);
+}
+
+static void test_thread_starts_on_first_run(void)
+{
+#if defined(__linux__)
+    guint threads = count_threads();
+
+    TimerPtr idle_timer = tm_new(TEST_SESSION_MINUTES, NULL, NULL, NULL);
+    g_assert_cmpuint(count_threads(), ==, threads);
+    tm_free(idle_timer);
+
+    // Driven through tm_tick, a timer on an injected clock never needs the thread either.
+    TestSession session;
+    test_session_init(&session, FALSE);
+    threads = count_threads();
+    sm_trigger_event(session.session_manager, EvStart);
+    test_session_run_out(&session);
+    g_assert_cmpuint(count_threads(), ==, threads);
+    test_session_clear(&session);
+
+    threads = count_threads();
+    TimerPtr timer = tm_new(TEST_SESSION_MINUTES, NULL, NULL, NULL);
+    tm_trigger_event(timer, EvStart);
+    g_assert_cmpuint(count_threads(), ==, threads + 1);
+    tm_free(timer);
+#else
+    g_test_skip("Counting threads needs /proc");
+#endif
+}
+
+/*  Build with -Db_sanitize=thread to also have ThreadSanitizer check the seqlock, it understands
+    the release and acquire orders the snapshot is published with.
+*/
+static void test_snapshot_no_torn_reads(void)
+{
+    SnapshotTest test = {.now_us = 1};
+    GThread *readers[TEST_SNAPSHOT_READERS];
+
+    test.timer = tm_new(TEST_SNAPSHOT_MINUTES, NULL, NULL, NULL);
+    tm_set_clock(test.timer, snapshot_test_clock, &test);
+    tm_trigger_event(test.timer, EvStart);
+    test.deadline_us = tm_get_deadline_us(test.timer);
+
+    for (guint i = 0; i < TEST_SNAPSHOT_READERS; i++) {
+        readers[i] = g_thread_new("test-snapshot-reader", read_snapshots, &test);
+    }
+
+    for (guint i = 0; i < TEST_SNAPSHOT_TICKS; i++) {
+        test.now_us += 1000;
+        tm_tick(test.timer);
+    }
+
+    g_atomic_int_set(&test.done, TRUE);
+    for (guint i = 0; i < TEST_SNAPSHOT_READERS; i++) {
+        g_thread_join(readers[i]);
+    }
+
+    g_test_message("%" G_GUINT64_FORMAT " snapshots read during %d ticks", test.reads,
+                   TEST_SNAPSHOT_TICKS);
+    g_assert_cmpuint(test.reads, >, 0);
+    g_assert_cmpuint(test.torn_reads, ==, 0);
+    g_assert_cmpint(tm_get_remaining_time_ms(test.timer), ==,
+                    (gint64) (TEST_SNAPSHOT_MINUTES * 60 * 1000) - TEST_SNAPSHOT_TICKS);
+
+    tm_free(test.timer);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+    g_test_add_func("/timer/expires-while-owner-stalls", test_expires_while_owner_stalls);
+    g_test_add_func("/timer/session-rings-while-owner-stalls",
+                    test_session_rings_while_owner_stalls);
+    g_test_add_func("/timer/thread-starts-on-first-run", test_thread_starts_on_first_run);
+    g_test_add_func("/timer/snapshot-no-torn-reads", test_snapshot_no_torn_reads);
+
+    return g_test_run();
+}
@@ -0,0 +1,385 @@
+/* test-tray.c
+ *
+ * Copyright 2025 Suyog Tandel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*  The StatusNotifierItem against a stand-in org.kde.StatusNotifierWatcher on a private bus: the
+    item registers with the watcher, and again when a restarted watcher comes back, serves its
+    icon, sends NewIcon only when the quantized ring changes, and its secondary action starts and
+    pauses the timer through the application actions. An item that cannot be exported is cleaned
+    up without touching the session manager.
+*/
+
+#include <gio/gio.h>
+#include "samaya-actions.h"
+#include "samaya-tray.h"
+#include "test-common.h"
+
+#define TEST_APP_ID "io.github.redddfoxxyy.samaya.TrayTest"
+#define TEST_WATCHER_NAME "org.kde.StatusNotifierWatcher"
+#define TEST_WATCHER_PATH "/StatusNotifierWatcher"
+#define TEST_ITEM_PATH "/StatusNotifierItem"
+#define TEST_ITEM_INTERFACE "org.kde.StatusNotifierItem"
+#define TEST_ICON_SIZE 24
+// The ring is quantized to 60 steps. A session walks through each of them once, plus the jumps
+// when it starts and when the icon switches to the next routine.
+#define TEST_MAX_ICON_UPDATES (60 + 2)
+
+static const gchar watcherInterfaceXml[] =
+    "<node>"
+    "  <interface name='" TEST_WATCHER_NAME "'>"
+    "    <method name='RegisterStatusNotifierItem'>"
+    "      <arg name='service' type='s' direction='in'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+// Takes the item path first, so exporting the item fails.
+static const gchar takenItemXml[] = "<node><interface name='" TEST_ITEM_INTERFACE "'/></node>";
+
+typedef struct
+{
+    TestSession session;
+    GTestDBus *bus;
+    GApplication *app;
+
+    GDBusConnection *tray_connection;
+    TrayPtr tray;
+
+    // The stand-in watcher, which also listens to the item like a panel would.
+    GDBusConnection *watcher_connection;
+    GDBusNodeInfo *watcher_info;
+    guint watcher_registration_id;
+    guint watcher_owner_id;
+    gboolean watcher_owned;
+    guint registrations;
+    gchar *registered_service;
+
+    guint icon_subscription;
+    guint icon_updates;
+} TrayTest;
+
+typedef struct
+{
+    GVariant *reply;
+    GError *error;
+    gboolean done;
+} TrayCall;
+
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static GDBusConnection *connect_test_bus(TrayTest *test)
+{
+    g_autoptr(GError) error = NULL;
+    GDBusConnection *connection = g_dbus_connection_new_for_address_sync(
+        g_test_dbus_get_bus_address(test->bus),
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, &error);
+
+    g_assert_no_error(error);
+    return connection;
+}
+
+static void watcher_method_call(GDBusConnection *connection, const gchar *sender,
+                                const gchar *object_path, const gchar *interface_name,
+                                const gchar *method_name, GVariant *parameters,
+                                GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    TrayTest *test = user_data;
+
+    test->registrations++;
+    g_free(test->registered_service);
+    g_variant_get(parameters, "(s)", &test->registered_service);
+
+    g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+static const GDBusInterfaceVTable watcherInterfaceVTable = {
+    .method_call = watcher_method_call,
+};
+
+static void on_watcher_name_acquired(GDBusConnection *connection, const gchar *name,
+                                     gpointer user_data)
+{
+    TrayTest *test = user_data;
+    test->watcher_owned = TRUE;
+}
+
+static void wait_until(const gboolean *condition)
+{
+    while (!*condition) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+}
+
+static void own_watcher_name(TrayTest *test)
+{
+    test->watcher_owned = FALSE;
+    test->watcher_owner_id = g_bus_own_name_on_connection(
+        test->watcher_connection, TEST_WATCHER_NAME, G_BUS_NAME_OWNER_FLAGS_NONE,
+        on_watcher_name_acquired, NULL, test, NULL);
+    wait_until(&test->watcher_owned);
+}
+
+static void on_icon_changed(GDBusConnection *connection, const gchar *sender,
+                            const gchar *object_path, const gchar *interface_name,
+                            const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    TrayTest *test = user_data;
+    test->icon_updates++;
+}
+
+static void on_call_done(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    TrayCall *call = user_data;
+
+    call->reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), result, &call->error);
+    call->done = TRUE;
+}
+
+/*  Calls method on the item from the watcher connection and waits for the reply. Signals the item
+    sent before it are handled by then, as the bus keeps the messages of a sender in order.
+*/
+static GVariant *call_item(TrayTest *test, const gchar *interface_name, const gchar *method,
+                           GVariant *parameters)
+{
+    TrayCall call = {0};
+
+    g_dbus_connection_call(test->watcher_connection,
+                           g_dbus_connection_get_unique_name(test->tray_connection),
+                           TEST_ITEM_PATH, interface_name, method, parameters, NULL,
+                           G_DBUS_CALL_FLAGS_NONE, -1, NULL, on_call_done, &call);
+    wait_until(&call.done);
+
+    g_assert_no_error(call.error);
+    return call.reply;
+}
+
+static void tray_test_init(TrayTest *test)
+{
+    test_session_init(&test->session, FALSE);
+
+    test->bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(test->bus);
+
+    test->app = g_application_new(TEST_APP_ID, G_APPLICATION_NON_UNIQUE);
+    actions_add_timer_actions(G_ACTION_MAP(test->app), test->session.session_manager);
+
+    test->watcher_connection = connect_test_bus(test);
+    test->watcher_info = g_dbus_node_info_new_for_xml(watcherInterfaceXml, NULL);
+    test->watcher_registration_id = g_dbus_connection_register_object(
+        test->watcher_connection, TEST_WATCHER_PATH, test->watcher_info->interfaces[0],
+        &watcherInterfaceVTable, test, NULL, NULL);
+    g_assert_cmpuint(test->watcher_registration_id, !=, 0);
+
+    test->icon_subscription = g_dbus_connection_signal_subscribe(
+        test->watcher_connection, NULL, TEST_ITEM_INTERFACE, "NewIcon", TEST_ITEM_PATH, NULL,
+        G_DBUS_SIGNAL_FLAGS_NONE, on_icon_changed, test, NULL);
+
+    test->tray_connection = connect_test_bus(test);
+}
+
+static void tray_test_clear(TrayTest *test)
+{
+    g_clear_pointer(&test->tray, tray_free);
+    g_clear_object(&test->tray_connection);
+
+    if (test->watcher_owner_id != 0) {
+        g_bus_unown_name(test->watcher_owner_id);
+    }
+    g_dbus_connection_signal_unsubscribe(test->watcher_connection, test->icon_subscription);
+    g_dbus_connection_unregister_object(test->watcher_connection, test->watcher_registration_id);
+    g_clear_pointer(&test->watcher_info, g_dbus_node_info_unref);
+    g_clear_object(&test->watcher_connection);
+    g_clear_pointer(&test->registered_service, g_free);
+
+    g_clear_object(&test->app);
+    g_test_dbus_down(test->bus);
+    g_clear_object(&test->bus);
+    test_session_clear(&test->session);
+}
+
+static void wait_for_registrations(TrayTest *test, guint registrations)
+{
+    while (test->registrations < registrations) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+}
+
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+static void test_registers_with_watcher(void)
+{
+    TrayTest test = {0};
+    tray_test_init(&test);
+
+    own_watcher_name(&test);
+    test.tray = tray_new(test.session.session_manager, test.app, test.tray_connection);
+    g_assert_nonnull(test.tray);
+
+    wait_for_registrations(&test, 1);
+    g_assert_cmpstr(test.registered_service, ==,
+                    g_dbus_connection_get_unique_name(test.tray_connection));
+
+    // A restarted panel forgets its items, the item registers with the new watcher.
+    g_bus_unown_name(test.watcher_owner_id);
+    test.watcher_owner_id = 0;
+    own_watcher_name(&test);
+    wait_for_registrations(&test, 2);
+    g_assert_cmpuint(test.registrations, ==, 2);
+
+    tray_test_clear(&test);
+}
+
+static void test_registers_when_watcher_appears(void)
+{
+    TrayTest test = {0};
+    tray_test_init(&test);
+
+    // No panel yet, the item waits for one.
+    test.tray = tray_new(test.session.session_manager, test.app, test.tray_connection);
+    g_assert_nonnull(test.tray);
+    g_assert_cmpuint(test.registrations, ==, 0);
+
+    own_watcher_name(&test);
+    wait_for_registrations(&test, 1);
+
+    tray_test_clear(&test);
+}
+
+static void test_icon_updates_are_quantized(void)
+{
+    TrayTest test = {0};
+    tray_test_init(&test);
+    own_watcher_name(&test);
+    test.tray = tray_new(test.session.session_manager, test.app, test.tray_connection);
+
+    g_autoptr(GVariant) reply =
+        call_item(&test, "org.freedesktop.DBus.Properties", "Get",
+                  g_variant_new("(ss)", TEST_ITEM_INTERFACE, "IconPixmap"));
+    g_autoptr(GVariant) value = NULL;
+    g_variant_get(reply, "(v)", &value);
+    g_assert_true(g_variant_is_of_type(value, G_VARIANT_TYPE("a(iiay)")));
+    g_assert_cmpuint(g_variant_n_children(value), ==, 1);
+
+    g_autoptr(GVariant) pixmap = g_variant_get_child_value(value, 0);
+    g_autoptr(GVariant) pixels = g_variant_get_child_value(pixmap, 2);
+    gint32 width;
+    gint32 height;
+    g_variant_get_child(pixmap, 0, "i", &width);
+    g_variant_get_child(pixmap, 1, "i", &height);
+    g_assert_cmpint(width, ==, TEST_ICON_SIZE);
+    g_assert_cmpint(height, ==, TEST_ICON_SIZE);
+    g_assert_cmpuint(g_variant_get_size(pixels), ==, TEST_ICON_SIZE * TEST_ICON_SIZE * 4);
+
+    // A 25 minute session ticks 1500 times, the icon only changes with the quantized ring.
+    sm_trigger_event(test.session.session_manager, EvStart);
+    guint ticks = test_session_run_out(&test.session);
+    g_autoptr(GVariant) ping = call_item(&test, "org.freedesktop.DBus.Peer", "Ping", NULL);
+
+    g_test_message("%u ticks sent %u icon updates", ticks, test.icon_updates);
+    g_assert_cmpuint(ticks, >, TEST_MAX_ICON_UPDATES);
+    g_assert_cmpuint(test.icon_updates, >, 0);
+    g_assert_cmpuint(test.icon_updates, <=, TEST_MAX_ICON_UPDATES);
+
+    tray_test_clear(&test);
+}
+
+static void test_keeps_ticks_for_the_ring(void)
+{
+    TrayTest test = {0};
+    tray_test_init(&test);
+    SessionManagerPtr session_manager = test.session.session_manager;
+
+    // Nothing shows seconds, but the ring of a 25 minute session still moves every 25 seconds.
+    sm_set_time_resolution(session_manager, TM_TICK_INTERVAL_MINUTES);
+    g_assert_cmpuint(tm_get_tick_interval(test.session.timer), ==, TM_TICK_INTERVAL_MINUTES);
+
+    test.tray = tray_new(session_manager, test.app, test.tray_connection);
+    g_assert_cmpuint(tm_get_tick_interval(test.session.timer), ==, 25 * 1000);
+
+    // A short break moves it every 5 seconds.
+    sm_set_routine(ShortBreak, session_manager);
+    g_assert_cmpuint(tm_get_tick_interval(test.session.timer), ==, 5 * 1000);
+
+    g_clear_pointer(&test.tray, tray_free);
+    g_assert_cmpuint(tm_get_tick_interval(test.session.timer), ==, TM_TICK_INTERVAL_MINUTES);
+
+    tray_test_clear(&test);
+}
+
+static void test_secondary_activate_toggles_timer(void)
+{
+    TrayTest test = {0};
+    tray_test_init(&test);
+    test.tray = tray_new(test.session.session_manager, test.app, test.tray_connection);
+
+    g_autoptr(GVariant) start =
+        call_item(&test, TEST_ITEM_INTERFACE, "SecondaryActivate", g_variant_new("(ii)", 0, 0));
+    g_assert_cmpint(tm_get_state(test.session.timer), ==, StRunning);
+
+    g_autoptr(GVariant) pause =
+        call_item(&test, TEST_ITEM_INTERFACE, "SecondaryActivate", g_variant_new("(ii)", 0, 0));
+    g_assert_cmpint(tm_get_state(test.session.timer), ==, StPaused);
+
+    tray_test_clear(&test);
+}
+
+static void test_export_failure(void)
+{
+    TrayTest test = {0};
+    tray_test_init(&test);
+
+    g_autoptr(GDBusNodeInfo) taken_info = g_dbus_node_info_new_for_xml(takenItemXml, NULL);
+    guint taken_id = g_dbus_connection_register_object(test.tray_connection, TEST_ITEM_PATH,
+                                                       taken_info->interfaces[0], NULL, NULL,
+                                                       NULL, NULL);
+    g_assert_cmpuint(taken_id, !=, 0);
+
+    // Freeing the half built item must not disconnect hooks it never connected, which would be
+    // a fatal critical here.
+    g_test_expect_message(NULL, G_LOG_LEVEL_WARNING, "Failed to export the tray icon*");
+    test.tray = tray_new(test.session.session_manager, test.app, test.tray_connection);
+    g_test_assert_expected_messages();
+    g_assert_null(test.tray);
+
+    g_dbus_connection_unregister_object(test.tray_connection, taken_id);
+    tray_test_clear(&test);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+    g_test_add_func("/tray/registers-with-watcher", test_registers_with_watcher);
+    g_test_add_func("/tray/registers-when-watcher-appears", test_registers_when_watcher_appears);
+    g_test_add_func("/tray/icon-updates-are-quantized", test_icon_updates_are_quantized);
+    g_test_add_func("/tray/keeps-ticks-for-the-ring", test_keeps_ticks_for_the_ring);
+    g_test_add_func("/tray/secondary-activate-toggles-timer",
+                    test_secondary_activate_toggles_timer);
+    g_test_add_func("/tray/export-failure", test_export_failure);
+
+    return g_test_run();
+}